@@ -0,0 +1,131 @@
+//--------------------------------------------------------------------------------------
+// Keyframe animation of a node hierarchy
+//--------------------------------------------------------------------------------------
+
+#include "Animation.h"
+
+#include <algorithm>
+
+
+//--------------------------------------------------------------------------------------
+// Node transforms
+//--------------------------------------------------------------------------------------
+
+// Convert a node transform to a matrix (scale, then rotate, then translate)
+CMatrix4x4 MatrixFromTransform(const NodeTransform& transform)
+{
+    CMatrix4x4 m = MatrixFromQuaternion(transform.rotation);
+    m.e00 *= transform.scale.x;  m.e01 *= transform.scale.x;  m.e02 *= transform.scale.x;
+    m.e10 *= transform.scale.y;  m.e11 *= transform.scale.y;  m.e12 *= transform.scale.y;
+    m.e20 *= transform.scale.z;  m.e21 *= transform.scale.z;  m.e22 *= transform.scale.z;
+    m.SetRow(3, transform.position);
+    return m;
+}
+
+// Split a matrix into position, rotation and scale. The matrix must not contain shear
+NodeTransform TransformFromMatrix(const CMatrix4x4& m)
+{
+    NodeTransform transform;
+    transform.position = m.GetPosition();
+    transform.scale = m.GetScale();
+
+    CMatrix4x4 rotation = MatrixIdentity();
+    rotation.SetRow(0, m.GetXAxis() * (1.0f / transform.scale.x));
+    rotation.SetRow(1, m.GetYAxis() * (1.0f / transform.scale.y));
+    rotation.SetRow(2, m.GetZAxis() * (1.0f / transform.scale.z));
+
+    // A mirrored matrix can't be held in a quaternion, move the mirroring into the scale
+    if (Dot(Cross(rotation.GetXAxis(), rotation.GetYAxis()), rotation.GetZAxis()) < 0)
+    {
+        transform.scale.z = -transform.scale.z;
+        rotation.SetRow(2, rotation.GetZAxis() * -1.0f);
+    }
+    transform.rotation = QuaternionFromMatrix(rotation);
+    return transform;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Sampling
+//--------------------------------------------------------------------------------------
+namespace
+{
+    // Find the key at or before the given time, and the fraction of the way to the next key
+    template <typename Key>
+    unsigned int FindKey(const std::vector<Key>& keys, float time, float& t)
+    {
+        auto next = std::upper_bound(keys.begin(), keys.end(), time, [](float time, const Key& key) { return time < key.time; });
+        if (next == keys.begin())
+        {
+            t = 0;
+            return 0;
+        }
+        unsigned int index = static_cast<unsigned int>(next - keys.begin()) - 1;
+        if (next == keys.end())
+        {
+            t = 0;
+            return index;
+        }
+        float gap = next->time - keys[index].time;
+        t = (gap > 0) ? (time - keys[index].time) / gap : 0;
+        return index;
+    }
+}
+
+
+// Sample a list of keys at the given time (seconds), interpolating between keys. Times outside the keys are clamped
+CVector3 SampleKeys(const std::vector<VectorKey>& keys, float time)
+{
+    float t;
+    unsigned int i = FindKey(keys, time, t);
+    if (t == 0)  return keys[i].value;
+    return keys[i].value + (keys[i + 1].value - keys[i].value) * t;
+}
+
+CQuaternion SampleKeys(const std::vector<QuaternionKey>& keys, float time)
+{
+    float t;
+    unsigned int i = FindKey(keys, time, t);
+    if (t == 0)  return keys[i].value;
+    return Nlerp(keys[i].value, keys[i + 1].value, t); // Keys are close together so nlerp is indistinguishable from slerp
+}
+
+
+// Wrap a time into the range 0 -> duration if looping, or clamp it to that range if not
+float ClipTime(float time, float duration, bool loop)
+{
+    if (duration <= 0)  return 0;
+    if (loop)
+    {
+        time = std::fmod(time, duration);
+        return (time < 0) ? time + duration : time;
+    }
+    return std::min(std::max(time, 0.0f), duration);
+}
+
+
+// Sample a clip at the given time (seconds), wrapping the time if looping or clamping to the ends otherwise
+// Only the nodes with tracks in the clip are written to the pose, which must have an entry for every node
+void SampleAnimation(const AnimationClip& clip, float time, bool loop, NodeTransform* pose)
+{
+    time = ClipTime(time, clip.duration, loop);
+    for (auto& track : clip.tracks)
+    {
+        auto& transform = pose[track.node];
+        if (!track.positionKeys.empty())  transform.position = SampleKeys(track.positionKeys, time);
+        if (!track.rotationKeys.empty())  transform.rotation = SampleKeys(track.rotationKeys, time);
+        if (!track.scaleKeys.empty())     transform.scale    = SampleKeys(track.scaleKeys,    time);
+    }
+}
+
+
+// Blend between two poses, weight 0 gives pose1 and 1 gives pose2. The result can be the same array as either input
+void BlendPoses(const NodeTransform* pose1, const NodeTransform* pose2, float weight, unsigned int numNodes, NodeTransform* result)
+{
+    for (unsigned int n = 0; n < numNodes; ++n)
+    {
+        result[n].position = pose1[n].position + (pose2[n].position - pose1[n].position) * weight;
+        result[n].rotation = Nlerp(pose1[n].rotation, pose2[n].rotation, weight);
+        result[n].scale    = pose1[n].scale    + (pose2[n].scale    - pose1[n].scale)    * weight;
+    }
+}
@@ -0,0 +1,83 @@
+//--------------------------------------------------------------------------------------
+// Keyframe animation of a node hierarchy
+//--------------------------------------------------------------------------------------
+// An animation clip holds keyframe tracks for some of the nodes in a mesh. Sampling a clip
+// at a given time gives a pose: the position, rotation and scale of each node relative to
+// its parent. Poses from two clips can be blended, then converted to the node matrices used
+// by Model and Mesh. No DirectX in here so animations can be sampled (and tested) headless.
+
+#ifndef _ANIMATION_H_INCLUDED_
+#define _ANIMATION_H_INCLUDED_
+
+#include "CVector3.h"
+#include "CQuaternion.h"
+#include "CMatrix4x4.h"
+
+#include <string>
+#include <vector>
+
+
+// Position, rotation and scale of a node relative to its parent
+struct NodeTransform
+{
+    CVector3    position;
+    CQuaternion rotation;
+    CVector3    scale;
+};
+
+// Convert a node transform to a matrix (scale, then rotate, then translate)
+CMatrix4x4 MatrixFromTransform(const NodeTransform& transform);
+
+// Split a matrix into position, rotation and scale. The matrix must not contain shear
+NodeTransform TransformFromMatrix(const CMatrix4x4& m);
+
+
+// Keyframes, times are in seconds
+struct VectorKey
+{
+    float    time;
+    CVector3 value;
+};
+
+struct QuaternionKey
+{
+    float       time;
+    CQuaternion value;
+};
+
+
+// The keyframes for one node. Any of the key lists can be empty, then the node keeps that part of its current pose
+struct AnimationTrack
+{
+    unsigned int               node; // Index of the node in the mesh hierarchy
+    std::vector<VectorKey>     positionKeys;
+    std::vector<QuaternionKey> rotationKeys;
+    std::vector<VectorKey>     scaleKeys;
+};
+
+
+struct AnimationClip
+{
+    std::string                 name;
+    float                       duration = 0; // In seconds
+    std::vector<AnimationTrack> tracks;
+};
+
+
+// Sample a list of keys at the given time (seconds), interpolating between keys. Times outside the keys are clamped
+// The key list must not be empty
+CVector3    SampleKeys(const std::vector<VectorKey>& keys, float time);
+CQuaternion SampleKeys(const std::vector<QuaternionKey>& keys, float time);
+
+// Wrap a time into the range 0 -> duration if looping, or clamp it to that range if not
+float ClipTime(float time, float duration, bool loop);
+
+// Sample a clip at the given time (seconds), wrapping the time if looping or clamping to the ends otherwise
+// Only the nodes with tracks in the clip are written to the pose, which must have an entry for every node
+void SampleAnimation(const AnimationClip& clip, float time, bool loop, NodeTransform* pose);
+
+// Blend between two poses, weight 0 gives pose1 and 1 gives pose2. The result can be the same array as either input
+void BlendPoses(const NodeTransform* pose1, const NodeTransform* pose2, float weight, unsigned int numNodes, NodeTransform* result);
+
+
+#endif //_ANIMATION_H_INCLUDED_
@@ -0,0 +1,791 @@
+//--------------------------------------------------------------------------------------
+// Software decoding of block compressed (BC1-BC7) textures
+//--------------------------------------------------------------------------------------
+
+#include "BCDecoder.h"
+#include "ParallelFor.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define BCDECODER_USE_SSE
+#include <emmintrin.h>
+#endif
+
+
+namespace
+{
+    // The DXGI_FORMAT values decoded, so this file doesn't need the DirectX headers
+    const uint32_t FORMAT_BC1_UNORM      = 71;
+    const uint32_t FORMAT_BC1_UNORM_SRGB = 72;
+    const uint32_t FORMAT_BC2_UNORM      = 74;
+    const uint32_t FORMAT_BC2_UNORM_SRGB = 75;
+    const uint32_t FORMAT_BC3_UNORM      = 77;
+    const uint32_t FORMAT_BC3_UNORM_SRGB = 78;
+    const uint32_t FORMAT_BC4_UNORM      = 80;
+    const uint32_t FORMAT_BC4_SNORM      = 81;
+    const uint32_t FORMAT_BC5_UNORM      = 83;
+    const uint32_t FORMAT_BC5_SNORM      = 84;
+    const uint32_t FORMAT_BC6H_UF16      = 95;
+    const uint32_t FORMAT_BC6H_SF16      = 96;
+    const uint32_t FORMAT_BC7_UNORM      = 98;
+    const uint32_t FORMAT_BC7_UNORM_SRGB = 99;
+
+    // Block rows decoded per batch when decoding a whole mip over several threads
+    const unsigned int DECODE_BATCH_ROWS = 4;
+
+
+    //--------------------------------------------------------------------------------------
+    // Partition tables shared by BC6H and BC7
+    //--------------------------------------------------------------------------------------
+
+    // Two subset partitions, bit n set if texel n is in the second subset. BC6H uses the first 32
+    const uint16_t PARTITIONS_2[64] =
+    {
+        0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80, 0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+        0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce, 0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+        0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a, 0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+        0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c, 0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22,
+    };
+
+    // Three subset partitions, two bits per texel giving its subset, texel 0 in the lowest bits
+    const uint32_t PARTITIONS_3[64] =
+    {
+        0xaa685050, 0x6a5a5040, 0x5a5a4200, 0x5450a0a8, 0xa5a50000, 0xa0a05050, 0x5555a0a0, 0x5a5a5050,
+        0xaa550000, 0xaa555500, 0xaaaa5500, 0x90909090, 0x94949494, 0xa4a4a4a4, 0xa9a59450, 0x2a0a4250,
+        0xa5945040, 0x0a425054, 0xa5a5a500, 0x55a0a0a0, 0xa8a85454, 0x6a6a4040, 0xa4a45000, 0x1a1a0500,
+        0x0050a4a4, 0xaaa59090, 0x14696914, 0x69691400, 0xa08585a0, 0xaa821414, 0x50a4a450, 0x6a5a0200,
+        0xa9a58000, 0x5090a0a8, 0xa8a09050, 0x24242424, 0x00aa5500, 0x24924924, 0x24499224, 0x50a50a50,
+        0x500aa550, 0xaaaa4444, 0x66660000, 0xa5a0a5a0, 0x50a050a0, 0x69286928, 0x44aaaa44, 0x66666600,
+        0xaa444444, 0x54a854a8, 0x95809580, 0x96969600, 0xa85454a8, 0x80959580, 0xaa141414, 0x96960000,
+        0xaaaa1414, 0xa05050a0, 0xa0a5a5a0, 0x96000000, 0x40804080, 0xa9a8a9a8, 0xaaaaaa44, 0x2a4a5254,
+    };
+
+    // Index of the texel in the second subset whose top index bit is implied zero, for two subset partitions
+    const uint8_t ANCHORS_2[64] =
+    {
+        15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+        15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+        15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+         6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15,
+    };
+
+    // The same for the second and third subsets of three subset partitions
+    const uint8_t ANCHORS_3_SECOND[64] =
+    {
+         3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+         3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+         8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+         3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3,
+    };
+    const uint8_t ANCHORS_3_THIRD[64] =
+    {
+        15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+        15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+        15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+        15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8,
+    };
+
+    // Interpolation weights (out of 64) for 2, 3 and 4 bit indices
+    const uint8_t WEIGHTS_2[4]  = { 0, 21, 43, 64 };
+    const uint8_t WEIGHTS_3[8]  = { 0, 9, 18, 27, 37, 46, 55, 64 };
+    const uint8_t WEIGHTS_4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    const uint8_t* Weights(unsigned int indexBits)
+    {
+        return indexBits == 2 ? WEIGHTS_2 : (indexBits == 3 ? WEIGHTS_3 : WEIGHTS_4);
+    }
+
+    // Subset of a texel in a BC6H/BC7 partition
+    unsigned int Subset(unsigned int numSubsets, unsigned int partition, unsigned int texel)
+    {
+        if (numSubsets == 2)  return (PARTITIONS_2[partition] >> texel) & 1;
+        if (numSubsets == 3)  return (PARTITIONS_3[partition] >> (texel * 2)) & 3;
+        return 0;
+    }
+
+    // Whether a texel is the anchor of its subset, which stores one index bit fewer
+    bool IsAnchor(unsigned int numSubsets, unsigned int partition, unsigned int texel)
+    {
+        if (texel == 0)  return true;
+        if (numSubsets == 2)  return texel == ANCHORS_2[partition];
+        if (numSubsets == 3)  return texel == ANCHORS_3_SECOND[partition] || texel == ANCHORS_3_THIRD[partition];
+        return false;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Helpers
+    //--------------------------------------------------------------------------------------
+
+    // Reads fields from a 128-bit block, least significant bits first
+    class BlockBits
+    {
+    public:
+        BlockBits(const void* block)
+        {
+            std::memcpy(&mLow, block, 8);
+            std::memcpy(&mHigh, static_cast<const uint8_t*>(block) + 8, 8);
+        }
+
+        uint32_t Read(unsigned int count)
+        {
+            uint64_t bits = mPosition >= 64 ? mHigh >> (mPosition - 64)
+                                            : (mLow >> mPosition) | (mPosition > 0 ? mHigh << (64 - mPosition) : 0);
+            mPosition += count;
+            return static_cast<uint32_t>(bits & ((1ull << count) - 1));
+        }
+
+    private:
+        uint64_t     mLow;
+        uint64_t     mHigh;
+        unsigned int mPosition = 0;
+    };
+
+    uint16_t Load16(const uint8_t* data)  { return static_cast<uint16_t>(data[0] | (data[1] << 8)); }
+
+    uint32_t PackRGBA(int r, int g, int b, int a)
+    {
+        return static_cast<uint32_t>(r) | (static_cast<uint32_t>(g) << 8) | (static_cast<uint32_t>(b) << 16) | (static_cast<uint32_t>(a) << 24);
+    }
+
+    // Write 16 texels looked up from a palette of packed RGBA
+    void WriteTexels(const uint32_t* palette, const uint8_t indices[16], uint8_t texels[16][4])
+    {
+        uint32_t packed[16];
+        for (unsigned int i = 0; i < 16; ++i)  packed[i] = palette[indices[i]];
+        std::memcpy(texels, packed, sizeof(packed));
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // BC1-BC5
+    //--------------------------------------------------------------------------------------
+
+    // Decode the colour half of a BC1/2/3 block. In BC1, a first endpoint not greater than the second selects three
+    // colours and transparent black, BC2/3 always use four colours
+    void DecodeColourBlock(const uint8_t* block, bool allowTransparent, uint8_t texels[16][4])
+    {
+        uint16_t c0 = Load16(block), c1 = Load16(block + 2);
+        int r0 = (c0 >> 11) & 31, g0 = (c0 >> 5) & 63, b0 = c0 & 31;
+        int r1 = (c1 >> 11) & 31, g1 = (c1 >> 5) & 63, b1 = c1 & 31;
+        r0 = (r0 << 3) | (r0 >> 2);  g0 = (g0 << 2) | (g0 >> 4);  b0 = (b0 << 3) | (b0 >> 2);
+        r1 = (r1 << 3) | (r1 >> 2);  g1 = (g1 << 2) | (g1 >> 4);  b1 = (b1 << 3) | (b1 >> 2);
+
+        uint32_t palette[4];
+        palette[0] = PackRGBA(r0, g0, b0, 255);
+        palette[1] = PackRGBA(r1, g1, b1, 255);
+        if (c0 > c1 || !allowTransparent)
+        {
+#ifdef BCDECODER_USE_SSE
+            // Both thirds at once in 16-bit lanes: (2 * e0 + e1 + 1) / 3 and (e0 + 2 * e1 + 1) / 3, dividing by
+            // multiplying by 65536 / 3 and keeping the high half (exact for these small values)
+            __m128i e0 = _mm_setr_epi16(static_cast<short>(r0), static_cast<short>(g0), static_cast<short>(b0), 255,
+                                        static_cast<short>(r1), static_cast<short>(g1), static_cast<short>(b1), 255);
+            __m128i e1 = _mm_shuffle_epi32(e0, _MM_SHUFFLE(1, 0, 3, 2));
+            __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_add_epi16(e0, e0), e1), _mm_set1_epi16(1));
+            __m128i thirds = _mm_mulhi_epu16(sum, _mm_set1_epi16(21846));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(&palette[2]), _mm_packus_epi16(thirds, thirds));
+#else
+            palette[2] = PackRGBA((2 * r0 + r1 + 1) / 3, (2 * g0 + g1 + 1) / 3, (2 * b0 + b1 + 1) / 3, 255);
+            palette[3] = PackRGBA((r0 + 2 * r1 + 1) / 3, (g0 + 2 * g1 + 1) / 3, (b0 + 2 * b1 + 1) / 3, 255);
+#endif
+        }
+        else
+        {
+            palette[2] = PackRGBA((r0 + r1 + 1) / 2, (g0 + g1 + 1) / 2, (b0 + b1 + 1) / 2, 255);
+            palette[3] = 0;
+        }
+
+        uint32_t bits = static_cast<uint32_t>(block[4]) | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+        uint8_t indices[16];
+        for (unsigned int i = 0; i < 16; ++i)  indices[i] = (bits >> (i * 2)) & 3;
+        WriteTexels(palette, indices, texels);
+    }
+
+    // Decode a BC4 block (also the alpha of BC3 and each channel of BC5) into one channel of the texels. Eight
+    // interpolated values if the first endpoint is greater, otherwise six plus the two extremes
+    void DecodeChannelBlock(const uint8_t* block, bool isSigned, uint8_t texels[16][4], unsigned int channel)
+    {
+        int values[8];
+        int e0, e1, low, high;
+        if (isSigned)
+        {
+            // -128 is an alias for -127
+            e0 = std::max(static_cast<int>(static_cast<int8_t>(block[0])), -127);
+            e1 = std::max(static_cast<int>(static_cast<int8_t>(block[1])), -127);
+            low = -127;
+            high = 127;
+        }
+        else
+        {
+            e0 = block[0];
+            e1 = block[1];
+            low = 0;
+            high = 255;
+        }
+
+        values[0] = e0;
+        values[1] = e1;
+        if (e0 > e1)
+        {
+            for (int i = 1; i < 7; ++i)  values[i + 1] = ((7 - i) * e0 + i * e1 + (e0 * (7 - i) + i * e1 >= 0 ? 3 : -3)) / 7;
+        }
+        else
+        {
+            for (int i = 1; i < 5; ++i)  values[i + 1] = ((5 - i) * e0 + i * e1 + ((5 - i) * e0 + i * e1 >= 0 ? 2 : -2)) / 5;
+            values[6] = low;
+            values[7] = high;
+        }
+        if (isSigned)
+        {
+            // Bias to unsigned so that -1 -> 1, 0 -> 128, 1 -> 255
+            for (auto& value : values)  value += 128;
+        }
+
+        uint64_t bits = 0;
+        for (int i = 7; i >= 2; --i)  bits = (bits << 8) | block[i];
+        for (unsigned int i = 0; i < 16; ++i)  texels[i][channel] = static_cast<uint8_t>(values[(bits >> (i * 3)) & 7]);
+    }
+
+    void DecodeBC2Alpha(const uint8_t* block, uint8_t texels[16][4])
+    {
+        for (unsigned int i = 0; i < 16; ++i)
+        {
+            unsigned int alpha = (block[i / 2] >> ((i & 1) * 4)) & 15;
+            texels[i][3] = static_cast<uint8_t>(alpha * 17);
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // BC7
+    //--------------------------------------------------------------------------------------
+
+    struct BC7Mode
+    {
+        uint8_t numSubsets;
+        uint8_t partitionBits;
+        uint8_t rotationBits;
+        uint8_t indexSelectionBits;
+        uint8_t colourBits;
+        uint8_t alphaBits;
+        uint8_t endpointPBits;  // One p-bit per endpoint
+        uint8_t sharedPBits;    // One p-bit per subset
+        uint8_t indexBits;
+        uint8_t index2Bits;     // Separate alpha (or colour, if selected) indices
+    };
+
+    const BC7Mode BC7_MODES[8] =
+    {
+        { 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+        { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+        { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+        { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+        { 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+        { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+        { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+        { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+    };
+
+    // Expand a value of some bits to 8 by repeating its top bits below it
+    int Expand(int value, unsigned int bits)
+    {
+        value <<= (8 - bits);
+        return value | (value >> bits);
+    }
+
+    // Fill a palette interpolating between two RGBA endpoints with the weights for an index size
+    void BC7Palette(const int e0[4], const int e1[4], unsigned int indexBits, uint32_t* palette)
+    {
+        const uint8_t* weights = Weights(indexBits);
+        unsigned int size = 1u << indexBits;
+#ifdef BCDECODER_USE_SSE
+        // Two palette entries per register in 16-bit lanes: (e0 * (64 - w) + e1 * w + 32) >> 6
+        __m128i low  = _mm_setr_epi16(static_cast<short>(e0[0]), static_cast<short>(e0[1]), static_cast<short>(e0[2]), static_cast<short>(e0[3]),
+                                      static_cast<short>(e0[0]), static_cast<short>(e0[1]), static_cast<short>(e0[2]), static_cast<short>(e0[3]));
+        __m128i high = _mm_setr_epi16(static_cast<short>(e1[0]), static_cast<short>(e1[1]), static_cast<short>(e1[2]), static_cast<short>(e1[3]),
+                                      static_cast<short>(e1[0]), static_cast<short>(e1[1]), static_cast<short>(e1[2]), static_cast<short>(e1[3]));
+        for (unsigned int i = 0; i < size; i += 2)
+        {
+            __m128i w = _mm_unpacklo_epi64(_mm_set1_epi16(weights[i]), _mm_set1_epi16(weights[i + 1]));
+            __m128i sum = _mm_add_epi16(_mm_mullo_epi16(low, _mm_sub_epi16(_mm_set1_epi16(64), w)), _mm_mullo_epi16(high, w));
+            __m128i value = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(32)), 6);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(&palette[i]), _mm_packus_epi16(value, value));
+        }
+#else
+        for (unsigned int i = 0; i < size; ++i)
+        {
+            int w = weights[i];
+            int c[4];
+            for (int j = 0; j < 4; ++j)  c[j] = (e0[j] * (64 - w) + e1[j] * w + 32) >> 6;
+            palette[i] = PackRGBA(c[0], c[1], c[2], c[3]);
+        }
+#endif
+    }
+
+    void DecodeBC7Block(const uint8_t* block, uint8_t texels[16][4])
+    {
+        // The mode is the position of the lowest set bit of the first byte, a block with no mode decodes to zero
+        unsigned int modeIndex = 0;
+        while (modeIndex < 8 && !(block[0] & (1 << modeIndex)))  ++modeIndex;
+        if (modeIndex == 8)
+        {
+            std::memset(texels, 0, 16 * 4);
+            return;
+        }
+        const BC7Mode& mode = BC7_MODES[modeIndex];
+
+        BlockBits bits(block);
+        bits.Read(modeIndex + 1);
+        unsigned int partition = bits.Read(mode.partitionBits);
+        unsigned int rotation = bits.Read(mode.rotationBits);
+        unsigned int indexSelection = bits.Read(mode.indexSelectionBits);
+
+        // Endpoints are stored channel by channel, each subset's pair in turn
+        int endpoints[6][4];
+        unsigned int numEndpoints = mode.numSubsets * 2;
+        for (unsigned int channel = 0; channel < 3; ++channel)
+        {
+            for (unsigned int e = 0; e < numEndpoints; ++e)  endpoints[e][channel] = bits.Read(mode.colourBits);
+        }
+        for (unsigned int e = 0; e < numEndpoints; ++e)  endpoints[e][3] = mode.alphaBits ? bits.Read(mode.alphaBits) : 255;
+
+        // P-bits add a shared lowest bit to every channel of an endpoint (or of both endpoints of a subset)
+        unsigned int colourBits = mode.colourBits, alphaBits = mode.alphaBits;
+        if (mode.endpointPBits || mode.sharedPBits)
+        {
+            unsigned int pBits[6];
+            if (mode.endpointPBits)  for (unsigned int e = 0; e < numEndpoints; ++e)  pBits[e] = bits.Read(1);
+            else                     for (unsigned int s = 0; s < mode.numSubsets; ++s)  pBits[s * 2] = pBits[s * 2 + 1] = bits.Read(1);
+
+            for (unsigned int e = 0; e < numEndpoints; ++e)
+            {
+                for (unsigned int channel = 0; channel < 4; ++channel)
+                {
+                    if (channel < 3 || mode.alphaBits)  endpoints[e][channel] = (endpoints[e][channel] << 1) | pBits[e];
+                }
+            }
+            ++colourBits;
+            if (alphaBits)  ++alphaBits;
+        }
+        for (unsigned int e = 0; e < numEndpoints; ++e)
+        {
+            for (unsigned int channel = 0; channel < 3; ++channel)  endpoints[e][channel] = Expand(endpoints[e][channel], colourBits);
+            if (alphaBits)  endpoints[e][3] = Expand(endpoints[e][3], alphaBits);
+        }
+
+        // Indices, anchors have their top bit implied zero. Then the second set of indices for modes 4 and 5
+        uint8_t indices[16], indices2[16];
+        for (unsigned int i = 0; i < 16; ++i)
+        {
+            indices[i] = static_cast<uint8_t>(bits.Read(mode.indexBits - (IsAnchor(mode.numSubsets, partition, i) ? 1 : 0)));
+        }
+        if (mode.index2Bits)
+        {
+            for (unsigned int i = 0; i < 16; ++i)  indices2[i] = static_cast<uint8_t>(bits.Read(mode.index2Bits - (i == 0 ? 1 : 0)));
+        }
+
+        uint32_t packed[16];
+        if (mode.index2Bits)
+        {
+            // Colour and alpha use separate indices, swapped by the index selection bit
+            unsigned int colourIndexBits = indexSelection ? mode.index2Bits : mode.indexBits;
+            unsigned int alphaIndexBits  = indexSelection ? mode.indexBits : mode.index2Bits;
+            const uint8_t* colourIndices = indexSelection ? indices2 : indices;
+            const uint8_t* alphaIndices  = indexSelection ? indices : indices2;
+            uint32_t colourPalette[8], alphaPalette[8];
+            BC7Palette(endpoints[0], endpoints[1], colourIndexBits, colourPalette);
+            BC7Palette(endpoints[0], endpoints[1], alphaIndexBits, alphaPalette);
+            for (unsigned int i = 0; i < 16; ++i)
+            {
+                packed[i] = (colourPalette[colourIndices[i]] & 0x00ffffff) | (alphaPalette[alphaIndices[i]] & 0xff000000);
+            }
+        }
+        else
+        {
+            uint32_t palettes[3][16];
+            for (unsigned int s = 0; s < mode.numSubsets; ++s)  BC7Palette(endpoints[s * 2], endpoints[s * 2 + 1], mode.indexBits, palettes[s]);
+            for (unsigned int i = 0; i < 16; ++i)  packed[i] = palettes[Subset(mode.numSubsets, partition, i)][indices[i]];
+        }
+
+        // Rotation swaps alpha with one of the colour channels, letting that channel have the separate indices
+        if (rotation)
+        {
+            unsigned int shift = (rotation - 1) * 8;
+            for (auto& texel : packed)
+            {
+                uint32_t alpha = texel >> 24, other = (texel >> shift) & 0xff;
+                texel = (texel & ~(0xffu << shift) & 0x00ffffff) | (alpha << shift) | (other << 24);
+            }
+        }
+        std::memcpy(texels, packed, sizeof(packed));
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // BC6H
+    //--------------------------------------------------------------------------------------
+
+    // Endpoint fields: W and X are the first subset's pair, Y and Z the second's. Field / 3 is the endpoint, % 3 the channel
+    enum BC6HField : uint8_t { RW, GW, BW, RX, GX, BX, RY, GY, BY, RZ, GZ, BZ };
+
+    // Bits read into a field: count bits from the stream placed at shift upwards
+    struct BC6HBits
+    {
+        uint8_t field;
+        uint8_t shift;
+        uint8_t count;
+    };
+
+    const unsigned int BC6H_MAX_FIELDS = 24;
+
+    struct BC6HMode
+    {
+        uint8_t  modeBits;       // Value of the mode bits, 2 or 5 of them
+        uint8_t  numSubsets;
+        bool     transformed;    // Other endpoints are stored as differences from the first
+        uint8_t  endpointBits;
+        uint8_t  deltaBits[3];   // Bits of the differences for each channel
+        BC6HBits fields[BC6H_MAX_FIELDS];
+    };
+
+    // The endpoint bits of each mode are scattered through the block, listed here in the order they are stored
+    const BC6HMode BC6H_MODES[] =
+    {
+        { 0x00, 2, true, 10, { 5, 5, 5 },
+          { {GY,4,1}, {BY,4,1}, {BZ,4,1}, {RW,0,10}, {GW,0,10}, {BW,0,10}, {RX,0,5}, {GZ,4,1}, {GY,0,4}, {GX,0,5}, {BZ,0,1},
+            {GZ,0,4}, {BX,0,5}, {BZ,1,1}, {BY,0,4}, {RY,0,5}, {BZ,2,1}, {RZ,0,5}, {BZ,3,1} } },
+        { 0x01, 2, true, 7, { 6, 6, 6 },
+          { {GY,5,1}, {GZ,4,1}, {GZ,5,1}, {RW,0,7}, {BZ,0,1}, {BZ,1,1}, {BY,4,1}, {GW,0,7}, {BY,5,1}, {BZ,2,1}, {GY,4,1},
+            {BW,0,7}, {BZ,3,1}, {BZ,5,1}, {BZ,4,1}, {RX,0,6}, {GY,0,4}, {GX,0,6}, {GZ,0,4}, {BX,0,6}, {BY,0,4}, {RY,0,6}, {RZ,0,6} } },
+        { 0x02, 2, true, 11, { 5, 4, 4 },
+          { {RW,0,10}, {GW,0,10}, {BW,0,10}, {RX,0,5}, {RW,10,1}, {GY,0,4}, {GX,0,4}, {GW,10,1}, {BZ,0,1}, {GZ,0,4}, {BX,0,4},
+            {BW,10,1}, {BZ,1,1}, {BY,0,4}, {RY,0,5}, {BZ,2,1}, {RZ,0,5}, {BZ,3,1} } },
+        { 0x06, 2, true, 11, { 4, 5, 4 },
+          { {RW,0,10}, {GW,0,10}, {BW,0,10}, {RX,0,4}, {RW,10,1}, {GZ,4,1}, {GY,0,4}, {GX,0,5}, {GW,10,1}, {GZ,0,4}, {BX,0,4},
+            {BW,10,1}, {BZ,1,1}, {BY,0,4}, {RY,0,4}, {BZ,0,1}, {BZ,2,1}, {RZ,0,4}, {GY,4,1}, {BZ,3,1} } },
+        { 0x0a, 2, true, 11, { 4, 4, 5 },
+          { {RW,0,10}, {GW,0,10}, {BW,0,10}, {RX,0,4}, {RW,10,1}, {BY,4,1}, {GY,0,4}, {GX,0,4}, {GW,10,1}, {BZ,0,1}, {GZ,0,4},
+            {BX,0,5}, {BW,10,1}, {BY,0,4}, {RY,0,4}, {BZ,1,1}, {BZ,2,1}, {RZ,0,4}, {BZ,4,1}, {BZ,3,1} } },
+        { 0x0e, 2, true, 9, { 5, 5, 5 },
+          { {RW,0,9}, {BY,4,1}, {GW,0,9}, {GY,4,1}, {BW,0,9}, {BZ,4,1}, {RX,0,5}, {GZ,4,1}, {GY,0,4}, {GX,0,5}, {BZ,0,1},
+            {GZ,0,4}, {BX,0,5}, {BZ,1,1}, {BY,0,4}, {RY,0,5}, {BZ,2,1}, {RZ,0,5}, {BZ,3,1} } },
+        { 0x12, 2, true, 8, { 6, 5, 5 },
+          { {RW,0,8}, {GZ,4,1}, {BY,4,1}, {GW,0,8}, {BZ,2,1}, {GY,4,1}, {BW,0,8}, {BZ,3,1}, {BZ,4,1}, {RX,0,6}, {GY,0,4},
+            {GX,0,5}, {BZ,0,1}, {GZ,0,4}, {BX,0,5}, {BZ,1,1}, {BY,0,4}, {RY,0,6}, {RZ,0,6} } },
+        { 0x16, 2, true, 8, { 5, 6, 5 },
+          { {RW,0,8}, {BZ,0,1}, {BY,4,1}, {GW,0,8}, {GY,5,1}, {GY,4,1}, {BW,0,8}, {GZ,5,1}, {BZ,4,1}, {RX,0,5}, {GZ,4,1},
+            {GY,0,4}, {GX,0,6}, {GZ,0,4}, {BX,0,5}, {BZ,1,1}, {BY,0,4}, {RY,0,5}, {BZ,2,1}, {RZ,0,5}, {BZ,3,1} } },
+        { 0x1a, 2, true, 8, { 5, 5, 6 },
+          { {RW,0,8}, {BZ,1,1}, {BY,4,1}, {GW,0,8}, {BY,5,1}, {GY,4,1}, {BW,0,8}, {BZ,5,1}, {BZ,4,1}, {RX,0,5}, {GZ,4,1},
+            {GY,0,4}, {GX,0,5}, {BZ,0,1}, {GZ,0,4}, {BX,0,6}, {BY,0,4}, {RY,0,5}, {BZ,2,1}, {RZ,0,5}, {BZ,3,1} } },
+        { 0x1e, 2, false, 6, { 6, 6, 6 },
+          { {RW,0,6}, {GZ,4,1}, {BZ,0,1}, {BZ,1,1}, {BY,4,1}, {GW,0,6}, {GY,5,1}, {BY,5,1}, {BZ,2,1}, {GY,4,1}, {BW,0,6},
+            {GZ,5,1}, {BZ,3,1}, {BZ,5,1}, {BZ,4,1}, {RX,0,6}, {GY,0,4}, {GX,0,6}, {GZ,0,4}, {BX,0,6}, {BY,0,4}, {RY,0,6}, {RZ,0,6} } },
+        { 0x03, 1, false, 10, { 10, 10, 10 },
+          { {RW,0,10}, {GW,0,10}, {BW,0,10}, {RX,0,10}, {GX,0,10}, {BX,0,10} } },
+        { 0x07, 1, true, 11, { 9, 9, 9 },
+          { {RW,0,10}, {GW,0,10}, {BW,0,10}, {RX,0,9}, {RW,10,1}, {GX,0,9}, {GW,10,1}, {BX,0,9}, {BW,10,1} } },
+        // The top bits of the first endpoint in the last two modes are stored in reverse order
+        { 0x0b, 1, true, 12, { 8, 8, 8 },
+          { {RW,0,10}, {GW,0,10}, {BW,0,10}, {RX,0,8}, {RW,11,1}, {RW,10,1}, {GX,0,8}, {GW,11,1}, {GW,10,1},
+            {BX,0,8}, {BW,11,1}, {BW,10,1} } },
+        { 0x0f, 1, true, 16, { 4, 4, 4 },
+          { {RW,0,10}, {GW,0,10}, {BW,0,10}, {RX,0,4}, {RW,15,1}, {RW,14,1}, {RW,13,1}, {RW,12,1}, {RW,11,1}, {RW,10,1},
+            {GX,0,4}, {GW,15,1}, {GW,14,1}, {GW,13,1}, {GW,12,1}, {GW,11,1}, {GW,10,1},
+            {BX,0,4}, {BW,15,1}, {BW,14,1}, {BW,13,1}, {BW,12,1}, {BW,11,1}, {BW,10,1} } },
+    };
+
+    int SignExtend(int value, unsigned int bits)
+    {
+        int shift = 32 - static_cast<int>(bits);
+        return static_cast<int>(static_cast<uint32_t>(value) << shift) >> shift;
+    }
+
+    // Scale a stored endpoint up to 16 bits (or 15 plus sign), ready for interpolation
+    int Unquantise(int value, unsigned int bits, bool isSigned)
+    {
+        if (!isSigned)
+        {
+            if (bits >= 15 || value == 0)  return value;
+            if (value == (1 << bits) - 1)  return 0xffff;
+            return ((value << 16) + 0x8000) >> bits;
+        }
+
+        if (bits >= 16)  return value;
+        bool negative = value < 0;
+        int magnitude = negative ? -value : value;
+        int result;
+        if (magnitude == 0)                              result = 0;
+        else if (magnitude >= (1 << (bits - 1)) - 1)     result = 0x7fff;
+        else                                             result = ((magnitude << 15) + 0x4000) >> (bits - 1);
+        return negative ? -result : result;
+    }
+
+    // Scale an interpolated value to the bits of a half float (31/64 of the range keeps it finite)
+    uint16_t FinishUnquantise(int value, bool isSigned)
+    {
+        if (!isSigned)  return static_cast<uint16_t>((value * 31) >> 6);
+        value = value < 0 ? -(((-value) * 31) >> 5) : (value * 31) >> 5;
+        return static_cast<uint16_t>(value < 0 ? 0x8000 | -value : value);
+    }
+
+    float HalfToFloat(uint16_t half)
+    {
+        uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+        uint32_t exponent = (half >> 10) & 31;
+        uint32_t mantissa = half & 1023;
+        uint32_t bits;
+        if (exponent == 0)
+        {
+            // Denormal halves are normal floats
+            float value = mantissa * (1.0f / 16777216.0f);
+            std::memcpy(&bits, &value, sizeof(bits));
+            bits |= sign;
+        }
+        else if (exponent == 31)
+        {
+            bits = sign | 0x7f800000 | (mantissa << 13); // Infinity or NaN
+        }
+        else
+        {
+            bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+        }
+        float result;
+        std::memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Blocks
+//--------------------------------------------------------------------------------------
+
+// Decode one BC6H block to RGB floats, unclamped (negative values only from signed blocks)
+void DecodeBC6HBlock(const void* block, bool isSigned, float texels[16][3])
+{
+    BlockBits bits(block);
+    uint32_t modeBits = bits.Read(2);
+    if (modeBits >= 2)  modeBits |= bits.Read(3) << 2;
+
+    const BC6HMode* mode = nullptr;
+    for (auto& candidate : BC6H_MODES)
+    {
+        if (candidate.modeBits == modeBits)  mode = &candidate;
+    }
+    if (mode == nullptr)
+    {
+        // Reserved modes decode to black
+        for (unsigned int i = 0; i < 16; ++i)  texels[i][0] = texels[i][1] = texels[i][2] = 0;
+        return;
+    }
+
+    int endpoints[4][3] = {};
+    for (auto& field : mode->fields)
+    {
+        if (field.count == 0)  break;
+        endpoints[field.field / 3][field.field % 3] |= bits.Read(field.count) << field.shift;
+    }
+    unsigned int partition = mode->numSubsets == 2 ? bits.Read(5) : 0;
+
+    // Differences are signed and added to the first endpoint, wrapping to its size. Signed formats sign extend the result
+    unsigned int numEndpoints = mode->numSubsets * 2;
+    for (unsigned int channel = 0; channel < 3; ++channel)
+    {
+        int mask = (1 << mode->endpointBits) - 1;
+        if (isSigned)  endpoints[0][channel] = SignExtend(endpoints[0][channel], mode->endpointBits);
+        for (unsigned int e = 1; e < numEndpoints; ++e)
+        {
+            int& value = endpoints[e][channel];
+            if (mode->transformed)
+            {
+                value = (endpoints[0][channel] + SignExtend(value, mode->deltaBits[channel])) & mask;
+            }
+            if (isSigned)  value = SignExtend(value, mode->endpointBits);
+        }
+        for (unsigned int e = 0; e < numEndpoints; ++e)
+        {
+            endpoints[e][channel] = Unquantise(endpoints[e][channel], mode->endpointBits, isSigned);
+        }
+    }
+
+    unsigned int indexBits = mode->numSubsets == 2 ? 3 : 4;
+    const uint8_t* weights = Weights(indexBits);
+    for (unsigned int i = 0; i < 16; ++i)
+    {
+        unsigned int index = bits.Read(indexBits - (IsAnchor(mode->numSubsets, partition, i) ? 1 : 0));
+        unsigned int subset = Subset(mode->numSubsets, partition, i);
+        int w = weights[index];
+        for (unsigned int channel = 0; channel < 3; ++channel)
+        {
+            int e0 = endpoints[subset * 2][channel], e1 = endpoints[subset * 2 + 1][channel];
+            texels[i][channel] = HalfToFloat(FinishUnquantise((e0 * (64 - w) + e1 * w + 32) >> 6, isSigned));
+        }
+    }
+}
+
+
+// Bytes per 4x4 block of a format, or 0 if it is not a block compressed format that can be decoded
+uint32_t BCBlockBytes(uint32_t format)
+{
+    switch (format)
+    {
+    case FORMAT_BC1_UNORM: case FORMAT_BC1_UNORM_SRGB:
+    case FORMAT_BC4_UNORM: case FORMAT_BC4_SNORM:
+        return 8;
+
+    case FORMAT_BC2_UNORM: case FORMAT_BC2_UNORM_SRGB:
+    case FORMAT_BC3_UNORM: case FORMAT_BC3_UNORM_SRGB:
+    case FORMAT_BC5_UNORM: case FORMAT_BC5_SNORM:
+    case FORMAT_BC6H_UF16: case FORMAT_BC6H_SF16:
+    case FORMAT_BC7_UNORM: case FORMAT_BC7_UNORM_SRGB:
+        return 16;
+
+    default:
+        return 0;
+    }
+}
+
+
+// Decode one 4x4 block to RGBA, texels in rows top to bottom. Returns false if the format is not supported
+bool DecodeBCBlock(uint32_t format, const void* block, uint8_t texels[16][4])
+{
+    const uint8_t* data = static_cast<const uint8_t*>(block);
+    switch (format)
+    {
+    case FORMAT_BC1_UNORM: case FORMAT_BC1_UNORM_SRGB:
+        DecodeColourBlock(data, true, texels);
+        return true;
+
+    case FORMAT_BC2_UNORM: case FORMAT_BC2_UNORM_SRGB:
+        DecodeColourBlock(data + 8, false, texels);
+        DecodeBC2Alpha(data, texels);
+        return true;
+
+    case FORMAT_BC3_UNORM: case FORMAT_BC3_UNORM_SRGB:
+        DecodeColourBlock(data + 8, false, texels);
+        DecodeChannelBlock(data, false, texels, 3);
+        return true;
+
+    case FORMAT_BC4_UNORM: case FORMAT_BC4_SNORM:
+    {
+        static const uint32_t red[1] = { PackRGBA(0, 0, 0, 255) };
+        static const uint8_t zeros[16] = {};
+        WriteTexels(red, zeros, texels);
+        DecodeChannelBlock(data, format == FORMAT_BC4_SNORM, texels, 0);
+        return true;
+    }
+
+    case FORMAT_BC5_UNORM: case FORMAT_BC5_SNORM:
+    {
+        static const uint32_t redGreen[1] = { PackRGBA(0, 0, 0, 255) };
+        static const uint8_t zeros[16] = {};
+        WriteTexels(redGreen, zeros, texels);
+        DecodeChannelBlock(data, format == FORMAT_BC5_SNORM, texels, 0);
+        DecodeChannelBlock(data + 8, format == FORMAT_BC5_SNORM, texels, 1);
+        return true;
+    }
+
+    case FORMAT_BC6H_UF16: case FORMAT_BC6H_SF16:
+    {
+        float hdr[16][3];
+        DecodeBC6HBlock(data, format == FORMAT_BC6H_SF16, hdr);
+        for (unsigned int i = 0; i < 16; ++i)
+        {
+            for (unsigned int channel = 0; channel < 3; ++channel)
+            {
+                texels[i][channel] = static_cast<uint8_t>(std::min(std::max(hdr[i][channel], 0.0f), 1.0f) * 255 + 0.5f);
+            }
+            texels[i][3] = 255;
+        }
+        return true;
+    }
+
+    case FORMAT_BC7_UNORM: case FORMAT_BC7_UNORM_SRGB:
+        DecodeBC7Block(data, texels);
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Images
+//--------------------------------------------------------------------------------------
+
+// Decode a whole mip to RGBA, width * height * 4 bytes with no padding. Block rows are shared among threads with
+// ParallelFor if parallel is set. Returns false if the format is not supported
+bool DecodeBCImage(uint32_t format, const DDSSubresource& subresource, uint8_t* rgba, bool parallel /*= true*/)
+{
+    uint32_t blockBytes = BCBlockBytes(format);
+    if (blockBytes == 0)  return false;
+
+    const uint8_t* data = static_cast<const uint8_t*>(subresource.data);
+    uint32_t width = subresource.width, height = subresource.height;
+    uint32_t blocksAcross = (width + 3) / 4, blocksDown = (height + 3) / 4;
+    auto decodeRows = [&](unsigned int start, unsigned int end)
+    {
+        uint8_t texels[16][4];
+        for (unsigned int blockY = start; blockY < end; ++blockY)
+        {
+            const uint8_t* block = data + static_cast<size_t>(blockY) * subresource.rowPitch;
+            unsigned int rows = std::min(4u, height - blockY * 4);
+            for (unsigned int blockX = 0; blockX < blocksAcross; ++blockX, block += blockBytes)
+            {
+                DecodeBCBlock(format, block, texels);
+
+                // Blocks over the right or bottom edge of a mip that isn't a multiple of 4 are clipped
+                unsigned int columns = std::min(4u, width - blockX * 4);
+                uint8_t* out = rgba + (static_cast<size_t>(blockY) * 4 * width + blockX * 4) * 4;
+                for (unsigned int row = 0; row < rows; ++row, out += width * 4)  std::memcpy(out, texels[row * 4], columns * 4);
+            }
+        }
+    };
+
+    if (parallel)  ParallelFor(blocksDown, DECODE_BATCH_ROWS, decodeRows);
+    else           decodeRows(0, blocksDown);
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Block cache
+//--------------------------------------------------------------------------------------
+
+// The subresource's data must outlive the cache (e.g. keep its DDSFile open)
+// Will throw a std::runtime_error exception if the format is not supported (since constructors can't return errors)
+BCBlockCache::BCBlockCache(uint32_t format, const DDSSubresource& subresource)
+    : mFormat(format), mBlockBytes(BCBlockBytes(format)), mData(static_cast<const uint8_t*>(subresource.data)),
+      mRowPitch(subresource.rowPitch), mWidth(subresource.width), mHeight(subresource.height)
+{
+    if (mBlockBytes == 0)  throw std::runtime_error("BCBlockCache: format " + std::to_string(format) + " is not block compressed");
+}
+
+
+// RGBA of a texel, coordinates outside the mip are clamped to its edge. Valid until the next call
+const uint8_t* BCBlockCache::Texel(uint32_t x, uint32_t y)
+{
+    x = std::min(x, mWidth - 1);
+    y = std::min(y, mHeight - 1);
+    uint32_t blockX = x / 4, blockY = y / 4;
+
+    Entry& entry = mEntries[(blockY % CACHE_SIDE) * CACHE_SIDE + blockX % CACHE_SIDE];
+    if (entry.blockX == blockX && entry.blockY == blockY)
+    {
+        ++mHits;
+    }
+    else
+    {
+        DecodeBCBlock(mFormat, mData + static_cast<size_t>(blockY) * mRowPitch + static_cast<size_t>(blockX) * mBlockBytes, entry.texels);
+        entry.blockX = blockX;
+        entry.blockY = blockY;
+        ++mMisses;
+    }
+    return entry.texels[(y % 4) * 4 + x % 4];
+}
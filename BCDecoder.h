@@ -0,0 +1,82 @@
+//--------------------------------------------------------------------------------------
+// Software decoding of block compressed (BC1-BC7) textures
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+// For CPU work that needs to read compressed textures: a software rasterizer or lighting
+// reference sampling the same .dds files the GPU uses, or checking the output of the texture
+// cooker without a device. Whole mips can be decoded at once, spread over threads with
+// ParallelFor, or single texels fetched through a small cache of decoded blocks.
+//
+// Texels are decoded to 8-bit RGBA exactly as stored: sRGB formats are not converted to linear
+// (as with the cooker's images). Missing channels are filled as the GPU does: BC4 gives (r,0,0,1)
+// and BC5 (r,g,0,1). Signed BC4/BC5 are returned biased, -1 -> 1, 0 -> 128, 1 -> 255, like a
+// normal map stored unsigned. BC6H is clamped to 0-1 for 8-bit output, DecodeBC6HBlock gives the
+// full HDR range. Palettes are built with SSE2 where available, with a plain C++ fallback.
+//
+// Has no DirectX dependency, formats are given as DXGI_FORMAT values.
+
+#ifndef _BC_DECODER_H_INCLUDED_
+#define _BC_DECODER_H_INCLUDED_
+
+#include "DDSFile.h"
+
+#include <cstdint>
+
+
+// Bytes per 4x4 block of a format, or 0 if it is not a block compressed format that can be decoded
+uint32_t BCBlockBytes(uint32_t format);
+
+// Decode one 4x4 block to RGBA, texels in rows top to bottom. Returns false if the format is not supported
+bool DecodeBCBlock(uint32_t format, const void* block, uint8_t texels[16][4]);
+
+// Decode one BC6H block to RGB floats, unclamped (negative values only from signed blocks)
+void DecodeBC6HBlock(const void* block, bool isSigned, float texels[16][3]);
+
+// Decode a whole mip to RGBA, width * height * 4 bytes with no padding. Block rows are shared among threads with
+// ParallelFor if parallel is set. Returns false if the format is not supported
+bool DecodeBCImage(uint32_t format, const DDSSubresource& subresource, uint8_t* rgba, bool parallel = true);
+
+
+// Fetches texels from a compressed mip on demand, keeping the blocks decoded most recently. The cache is direct
+// mapped by block position, each entry holding one of the blocks in an 8x8 grid, so any 32x32 texel area (or
+// smaller lookups scattered less than 8 blocks apart) decodes each block once. Not thread safe, use one per thread
+class BCBlockCache
+{
+public:
+    // The subresource's data must outlive the cache (e.g. keep its DDSFile open)
+    // Will throw a std::runtime_error exception if the format is not supported (since constructors can't return errors)
+    BCBlockCache(uint32_t format, const DDSSubresource& subresource);
+
+    // RGBA of a texel, coordinates outside the mip are clamped to its edge. Valid until the next call
+    const uint8_t* Texel(uint32_t x, uint32_t y);
+
+    uint64_t Hits()    { return mHits; }
+    uint64_t Misses()  { return mMisses; } // Blocks decoded
+
+
+private:
+    static const uint32_t CACHE_SIDE = 8; // Cache holds CACHE_SIDE x CACHE_SIDE blocks
+    static const uint32_t NO_BLOCK = 0xffffffff;
+
+    struct Entry
+    {
+        uint32_t blockX = NO_BLOCK;
+        uint32_t blockY = NO_BLOCK;
+        uint8_t  texels[16][4];
+    };
+
+    uint32_t       mFormat;
+    uint32_t       mBlockBytes;
+    const uint8_t* mData;
+    uint32_t       mRowPitch;
+    uint32_t       mWidth;
+    uint32_t       mHeight;
+
+    Entry mEntries[CACHE_SIDE * CACHE_SIDE];
+
+    uint64_t mHits   = 0;
+    uint64_t mMisses = 0;
+};
+
+
+#endif //_BC_DECODER_H_INCLUDED_
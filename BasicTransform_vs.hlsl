@@ -17,8 +17,8 @@ SimplePixelShaderInput main(BasicVertex modelVertex)
     float4 viewPosition      = mul(gViewMatrix,       worldPosition);
     output.projectedPosition = mul(gProjectionMatrix, viewPosition);
 
-    // Pass texture coordinates (UVs) on to the pixel shader
-    output.uv = modelVertex.uv;
+    // Pass texture coordinates (UVs) on to the pixel shader, moved to the texture's region if it is in an atlas
+    output.uv = modelVertex.uv * gUVScale + gUVOffset;
 
     return output; // Output data sent down the pipeline (to the pixel shader)
 }
@@ -5,10 +5,30 @@
 
 #include "Camera.h"
 
+
+// Camera rotations (Euler angles, radians) looking down each cube map face in D3D order: +X, -X, +Y, -Y, +Z, -Z
+const CVector3 CUBE_FACE_ROTATIONS[6] =
+{
+    { 0,       PI / 2, 0 },
+    { 0,      -PI / 2, 0 },
+    { -PI / 2, 0,      0 },
+    {  PI / 2, 0,      0 },
+    { 0,       0,      0 },
+    { 0,       PI,     0 },
+};
+
+
 // Control the camera's position and rotation using keys provided
 void Camera::Control(float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode turnLeft, KeyCode turnRight,
                                       KeyCode moveForward, KeyCode moveBackward, KeyCode moveLeft, KeyCode moveRight)
 {
+	// Any key held moves or turns the camera, so its matrices will need updating
+	if (KeyHeld(Key_Down) || KeyHeld(Key_Up) || KeyHeld(Key_Right) || KeyHeld(Key_Left) ||
+	    KeyHeld(Key_D) || KeyHeld(Key_A) || KeyHeld(Key_W) || KeyHeld(Key_S))
+	{
+		mViewDirty = true;
+	}
+
 	//**** ROTATION ****
 	if (KeyHeld(Key_Down))
 	{
@@ -55,28 +75,56 @@ void Camera::Control(float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode
 }
 
 
-// Update the matrices used for the camera in the rendering pipeline
+// Ray from the camera through a pixel of a viewport of the given size. The direction reaches the plane one unit in front
+// of the camera, so distances along it are distances in front of the camera
+void Camera::PixelRay(int x, int y, int viewportWidth, int viewportHeight, CVector3& origin, CVector3& direction)
+{
+	UpdateMatrices();
+
+	// Centre of the pixel from -1 to 1 across the viewport (y upwards), then undo the projection's scaling of x and y
+	float viewX = (2.0f * (x + 0.5f) / viewportWidth - 1.0f) / mProjectionMatrix.e00;
+	float viewY = (1.0f - 2.0f * (y + 0.5f) / viewportHeight) / mProjectionMatrix.e11;
+
+	origin = mPosition;
+	direction = TransformVector({ viewX, viewY, 1.0f }, mWorldMatrix);
+}
+
+
+// Update the matrices used for the camera in the rendering pipeline, if anything has changed
 void Camera::UpdateMatrices()
 {
-    // "World" matrix for the camera - treat it like a model at first
-    mWorldMatrix = MatrixRotationZ(mRotation.z) * MatrixRotationX(mRotation.x) * MatrixRotationY(mRotation.y) * MatrixTranslation(mPosition);
+    if (!mViewDirty && !mProjectionDirty)  return;
 
-    // View matrix is the usual matrix used for the camera in shaders, it is the inverse of the world matrix (see lectures)
-    mViewMatrix = InverseAffine(mWorldMatrix);
+    if (mViewDirty)
+    {
+        // "World" matrix for the camera - treat it like a model at first
+        mWorldMatrix = MatrixRotationZ(mRotation.z) * MatrixRotationX(mRotation.x) * MatrixRotationY(mRotation.y) * MatrixTranslation(mPosition);
 
-    // Projection matrix, how to flatten the 3D world onto the screen (needs field of view, near and far clip, aspect ratio)
-    float tanFOVx = std::tan(mFOVx * 0.5f);
-    float scaleX = 1.0f / tanFOVx;
-    float scaleY = mAspectRatio / tanFOVx;
-    float scaleZa = mFarClip / (mFarClip - mNearClip);
-    float scaleZb = -mNearClip * scaleZa;
+        // View matrix is the usual matrix used for the camera in shaders, it is the inverse of the world matrix (see lectures)
+        mViewMatrix = InverseAffine(mWorldMatrix);
+    }
 
-    mProjectionMatrix = { scaleX,   0.0f,    0.0f,   0.0f,
-                            0.0f, scaleY,    0.0f,   0.0f,
-                            0.0f,   0.0f, scaleZa,   1.0f,
-                            0.0f,   0.0f, scaleZb,   0.0f };
+    if (mProjectionDirty)
+    {
+        // Projection matrix, how to flatten the 3D world onto the screen (needs field of view, near and far clip, aspect ratio)
+        float tanFOVx = std::tan(mFOVx * 0.5f);
+        float scaleX = 1.0f / tanFOVx;
+        float scaleY = mAspectRatio / tanFOVx;
+
+        // Depth is z * scaleZa + scaleZb, divided by w (= z). Normally 0 at the near clip and 1 at the far clip. For
+        // reverse-Z use the limit as the far clip goes to infinity with near and far swapped, giving depth = near / z
+        float scaleZa = mReverseZ ? 0.0f : mFarClip / (mFarClip - mNearClip);
+        float scaleZb = mReverseZ ? mNearClip : -mNearClip * scaleZa;
+
+        mProjectionMatrix = { scaleX,   0.0f,    0.0f,   0.0f,
+                                0.0f, scaleY,    0.0f,   0.0f,
+                                0.0f,   0.0f, scaleZa,   1.0f,
+                                0.0f,   0.0f, scaleZb,   0.0f };
+    }
 
     // The view-projection matrix combines the two matrices usually used for the camera into one, which can save a multiply in the shaders (optional)
     mViewProjectionMatrix = mViewMatrix * mProjectionMatrix;
-}
 
+    mViewDirty = false;
+    mProjectionDirty = false;
+}
@@ -37,31 +37,48 @@ public:
 	// Data access
 	//-------------------------------------
 
-	// Getters / setters
+	// Getters / setters. Setters mark the matrices that depend on the value as needing an update
 	CVector3 Position()  { return mPosition; }
 	CVector3 Rotation()  { return mRotation;	}
-	void SetPosition(CVector3 position)  { mPosition = position; }
-	void SetRotation(CVector3 rotation)  { mRotation = rotation; }
+	void SetPosition(CVector3 position)  { mPosition = position;  mViewDirty = true; }
+	void SetRotation(CVector3 rotation)  { mRotation = rotation;  mViewDirty = true; }
 
-	float FOV()       { return mFOVx;     }
-	float NearClip()  { return mNearClip; }
-	float FarClip()   { return mFarClip;  }
+	float FOV()         { return mFOVx;        }
+	float AspectRatio() { return mAspectRatio; }
+	float NearClip()    { return mNearClip;    }
+	float FarClip()     { return mFarClip;     }
 
-	void SetFOV     (float fov     )  { mFOVx     = fov;      }
-	void SetNearClip(float nearClip)  { mNearClip = nearClip; }
-	void SetFarClip (float farClip )  { mFarClip  = farClip;  }
+	void SetFOV        (float fov        )  { mFOVx        = fov;          mProjectionDirty = true; }
+	void SetAspectRatio(float aspectRatio)  { mAspectRatio = aspectRatio;  mProjectionDirty = true; }
+	void SetNearClip   (float nearClip   )  { mNearClip    = nearClip;     mProjectionDirty = true; }
+	void SetFarClip    (float farClip    )  { mFarClip     = farClip;      mProjectionDirty = true; }
+
+	// Reverse-Z projection: depth is 1 at the near clip and falls towards 0 at an infinite distance, the far clip is
+	// not used. Floating point depth buffers have most precision near 0, which this spreads over distant geometry
+	// Render with the reversed depth states (see ReverseDepthState) and clear depth to FarDepth()
+	bool ReverseZ()  { return mReverseZ; }
+	void SetReverseZ(bool reverseZ)  { mReverseZ = reverseZ;  mProjectionDirty = true; }
+
+	// Depth buffer value for the furthest distance, to clear the depth buffer to
+	float FarDepth()  { return mReverseZ ? 0.0f : 1.0f; }
 
 	// Read only access to camera matrices, updated on request from position, rotation and camera settings
+	// Only the matrices affected by changes since the last request are rebuilt
 	CMatrix4x4 ViewMatrix()            { UpdateMatrices(); return mViewMatrix;           }
 	CMatrix4x4 ProjectionMatrix()      { UpdateMatrices(); return mProjectionMatrix;     }
 	CMatrix4x4 ViewProjectionMatrix()  { UpdateMatrices(); return mViewProjectionMatrix; }
+	CMatrix4x4 WorldMatrix()           { UpdateMatrices(); return mWorldMatrix;          } // Axes are the camera's right, up and facing directions
+
+	// Ray from the camera through a pixel of a viewport of the given size, e.g. the pixel under the mouse to pick what is
+	// there. The direction is not normalised, distances along it are distances in front of the camera
+	void PixelRay(int x, int y, int viewportWidth, int viewportHeight, CVector3& origin, CVector3& direction);
 
 	
 //-------------------------------------
 // Private members
 //-------------------------------------
 private:
-	// Update the matrices used for the camera in the rendering pipeline
+	// Update the matrices used for the camera in the rendering pipeline, if anything has changed
 	void UpdateMatrices();
 
 	// Postition and rotations for the camera (rarely scale cameras)
@@ -74,6 +91,11 @@ private:
     float mAspectRatio;
 	float mNearClip;
 	float mFarClip;
+	bool  mReverseZ = false;
+
+	// Set when the position/rotation or the projection settings change, so the matrices need rebuilding
+	bool mViewDirty = true;
+	bool mProjectionDirty = true;
 
 	// Current view, projection and combined view-projection matrices (DirectX matrix type)
 	CMatrix4x4 mWorldMatrix; // Easiest to treat the camera like a model and give it a "world" matrix...
@@ -85,4 +107,10 @@ private:
 };
 
 
+// Camera rotations (Euler angles, radians) looking down each cube map face in D3D order: +X, -X, +Y, -Y, +Z, -Z
+// The camera's up and right axes match the layout DirectX expects for each face. Use a 90 degree field of view and
+// square aspect ratio so the six faces meet exactly
+extern const CVector3 CUBE_FACE_ROTATIONS[6];
+
+
 #endif //_CAMERA_H_INCLUDED_
@@ -0,0 +1,132 @@
+//--------------------------------------------------------------------------------------
+// Cascaded shadow map for a directional light (the sun)
+//--------------------------------------------------------------------------------------
+
+#include "CascadedShadowMap.h"
+#include "ShadowMap.h"
+#include "SceneObject.h"
+#include "State.h"
+#include "GraphicsHelpers.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+
+// Create the texture array and views, one slice per cascade
+CascadedShadowMap::CascadedShadowMap(const CascadeSettings& settings)
+    : mSettings(settings)
+{
+    mSettings.numCascades = std::min(std::max(mSettings.numCascades, 1u), MAX_SHADOW_CASCADES);
+
+    D3D11_TEXTURE2D_DESC textureDesc = {};
+    textureDesc.Width  = mSettings.resolution;
+    textureDesc.Height = mSettings.resolution;
+    textureDesc.MipLevels = 1;
+    textureDesc.ArraySize = mSettings.numCascades;
+    textureDesc.Format = DXGI_FORMAT_R32_TYPELESS; // Typeless so it can be viewed as both depth and float
+    textureDesc.SampleDesc.Count = 1;
+    textureDesc.SampleDesc.Quality = 0;
+    textureDesc.Usage = D3D11_USAGE_DEFAULT;
+    textureDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+    textureDesc.CPUAccessFlags = 0;
+    textureDesc.MiscFlags = 0;
+    if (FAILED(gD3DDevice->CreateTexture2D(&textureDesc, nullptr, &mTexture)))
+    {
+        throw std::runtime_error("Error creating cascaded shadow map texture");
+    }
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+    srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+    srvDesc.Texture2DArray.MostDetailedMip = 0;
+    srvDesc.Texture2DArray.MipLevels = 1;
+    srvDesc.Texture2DArray.FirstArraySlice = 0;
+    srvDesc.Texture2DArray.ArraySize = mSettings.numCascades;
+    if (FAILED(gD3DDevice->CreateShaderResourceView(mTexture, &srvDesc, &mSRV)))
+    {
+        throw std::runtime_error("Error creating cascaded shadow map texture view");
+    }
+
+    mDepthStencils.resize(mSettings.numCascades, nullptr);
+    for (unsigned int cascade = 0; cascade < mSettings.numCascades; ++cascade)
+    {
+        D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+        dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+        dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+        dsvDesc.Texture2DArray.MipSlice = 0;
+        dsvDesc.Texture2DArray.FirstArraySlice = cascade;
+        dsvDesc.Texture2DArray.ArraySize = 1;
+        if (FAILED(gD3DDevice->CreateDepthStencilView(mTexture, &dsvDesc, &mDepthStencils[cascade])))
+        {
+            throw std::runtime_error("Error creating cascaded shadow map depth view");
+        }
+    }
+}
+
+
+CascadedShadowMap::~CascadedShadowMap()
+{
+    for (auto dsv : mDepthStencils)  if (dsv)  dsv->Release();
+    if (mSRV)      mSRV->Release();
+    if (mTexture)  mTexture->Release();
+}
+
+
+// Fit the cascades to the camera's view and render the casters inside each one
+void CascadedShadowMap::Update(Camera* camera, CVector3 lightDirection, const std::vector<SceneObject*>& casters)
+{
+    CMatrix4x4 cameraWorldMatrix = InverseAffine(camera->ViewMatrix());
+    FitShadowCascades(cameraWorldMatrix, camera->FOV(), camera->AspectRatio(), camera->NearClip(), camera->FarClip(),
+                      lightDirection, mSettings, mCascades);
+
+    unsigned int numCasters = static_cast<unsigned int>(casters.size());
+    mCasterCentres.resize(numCasters);
+    mCasterRadii.resize(numCasters);
+    mCasterMasks.resize(numCasters);
+    for (unsigned int i = 0; i < numCasters; ++i)
+    {
+        casters[i]->ObjectModel()->BoundingSphere(mCasterCentres[i], mCasterRadii[i]);
+    }
+    std::fill(mCasterDraws, mCasterDraws + MAX_SHADOW_CASCADES, 0);
+    CullCascadeCasters(mCascades, mSettings.numCascades, mCasterCentres.data(), mCasterRadii.data(), numCasters,
+                       mCasterMasks.data(), mCasterDraws);
+
+    // The map can't be read while it is being rendered to
+    ID3D11ShaderResourceView* nullSRV = nullptr;
+    gD3DContext->PSSetShaderResources(SUN_SHADOW_TEXTURE_SLOT, 1, &nullSRV);
+
+    D3D11_VIEWPORT viewport = { 0, 0, static_cast<FLOAT>(mSettings.resolution), static_cast<FLOAT>(mSettings.resolution), 0.0f, 1.0f };
+    gD3DContext->RSSetViewports(1, &viewport);
+    for (unsigned int cascade = 0; cascade < mSettings.numCascades; ++cascade)
+    {
+        auto& cascadeData = mCascades[cascade];
+
+        // Depth only, no render target
+        gD3DContext->OMSetRenderTargets(0, nullptr, mDepthStencils[cascade]);
+        gD3DContext->ClearDepthStencilView(mDepthStencils[cascade], D3D11_CLEAR_DEPTH, 1.0f, 0);
+
+        // The light camera has no real position for an orthographic view, use the centre of its near plane
+        gPerFrameConstants.viewMatrix           = cascadeData.viewMatrix;
+        gPerFrameConstants.projectionMatrix     = cascadeData.projectionMatrix;
+        gPerFrameConstants.viewProjectionMatrix = cascadeData.viewProjectionMatrix;
+        gPerFrameConstants.cameraPosition       = InverseAffine(cascadeData.viewMatrix).GetPosition();
+        gPerFrameConstants.farDepth             = 1.0f;
+        UpdateConstantBuffer(gPerFrameConstantBuffer, gPerFrameConstants);
+        gD3DContext->VSSetConstantBuffers(0, 1, &gPerFrameConstantBuffer);
+        gReverseDepth = false;
+
+        // Meshlet back face culling assumes a perspective view from the camera position, so skip it here
+        for (unsigned int i = 0; i < numCasters; ++i)
+        {
+            if (mCasterMasks[i] & (1 << cascade))  casters[i]->RenderShadow(false);
+        }
+    }
+}
+
+
+// Select the texture array and the comparison sampler for the lit pixel shaders
+void CascadedShadowMap::Bind()
+{
+    gD3DContext->PSSetShaderResources(SUN_SHADOW_TEXTURE_SLOT, 1, &mSRV);
+    gD3DContext->PSSetSamplers(SHADOW_SAMPLER_SLOT, 1, &gShadowSampler);
+}
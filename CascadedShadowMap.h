@@ -0,0 +1,68 @@
+//--------------------------------------------------------------------------------------
+// Cascaded shadow map for a directional light (the sun)
+//--------------------------------------------------------------------------------------
+// The camera's view is split into slices by distance, each covered by one slice of a texture
+// array holding an orthographic depth map from the light. Fitting the cascades and culling
+// the casters is done by the maths in ShadowCascades.h, this class owns the textures and
+// renders the casters into each cascade every frame. Lit pixel shaders pick the first
+// cascade containing the pixel (see Shadows.hlsli).
+
+#ifndef _CASCADED_SHADOW_MAP_H_INCLUDED_
+#define _CASCADED_SHADOW_MAP_H_INCLUDED_
+
+#include "Common.h"
+#include "Camera.h"
+#include "ShadowCascades.h"
+
+#include <vector>
+#include <cstdint>
+
+class SceneObject;
+
+// Texture slot used by lit pixel shaders (see Shadows.hlsli), the comparison sampler is shared with ShadowMap
+const unsigned int SUN_SHADOW_TEXTURE_SLOT = 11;
+
+
+class CascadedShadowMap
+{
+public:
+    // Create the texture array and views, one slice per cascade. settings.numCascades must be NUM_SUN_CASCADES to
+    // match the shaders
+    // Will throw a std::runtime_error exception on failure (since constructors can't return errors)
+    CascadedShadowMap(const CascadeSettings& settings);
+    ~CascadedShadowMap();
+
+    // Fit the cascades to the camera's view and render the casters inside each one. lightDirection is the direction
+    // the light travels in. Changes the render targets and per-frame camera constants, so call before setting up the
+    // views that use the map
+    void Update(Camera* camera, CVector3 lightDirection, const std::vector<SceneObject*>& casters);
+
+    // Select the texture array and the comparison sampler for the lit pixel shaders
+    void Bind();
+
+    // For the per-frame constants: the matrix from world space into a cascade's map
+    CMatrix4x4 CascadeMatrix(unsigned int cascade)  { return mCascades[cascade].viewProjectionMatrix; }
+
+
+    // Statistics for the last update: casters drawn into each cascade
+    unsigned int NumberCascades()  { return mSettings.numCascades; }
+    unsigned int CasterDraws(unsigned int cascade)  { return mCasterDraws[cascade]; }
+
+
+private:
+    CascadeSettings mSettings;
+    ShadowCascade   mCascades[MAX_SHADOW_CASCADES];
+    unsigned int    mCasterDraws[MAX_SHADOW_CASCADES] = {};
+
+    // Caster bounds and the cascades each falls in, reused between updates
+    std::vector<CVector3> mCasterCentres;
+    std::vector<float>    mCasterRadii;
+    std::vector<uint8_t>  mCasterMasks;
+
+    ID3D11Texture2D*                     mTexture = nullptr;
+    ID3D11ShaderResourceView*            mSRV = nullptr;
+    std::vector<ID3D11DepthStencilView*> mDepthStencils;
+};
+
+
+#endif //_CASCADED_SHADOW_MAP_H_INCLUDED_
@@ -9,8 +9,11 @@
 #include <d3d11.h>
 #include <string>
 
+#include "CVector2.h"
 #include "CVector3.h"
 #include "CMatrix4x4.h"
+#include "Meshlet.h"
+#include "Skinning.h"
 
 
 //--------------------------------------------------------------------------------------
@@ -41,6 +44,22 @@ extern const float ROTATION_SPEED;
 extern const float MOVEMENT_SPEED;
 
 
+// Rendering statistics for the current frame, reset at the start of each frame and shown in the window title
+extern unsigned int gTrianglesRendered;
+extern MeshletCullStats gMeshletStats;
+extern float gMeshletCullTime; // Seconds spent culling meshlets on the CPU
+extern unsigned int gSkinnedVertices;
+extern float gSkinningTime;    // Seconds spent preparing skinning on the CPU (building bone matrices, plus the vertices for CPU skinning)
+extern unsigned int gViewsRendered;
+extern unsigned int gObjectsDrawn; // Summed over all views
+
+// Skin meshes on the CPU rather than in the vertex shader
+extern bool gCPUSkinning;
+
+// The camera being rendered uses reverse-Z projection, so objects must use the reverse-Z depth states
+extern bool gReverseDepth;
+
+
 // A global error message to help track down fatal errors - set it to a useful message
 // when a serious error occurs
 extern std::string gLastError;
@@ -52,6 +71,9 @@ extern std::string gLastError;
 //--------------------------------------------------------------------------------------
 // Variables sent over to the GPU each frame
 
+// Number of cascades in the sun's shadow map, fixed in the shaders (see CascadedShadowMap.h)
+const unsigned int NUM_SUN_CASCADES = 4;
+
 // Data that remains constant for an entire frame, updated from C++ to the GPU shaders *once per frame*
 // We hold them together in a structure and send the whole thing to a "constant buffer" on the GPU each frame when
 // we have finished updating the scene. There is a structure in the shader code that exactly matches this one
@@ -76,7 +98,7 @@ struct PerFrameConstants
 
 	float	   light2CosHalfAngle;
 	float	   gTime;
-	float	   padding6;
+	float	   farDepth;       // Depth of the furthest distance, 1 normally or 0 with reverse-Z projection
 	float      padding7;
 
     CVector3   ambientColour;
@@ -84,6 +106,21 @@ struct PerFrameConstants
 
     CVector3   cameraPosition;
 	float      padding8;
+
+    // Shadows (see ShadowMap.h). Light 2's matrix takes world positions into its shadow map. Light 1's cube map holds
+    // depth = scale + offset / z for distance z along the axis of each face
+    CMatrix4x4 light2ShadowMatrix;
+    float      light1ShadowDepthScale;
+    float      light1ShadowDepthOffset;
+    float      light1ShadowTexelSize; // Size of one texel of the cube map at distance 1 from the light
+    float      paddingShadow;
+
+    // Directional light with cascaded shadows. The matrices take world positions into each cascade's map
+    CVector3   sunDirection; // Direction the light travels in
+    float      paddingSun1;
+    CVector3   sunColour;
+    float      paddingSun2;
+    CMatrix4x4 sunCascadeMatrices[NUM_SUN_CASCADES];
 };
 
 extern PerFrameConstants gPerFrameConstants;      // This variable holds the CPU-side constant buffer described above
@@ -98,9 +135,37 @@ struct PerModelConstants
     CMatrix4x4 worldMatrix;
     CVector3   objectColour; // Allows each light model to be tinted to match the light colour they cast
     float      padding9;
+    CVector2   uvScale;      // Maps the model's UVs to its texture's region of an atlas, see TextureAtlas.h
+    CVector2   uvOffset;
 };
 extern PerModelConstants gPerModelConstants;      // This variable holds the CPU-side constant buffer described above
 extern ID3D11Buffer*     gPerModelConstantBuffer; // This variable controls the GPU-side constant buffer related to the above structure
 
 
+// Bone matrices for the skinned sub-mesh being rendered, updated for each skinned sub-mesh. Used by the skinning vertex shader
+struct PerBoneConstants
+{
+    CMatrix4x4 boneMatrices[MAX_BONES];
+};
+extern PerBoneConstants gPerBoneConstants;
+extern ID3D11Buffer*    gPerBoneConstantBuffer;
+
+
+// Reflection probe positions for reflective shaders, which pick the nearest probe. See ReflectionProbes.h
+const unsigned int MAX_REFLECTION_PROBES = 8;
+struct PerProbeConstants
+{
+    struct
+    {
+        CVector3 position;
+        float    radius;
+    } probes[MAX_REFLECTION_PROBES];
+
+    unsigned int numProbes;
+    float        padding[3];
+};
+extern PerProbeConstants gPerProbeConstants;
+extern ID3D11Buffer*     gPerProbeConstantBuffer;
+
+
 #endif //_COMMON_H_INCLUDED_
@@ -24,11 +24,29 @@ struct TangentVertex
 	float2 uv       : uv;
 };
 
+// Vertex with up to four bones, used by the skinning vertex shader. Weights sum to 1
+struct SkinnedVertex
+{
+    float3 position : position;
+    float3 normal   : normal;
+    float2 uv       : uv;
+    uint4  bones    : boneIndices;
+    float4 weights  : boneWeights;
+};
+
 struct SkyboxVertex
 {
 	float3 position : position;
 };
 
+// Corner of a particle quad, built on the CPU in world space (see ParticleSystem.h)
+struct ParticleVertex
+{
+    float3 position : position;
+    float2 uv       : uv;
+    float4 colour   : colour;
+};
+
 // This structure describes what data the lighting pixel shader receives from the vertex shader.
 // The projected position is a required output from all vertex shaders - where the vertex is on the screen
 // The world position and normal at the vertex are sent to the pixel shader for the lighting equations.
@@ -56,6 +74,13 @@ struct SimplePixelShaderInput
     float2 uv : uv;
 };
 
+struct ParticlePixelShaderInput
+{
+    float4 projectedPosition : SV_Position;
+    float2 uv     : uv;
+    float4 colour : colour;
+};
+
 struct NormalMappingPixelShaderInput
 {
 	float4 projectedPosition : SV_Position; // This is the position of the pixel to render, this is a required input
@@ -92,6 +117,9 @@ struct ReflectionPixelShaderInput
 // They are called constants but that only means they are constant for the duration of a single GPU draw call.
 // These "constants" correspond to variables in C++ that we will change per-model, or per-frame etc.
 
+// Number of cascades in the sun's shadow map, must match NUM_SUN_CASCADES in C++
+static const uint NUM_SUN_CASCADES = 4;
+
 // In this exercise the matrices used to position the camera are updated from C++ to GPU every frame along with lighting information
 // These variables must match exactly the gPerFrameConstants structure in Scene.cpp
 cbuffer PerFrameConstants : register(b0) // The b0 gives this constant buffer the number 0 - used in the C++ code
@@ -114,7 +142,7 @@ cbuffer PerFrameConstants : register(b0) // The b0 gives this constant buffer th
 	
 	float	 gLight2CosHalfAngle;
 	float    gTime;
-	float	 padding6;
+	float	 gFarDepth;    // Depth of the furthest distance, 1 normally or 0 with reverse-Z projection
 	float	 padding7;
 	
     float3   gAmbientColour;
@@ -122,6 +150,18 @@ cbuffer PerFrameConstants : register(b0) // The b0 gives this constant buffer th
 
     float3   gCameraPosition;
     float    padding8;
+
+    float4x4 gLight2ShadowMatrix;        // World space to light 2's shadow map (see Shadows.hlsli)
+    float    gLight1ShadowDepthScale;    // Light 1's cube shadow map holds depth = scale + offset / z...
+    float    gLight1ShadowDepthOffset;   // ...for distance z along the axis of each face
+    float    gLight1ShadowTexelSize;     // Size of one texel of the cube map at distance 1 from the light
+    float    paddingShadow;
+
+    float3   gSunDirection;              // Direction the sun's light travels in
+    float    paddingSun1;
+    float3   gSunColour;
+    float    paddingSun2;
+    float4x4 gSunCascadeMatrices[NUM_SUN_CASCADES]; // World space to each cascade of the sun's shadow map
 }
 // Note constant buffers are not structs: we don't use the name of the constant buffer, these are really just a collection of global variables (hence the 'g')
 
@@ -137,4 +177,27 @@ cbuffer PerModelConstants : register(b1) // The b1 gives this constant buffer th
 
     float3   gObjectColour;
     float    padding9;  // See notes on padding in structure above
+
+    float2   gUVScale;  // Maps the model's UVs to its texture's region of an atlas (scale 1, offset 0 if not in one)
+    float2   gUVOffset;
+}
+
+
+// Bone matrices for skinning, these take vertices from the mesh's space straight to world space
+// Must match the gPerBoneConstants structure in C++, including the array size (MAX_BONES)
+static const uint MAX_BONES = 64;
+cbuffer PerBoneConstants : register(b2)
+{
+    float4x4 gBoneMatrices[MAX_BONES];
+}
+
+
+// Reflection probes, each with a cube map in the probe texture array. Reflective shaders use the nearest probe
+// Must match the gPerProbeConstants structure in C++, including the array size (MAX_REFLECTION_PROBES)
+static const uint MAX_REFLECTION_PROBES = 8;
+cbuffer PerProbeConstants : register(b3)
+{
+    float4 gReflectionProbes[MAX_REFLECTION_PROBES]; // Position in xyz, radius in w
+    uint   gNumReflectionProbes;
+    float3 paddingProbes;
 }
@@ -0,0 +1,62 @@
+#--------------------------------------------------------------------------------------
+# Offline compiler for the input signatures of vertex layouts
+#--------------------------------------------------------------------------------------
+# Compiles a dummy vertex shader for each layout in the signature list (InputSignatures.txt), so
+# input layouts can be created at startup without running the shader compiler (see InputLayout.h).
+# Each is written to Signature_<hash>.cso, where the hash is the 64-bit FNV-1a hash of the shader
+# source in hex. The source must match SignatureSource in InputLayout.cpp character for character.
+# The name depends only on the source, so a signature is only compiled if its output is missing.
+
+param(
+    [string]$Fxc = "fxc.exe",                   # Path to the shader compiler from the Windows SDK
+    [string]$List = "InputSignatures.txt",      # Layouts to compile signatures for
+    [string]$OutDir = "."                       # Folder for the compiled shaders, where the app loads them from
+)
+
+$ErrorActionPreference = "Stop"
+Set-Location $PSScriptRoot
+
+Add-Type -Language CSharp -TypeDefinition @"
+public static class SignatureHash
+{
+    public static string Hash(string source)
+    {
+        ulong hash = 14695981039346656037UL;
+        foreach (byte b in System.Text.Encoding.ASCII.GetBytes(source))  hash = unchecked((hash ^ b) * 1099511628211UL);
+        return hash.ToString("x16");
+    }
+}
+"@
+
+$tempSource = Join-Path ([System.IO.Path]::GetTempPath()) "InputSignature.hlsl"
+$lineNumber = 0
+$listed = 0
+$compiled = 0
+foreach ($line in Get-Content $List)
+{
+    ++$lineNumber
+    $line = ($line -split "#")[0].Trim()
+    if ($line -eq "") { continue }
+
+    # Each input is a type and name, the name doubling as the semantic
+    $inputs = @()
+    foreach ($parameter in $line -split ",")
+    {
+        $words = $parameter.Trim() -split "\s+"
+        if ($words.Count -ne 2) { throw "${List}($lineNumber): expected a type and semantic name, found '$($parameter.Trim())'" }
+        $inputs += "$($words[0]) $($words[1]) : $($words[1])"
+    }
+    $source = "float4 main(" + ($inputs -join " , ") + ") : SV_Position {return 0;}"
+    ++$listed
+
+    $output = Join-Path $OutDir "Signature_$([SignatureHash]::Hash($source)).cso"
+    if (Test-Path $output) { continue }
+
+    [System.IO.File]::WriteAllText($tempSource, $source)
+    & $Fxc /nologo /T vs_5_0 /E main /O0 /Fo $output $tempSource
+    if ($LASTEXITCODE -ne 0) { throw "${List}($lineNumber): error compiling input signature" }
+    ++$compiled
+}
+Remove-Item $tempSource -ErrorAction SilentlyContinue
+
+Write-Host "Input signatures: $listed listed, $compiled compiled"
@@ -0,0 +1,78 @@
+#--------------------------------------------------------------------------------------
+# Offline compiler for the lighting shader permutations
+#--------------------------------------------------------------------------------------
+# Compiles Lighting_ps.hlsl once for each line of the permutation list (ShaderPermutations.txt),
+# with that line's features defined, to Lighting_ps_<features>.cso. Run before each build by the
+# Visual Studio project. A permutation is only recompiled if its output is older than the shader
+# source or any of the include files.
+#
+# The feature bits and the file name must match Shader.h / Shader.cpp, and the list format is
+# described there.
+
+param(
+    [string]$Fxc = "fxc.exe",                   # Path to the shader compiler from the Windows SDK
+    [string]$List = "ShaderPermutations.txt",   # Permutations to compile
+    [string]$OutDir = ".",                      # Folder for the compiled shaders, where the app loads them from
+    [switch]$DebugInfo                          # Unoptimised with debug information, for graphics debuggers
+)
+
+$ErrorActionPreference = "Stop"
+Set-Location $PSScriptRoot
+
+$Source = "Lighting_ps.hlsl"
+$Features = [ordered]@{ NORMAL_MAP = 1; PARALLAX = 2; CELL_SHADING = 4; REFLECTION = 8; ALPHA_TEST = 16 }
+$NumLightsShift = 5
+
+# Newest of the source and the files it may include, outputs older than this are rebuilt
+$newestInput = (Get-Item $Source, "*.hlsli" | Measure-Object -Property LastWriteTime -Maximum).Maximum
+
+$lineNumber = 0
+$compiled = 0
+$done = @{}
+foreach ($line in Get-Content $List)
+{
+    ++$lineNumber
+    $line = ($line -split "#")[0].Trim()
+    if ($line -eq "") { continue }
+
+    # Convert the feature names to bits and defines as Shader.cpp's ParseShaderFeatures does
+    $bits = 0
+    $numLights = 2
+    $defines = @()
+    foreach ($word in $line -split "\s+")
+    {
+        if ($Features.Contains($word))
+        {
+            $bits = $bits -bor $Features[$word]
+            $defines += "/D", "$word=1"
+        }
+        elseif ($word -match "^NUM_LIGHTS=([0-2])$")
+        {
+            $numLights = [int]$Matches[1]
+        }
+        else
+        {
+            throw "${List}($lineNumber): unknown shader feature '$word'"
+        }
+    }
+    if ($bits -band $Features.PARALLAX) { $bits = $bits -bor $Features.NORMAL_MAP }
+    if (($bits -band $Features.NORMAL_MAP) -and ($bits -band $Features.CELL_SHADING))
+    {
+        throw "${List}($lineNumber): NORMAL_MAP / PARALLAX can't be used with CELL_SHADING"
+    }
+    $bits = $bits -bor ($numLights -shl $NumLightsShift)
+    $defines += "/D", "NUM_LIGHTS=$numLights"
+
+    if ($done.ContainsKey($bits)) { continue }
+    $done[$bits] = $true
+
+    $output = Join-Path $OutDir "Lighting_ps_$bits.cso"
+    if ((Test-Path $output) -and (Get-Item $output).LastWriteTime -ge $newestInput) { continue }
+
+    $options = if ($DebugInfo) { "/Od", "/Zi" } else { @("/O3") }
+    & $Fxc /nologo /T ps_5_0 /E main @options @defines /Fo $output $Source
+    if ($LASTEXITCODE -ne 0) { throw "Error compiling shader permutation '$line'" }
+    ++$compiled
+}
+
+Write-Host "Shader permutations: $($done.Count) listed, $compiled compiled"
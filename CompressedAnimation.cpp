@@ -0,0 +1,330 @@
+//--------------------------------------------------------------------------------------
+// Compressed keyframe animation
+//--------------------------------------------------------------------------------------
+
+#include "CompressedAnimation.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+//--------------------------------------------------------------------------------------
+// Quantisation
+//--------------------------------------------------------------------------------------
+namespace
+{
+    const float QUANTISE_16BIT = 65535.0f;
+    const float QUANTISE_15BIT = 32767.0f;
+
+    // The three smallest components of a unit quaternion are at most 1/sqrt(2) in size
+    const float SMALLEST_THREE_RANGE = 0.70710678f;
+
+
+    // Store a unit quaternion in 48 bits. The largest component is dropped (it can be rebuilt since the quaternion
+    // is unit length) and made positive (q and -q are the same rotation). The other three are stored in 15 bits each,
+    // with the index of the dropped component in the top bits of the first two values
+    void QuantiseQuaternion(const CQuaternion& q, uint16_t* out)
+    {
+        float components[4] = { q.w, q.x, q.y, q.z };
+        unsigned int largest = 0;
+        for (unsigned int i = 1; i < 4; ++i)  if (std::abs(components[i]) > std::abs(components[largest]))  largest = i;
+        float sign = (components[largest] < 0) ? -1.0f : 1.0f;
+
+        unsigned int c = 0;
+        for (unsigned int i = 0; i < 4; ++i)
+        {
+            if (i == largest)  continue;
+            float value = components[i] * sign / SMALLEST_THREE_RANGE; // -1 -> 1
+            value = std::min(std::max(value * 0.5f + 0.5f, 0.0f), 1.0f);
+            out[c++] = static_cast<uint16_t>(value * QUANTISE_15BIT + 0.5f);
+        }
+        out[0] |= static_cast<uint16_t>((largest >> 1) << 15);
+        out[1] |= static_cast<uint16_t>((largest & 1) << 15);
+    }
+
+    CQuaternion DequantiseQuaternion(const uint16_t* in)
+    {
+        unsigned int largest = ((in[0] >> 15) << 1) | (in[1] >> 15);
+        float smallest[3];
+        float sumSquares = 0;
+        for (unsigned int c = 0; c < 3; ++c)
+        {
+            float value = (in[c] & 0x7fff) * (1.0f / QUANTISE_15BIT);
+            smallest[c] = (value * 2.0f - 1.0f) * SMALLEST_THREE_RANGE;
+            sumSquares += smallest[c] * smallest[c];
+        }
+
+        float components[4];
+        unsigned int c = 0;
+        for (unsigned int i = 0; i < 4; ++i)
+        {
+            components[i] = (i == largest) ? std::sqrt(std::max(0.0f, 1.0f - sumSquares)) : smallest[c++];
+        }
+        return { components[0], components[1], components[2], components[3] };
+    }
+
+
+    // Store a vector in 48 bits, 16 bits per component over the range given by the channel
+    void QuantiseVector(const CVector3& v, const CompressedChannel& channel, uint16_t* out)
+    {
+        const float* value = &v.x;
+        const float* minimum = &channel.minimum.x;
+        const float* scale = &channel.scale.x;
+        for (int c = 0; c < 3; ++c)
+        {
+            float q = (scale[c] > 0) ? (value[c] - minimum[c]) / scale[c] : 0.0f;
+            out[c] = static_cast<uint16_t>(std::min(std::max(q + 0.5f, 0.0f), QUANTISE_16BIT));
+        }
+    }
+
+    inline CVector3 DequantiseVector(const uint16_t* in, const CompressedChannel& channel)
+    {
+        return { channel.minimum.x + in[0] * channel.scale.x,
+                 channel.minimum.y + in[1] * channel.scale.y,
+                 channel.minimum.z + in[2] * channel.scale.z };
+    }
+
+
+    // Difference between two rotations in radians
+    float RotationError(const CQuaternion& q1, const CQuaternion& q2)
+    {
+        return 2.0f * std::acos(std::min(1.0f, std::abs(Dot(q1, q2))));
+    }
+
+    // Largest difference in any component of two vectors
+    float VectorError(const CVector3& v1, const CVector3& v2)
+    {
+        return Max(std::abs(v1.x - v2.x), std::abs(v1.y - v2.y), std::abs(v1.z - v2.z));
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Compression
+//--------------------------------------------------------------------------------------
+namespace
+{
+    // Compress one channel given its value at every frame of the clip. Tries keeping every Nth frame for large N first,
+    // stopping at the first N where every frame can be rebuilt within the tolerance from the quantised samples
+    // - Setup prepares the channel's quantisation range from the kept samples (vectors only)
+    template <typename T, typename Setup, typename Encode, typename Decode, typename Interpolate, typename Error>
+    CompressedChannel CompressChannel(const std::vector<T>& frames, float tolerance, std::vector<uint16_t>& data,
+                                      Setup setup, Encode encode, Decode decode, Interpolate interpolate, Error error)
+    {
+        CompressedChannel channel;
+        channel.dataOffset = static_cast<uint32_t>(data.size());
+        unsigned int lastFrame = static_cast<unsigned int>(frames.size()) - 1;
+
+        // Constant channel
+        bool constant = true;
+        for (auto& frame : frames)  if (error(frame, frames[0]) > tolerance)  { constant = false;  break; }
+        if (constant)
+        {
+            std::vector<T> sample(1, frames[0]);
+            setup(channel, sample);
+            channel.numSamples = 1;
+            data.resize(data.size() + 3);
+            encode(frames[0], channel, &data[channel.dataOffset]);
+            return channel;
+        }
+
+        unsigned int step = 1;
+        while (step * 2 <= lastFrame && step * 2 <= 0x8000)  step *= 2;
+
+        std::vector<T> samples;
+        std::vector<uint16_t> encoded;
+        std::vector<T> decoded;
+        for (; step >= 1; step /= 2)
+        {
+            // Keep every step'th frame, the last sample may be past the end of the clip so it holds the final frame
+            unsigned int numSamples = (lastFrame + step - 1) / step + 1;
+            samples.resize(numSamples);
+            for (unsigned int s = 0; s < numSamples; ++s)  samples[s] = frames[std::min(s * step, lastFrame)];
+
+            channel.step = static_cast<uint16_t>(step);
+            channel.numSamples = static_cast<uint16_t>(numSamples);
+            setup(channel, samples);
+            encoded.resize(numSamples * 3);
+            decoded.resize(numSamples);
+            for (unsigned int s = 0; s < numSamples; ++s)
+            {
+                encode(samples[s], channel, &encoded[s * 3]);
+                decoded[s] = decode(&encoded[s * 3], channel);
+            }
+
+            // Rebuild every frame and check the error, always accept keeping every frame
+            bool accepted = (step == 1);
+            if (!accepted)
+            {
+                accepted = true;
+                for (unsigned int f = 0; f <= lastFrame && accepted; ++f)
+                {
+                    unsigned int s = f / step;
+                    float t = static_cast<float>(f - s * step) / step;
+                    T value = (t == 0) ? decoded[s] : interpolate(decoded[s], decoded[s + 1], t);
+                    accepted = (error(value, frames[f]) <= tolerance);
+                }
+            }
+            if (accepted)  break;
+        }
+
+        data.insert(data.end(), encoded.begin(), encoded.end());
+        return channel;
+    }
+
+
+    void SetupVectorRange(CompressedChannel& channel, const std::vector<CVector3>& samples)
+    {
+        CVector3 minimum = samples[0];
+        CVector3 maximum = samples[0];
+        for (auto& v : samples)
+        {
+            minimum = { std::min(minimum.x, v.x), std::min(minimum.y, v.y), std::min(minimum.z, v.z) };
+            maximum = { std::max(maximum.x, v.x), std::max(maximum.y, v.y), std::max(maximum.z, v.z) };
+        }
+        channel.minimum = minimum;
+        channel.scale = (maximum - minimum) * (1.0f / QUANTISE_16BIT);
+    }
+
+    CompressedChannel CompressVectorChannel(const std::vector<CVector3>& frames, float tolerance, std::vector<uint16_t>& data)
+    {
+        return CompressChannel(frames, tolerance, data, SetupVectorRange, QuantiseVector, DequantiseVector,
+                               [](const CVector3& v1, const CVector3& v2, float t) { return v1 + (v2 - v1) * t; }, VectorError);
+    }
+
+    CompressedChannel CompressRotationChannel(const std::vector<CQuaternion>& frames, float tolerance, std::vector<uint16_t>& data)
+    {
+        return CompressChannel(frames, tolerance, data,
+                               [](CompressedChannel&, const std::vector<CQuaternion>&) {},
+                               [](const CQuaternion& q, const CompressedChannel&, uint16_t* out) { QuantiseQuaternion(q, out); },
+                               [](const uint16_t* in, const CompressedChannel&) { return DequantiseQuaternion(in); },
+                               Nlerp, RotationError);
+    }
+}
+
+
+// Compress an animation clip. nodeReach is optional, giving for each node the distance to the furthest point moved by
+// the node, used to set the rotation tolerance for that node's track
+CompressedAnimationClip CompressAnimation(const AnimationClip& clip, const AnimationCompressionSettings& settings /*= {}*/,
+                                          const float* nodeReach /*= nullptr*/)
+{
+    CompressedAnimationClip compressed;
+    compressed.name = clip.name;
+    compressed.duration = clip.duration;
+    compressed.sampleRate = settings.sampleRate;
+
+    // Time of each frame at the sample rate, the last frame is the end of the clip
+    unsigned int numFrames = static_cast<unsigned int>(std::ceil(clip.duration * settings.sampleRate - 0.001f)) + 1;
+    std::vector<float> frameTimes(numFrames);
+    for (unsigned int f = 0; f < numFrames; ++f)  frameTimes[f] = std::min(f / settings.sampleRate, clip.duration);
+
+    std::vector<CVector3> vectorFrames(numFrames);
+    std::vector<CQuaternion> rotationFrames(numFrames);
+    for (auto& track : clip.tracks)
+    {
+        CompressedTrack compressedTrack;
+        compressedTrack.node = track.node;
+
+        if (!track.positionKeys.empty())
+        {
+            for (unsigned int f = 0; f < numFrames; ++f)  vectorFrames[f] = SampleKeys(track.positionKeys, frameTimes[f]);
+            compressedTrack.position = CompressVectorChannel(vectorFrames, settings.positionTolerance, compressed.data);
+        }
+
+        if (!track.rotationKeys.empty())
+        {
+            // A rotation error of e radians moves points at distance r from the node by about e * r
+            float tolerance = settings.rotationTolerance;
+            if (nodeReach && nodeReach[track.node] > 0)
+            {
+                tolerance = std::min(tolerance, settings.positionTolerance / nodeReach[track.node]);
+            }
+            for (unsigned int f = 0; f < numFrames; ++f)  rotationFrames[f] = SampleKeys(track.rotationKeys, frameTimes[f]);
+            compressedTrack.rotation = CompressRotationChannel(rotationFrames, tolerance, compressed.data);
+        }
+
+        if (!track.scaleKeys.empty())
+        {
+            for (unsigned int f = 0; f < numFrames; ++f)  vectorFrames[f] = SampleKeys(track.scaleKeys, frameTimes[f]);
+            compressedTrack.scale = CompressVectorChannel(vectorFrames, settings.scaleTolerance, compressed.data);
+        }
+
+        compressed.tracks.push_back(compressedTrack);
+    }
+
+    compressed.data.shrink_to_fit();
+    return compressed;
+}
+
+
+// Bytes used by this clip
+size_t CompressedAnimationClip::MemoryUsage() const
+{
+    return sizeof(*this) + name.capacity() + tracks.capacity() * sizeof(CompressedTrack) + data.capacity() * sizeof(uint16_t);
+}
+
+// Bytes used by an uncompressed clip, for comparison with the above
+size_t AnimationMemoryUsage(const AnimationClip& clip)
+{
+    size_t bytes = sizeof(clip) + clip.name.capacity() + clip.tracks.capacity() * sizeof(AnimationTrack);
+    for (auto& track : clip.tracks)
+    {
+        bytes += track.positionKeys.capacity() * sizeof(VectorKey) + track.rotationKeys.capacity() * sizeof(QuaternionKey) +
+                 track.scaleKeys.capacity() * sizeof(VectorKey);
+    }
+    return bytes;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Sampling
+//--------------------------------------------------------------------------------------
+namespace
+{
+    // Find the two samples either side of the given frame and the fraction between them
+    inline const uint16_t* FindSamples(const CompressedChannel& channel, const uint16_t* data, float frame, float& t)
+    {
+        const uint16_t* samples = data + channel.dataOffset;
+        float position = frame / channel.step;
+        unsigned int s = static_cast<unsigned int>(position);
+        if (s + 1 >= channel.numSamples)
+        {
+            t = 0;
+            return samples + (channel.numSamples - 1) * 3;
+        }
+        t = position - s;
+        return samples + s * 3;
+    }
+}
+
+
+// Sample a compressed clip at the given time (seconds), wrapping the time if looping or clamping to the ends otherwise
+void SampleAnimation(const CompressedAnimationClip& clip, float time, bool loop, NodeTransform* pose)
+{
+    float frame = ClipTime(time, clip.duration, loop) * clip.sampleRate;
+    const uint16_t* data = clip.data.data();
+
+    for (auto& track : clip.tracks)
+    {
+        auto& transform = pose[track.node];
+        float t;
+        if (track.position.numSamples > 0)
+        {
+            const uint16_t* sample = FindSamples(track.position, data, frame, t);
+            CVector3 v = DequantiseVector(sample, track.position);
+            transform.position = (t == 0) ? v : v + (DequantiseVector(sample + 3, track.position) - v) * t;
+        }
+        if (track.rotation.numSamples > 0)
+        {
+            const uint16_t* sample = FindSamples(track.rotation, data, frame, t);
+            CQuaternion q = DequantiseQuaternion(sample);
+            transform.rotation = (t == 0) ? q : Nlerp(q, DequantiseQuaternion(sample + 3), t);
+        }
+        if (track.scale.numSamples > 0)
+        {
+            const uint16_t* sample = FindSamples(track.scale, data, frame, t);
+            CVector3 v = DequantiseVector(sample, track.scale);
+            transform.scale = (t == 0) ? v : v + (DequantiseVector(sample + 3, track.scale) - v) * t;
+        }
+    }
+}
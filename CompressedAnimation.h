@@ -0,0 +1,82 @@
+//--------------------------------------------------------------------------------------
+// Compressed keyframe animation
+//--------------------------------------------------------------------------------------
+// Animation clips are converted to a compact form for playback:
+// - Each channel (position, rotation or scale of a node) is resampled at a fixed rate, so
+//   no key times are stored and finding the keys for a given time is a single divide
+// - Each channel keeps only every Nth sample, with N as large as possible (a power of 2)
+//   while interpolating between the kept samples stays within the channel's tolerance.
+//   Channels that don't change are stored as a single value
+// - Positions and scales are quantised to 16 bits per component over the channel's range,
+//   rotations use 48 bits (the three smallest components of the quaternion at 15 bits each)
+// Rotation tolerances are set per track: a rotation error moves everything beneath the node
+// by the error times the node's "reach", so nodes with larger reach get tighter tolerances.
+// No DirectX in here so clips can be compressed and sampled (and tested) headless.
+
+#ifndef _COMPRESSED_ANIMATION_H_INCLUDED_
+#define _COMPRESSED_ANIMATION_H_INCLUDED_
+
+#include "Animation.h"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+
+// Settings used when compressing a clip
+struct AnimationCompressionSettings
+{
+    float sampleRate        = 30.0f;  // Samples per second before removing unneeded samples
+    float positionTolerance = 0.001f; // Largest error allowed in positions, in model units
+    float scaleTolerance    = 0.001f; // Largest error allowed in scales
+    float rotationTolerance = 0.002f; // Largest rotation error allowed (radians) for nodes with no reach given
+};
+
+
+// One channel of a compressed track. The samples are stored in the clip's data array
+struct CompressedChannel
+{
+    uint32_t dataOffset = 0; // Index into the clip's data of the first sample
+    uint16_t step       = 1; // Number of frames (at the clip's sample rate) between samples
+    uint16_t numSamples = 0; // 0 if the channel is not animated, 1 if it is constant
+    CVector3 minimum    = { 0, 0, 0 }; // Dequantised value = minimum + quantised * scale (positions and scales only)
+    CVector3 scale      = { 0, 0, 0 };
+};
+
+struct CompressedTrack
+{
+    unsigned int      node;
+    CompressedChannel position;
+    CompressedChannel rotation;
+    CompressedChannel scale;
+};
+
+
+struct CompressedAnimationClip
+{
+    std::string                  name;
+    float                        duration = 0; // In seconds
+    float                        sampleRate = 30;
+    std::vector<CompressedTrack> tracks;
+    std::vector<uint16_t>        data; // 3 values per sample for every channel type
+
+    // Bytes used by this clip
+    size_t MemoryUsage() const;
+};
+
+
+// Compress an animation clip. nodeReach is optional, giving for each node the distance to the furthest point moved by
+// the node (e.g. the radius of the geometry beneath it), used to set the rotation tolerance for that node's track
+CompressedAnimationClip CompressAnimation(const AnimationClip& clip, const AnimationCompressionSettings& settings = {},
+                                          const float* nodeReach = nullptr);
+
+// Bytes used by an uncompressed clip, for comparison with the above
+size_t AnimationMemoryUsage(const AnimationClip& clip);
+
+
+// Sample a compressed clip at the given time (seconds), wrapping the time if looping or clamping to the ends otherwise
+// Only the nodes with tracks in the clip are written to the pose, which must have an entry for every node
+void SampleAnimation(const CompressedAnimationClip& clip, float time, bool loop, NodeTransform* pose);
+
+
+#endif //_COMPRESSED_ANIMATION_H_INCLUDED_
@@ -0,0 +1,236 @@
+//--------------------------------------------------------------------------------------
+// DDS texture files read in place from a memory mapping
+//--------------------------------------------------------------------------------------
+
+#include "DDSFile.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+
+namespace
+{
+    // Layout of the start of a DDS file: magic number then header, optionally followed by a DX10 header, then the data
+    const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+
+    struct DDSPixelFormat
+    {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t fourCC;
+        uint32_t rgbBitCount;
+        uint32_t rBitMask;
+        uint32_t gBitMask;
+        uint32_t bBitMask;
+        uint32_t aBitMask;
+    };
+
+    struct DDSHeader
+    {
+        uint32_t       magic;
+        uint32_t       size;
+        uint32_t       flags;
+        uint32_t       height;
+        uint32_t       width;
+        uint32_t       pitchOrLinearSize;
+        uint32_t       depth;
+        uint32_t       mipMapCount;
+        uint32_t       reserved1[11];
+        DDSPixelFormat pixelFormat;
+        uint32_t       caps;
+        uint32_t       caps2;
+        uint32_t       caps3;
+        uint32_t       caps4;
+        uint32_t       reserved2;
+    };
+    static_assert(sizeof(DDSHeader) == 128, "DDS header layout");
+
+    struct DDSHeaderDX10
+    {
+        uint32_t dxgiFormat;
+        uint32_t resourceDimension;
+        uint32_t miscFlag;
+        uint32_t arraySize;
+        uint32_t miscFlags2;
+    };
+    static_assert(sizeof(DDSHeaderDX10) == 20, "DDS DX10 header layout");
+
+    const uint32_t DDPF_ALPHAPIXELS = 0x1;
+    const uint32_t DDPF_FOURCC      = 0x4;
+    const uint32_t DDPF_RGB         = 0x40;
+
+    const uint32_t DDSCAPS2_CUBEMAP     = 0x200;
+    const uint32_t DDSCAPS2_ALLFACES    = 0xfc00;
+    const uint32_t DDSCAPS2_VOLUME      = 0x200000;
+
+    const uint32_t DX10_DIMENSION_TEXTURE2D = 3;
+    const uint32_t DX10_MISC_TEXTURECUBE    = 0x4;
+
+    // DirectX limits on 2D textures
+    const uint32_t MAX_SIZE       = 16384;
+    const uint32_t MAX_ARRAY_SIZE = 2048;
+
+    // The DXGI_FORMAT values supported, so this file doesn't need the DirectX headers
+    const uint32_t FORMAT_R8G8B8A8_UNORM      = 28;
+    const uint32_t FORMAT_R8G8B8A8_UNORM_SRGB = 29;
+    const uint32_t FORMAT_BC1_UNORM           = 71;
+    const uint32_t FORMAT_BC1_UNORM_SRGB      = 72;
+    const uint32_t FORMAT_BC2_UNORM           = 74;
+    const uint32_t FORMAT_BC2_UNORM_SRGB      = 75;
+    const uint32_t FORMAT_BC3_UNORM           = 77;
+    const uint32_t FORMAT_BC3_UNORM_SRGB      = 78;
+    const uint32_t FORMAT_BC4_UNORM           = 80;
+    const uint32_t FORMAT_BC4_SNORM           = 81;
+    const uint32_t FORMAT_BC5_UNORM           = 83;
+    const uint32_t FORMAT_BC5_SNORM           = 84;
+    const uint32_t FORMAT_B8G8R8A8_UNORM      = 87;
+    const uint32_t FORMAT_B8G8R8X8_UNORM      = 88;
+    const uint32_t FORMAT_B8G8R8A8_UNORM_SRGB = 91;
+    const uint32_t FORMAT_B8G8R8X8_UNORM_SRGB = 93;
+    const uint32_t FORMAT_BC6H_UF16           = 95;
+    const uint32_t FORMAT_BC6H_SF16           = 96;
+    const uint32_t FORMAT_BC7_UNORM           = 98;
+    const uint32_t FORMAT_BC7_UNORM_SRGB      = 99;
+
+    uint32_t FourCC(const char code[4])
+    {
+        return static_cast<uint32_t>(code[0]) | (static_cast<uint32_t>(code[1]) << 8) |
+               (static_cast<uint32_t>(code[2]) << 16) | (static_cast<uint32_t>(code[3]) << 24);
+    }
+
+    // Bytes per 4x4 block of a block compressed format, 0 for other supported formats, or -1 if not supported
+    int BlockBytes(uint32_t format)
+    {
+        switch (format)
+        {
+        case FORMAT_BC1_UNORM: case FORMAT_BC1_UNORM_SRGB:
+        case FORMAT_BC4_UNORM: case FORMAT_BC4_SNORM:
+            return 8;
+
+        case FORMAT_BC2_UNORM: case FORMAT_BC2_UNORM_SRGB:
+        case FORMAT_BC3_UNORM: case FORMAT_BC3_UNORM_SRGB:
+        case FORMAT_BC5_UNORM: case FORMAT_BC5_SNORM:
+        case FORMAT_BC6H_UF16: case FORMAT_BC6H_SF16:
+        case FORMAT_BC7_UNORM: case FORMAT_BC7_UNORM_SRGB:
+            return 16;
+
+        case FORMAT_R8G8B8A8_UNORM: case FORMAT_R8G8B8A8_UNORM_SRGB:
+        case FORMAT_B8G8R8A8_UNORM: case FORMAT_B8G8R8A8_UNORM_SRGB:
+        case FORMAT_B8G8R8X8_UNORM: case FORMAT_B8G8R8X8_UNORM_SRGB:
+            return 0;
+
+        default:
+            return -1;
+        }
+    }
+
+    // DXGI format for a pixel format in the original header, 0 if not supported
+    uint32_t LegacyFormat(const DDSPixelFormat& pf)
+    {
+        if (pf.flags & DDPF_FOURCC)
+        {
+            if (pf.fourCC == FourCC("DXT1"))  return FORMAT_BC1_UNORM;
+            if (pf.fourCC == FourCC("DXT2") || pf.fourCC == FourCC("DXT3"))  return FORMAT_BC2_UNORM;
+            if (pf.fourCC == FourCC("DXT4") || pf.fourCC == FourCC("DXT5"))  return FORMAT_BC3_UNORM;
+            if (pf.fourCC == FourCC("ATI1") || pf.fourCC == FourCC("BC4U"))  return FORMAT_BC4_UNORM;
+            if (pf.fourCC == FourCC("BC4S"))  return FORMAT_BC4_SNORM;
+            if (pf.fourCC == FourCC("ATI2") || pf.fourCC == FourCC("BC5U"))  return FORMAT_BC5_UNORM;
+            if (pf.fourCC == FourCC("BC5S"))  return FORMAT_BC5_SNORM;
+            return 0;
+        }
+        if ((pf.flags & DDPF_RGB) && pf.rgbBitCount == 32)
+        {
+            uint32_t alpha = (pf.flags & DDPF_ALPHAPIXELS) ? pf.aBitMask : 0;
+            if (pf.rBitMask == 0x00ff0000 && pf.gBitMask == 0x0000ff00 && pf.bBitMask == 0x000000ff)
+            {
+                return alpha == 0xff000000 ? FORMAT_B8G8R8A8_UNORM : FORMAT_B8G8R8X8_UNORM;
+            }
+            if (pf.rBitMask == 0x000000ff && pf.gBitMask == 0x0000ff00 && pf.bBitMask == 0x00ff0000 && alpha == 0xff000000)
+            {
+                return FORMAT_R8G8B8A8_UNORM;
+            }
+        }
+        return 0;
+    }
+}
+
+
+// Map a DDS file and check its headers and size
+DDSFile::DDSFile(const std::string& fileName) : mFile(fileName)
+{
+    const char* fileData = static_cast<const char*>(mFile.Data());
+    size_t fileSize = mFile.Size();
+    auto fail = [&](const char* reason) { throw std::runtime_error("Error in DDS file " + fileName + ": " + reason); };
+
+    // Headers are copied out rather than used in place, the mapping has no alignment guarantees beyond the page
+    DDSHeader header;
+    if (fileSize < sizeof(header))  fail("too short");
+    std::memcpy(&header, fileData, sizeof(header));
+    if (header.magic != DDS_MAGIC || header.size != sizeof(header) - sizeof(header.magic))  fail("not a DDS file");
+
+    size_t dataOffset = sizeof(header);
+    mWidth = header.width;
+    mHeight = header.height;
+    mNumMips = std::max(header.mipMapCount, 1u); // Zero means there is only the top level
+    if ((header.pixelFormat.flags & DDPF_FOURCC) && header.pixelFormat.fourCC == FourCC("DX10"))
+    {
+        DDSHeaderDX10 dx10;
+        if (fileSize < dataOffset + sizeof(dx10))  fail("too short");
+        std::memcpy(&dx10, fileData + dataOffset, sizeof(dx10));
+        dataOffset += sizeof(dx10);
+
+        if (dx10.resourceDimension != DX10_DIMENSION_TEXTURE2D)  fail("only 2D textures are supported");
+        mFormat = dx10.dxgiFormat;
+        mCubeMap = (dx10.miscFlag & DX10_MISC_TEXTURECUBE) != 0;
+        if (dx10.arraySize == 0 || dx10.arraySize > MAX_ARRAY_SIZE / (mCubeMap ? 6 : 1))  fail("bad array size");
+        mArraySize = dx10.arraySize * (mCubeMap ? 6 : 1);
+    }
+    else
+    {
+        if (header.caps2 & DDSCAPS2_VOLUME)  fail("volume textures are not supported");
+        mFormat = LegacyFormat(header.pixelFormat);
+        mCubeMap = (header.caps2 & DDSCAPS2_CUBEMAP) != 0;
+        if (mCubeMap && (header.caps2 & DDSCAPS2_ALLFACES) != DDSCAPS2_ALLFACES)  fail("cube maps must have all six faces");
+        mArraySize = mCubeMap ? 6 : 1;
+    }
+
+    int blockBytes = BlockBytes(mFormat);
+    if (mFormat == 0 || blockBytes < 0)  fail("unsupported format");
+    mBlockBytes = static_cast<uint32_t>(blockBytes);
+
+    if (mWidth == 0 || mHeight == 0 || mWidth > MAX_SIZE || mHeight > MAX_SIZE)  fail("bad dimensions");
+    if (mCubeMap && mWidth != mHeight)  fail("cube map faces must be square");
+    uint32_t fullChain = 1;
+    while ((std::max(mWidth, mHeight) >> fullChain) > 0)  ++fullChain;
+    if (mNumMips > fullChain)  fail("too many mips");
+
+    // Each image's mips follow each other without padding, each half the size of the one before, then the next image
+    uint64_t offset = dataOffset;
+    mSubresources.reserve(static_cast<size_t>(mArraySize) * mNumMips);
+    for (uint32_t image = 0; image < mArraySize; ++image)
+    {
+        for (uint32_t mip = 0; mip < mNumMips; ++mip)
+        {
+            DDSSubresource subresource;
+            subresource.width  = std::max(1u, mWidth  >> mip);
+            subresource.height = std::max(1u, mHeight >> mip);
+            if (mBlockBytes > 0)
+            {
+                subresource.rowPitch = std::max(1u, (subresource.width + 3) / 4) * mBlockBytes;
+                subresource.size = subresource.rowPitch * std::max(1u, (subresource.height + 3) / 4);
+            }
+            else
+            {
+                subresource.rowPitch = subresource.width * 4;
+                subresource.size = subresource.rowPitch * subresource.height;
+            }
+            subresource.fileOffset = offset;
+            offset += subresource.size;
+            if (offset > fileSize)  fail("data is truncated");
+
+            subresource.data = fileData + subresource.fileOffset;
+            mSubresources.push_back(subresource);
+        }
+    }
+}
@@ -0,0 +1,78 @@
+//--------------------------------------------------------------------------------------
+// DDS texture files read in place from a memory mapping
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+// The file is memory mapped and its headers checked, then the data of each mip of each image
+// (array slice or cube face) is found where it lies in the mapping. Nothing is read or copied
+// up front: the spans point straight into the file, so they can be handed to the GPU as the
+// initial data of a texture and the OS pages the file in as the driver reads it.
+//
+// Both the original header and the DX10 extension header are understood. Supported are 2D
+// textures, texture arrays and cube maps (and cube map arrays) in BC1-BC7 and 32-bit RGBA / BGRA
+// formats. Volume textures, 1D textures and other formats are rejected. Has no DirectX dependency,
+// formats are given as DXGI_FORMAT values, so it can be used and checked on any platform.
+
+#ifndef _DDS_FILE_H_INCLUDED_
+#define _DDS_FILE_H_INCLUDED_
+
+#include "MappedFile.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+// One mip of one image in a DDS file
+struct DDSSubresource
+{
+    const void* data;       // Points into the mapped file
+    uint64_t    fileOffset;
+    uint32_t    size;       // Bytes
+    uint32_t    rowPitch;   // Bytes from one row of pixels to the next, or one row of 4x4 blocks for compressed formats
+    uint32_t    width;
+    uint32_t    height;
+};
+
+
+class DDSFile
+{
+public:
+    // Map a DDS file and check its headers and size
+    // Will throw a std::runtime_error exception on failure (since constructors can't return errors)
+    DDSFile(const std::string& fileName);
+
+    // The mapping can't be shared
+    DDSFile(const DDSFile&) = delete;
+    DDSFile& operator=(const DDSFile&) = delete;
+
+    uint32_t Format()             { return mFormat; } // DXGI_FORMAT
+    uint32_t Width()              { return mWidth; }
+    uint32_t Height()             { return mHeight; }
+    uint32_t NumberMips()         { return mNumMips; }
+    uint32_t ArraySize()          { return mArraySize; } // Number of images, 6 for each cube in a cube map
+    bool     IsCubeMap()          { return mCubeMap; }
+    bool     IsBlockCompressed()  { return mBlockBytes > 0; }
+
+    // Data of a mip of an image (array slice, or cube face in the order +X -X +Y -Y +Z -Z)
+    const DDSSubresource& Subresource(unsigned int image, unsigned int mip)  { return mSubresources[image * mNumMips + mip]; }
+
+    // All the subresources in DirectX order, each image's mips in turn, most detailed first
+    const std::vector<DDSSubresource>& Subresources()  { return mSubresources; }
+
+
+private:
+    MappedFile mFile;
+
+    uint32_t mFormat     = 0;
+    uint32_t mBlockBytes = 0; // Bytes per 4x4 block, 0 if not block compressed
+    uint32_t mWidth      = 0;
+    uint32_t mHeight     = 0;
+    uint32_t mNumMips    = 0;
+    uint32_t mArraySize  = 0;
+    bool     mCubeMap    = false;
+
+    std::vector<DDSSubresource> mSubresources;
+};
+
+
+#endif //_DDS_FILE_H_INCLUDED_
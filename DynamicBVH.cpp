@@ -0,0 +1,774 @@
+//--------------------------------------------------------------------------------------
+// Dynamic bounding volume hierarchy - a tree of boxes for fast spatial queries
+//--------------------------------------------------------------------------------------
+
+#include "DynamicBVH.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define BVH_USE_SSE
+#include <emmintrin.h>
+#endif
+
+
+// Bins per axis when looking for the split with the lowest SAH cost. More bins find slightly better splits but take
+// longer to build
+const unsigned int SAH_BINS = 12;
+
+// Bounds of an empty child, the reductions in NodeBounds skip them
+const float EMPTY_MIN = std::numeric_limits<float>::max();
+const float EMPTY_MAX = -std::numeric_limits<float>::max();
+
+
+namespace
+{
+    float Axis(const CVector3& v, unsigned int axis)  { return axis == 0 ? v.x : (axis == 1 ? v.y : v.z); }
+
+    // Half the surface area of a box, the SAH only needs relative areas
+    float HalfArea(const BoundingBox& box)
+    {
+        float x = box.maxBounds.x - box.minBounds.x, y = box.maxBounds.y - box.minBounds.y, z = box.maxBounds.z - box.minBounds.z;
+        return x * y + y * z + z * x;
+    }
+
+    BoundingBox Union(const BoundingBox& a, const BoundingBox& b)
+    {
+        return { { std::min(a.minBounds.x, b.minBounds.x), std::min(a.minBounds.y, b.minBounds.y), std::min(a.minBounds.z, b.minBounds.z) },
+                 { std::max(a.maxBounds.x, b.maxBounds.x), std::max(a.maxBounds.y, b.maxBounds.y), std::max(a.maxBounds.z, b.maxBounds.z) } };
+    }
+
+    const BoundingBox EMPTY_BOX = { { EMPTY_MIN, EMPTY_MIN, EMPTY_MIN }, { EMPTY_MAX, EMPTY_MAX, EMPTY_MAX } };
+}
+
+
+//--------------------------------------------------------------------------------------
+// Tests of four child boxes at once
+//--------------------------------------------------------------------------------------
+// Each returns a bit set for each child that passes (bits 0 to 3). Empty children may give any result, the traversal
+// ignores them
+
+namespace
+{
+    // Boxes that may be inside the frustum, testing the corner of each box furthest along each plane normal. Also sets
+    // bits 4 to 7 for boxes entirely inside, where the nearest corner to each plane is inside it
+    template <class Node> int FrustumTest(const Node& node, const CFrustum& frustum)
+    {
+#ifdef BVH_USE_SSE
+        const __m128 minX = _mm_loadu_ps(node.minX), minY = _mm_loadu_ps(node.minY), minZ = _mm_loadu_ps(node.minZ);
+        const __m128 maxX = _mm_loadu_ps(node.maxX), maxY = _mm_loadu_ps(node.maxY), maxZ = _mm_loadu_ps(node.maxZ);
+        __m128 outside = _mm_setzero_ps(), crossing = _mm_setzero_ps();
+        for (int p = 0; p < 6; ++p)
+        {
+            const CVector3& normal = frustum.normals[p];
+            const __m128 normalX = _mm_set1_ps(normal.x), normalY = _mm_set1_ps(normal.y), normalZ = _mm_set1_ps(normal.z);
+            const __m128 planeDistance = _mm_set1_ps(frustum.distances[p]);
+            __m128 furthest = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, normal.x >= 0 ? maxX : minX),
+                                                    _mm_mul_ps(normalY, normal.y >= 0 ? maxY : minY)),
+                                         _mm_add_ps(_mm_mul_ps(normalZ, normal.z >= 0 ? maxZ : minZ), planeDistance));
+            __m128 nearest  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, normal.x >= 0 ? minX : maxX),
+                                                    _mm_mul_ps(normalY, normal.y >= 0 ? minY : maxY)),
+                                         _mm_add_ps(_mm_mul_ps(normalZ, normal.z >= 0 ? minZ : maxZ), planeDistance));
+            outside  = _mm_or_ps(outside,  _mm_cmplt_ps(furthest, _mm_setzero_ps()));
+            crossing = _mm_or_ps(crossing, _mm_cmplt_ps(nearest,  _mm_setzero_ps()));
+        }
+        int visible = ~_mm_movemask_ps(outside) & 0xf;
+        int inside  = ~_mm_movemask_ps(crossing) & 0xf;
+        return visible | inside << 4;
+#else
+        int mask = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            bool visible = true, inside = true;
+            for (int p = 0; p < 6; ++p)
+            {
+                const CVector3& normal = frustum.normals[p];
+                float furthest = normal.x * (normal.x >= 0 ? node.maxX[i] : node.minX[i]) + normal.y * (normal.y >= 0 ? node.maxY[i] : node.minY[i]) +
+                                 normal.z * (normal.z >= 0 ? node.maxZ[i] : node.minZ[i]) + frustum.distances[p];
+                float nearest  = normal.x * (normal.x >= 0 ? node.minX[i] : node.maxX[i]) + normal.y * (normal.y >= 0 ? node.minY[i] : node.maxY[i]) +
+                                 normal.z * (normal.z >= 0 ? node.minZ[i] : node.maxZ[i]) + frustum.distances[p];
+                if (furthest < 0)  visible = false;
+                if (nearest  < 0)  inside = false;
+            }
+            if (visible)  mask |= 1 << i;
+            if (inside)   mask |= 0x10 << i;
+        }
+        return mask;
+#endif
+    }
+
+    // Boxes touching the sphere, where the nearest point in the box to the centre is within the radius
+    template <class Node> int SphereTest(const Node& node, const CVector3& centre, float radius)
+    {
+#ifdef BVH_USE_SSE
+        const __m128 centreX = _mm_set1_ps(centre.x), centreY = _mm_set1_ps(centre.y), centreZ = _mm_set1_ps(centre.z);
+        __m128 x = _mm_sub_ps(_mm_min_ps(_mm_max_ps(centreX, _mm_loadu_ps(node.minX)), _mm_loadu_ps(node.maxX)), centreX);
+        __m128 y = _mm_sub_ps(_mm_min_ps(_mm_max_ps(centreY, _mm_loadu_ps(node.minY)), _mm_loadu_ps(node.maxY)), centreY);
+        __m128 z = _mm_sub_ps(_mm_min_ps(_mm_max_ps(centreZ, _mm_loadu_ps(node.minZ)), _mm_loadu_ps(node.maxZ)), centreZ);
+        __m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+        return _mm_movemask_ps(_mm_cmple_ps(distanceSquared, _mm_set1_ps(radius * radius)));
+#else
+        int mask = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            float x = std::min(std::max(centre.x, node.minX[i]), node.maxX[i]) - centre.x;
+            float y = std::min(std::max(centre.y, node.minY[i]), node.maxY[i]) - centre.y;
+            float z = std::min(std::max(centre.z, node.minZ[i]), node.maxZ[i]) - centre.z;
+            if (x * x + y * y + z * z <= radius * radius)  mask |= 1 << i;
+        }
+        return mask;
+#endif
+    }
+
+    // Boxes overlapping the box
+    template <class Node> int BoxTest(const Node& node, const BoundingBox& box)
+    {
+#ifdef BVH_USE_SSE
+        __m128 overlap = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(node.minX), _mm_set1_ps(box.maxBounds.x)),
+                                    _mm_cmpge_ps(_mm_loadu_ps(node.maxX), _mm_set1_ps(box.minBounds.x)));
+        overlap = _mm_and_ps(overlap, _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(node.minY), _mm_set1_ps(box.maxBounds.y)),
+                                                 _mm_cmpge_ps(_mm_loadu_ps(node.maxY), _mm_set1_ps(box.minBounds.y))));
+        overlap = _mm_and_ps(overlap, _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(node.minZ), _mm_set1_ps(box.maxBounds.z)),
+                                                 _mm_cmpge_ps(_mm_loadu_ps(node.maxZ), _mm_set1_ps(box.minBounds.z))));
+        return _mm_movemask_ps(overlap);
+#else
+        int mask = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            if (node.minX[i] <= box.maxBounds.x && node.maxX[i] >= box.minBounds.x &&
+                node.minY[i] <= box.maxBounds.y && node.maxY[i] >= box.minBounds.y &&
+                node.minZ[i] <= box.maxBounds.z && node.maxZ[i] >= box.minBounds.z)  mask |= 1 << i;
+        }
+        return mask;
+#endif
+    }
+
+    // Boxes hit by a ray between 0 and maxDistance, using the slab test: the ray is in the box between where it has
+    // entered the slabs of all three axes and where it leaves the first of them. Also writes the distance each box is
+    // entered
+    template <class Node> int RayTest(const Node& node, const CVector3& origin, const CVector3& inverseDirection,
+                                      float maxDistance, float* entry)
+    {
+#ifdef BVH_USE_SSE
+        const __m128 originX = _mm_set1_ps(origin.x), originY = _mm_set1_ps(origin.y), originZ = _mm_set1_ps(origin.z);
+        const __m128 inverseX = _mm_set1_ps(inverseDirection.x), inverseY = _mm_set1_ps(inverseDirection.y);
+        const __m128 inverseZ = _mm_set1_ps(inverseDirection.z);
+        __m128 x1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minX), originX), inverseX);
+        __m128 x2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxX), originX), inverseX);
+        __m128 y1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minY), originY), inverseY);
+        __m128 y2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxY), originY), inverseY);
+        __m128 z1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minZ), originZ), inverseZ);
+        __m128 z2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxZ), originZ), inverseZ);
+        __m128 nearest = _mm_max_ps(_mm_max_ps(_mm_min_ps(x1, x2), _mm_min_ps(y1, y2)), _mm_max_ps(_mm_min_ps(z1, z2), _mm_setzero_ps()));
+        __m128 furthest = _mm_min_ps(_mm_min_ps(_mm_max_ps(x1, x2), _mm_max_ps(y1, y2)), _mm_min_ps(_mm_max_ps(z1, z2), _mm_set1_ps(maxDistance)));
+        _mm_storeu_ps(entry, nearest);
+        return _mm_movemask_ps(_mm_cmple_ps(nearest, furthest));
+#else
+        int mask = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            float x1 = (node.minX[i] - origin.x) * inverseDirection.x, x2 = (node.maxX[i] - origin.x) * inverseDirection.x;
+            float y1 = (node.minY[i] - origin.y) * inverseDirection.y, y2 = (node.maxY[i] - origin.y) * inverseDirection.y;
+            float z1 = (node.minZ[i] - origin.z) * inverseDirection.z, z2 = (node.maxZ[i] - origin.z) * inverseDirection.z;
+            float nearest = std::max(std::max(std::min(x1, x2), std::min(y1, y2)), std::max(std::min(z1, z2), 0.0f));
+            float furthest = std::min(std::min(std::max(x1, x2), std::max(y1, y2)), std::min(std::max(z1, z2), maxDistance));
+            entry[i] = nearest;
+            if (nearest <= furthest)  mask |= 1 << i;
+        }
+        return mask;
+#endif
+    }
+
+    // Reciprocal of each component of a ray direction, infinite for zero components so their slabs never limit the ray
+    CVector3 InverseDirection(const CVector3& direction)
+    {
+        const float infinity = std::numeric_limits<float>::infinity();
+        return { direction.x != 0 ? 1 / direction.x : infinity,
+                 direction.y != 0 ? 1 / direction.y : infinity,
+                 direction.z != 0 ? 1 / direction.z : infinity };
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Building and changing the tree
+//--------------------------------------------------------------------------------------
+
+// Add an item, descending from the root to the child whose bounds grow least, until there is an empty child to use or
+// the chosen child is an item, which is replaced by a new node holding both
+DynamicBVH::ItemID DynamicBVH::Insert(const BoundingBox& bounds, uint32_t value)
+{
+    ItemID id;
+    if (!mFreeItems.empty())
+    {
+        id = mFreeItems.back();
+        mFreeItems.pop_back();
+    }
+    else
+    {
+        id = static_cast<ItemID>(mItems.size());
+        mItems.emplace_back();
+    }
+    mItems[id].bounds = bounds;
+    mItems[id].value = value;
+    ++mNumItems;
+
+    if (mRoot == NO_NODE)  mRoot = NewNode(NO_NODE, 0);
+    uint32_t node = mRoot;
+    while (true)
+    {
+        // Nodes above were grown on the way down, so there is nothing more to update
+        for (uint32_t slot = 0; slot < 4; ++slot)
+        {
+            if (mNodes[node].children[slot] == EMPTY_CHILD)
+            {
+                SetChild(node, slot, LEAF | id, bounds);
+                return id;
+            }
+        }
+
+        uint32_t bestSlot = 0;
+        float bestGrowth = 0, bestArea = 0;
+        BoundingBox bestUnion;
+        for (uint32_t slot = 0; slot < 4; ++slot)
+        {
+            const Node& n = mNodes[node];
+            BoundingBox child = { { n.minX[slot], n.minY[slot], n.minZ[slot] }, { n.maxX[slot], n.maxY[slot], n.maxZ[slot] } };
+            BoundingBox grown = Union(child, bounds);
+            float area = HalfArea(child);
+            float growth = HalfArea(grown) - area;
+            if (slot == 0 || growth < bestGrowth || (growth == bestGrowth && area < bestArea))
+            {
+                bestSlot = slot;
+                bestGrowth = growth;
+                bestArea = area;
+                bestUnion = grown;
+            }
+        }
+
+        uint32_t child = mNodes[node].children[bestSlot];
+        if (child & LEAF)
+        {
+            uint32_t newNode = NewNode(node, bestSlot);
+            SetChild(newNode, 0, child, mItems[child & ~LEAF].bounds);
+            SetChild(newNode, 1, LEAF | id, bounds);
+            SetChild(node, bestSlot, newNode, bestUnion);
+            return id;
+        }
+        SetChild(node, bestSlot, child, bestUnion);
+        node = child;
+    }
+}
+
+
+// Empty the item's child, freeing nodes left with no children, then shrink the nodes above
+void DynamicBVH::Remove(ItemID item)
+{
+    if (item >= mItems.size() || mItems[item].node == NO_NODE)  return;
+
+    uint32_t node = mItems[item].node;
+    SetChild(node, mItems[item].slot, EMPTY_CHILD, EMPTY_BOX);
+    mItems[item].node = NO_NODE;
+    mFreeItems.push_back(item);
+    --mNumItems;
+
+    auto IsEmpty = [&](uint32_t n)
+    {
+        auto& children = mNodes[n].children;
+        return children[0] == EMPTY_CHILD && children[1] == EMPTY_CHILD && children[2] == EMPTY_CHILD && children[3] == EMPTY_CHILD;
+    };
+    while (IsEmpty(node))
+    {
+        uint32_t parent = mNodes[node].parent;
+        uint32_t parentSlot = mNodes[node].parentSlot;
+        FreeNode(node);
+        if (parent == NO_NODE)
+        {
+            mRoot = NO_NODE;
+            return;
+        }
+        SetChild(parent, parentSlot, EMPTY_CHILD, EMPTY_BOX);
+        node = parent;
+    }
+    RefitUpwards(node);
+}
+
+
+// Set the item's own bounds and queue its node for the next refit
+void DynamicBVH::Move(ItemID item, const BoundingBox& bounds)
+{
+    Item& moved = mItems[item];
+    moved.bounds = bounds;
+    SetChild(moved.node, moved.slot, LEAF | item, bounds);
+    if (!mNodes[moved.node].refitQueued)
+    {
+        mNodes[moved.node].refitQueued = 1;
+        mRefitNodes.push_back(moved.node);
+    }
+}
+
+
+// Mark the nodes above those with moved items, then update the marked nodes from the bottom up so each is only
+// updated once however many of the items below it moved. Nodes freed since they were queued have had their mark cleared
+void DynamicBVH::Refit()
+{
+    for (auto node : mRefitNodes)
+    {
+        if (!mNodes[node].refitQueued)  continue;
+        for (uint32_t parent = mNodes[node].parent; parent != NO_NODE && !mNodes[parent].refitQueued; parent = mNodes[parent].parent)
+        {
+            mNodes[parent].refitQueued = 1;
+        }
+    }
+    mRefitNodes.clear();
+    if (mRoot != NO_NODE && mNodes[mRoot].refitQueued)  RefitNode(mRoot);
+}
+
+
+// Throw away the nodes and build them again from all the items
+void DynamicBVH::Rebuild()
+{
+    std::vector<BuildItem> items;
+    items.reserve(mNumItems);
+    for (ItemID id = 0; id < mItems.size(); ++id)
+    {
+        const BoundingBox& bounds = mItems[id].bounds;
+        CVector3 centre = { bounds.minBounds.x + bounds.maxBounds.x, bounds.minBounds.y + bounds.maxBounds.y,
+                            bounds.minBounds.z + bounds.maxBounds.z };
+        if (mItems[id].node != NO_NODE)  items.push_back({ bounds, centre, id });
+    }
+
+    mNodes.clear();
+    mFreeNodes.clear();
+    mRefitNodes.clear();
+    mNodes.reserve(items.size() / 2 + 1); // Usually enough for the nodes, as each has 2 to 4 children
+    mRoot = items.empty() ? NO_NODE : BuildNode(items.data(), static_cast<unsigned int>(items.size()), NO_NODE, 0);
+}
+
+
+void DynamicBVH::Build(const std::vector<BoundingBox>& boxes)
+{
+    Clear();
+    mItems.resize(boxes.size());
+    for (ItemID id = 0; id < boxes.size(); ++id)
+    {
+        mItems[id].bounds = boxes[id];
+        mItems[id].value = id;
+        mItems[id].node = 0; // Anything but NO_NODE marks the item as used, Rebuild sets the real node
+    }
+    mNumItems = static_cast<unsigned int>(boxes.size());
+    Rebuild();
+}
+
+
+void DynamicBVH::Clear()
+{
+    mNodes.clear();
+    mFreeNodes.clear();
+    mRefitNodes.clear();
+    mItems.clear();
+    mFreeItems.clear();
+    mRoot = NO_NODE;
+    mNumItems = 0;
+}
+
+
+// Build a node over a range of items, splitting it into up to four groups: the largest group is split in two by the
+// SAH until there are four. Groups of one item become children directly, larger ones become child nodes
+uint32_t DynamicBVH::BuildNode(BuildItem* items, unsigned int count, uint32_t parent, uint32_t parentSlot)
+{
+    uint32_t node = NewNode(parent, parentSlot);
+
+    BuildItem*   groupStart[4] = { items };
+    unsigned int groupCount[4] = { count };
+    unsigned int numGroups = 1;
+    if (count <= 4)
+    {
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            groupStart[i] = items + i;
+            groupCount[i] = 1;
+        }
+        numGroups = count;
+    }
+    else
+    {
+        while (numGroups < 4)
+        {
+            unsigned int largest = 0;
+            for (unsigned int group = 1; group < numGroups; ++group)
+            {
+                if (groupCount[group] > groupCount[largest])  largest = group;
+            }
+            unsigned int leftCount = SplitItems(groupStart[largest], groupCount[largest]);
+            groupStart[numGroups] = groupStart[largest] + leftCount;
+            groupCount[numGroups] = groupCount[largest] - leftCount;
+            groupCount[largest] = leftCount;
+            ++numGroups;
+        }
+    }
+
+    for (unsigned int group = 0; group < numGroups; ++group)
+    {
+        if (groupCount[group] == 1)
+        {
+            SetChild(node, group, LEAF | groupStart[group]->id, groupStart[group]->bounds);
+        }
+        else
+        {
+            uint32_t child = BuildNode(groupStart[group], groupCount[group], node, group);
+            SetChild(node, group, child, NodeBounds(child));
+        }
+    }
+    return node;
+}
+
+
+// Reorder a range of items (of at least two) into two groups and return the size of the first. Items are sorted into
+// bins by the centre of their boxes, and the split between bins with the lowest SAH cost chosen: the
+// area of each group's bounds times the items in it, the chance of a query reaching the group times its cost
+unsigned int DynamicBVH::SplitItems(BuildItem* items, unsigned int count)
+{
+    BoundingBox centres = EMPTY_BOX;
+    for (unsigned int i = 0; i < count; ++i)  centres = Union(centres, { items[i].centre, items[i].centre });
+
+    // Only the axis along which the centres are most spread is tried, which finds nearly as good splits in a third of
+    // the time
+    CVector3 spread = centres.maxBounds - centres.minBounds;
+    unsigned int axis = (spread.x >= spread.y && spread.x >= spread.z) ? 0 : (spread.y >= spread.z ? 1 : 2);
+    float bestCost = std::numeric_limits<float>::max();
+    unsigned int bestBin = 0;
+    float minCentre = Axis(centres.minBounds, axis);
+    float extent = Axis(centres.maxBounds, axis) - minCentre;
+    if (extent > 0)
+    {
+        float binScale = SAH_BINS / extent;
+
+        BoundingBox  binBounds[SAH_BINS];
+        unsigned int binCounts[SAH_BINS] = {};
+        for (auto& bounds : binBounds)  bounds = EMPTY_BOX;
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            unsigned int bin = std::min(static_cast<unsigned int>((Axis(items[i].centre, axis) - minCentre) * binScale), SAH_BINS - 1);
+            binBounds[bin] = Union(binBounds[bin], items[i].bounds);
+            ++binCounts[bin];
+        }
+
+        // Cost of the right group for each split, sweeping from the right, then sweep from the left adding the left
+        float rightCosts[SAH_BINS];
+        BoundingBox sweep = EMPTY_BOX;
+        unsigned int sweepCount = 0;
+        for (unsigned int bin = SAH_BINS - 1; bin > 0; --bin)
+        {
+            sweep = Union(sweep, binBounds[bin]);
+            sweepCount += binCounts[bin];
+            rightCosts[bin] = sweepCount > 0 ? HalfArea(sweep) * sweepCount : 0;
+        }
+        sweep = EMPTY_BOX;
+        sweepCount = 0;
+        for (unsigned int bin = 0; bin < SAH_BINS - 1; ++bin)
+        {
+            sweep = Union(sweep, binBounds[bin]);
+            sweepCount += binCounts[bin];
+            if (sweepCount == 0 || sweepCount == count)  continue;
+            float cost = HalfArea(sweep) * sweepCount + rightCosts[bin + 1];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestBin = bin;
+            }
+        }
+    }
+
+    // All centres in the same place, any split is as good as another
+    if (bestCost == std::numeric_limits<float>::max())  return count / 2;
+
+    float binScale = SAH_BINS / extent;
+    BuildItem* middle = std::partition(items, items + count, [&](const BuildItem& item)
+    {
+        return std::min(static_cast<unsigned int>((Axis(item.centre, axis) - minCentre) * binScale), SAH_BINS - 1) <= bestBin;
+    });
+    return static_cast<unsigned int>(middle - items);
+}
+
+
+uint32_t DynamicBVH::NewNode(uint32_t parent, uint32_t parentSlot)
+{
+    uint32_t node;
+    if (!mFreeNodes.empty())
+    {
+        node = mFreeNodes.back();
+        mFreeNodes.pop_back();
+    }
+    else
+    {
+        node = static_cast<uint32_t>(mNodes.size());
+        mNodes.emplace_back();
+    }
+    Node& n = mNodes[node];
+    for (uint32_t slot = 0; slot < 4; ++slot)
+    {
+        n.minX[slot] = n.minY[slot] = n.minZ[slot] = EMPTY_MIN;
+        n.maxX[slot] = n.maxY[slot] = n.maxZ[slot] = EMPTY_MAX;
+        n.children[slot] = EMPTY_CHILD;
+    }
+    n.parent = parent;
+    n.parentSlot = parentSlot;
+    n.refitQueued = 0;
+    n.padding = 0;
+    return node;
+}
+
+
+void DynamicBVH::FreeNode(uint32_t node)
+{
+    mNodes[node].refitQueued = 0;
+    mFreeNodes.push_back(node);
+}
+
+
+// Set one of a node's children and its bounds, keeping track of where items and nodes are held
+void DynamicBVH::SetChild(uint32_t node, uint32_t slot, uint32_t child, const BoundingBox& bounds)
+{
+    Node& n = mNodes[node];
+    n.children[slot] = child;
+    n.minX[slot] = bounds.minBounds.x;  n.minY[slot] = bounds.minBounds.y;  n.minZ[slot] = bounds.minBounds.z;
+    n.maxX[slot] = bounds.maxBounds.x;  n.maxY[slot] = bounds.maxBounds.y;  n.maxZ[slot] = bounds.maxBounds.z;
+    if (child == EMPTY_CHILD)  return;
+    if (child & LEAF)
+    {
+        mItems[child & ~LEAF].node = node;
+        mItems[child & ~LEAF].slot = slot;
+    }
+    else
+    {
+        mNodes[child].parent = node;
+        mNodes[child].parentSlot = slot;
+    }
+}
+
+
+// Bounds of all of a node's children
+BoundingBox DynamicBVH::NodeBounds(uint32_t node) const
+{
+    const Node& n = mNodes[node];
+    return { { std::min(std::min(n.minX[0], n.minX[1]), std::min(n.minX[2], n.minX[3])),
+               std::min(std::min(n.minY[0], n.minY[1]), std::min(n.minY[2], n.minY[3])),
+               std::min(std::min(n.minZ[0], n.minZ[1]), std::min(n.minZ[2], n.minZ[3])) },
+             { std::max(std::max(n.maxX[0], n.maxX[1]), std::max(n.maxX[2], n.maxX[3])),
+               std::max(std::max(n.maxY[0], n.maxY[1]), std::max(n.maxY[2], n.maxY[3])),
+               std::max(std::max(n.maxZ[0], n.maxZ[1]), std::max(n.maxZ[2], n.maxZ[3])) } };
+}
+
+
+// Update the children of a node marked for refit that are also marked, then set their bounds here
+void DynamicBVH::RefitNode(uint32_t node)
+{
+    mNodes[node].refitQueued = 0;
+    for (uint32_t slot = 0; slot < 4; ++slot)
+    {
+        uint32_t child = mNodes[node].children[slot];
+        if ((child & LEAF) || !mNodes[child].refitQueued)  continue;
+        RefitNode(child);
+        SetChild(node, slot, child, NodeBounds(child));
+    }
+}
+
+
+// Set a node's bounds in its parent, then the parent's in its parent and so on, stopping when the bounds don't change
+// as the nodes above are then already right
+void DynamicBVH::RefitUpwards(uint32_t node)
+{
+    while (node != mRoot)
+    {
+        BoundingBox bounds = NodeBounds(node);
+        uint32_t parent = mNodes[node].parent;
+        uint32_t slot = mNodes[node].parentSlot;
+        const Node& p = mNodes[parent];
+        if (p.minX[slot] == bounds.minBounds.x && p.minY[slot] == bounds.minBounds.y && p.minZ[slot] == bounds.minBounds.z &&
+            p.maxX[slot] == bounds.maxBounds.x && p.maxY[slot] == bounds.maxBounds.y && p.maxZ[slot] == bounds.maxBounds.z)  break;
+        SetChild(parent, slot, node, bounds);
+        node = parent;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Queries
+//--------------------------------------------------------------------------------------
+
+namespace
+{
+    // Stack of nodes still to visit in a query. Each query has its own, so a query can be made from inside the
+    // callbacks of another (e.g. a ray cast against the objects in one tree testing each against its own tree). Entries
+    // are kept on the call stack up to a depth that fits any reasonably balanced tree, and move to the heap beyond it
+    template <class Entry> class NodeStack
+    {
+    public:
+        NodeStack() = default;
+        NodeStack(const NodeStack&) = delete;
+        NodeStack& operator=(const NodeStack&) = delete;
+
+        bool Empty() const  { return mSize == 0; }
+
+        Entry Pop()  { return mEntries[--mSize]; }
+
+        void Push(const Entry& entry)
+        {
+            if (mSize == mCapacity)
+            {
+                if (mEntries == mFixed)  mHeap.assign(mFixed, mFixed + mSize);
+                mCapacity *= 2;
+                mHeap.resize(mCapacity);
+                mEntries = mHeap.data();
+            }
+            mEntries[mSize++] = entry;
+        }
+
+    private:
+        static const unsigned int FIXED_SIZE = 64;
+
+        Entry              mFixed[FIXED_SIZE];
+        std::vector<Entry> mHeap;
+        Entry*             mEntries = mFixed;
+        unsigned int       mCapacity = FIXED_SIZE;
+        unsigned int       mSize = 0;
+    };
+}
+
+
+// Visit the nodes from the root down with a stack. The test may also return bits 4 to 7 for children entirely within
+// the query, whose nodes are then stacked marked with the LEAF bit (unused by node indices) so everything below them
+// is found without testing
+template <class NodeTest, class Found> void DynamicBVH::Traverse(NodeTest test, Found found) const
+{
+    if (mRoot == NO_NODE)  return;
+
+    NodeStack<uint32_t> stack;
+    stack.Push(mRoot);
+    while (!stack.Empty())
+    {
+        uint32_t top = stack.Pop();
+        const Node& node = mNodes[top & ~LEAF];
+        int mask = (top & LEAF) ? 0xff : test(node);
+        for (uint32_t slot = 0; slot < 4; ++slot)
+        {
+            uint32_t child = node.children[slot];
+            if (!(mask & (1 << slot)) || child == EMPTY_CHILD)  continue;
+            if (child & LEAF)                 found(mItems[child & ~LEAF].value);
+            else if (mask & (0x10 << slot))  stack.Push(child | LEAF);
+            else                             stack.Push(child);
+        }
+    }
+}
+
+
+void DynamicBVH::QueryFrustum(const CFrustum& frustum, std::vector<uint32_t>& results) const
+{
+    results.clear();
+    Traverse([&](const Node& node) { return FrustumTest(node, frustum); }, [&](uint32_t value) { results.push_back(value); });
+}
+
+
+void DynamicBVH::QuerySphere(const CVector3& centre, float radius, std::vector<uint32_t>& results) const
+{
+    results.clear();
+    Traverse([&](const Node& node) { return SphereTest(node, centre, radius); }, [&](uint32_t value) { results.push_back(value); });
+}
+
+
+void DynamicBVH::QueryBox(const BoundingBox& box, std::vector<uint32_t>& results) const
+{
+    results.clear();
+    Traverse([&](const Node& node) { return BoxTest(node, box); }, [&](uint32_t value) { results.push_back(value); });
+}
+
+
+void DynamicBVH::QueryRay(const CVector3& origin, const CVector3& direction, float maxDistance, std::vector<uint32_t>& results) const
+{
+    results.clear();
+    CVector3 inverseDirection = InverseDirection(direction);
+    float entry[4];
+    Traverse([&](const Node& node) { return RayTest(node, origin, inverseDirection, maxDistance, entry); },
+             [&](uint32_t value) { results.push_back(value); });
+}
+
+
+// Visit the children hit nearest first, so the nearest hit is usually found early, then skip anything entered beyond
+// it. Nodes are stacked with the distance the ray enters them, as the nearest hit may have moved closer since
+float DynamicBVH::RayCast(const CVector3& origin, const CVector3& direction, float maxDistance,
+                          const RayHitFunction& hitFunction, uint32_t& hitValue) const
+{
+    if (mRoot == NO_NODE)  return maxDistance;
+
+    struct StackEntry
+    {
+        uint32_t child;
+        float    entry;
+    };
+    NodeStack<StackEntry> stack;
+    stack.Push({ mRoot, 0 });
+
+    CVector3 inverseDirection = InverseDirection(direction);
+    float nearest = maxDistance;
+    while (!stack.Empty())
+    {
+        StackEntry top = stack.Pop();
+        if (top.entry > nearest)  continue;
+
+        if (top.child & LEAF)
+        {
+            const Item& item = mItems[top.child & ~LEAF];
+            float distance = hitFunction(item.value, nearest);
+            if (distance < nearest)
+            {
+                nearest = distance;
+                hitValue = item.value;
+            }
+            continue;
+        }
+
+        // Stack the children hit furthest first so the nearest is visited next
+        const Node& node = mNodes[top.child];
+        float entry[4];
+        int mask = RayTest(node, origin, inverseDirection, nearest, entry);
+        StackEntry hits[4];
+        unsigned int numHits = 0;
+        for (uint32_t slot = 0; slot < 4; ++slot)
+        {
+            if ((mask & (1 << slot)) && node.children[slot] != EMPTY_CHILD)  hits[numHits++] = { node.children[slot], entry[slot] };
+        }
+        std::sort(hits, hits + numHits, [](const StackEntry& a, const StackEntry& b) { return a.entry > b.entry; });
+        for (unsigned int hit = 0; hit < numHits; ++hit)  stack.Push(hits[hit]);
+    }
+    return nearest;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Statistics
+//--------------------------------------------------------------------------------------
+
+// Each node's area relative to the root is the chance that a random ray through the root visits it
+float DynamicBVH::SAHCost() const
+{
+    if (mRoot == NO_NODE)  return 0;
+
+    float rootArea = HalfArea(NodeBounds(mRoot));
+    if (rootArea <= 0)  return 1;
+
+    float cost = 0;
+    std::vector<uint32_t> stack = { mRoot };
+    while (!stack.empty())
+    {
+        uint32_t node = stack.back();
+        stack.pop_back();
+        cost += HalfArea(NodeBounds(node)) / rootArea;
+        for (auto child : mNodes[node].children)
+        {
+            if (!(child & LEAF))  stack.push_back(child);
+        }
+    }
+    return cost;
+}
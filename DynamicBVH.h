@@ -0,0 +1,180 @@
+//--------------------------------------------------------------------------------------
+// Dynamic bounding volume hierarchy - a tree of boxes for fast spatial queries
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+// Items are axis-aligned boxes, each with a value (e.g. an index into an array of objects).
+// Queries for the items in a frustum, sphere or box, or hit by a ray, skip whole branches of
+// the tree whose bounds miss, so cost grows with the log of the number of items rather than
+// linearly as when testing every item.
+//
+// Each node has four children, with the bounds of all four stored together as a structure of
+// arrays (all min x, then all min y...), so a query tests the four children at once with SSE.
+// A node is 128 bytes, two cache lines, and a tree has a quarter of the nodes of a binary one.
+//
+// Items can be inserted, removed and moved at any time. Inserting descends to the child whose
+// bounds grow least. Moving an item only changes its own bounds, then Refit updates the bounds
+// of the nodes above the items that moved, so a scene of moving objects costs little per frame.
+// The tree keeps its shape as items move, which slowly makes it less efficient to query, so
+// Rebuild builds it again from scratch, splitting the items where the surface area heuristic
+// (SAH) gives the lowest expected cost of a query.
+// No DirectX in here so the tree can be run (and tested) headless.
+
+#ifndef _DYNAMIC_BVH_H_INCLUDED_
+#define _DYNAMIC_BVH_H_INCLUDED_
+
+#include "CVector3.h"
+#include "CFrustum.h"
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+
+// An axis-aligned box
+struct BoundingBox
+{
+    CVector3 minBounds;
+    CVector3 maxBounds;
+};
+
+
+class DynamicBVH
+{
+public:
+    // Identifies an item in the tree, stays the same as the item moves and as the tree is rebuilt
+    using ItemID = uint32_t;
+    static const ItemID NO_ITEM = ~0u;
+
+    // Called by RayCast for each item whose box the ray reaches before the nearest hit so far, nearest boxes first.
+    // Returns the distance along the ray to where it hits the item itself, or any value >= maxDistance for a miss
+    using RayHitFunction = std::function<float(uint32_t value, float maxDistance)>;
+
+
+    /*-----------------------------------------------------------------------------------------
+        Building and changing the tree
+    -----------------------------------------------------------------------------------------*/
+
+    // Add an item to the tree, returns its ID
+    ItemID Insert(const BoundingBox& bounds, uint32_t value);
+
+    // Remove an item from the tree, its ID may be reused by a later insert
+    void Remove(ItemID item);
+
+    // Change the bounds of an item. The nodes above it aren't updated until the next call to Refit
+    void Move(ItemID item, const BoundingBox& bounds);
+
+    // Update the bounds of the nodes above the items moved since the last refit. Call after moving items and before
+    // querying the tree
+    void Refit();
+
+    // Build the whole tree again from the items in it, using the surface area heuristic to choose where to split
+    void Rebuild();
+
+    // Replace the contents of the tree with the given boxes and build it. The value of each item is its index in the
+    // array, which is also its ID
+    void Build(const std::vector<BoundingBox>& boxes);
+
+    // Remove all the items
+    void Clear();
+
+
+    /*-----------------------------------------------------------------------------------------
+        Queries
+    -----------------------------------------------------------------------------------------*/
+    // The queries test the items' boxes, so may return items whose own shape just misses. Results are the values of
+    // the items found, in no particular order. Queries don't change the tree so can run on several threads at once,
+    // and may be nested (e.g. the hit function of a ray cast may query this or another tree)
+
+    // Items whose boxes may be inside the frustum
+    void QueryFrustum(const CFrustum& frustum, std::vector<uint32_t>& results) const;
+
+    // Items whose boxes touch the sphere
+    void QuerySphere(const CVector3& centre, float radius, std::vector<uint32_t>& results) const;
+
+    // Items whose boxes overlap the box
+    void QueryBox(const BoundingBox& box, std::vector<uint32_t>& results) const;
+
+    // Items whose boxes are hit by the ray within the given distance. The direction need not be normalised, distances
+    // are in multiples of its length
+    void QueryRay(const CVector3& origin, const CVector3& direction, float maxDistance, std::vector<uint32_t>& results) const;
+
+    // Find the nearest item hit by a ray within the given distance, calling the hit function to test items whose boxes
+    // the ray hits. Returns the distance to the nearest hit and sets hitValue to the item's value, or returns
+    // maxDistance and leaves hitValue unchanged if nothing is hit
+    float RayCast(const CVector3& origin, const CVector3& direction, float maxDistance, const RayHitFunction& hitFunction,
+                  uint32_t& hitValue) const;
+
+
+    /*-----------------------------------------------------------------------------------------
+        Statistics
+    -----------------------------------------------------------------------------------------*/
+
+    unsigned int NumItems()  const  { return mNumItems; }
+    unsigned int NumNodes()  const  { return static_cast<unsigned int>(mNodes.size() - mFreeNodes.size()); }
+
+    // Expected cost of a query by the surface area heuristic, the number of nodes a random ray through the tree visits.
+    // Grows as moving items spoil the shape of the tree, compare with the cost just after a rebuild to decide when to
+    // rebuild again
+    float SAHCost() const;
+
+
+private:
+    static const uint32_t NO_NODE = ~0u;
+    static const uint32_t LEAF = 0x80000000u; // Set in a child that is an item rather than a node, with the item ID
+    static const uint32_t EMPTY_CHILD = ~0u;
+
+    // Four children's bounds as a structure of arrays, with the nodes above and below
+    struct Node
+    {
+        float    minX[4], minY[4], minZ[4];
+        float    maxX[4], maxY[4], maxZ[4];
+        uint32_t children[4];  // Node index, item ID with the LEAF bit set, or EMPTY_CHILD
+        uint32_t parent;       // NO_NODE for the root
+        uint32_t parentSlot;   // Which child of the parent this node is
+        uint32_t refitQueued;  // Non-zero if the node or one below it has items waiting to be refit
+        uint32_t padding;
+    };
+
+    struct Item
+    {
+        BoundingBox bounds;
+        uint32_t    value;
+        uint32_t    node;  // Node holding the item, NO_NODE if the item ID is free
+        uint32_t    slot;
+    };
+
+    uint32_t NewNode(uint32_t parent, uint32_t parentSlot);
+    void     FreeNode(uint32_t node);
+    void     SetChild(uint32_t node, uint32_t slot, uint32_t child, const BoundingBox& bounds);
+    BoundingBox NodeBounds(uint32_t node) const;
+    void     RefitNode(uint32_t node);
+    void     RefitUpwards(uint32_t node);
+
+    // Items are copied together with their centres (doubled) while building, to avoid looking them up as they are split
+    struct BuildItem
+    {
+        BoundingBox bounds;
+        CVector3    centre;
+        ItemID      id;
+    };
+    uint32_t BuildNode(BuildItem* items, unsigned int count, uint32_t parent, uint32_t parentSlot);
+    unsigned int SplitItems(BuildItem* items, unsigned int count);
+
+    // Traverse the nodes whose children pass a test of four boxes at once, which returns a bit set for each child
+    // to visit, calling found for the items passed
+    template <class NodeTest, class Found> void Traverse(NodeTest test, Found found) const;
+
+
+    std::vector<Node>     mNodes;
+    std::vector<uint32_t> mFreeNodes;
+    uint32_t              mRoot = NO_NODE;
+
+    std::vector<Item>     mItems;
+    std::vector<ItemID>   mFreeItems;
+    unsigned int          mNumItems = 0;
+
+    std::vector<uint32_t> mRefitNodes; // Nodes with moved items since the last refit
+};
+
+
+#endif //_DYNAMIC_BVH_H_INCLUDED_
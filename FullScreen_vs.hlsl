@@ -0,0 +1,12 @@
+//--------------------------------------------------------------------------------------
+// Full Screen Vertex Shader
+//--------------------------------------------------------------------------------------
+// Draws one triangle covering the viewport from the vertex index alone, with no vertex or index buffer.
+// Call Draw(3, 0) with no input layout
+
+float4 main(uint vertexID : SV_VertexID) : SV_Position
+{
+    // Vertices (-1,-1), (-1,3) and (3,-1) in clip space, so the triangle's inside covers -1 to 1 in x and y
+    float2 position = float2((vertexID == 2) ? 3.0f : -1.0f, (vertexID == 1) ? 3.0f : -1.0f);
+    return float4(position, 0, 1);
+}
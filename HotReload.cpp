@@ -0,0 +1,179 @@
+//--------------------------------------------------------------------------------------
+// Hot reloading of shaders, textures and meshes when their files change
+//--------------------------------------------------------------------------------------
+
+#include "HotReload.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "Mesh.h"
+#include "FileWatcher.h"
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+
+std::string gHotReloadResult;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Files are often written in several steps, or held open for a moment after being written. Wait until a file
+    // has not changed for this long before reloading it
+    const std::chrono::milliseconds SETTLE_TIME(100);
+
+    // A changed file waiting to settle
+    struct PendingChange
+    {
+        std::string       fileName;
+        Clock::time_point firstSeen;
+        Clock::time_point lastSeen;
+    };
+
+    std::unique_ptr<FileWatcher>                   gWatcher;
+    std::unordered_map<std::string, PendingChange> gPendingChanges; // By lower case file name
+    std::vector<Texture*>                          gWatchedTextures;
+    std::vector<Mesh*>                             gWatchedMeshes;
+
+
+    // File names are not case sensitive on Windows
+    std::string LowerCase(std::string name)
+    {
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return name;
+    }
+
+
+    // Rebuild everything loaded from a file and swap in the new versions. Returns a description of what was reloaded,
+    // empty if the file isn't used. Sets failed and gLastError if anything could not be rebuilt
+    std::string ReloadFile(const std::string& fileName, bool& failed)
+    {
+        failed = false;
+        std::string lowerName = LowerCase(fileName);
+        std::ostringstream reloaded;
+
+        unsigned int numShaders = 0;
+        if (!ReloadShaders(fileName, numShaders))  failed = true;
+        if (numShaders > 0)  reloaded << numShaders << " shader" << (numShaders > 1 ? "s" : "");
+
+        unsigned int numTextures = 0;
+        for (auto texture : gWatchedTextures)
+        {
+            if (LowerCase(texture->FileName()) != lowerName)  continue;
+            if (texture->Reload())  ++numTextures;
+            else                    failed = true;
+        }
+        if (numTextures > 0)  reloaded << (numShaders > 0 ? ", " : "") << numTextures << " texture" << (numTextures > 1 ? "s" : "");
+
+        unsigned int numMeshes = 0;
+        for (auto mesh : gWatchedMeshes)
+        {
+            if (LowerCase(mesh->FileName()) != lowerName)  continue;
+            try
+            {
+                Mesh newMesh(mesh->FileName(), mesh->RequiresTangents());
+                if (mesh->ReplaceGeometry(newMesh))
+                {
+                    ++numMeshes;
+                }
+                else
+                {
+                    gLastError = "Nodes in " + fileName + " have changed, restart to load it";
+                    failed = true;
+                }
+            }
+            catch (std::runtime_error& e)
+            {
+                gLastError = e.what();
+                failed = true;
+            }
+        }
+        if (numMeshes > 0)  reloaded << (numShaders + numTextures > 0 ? ", " : "") << numMeshes << " mesh" << (numMeshes > 1 ? "es" : "");
+
+        return reloaded.str();
+    }
+}
+
+
+// Start watching the working folder, returns false and sets gLastError on failure
+bool InitHotReload()
+{
+    try
+    {
+        gWatcher = std::make_unique<FileWatcher>(".");
+    }
+    catch (std::runtime_error& e)
+    {
+        gLastError = e.what();
+        return false;
+    }
+    return true;
+}
+
+
+// Stop watching, the registered resources are forgotten
+void ShutdownHotReload()
+{
+    gWatcher = nullptr;
+    gPendingChanges.clear();
+    gWatchedTextures.clear();
+    gWatchedMeshes.clear();
+}
+
+
+// Register resources to be reloaded when their files change
+void WatchTexture(Texture* texture)
+{
+    gWatchedTextures.push_back(texture);
+}
+
+void WatchMesh(Mesh* mesh)
+{
+    gWatchedMeshes.push_back(mesh);
+}
+
+
+// Rebuild resources whose files have changed and swap them in. Call at the start of a frame
+void UpdateHotReload()
+{
+    if (!gWatcher)  return;
+
+    Clock::time_point now = Clock::now();
+    for (auto& fileName : gWatcher->TakeChanges())
+    {
+        auto inserted = gPendingChanges.insert({ LowerCase(fileName), { fileName, now, now } });
+        inserted.first->second.lastSeen = now;
+    }
+
+    for (auto change = gPendingChanges.begin(); change != gPendingChanges.end(); )
+    {
+        if (now - change->second.lastSeen < SETTLE_TIME)
+        {
+            ++change;
+            continue;
+        }
+
+        bool failed;
+        std::string reloaded = ReloadFile(change->second.fileName, failed);
+        if (failed)
+        {
+            // Compiler messages can be long, only the first line fits in the title
+            gHotReloadResult = ", Reload failed: " + gLastError.substr(0, gLastError.find('\n'));
+        }
+        else if (!reloaded.empty())
+        {
+            float latency = std::chrono::duration<float>(Clock::now() - change->second.firstSeen).count();
+            std::ostringstream result;
+            result << ", Reloaded " << change->second.fileName << " (" << reloaded << ") in "
+                   << static_cast<int>(latency * 1000) << "ms";
+            gHotReloadResult = result.str();
+        }
+        change = gPendingChanges.erase(change);
+    }
+}
@@ -0,0 +1,39 @@
+//--------------------------------------------------------------------------------------
+// Hot reloading of shaders, textures and meshes when their files change
+//--------------------------------------------------------------------------------------
+// The working folder is watched in the background (see FileWatcher.h). Once per frame, before
+// anything is updated or rendered, the files that have changed are matched to the resources
+// loaded from them and only those are rebuilt. New versions replace the old in place: shaders
+// in their globals and pipeline states (see ReloadShaders in Shader.h), textures inside their
+// Texture objects and mesh geometry inside its Mesh. Everything using the resources goes
+// through those, so sees the new versions from the next frame on. A failed rebuild leaves the
+// old resource in use and reports the error in the window title.
+
+#ifndef _HOT_RELOAD_H_INCLUDED_
+#define _HOT_RELOAD_H_INCLUDED_
+
+#include <string>
+
+class Texture;
+class Mesh;
+
+
+// Start watching the working folder, returns false and sets gLastError on failure
+bool InitHotReload();
+
+// Stop watching, the registered resources are forgotten
+void ShutdownHotReload();
+
+// Register resources to be reloaded when their files change. Shaders are always watched
+void WatchTexture(Texture* texture);
+void WatchMesh(Mesh* mesh);
+
+// Rebuild resources whose files have changed and swap them in. Call at the start of a frame
+void UpdateHotReload();
+
+// Result of the last reload for the window title: what was reloaded or the error, and the latency from the file
+// change being seen to the new version being in use. Empty if nothing has been reloaded
+extern std::string gHotReloadResult;
+
+
+#endif //_HOT_RELOAD_H_INCLUDED_
@@ -0,0 +1,219 @@
+//--------------------------------------------------------------------------------------
+// Vertex input layouts shared between meshes
+//--------------------------------------------------------------------------------------
+
+#include "InputLayout.h"
+#include "Shader.h"
+#include "Hash.h"
+
+#include <vector>
+#include <unordered_map>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <d3dcompiler.h>
+
+
+unsigned int gInputLayoutRequests = 0;
+unsigned int gInputSignaturesCompiled = 0;
+
+namespace
+{
+    // A layout in the cache. Element descriptions point at semantic names owned by whoever created the layout, so
+    // the cache keeps its own copies of the names instead
+    struct CachedInputLayout
+    {
+        std::vector<D3D11_INPUT_ELEMENT_DESC> elements;
+        std::vector<std::string>              semanticNames;
+        ID3D11InputLayout*                    layout;
+    };
+
+    // Cached layouts and their indexes by hash of their elements to find them quickly
+    std::vector<CachedInputLayout>                  gInputLayouts;
+    std::unordered_multimap<uint64_t, unsigned int> gInputLayoutLookup;
+
+
+    // Hash of a list of elements, using the text of the semantic names rather than the pointers to them
+    uint64_t HashElements(const D3D11_INPUT_ELEMENT_DESC elements[], unsigned int numElements)
+    {
+        uint64_t hash = HASH_START;
+        for (unsigned int elt = 0; elt < numElements; ++elt)
+        {
+            auto& element = elements[elt];
+            hash = HashBytes(element.SemanticName, std::strlen(element.SemanticName) + 1, hash);
+            hash = HashBytes(&element.SemanticIndex,        sizeof(element.SemanticIndex),        hash);
+            hash = HashBytes(&element.Format,               sizeof(element.Format),               hash);
+            hash = HashBytes(&element.InputSlot,            sizeof(element.InputSlot),            hash);
+            hash = HashBytes(&element.AlignedByteOffset,    sizeof(element.AlignedByteOffset),    hash);
+            hash = HashBytes(&element.InputSlotClass,       sizeof(element.InputSlotClass),       hash);
+            hash = HashBytes(&element.InstanceDataStepRate, sizeof(element.InstanceDataStepRate), hash);
+        }
+        return hash;
+    }
+
+    bool SameElements(const CachedInputLayout& cached, const D3D11_INPUT_ELEMENT_DESC elements[], unsigned int numElements)
+    {
+        if (cached.elements.size() != numElements)  return false;
+        for (unsigned int elt = 0; elt < numElements; ++elt)
+        {
+            auto& a = cached.elements[elt];
+            auto& b = elements[elt];
+            if (cached.semanticNames[elt] != b.SemanticName || a.SemanticIndex != b.SemanticIndex || a.Format != b.Format ||
+                a.InputSlot != b.InputSlot || a.AlignedByteOffset != b.AlignedByteOffset ||
+                a.InputSlotClass != b.InputSlotClass || a.InstanceDataStepRate != b.InstanceDataStepRate)  return false;
+        }
+        return true;
+    }
+
+
+    // Source of a dummy vertex shader whose input signature matches a list of elements. Must match the source written
+    // by CompileInputSignatures.ps1 exactly, as the precompiled shaders are found by its hash. Returns an empty string
+    // if an element has a format not supported here
+    std::string SignatureSource(const D3D11_INPUT_ELEMENT_DESC elements[], unsigned int numElements)
+    {
+        std::string source = "float4 main(";
+        for (unsigned int elt = 0; elt < numElements; ++elt)
+        {
+            auto& format = elements[elt].Format;
+            // This list should be more complete for production use
+            if      (format == DXGI_FORMAT_R32G32B32A32_FLOAT) source += "float4";
+            else if (format == DXGI_FORMAT_R32G32B32_FLOAT)    source += "float3";
+            else if (format == DXGI_FORMAT_R32G32_FLOAT)       source += "float2";
+            else if (format == DXGI_FORMAT_R32_FLOAT)          source += "float";
+            else if (format == DXGI_FORMAT_R8G8B8A8_UINT)      source += "uint4";
+            else if (format == DXGI_FORMAT_R8G8B8A8_UNORM)     source += "float4";
+            else return ""; // Unsupported type in layout
+
+            std::string semanticName = elements[elt].SemanticName;
+            semanticName += std::to_string(elements[elt].SemanticIndex);
+
+            source += " " + semanticName + " : " + semanticName;
+            if (elt != numElements - 1)  source += " , ";
+        }
+        source += ") : SV_Position {return 0;}";
+        return source;
+    }
+
+    // Name of the precompiled dummy shader with the given source
+    std::string SignatureName(const std::string& source)
+    {
+        char hash[17];
+        std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(HashBytes(source.data(), source.length())));
+        return std::string("Signature_") + hash;
+    }
+
+    // Read a whole file, returns false if it can't be read
+    bool ReadWholeFile(const std::string& fileName, std::vector<char>& bytes)
+    {
+        std::ifstream file(fileName, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!file.is_open())  return false;
+
+        bytes.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0, std::ios::beg);
+        file.read(bytes.data(), bytes.size());
+        return !file.fail();
+    }
+
+
+    // Create a layout, with the signature from the precompiled dummy shader in the shader pack or its own .cso file,
+    // or compiled now if there is neither. Returns nullptr and sets gLastError on failure
+    ID3D11InputLayout* CreateLayout(const D3D11_INPUT_ELEMENT_DESC elements[], unsigned int numElements)
+    {
+        std::string source = SignatureSource(elements, numElements);
+        if (source.empty())
+        {
+            gLastError = "Unsupported vertex element format in input layout";
+            return nullptr;
+        }
+        std::string name = SignatureName(source);
+
+        const void*       byteCode = nullptr;
+        size_t            size = 0;
+        std::vector<char> fileBytes;
+        ID3DBlob*         compiled = nullptr;
+        if (!FindPackedShader(name, byteCode, size))
+        {
+            if (ReadWholeFile(name + ".cso", fileBytes))
+            {
+                byteCode = fileBytes.data();
+                size = fileBytes.size();
+            }
+            else
+            {
+                HRESULT hr = D3DCompile(source.c_str(), source.length(), nullptr, nullptr, nullptr, "main",
+                                        "vs_5_0", D3DCOMPILE_OPTIMIZATION_LEVEL0, 0, &compiled, nullptr);
+                if (FAILED(hr))
+                {
+                    gLastError = "Error compiling input signature " + name;
+                    return nullptr;
+                }
+                byteCode = compiled->GetBufferPointer();
+                size = compiled->GetBufferSize();
+                ++gInputSignaturesCompiled;
+            }
+        }
+
+        ID3D11InputLayout* layout = nullptr;
+        HRESULT hr = gD3DDevice->CreateInputLayout(elements, numElements, byteCode, size, &layout);
+        if (compiled)  compiled->Release();
+        if (FAILED(hr))
+        {
+            gLastError = "Error creating input layout with signature " + name;
+            return nullptr;
+        }
+        return layout;
+    }
+}
+
+
+// Input layout for a list of vertex elements, shared with everything else using an identical list
+ID3D11InputLayout* CreateSharedInputLayout(const D3D11_INPUT_ELEMENT_DESC elements[], unsigned int numElements)
+{
+    ++gInputLayoutRequests;
+
+    uint64_t hash = HashElements(elements, numElements);
+    auto matches = gInputLayoutLookup.equal_range(hash);
+    for (auto match = matches.first; match != matches.second; ++match)
+    {
+        auto& cached = gInputLayouts[match->second];
+        if (SameElements(cached, elements, numElements))
+        {
+            cached.layout->AddRef();
+            return cached.layout;
+        }
+    }
+
+    ID3D11InputLayout* layout = CreateLayout(elements, numElements);
+    if (layout == nullptr)  return nullptr;
+
+    CachedInputLayout cached;
+    cached.elements.assign(elements, elements + numElements);
+    for (auto& element : cached.elements)
+    {
+        cached.semanticNames.push_back(element.SemanticName);
+        element.SemanticName = nullptr; // Not kept, the caller's name may not outlive the cache
+    }
+    cached.layout = layout;
+
+    gInputLayoutLookup.emplace(hash, static_cast<unsigned int>(gInputLayouts.size()));
+    gInputLayouts.push_back(std::move(cached));
+
+    layout->AddRef(); // One reference for the cache, one for the caller
+    return layout;
+}
+
+
+// Release the cache's references to the layouts
+void ReleaseInputLayouts()
+{
+    for (auto& cached : gInputLayouts)  cached.layout->Release();
+    gInputLayouts.clear();
+    gInputLayoutLookup.clear();
+}
+
+
+// Number of different input layouts created
+unsigned int NumberInputLayouts()
+{
+    return static_cast<unsigned int>(gInputLayouts.size());
+}
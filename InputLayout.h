@@ -0,0 +1,40 @@
+//--------------------------------------------------------------------------------------
+// Vertex input layouts shared between meshes
+//--------------------------------------------------------------------------------------
+// DirectX needs the input signature of a vertex shader to create an input layout, even though
+// the layout only describes the vertex buffer. Meshes don't know which shaders will draw them,
+// so each layout is created against a dummy vertex shader taking exactly its elements. Those
+// dummy shaders are compiled offline by CompileInputSignatures.ps1 from the list of layouts in
+// InputSignatures.txt, and packed with the other shaders. Each is named "Signature_" followed by
+// the hash of its source in hex, so the name can be worked out from the layout alone. A layout
+// missing from the list still works: its dummy shader is compiled at run time, which is slow, and
+// counted in gInputSignaturesCompiled so it can be added to the list.
+//
+// Layouts are cached by their list of elements, so each different layout is created once and
+// shared by every sub-mesh that uses it.
+
+#ifndef _INPUT_LAYOUT_H_INCLUDED_
+#define _INPUT_LAYOUT_H_INCLUDED_
+
+#include "Common.h"
+
+
+// Input layout for a list of vertex elements, shared with everything else using an identical list. Adds a
+// reference for the caller, so release it when done as with any other DirectX object. Returns nullptr and sets
+// gLastError on failure
+ID3D11InputLayout* CreateSharedInputLayout(const D3D11_INPUT_ELEMENT_DESC elements[], unsigned int numElements);
+
+// Release the cache's references to the layouts. Layouts still held elsewhere stay alive until released there
+void ReleaseInputLayouts();
+
+
+// Number of different input layouts created
+unsigned int NumberInputLayouts();
+
+// Statistics since startup: calls to CreateSharedInputLayout, and dummy shaders that had to be compiled at run time
+// because they were not found precompiled
+extern unsigned int gInputLayoutRequests;
+extern unsigned int gInputSignaturesCompiled;
+
+
+#endif //_INPUT_LAYOUT_H_INCLUDED_
@@ -0,0 +1,74 @@
+//--------------------------------------------------------------------------------------
+// Lighting equations shared by the lit pixel shaders
+//--------------------------------------------------------------------------------------
+// Include after Common.hlsli. Blinn-Phong lighting from the point light (light 1), the spotlight
+// (light 2) and the sun, each reduced by its shadows (see Shadows.hlsli).
+//
+// Two of the shader features (see Lighting_ps.hlsl and Shader.h) change the equations here:
+//   NUM_LIGHTS    Number of the scene's local lights used: 0, 1 (point light only) or 2 (both). The sun is always used
+//   CELL_SHADING  Diffuse levels are limited to the bands in a cell map, bound to t1 and sampled with no filtering (s1)
+
+#include "Shadows.hlsli"
+
+#ifndef NUM_LIGHTS
+#define NUM_LIGHTS 2
+#endif
+#ifndef CELL_SHADING
+#define CELL_SHADING 0
+#endif
+
+#if CELL_SHADING
+Texture2D    CellMap          : register(t1); // 1D map limiting the range of diffuse levels
+SamplerState PointSampleClamp : register(s1); // No filtering of cell maps (otherwise the cell edges would be blurred)
+#endif
+
+
+// Amount of diffuse light reaching a surface from a light direction, before the light's colour and attenuation
+float DiffuseLevel(float3 worldNormal, float3 lightDirection)
+{
+    float level = max(dot(worldNormal, lightDirection), 0);
+#if CELL_SHADING
+    level = CellMap.Sample(PointSampleClamp, level).r;
+#endif
+    return level;
+}
+
+
+// Total diffuse (including the ambient) and specular light at a world position. The normal and camera direction
+// must be normalised
+void CalculateLighting(float3 worldPosition, float3 worldNormal, float3 cameraDirection,
+                       out float3 diffuseLight, out float3 specularLight)
+{
+    // Sun
+    SunLight(worldPosition, worldNormal, cameraDirection, diffuseLight, specularLight);
+    diffuseLight += gAmbientColour;
+
+#if NUM_LIGHTS >= 1
+    // Light 1, a point light
+    float3 light1Vector = gLight1Position - worldPosition;
+    float  light1Distance = length(light1Vector);
+    float3 light1Direction = light1Vector / light1Distance; // Quicker than normalising as we have length for attenuation
+    float3 diffuseLight1 = gLight1Colour * DiffuseLevel(worldNormal, light1Direction) / light1Distance;
+    diffuseLight1 *= PointShadow(worldPosition);
+
+    float3 halfway = normalize(light1Direction + cameraDirection);
+    diffuseLight  += diffuseLight1;
+    specularLight += diffuseLight1 * pow(max(dot(worldNormal, halfway), 0), gSpecularPower);
+#endif
+
+#if NUM_LIGHTS >= 2
+    // Light 2, a spotlight
+    float3 light2Vector = gLight2Position - worldPosition;
+    float  light2Distance = length(light2Vector);
+    float3 light2Direction = light2Vector / light2Distance;
+    if (dot(gLight2Facing, -light2Direction) > gLight2CosHalfAngle)
+    {
+        float3 diffuseLight2 = gLight2Colour * DiffuseLevel(worldNormal, light2Direction) / light2Distance;
+        diffuseLight2 *= SpotShadow(worldPosition);
+
+        float3 halfway2 = normalize(light2Direction + cameraDirection);
+        diffuseLight  += diffuseLight2;
+        specularLight += diffuseLight2 * pow(max(dot(worldNormal, halfway2), 0), gSpecularPower);
+    }
+#endif
+}
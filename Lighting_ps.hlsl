@@ -0,0 +1,161 @@
+//--------------------------------------------------------------------------------------
+// Lit pixel shader with optional features
+//--------------------------------------------------------------------------------------
+// One source for all the lit materials. Each feature is turned on by a define, and each
+// combination the scene uses is compiled offline to its own file, a permutation: see
+// ShaderPermutations.txt, CompileShaderPermutations.ps1 and the feature bits in Shader.h,
+// which must match the names here. Features that are off cost nothing at run time.
+//
+//   NORMAL_MAP    Normals from a tangent space normal map in t1. Use with the NormalMapping vertex shader
+//   PARALLAX      Parallax mapping from the height in the alpha of the normal map, implies NORMAL_MAP
+//   CELL_SHADING  Diffuse levels limited by a cell map in t1 (see Lighting.hlsli)
+//   REFLECTION    Material colour from the cube map in t0 or the nearest reflection probe in the direction reflected
+//                 by the surface. Use with the Reflection vertex shader
+//   ALPHA_TEST    Pixels are discarded where the alpha of the texture is below one half
+//   NUM_LIGHTS    Number of the scene's local lights used, 0 to 2 (see Lighting.hlsli)
+
+#ifndef NORMAL_MAP
+#define NORMAL_MAP 0
+#endif
+#ifndef PARALLAX
+#define PARALLAX 0
+#endif
+#ifndef REFLECTION
+#define REFLECTION 0
+#endif
+#ifndef ALPHA_TEST
+#define ALPHA_TEST 0
+#endif
+#if PARALLAX && !NORMAL_MAP
+#undef NORMAL_MAP
+#define NORMAL_MAP 1
+#endif
+
+#include "Common.hlsli"
+#include "Lighting.hlsli"
+
+#if NORMAL_MAP && CELL_SHADING
+#error The normal map and cell map both use t1
+#endif
+
+
+//--------------------------------------------------------------------------------------
+// Textures
+//--------------------------------------------------------------------------------------
+
+#if REFLECTION
+TextureCube      CubeMap          : register(t0); // Static environment, specular material in the alpha
+TextureCubeArray ReflectionProbes : register(t8); // Dynamic cube maps, one per reflection probe
+#else
+Texture2D        DiffuseSpecularMap : register(t0); // Diffuse material in RGB, specular material in A
+#endif
+
+#if NORMAL_MAP
+Texture2D        NormalHeightMap  : register(t1); // Tangent space normal in RGB, height in A if used for parallax mapping
+#endif
+
+SamplerState     TexSampler       : register(s0);
+
+
+#if NORMAL_MAP
+#define PixelShaderInput NormalMappingPixelShaderInput
+#elif REFLECTION
+#define PixelShaderInput ReflectionPixelShaderInput
+#else
+#define PixelShaderInput LightingPixelShaderInput
+#endif
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+float4 main(PixelShaderInput input) : SV_Target
+{
+    float3 cameraDirection = normalize(gCameraPosition - input.worldPosition);
+    float2 uv = input.uv;
+
+#if NORMAL_MAP
+    // The normals for each pixel are interpolated from the vertex normals/tangents. This means they will not be length 1,
+    // so they need to be renormalised. Then calculate the bi-tangent to complete the three axes of tangent space and
+    // create the inverse tangent matrix to convert from tangent space into model space
+    float3 modelNormal = normalize(input.modelNormal);
+    float3 modelTangent = normalize(input.modelTangent);
+    float3 modelBiTangent = cross(modelNormal, modelTangent);
+    float3x3 invTangentMatrix = float3x3(modelTangent, modelBiTangent, modelNormal);
+
+#if PARALLAX
+    // Transform the camera direction into model space (normalise in case the world matrix is scaled) and then into
+    // tangent space (texture coordinate space) to give the direction to offset the texture coordinate
+    float3x3 invWorldMatrix = transpose((float3x3)gWorldMatrix);
+    float3 cameraModelDir = normalize(mul(invWorldMatrix, cameraDirection));
+    float2 textureOffsetDir = mul(cameraModelDir, transpose(invTangentMatrix)).xy;
+
+    // Get the height from the normal map's alpha channel, rescaled from 0->1 to the parallax depth, and use it to offset
+    // the texture coordinate
+    float textureHeight = 0.08f * (NormalHeightMap.Sample(TexSampler, uv).a - 0.5f);
+    uv += textureHeight * textureOffsetDir;
+#endif
+
+    // Get the texture normal from the normal map, scaled from 0->1 to -1->1, convert it into model space using the inverse
+    // tangent matrix, and then into world space. Normalise, because of texture filtering and any scaling in the world matrix
+    // Only x and y are read, z is rebuilt from them, so two channel (BC5) normal maps from the texture cooker work too
+    float3 textureNormal;
+    textureNormal.xy = 2.0f * NormalHeightMap.Sample(TexSampler, uv).rg - 1.0f;
+    textureNormal.z = sqrt(saturate(1.0f - dot(textureNormal.xy, textureNormal.xy)));
+    float3 worldNormal = normalize(mul((float3x3)gWorldMatrix, mul(textureNormal, invTangentMatrix)));
+#else
+    // Normal might have been scaled by model scaling or interpolation so renormalise
+    float3 worldNormal = normalize(input.worldNormal);
+#endif
+
+
+    //// Material colour ////
+
+#if REFLECTION
+    // Reflect the scene from the nearest reflection probe if there are any. The specular material still comes from
+    // the static cube map's alpha
+    float3 reflection = reflect(-cameraDirection, worldNormal);
+    float4 textureColour = CubeMap.Sample(TexSampler, reflection);
+    if (gNumReflectionProbes > 0)
+    {
+        uint nearestProbe = 0;
+        float nearestDistanceSq = 1e30f;
+        for (uint probe = 0; probe < gNumReflectionProbes; ++probe)
+        {
+            float3 toProbe = gReflectionProbes[probe].xyz - input.worldPosition;
+            float distanceSq = dot(toProbe, toProbe);
+            if (distanceSq < nearestDistanceSq)
+            {
+                nearestDistanceSq = distanceSq;
+                nearestProbe = probe;
+            }
+        }
+        textureColour.rgb = ReflectionProbes.Sample(TexSampler, float4(reflection, nearestProbe)).rgb;
+    }
+#else
+    float4 textureColour = DiffuseSpecularMap.Sample(TexSampler, uv);
+#endif
+
+#if ALPHA_TEST
+    // Before the lighting, which isn't needed for discarded pixels
+    if (textureColour.a < 0.5f)
+    {
+        discard;
+    }
+#endif
+
+    float3 diffuseMaterialColour = textureColour.rgb; // Diffuse material colour in texture RGB (base colour of model)
+    float specularMaterialColour = textureColour.a;   // Specular material colour in texture A (shininess of the surface)
+
+
+    //// Lighting ////
+
+    float3 diffuseLight, specularLight;
+    CalculateLighting(input.worldPosition, worldNormal, cameraDirection, diffuseLight, specularLight);
+
+    // Combine lighting with texture colours
+    float3 finalColour = diffuseLight * diffuseMaterialColour + specularLight * specularMaterialColour;
+
+    return float4(finalColour, 1.0f);
+}
@@ -0,0 +1,77 @@
+//--------------------------------------------------------------------------------------
+// Frustum class (cut down version) for visibility tests against a camera's view volume
+//--------------------------------------------------------------------------------------
+
+#include "CFrustum.h"
+
+
+/*-----------------------------------------------------------------------------------------
+    Constructors
+-----------------------------------------------------------------------------------------*/
+
+// Extract the planes from a view-projection matrix (DirectX conventions: 0 <= z <= w)
+// Points are row vectors (p * M), so each plane is a combination of the matrix columns
+CFrustum::CFrustum(const CMatrix4x4& m)
+{
+    // Columns of the matrix
+    float c0[4] = { m.e00, m.e10, m.e20, m.e30 };
+    float c1[4] = { m.e01, m.e11, m.e21, m.e31 };
+    float c2[4] = { m.e02, m.e12, m.e22, m.e32 };
+    float c3[4] = { m.e03, m.e13, m.e23, m.e33 };
+
+    float planes[6][4];
+    for (int i = 0; i < 4; ++i)
+    {
+        planes[0][i] = c3[i] + c0[i]; // Left   (-w <= x)
+        planes[1][i] = c3[i] - c0[i]; // Right  ( x <= w)
+        planes[2][i] = c3[i] + c1[i]; // Bottom (-w <= y)
+        planes[3][i] = c3[i] - c1[i]; // Top    ( y <= w)
+        planes[4][i] = c2[i];         // Near   ( 0 <= z)
+        planes[5][i] = c3[i] - c2[i]; // Far    ( z <= w)
+    }
+
+    // Normalise so plane equations give true distances
+    for (int p = 0; p < 6; ++p)
+    {
+        // An infinite projection has a plane at infinity (e.g. the far plane with reverse-Z), which never culls
+        float lengthSq = planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2];
+        if (IsZero(lengthSq))
+        {
+            normals[p] = { 0, 0, 0 };
+            distances[p] = 1;
+            continue;
+        }
+        float invLength = InvSqrt(lengthSq);
+        normals[p] = { planes[p][0] * invLength, planes[p][1] * invLength, planes[p][2] * invLength };
+        distances[p] = planes[p][3] * invLength;
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Member functions
+-----------------------------------------------------------------------------------------*/
+
+// Returns true if any part of the given sphere may be inside the frustum
+bool CFrustum::IsSphereVisible(const CVector3& centre, float radius) const
+{
+    for (int p = 0; p < 6; ++p)
+    {
+        if (Dot(normals[p], centre) + distances[p] < -radius)  return false;
+    }
+    return true;
+}
+
+// Returns true if any part of the given axis-aligned box may be inside the frustum
+// Tests the corner of the box furthest along each plane normal
+bool CFrustum::IsBoxVisible(const CVector3& minBounds, const CVector3& maxBounds) const
+{
+    for (int p = 0; p < 6; ++p)
+    {
+        CVector3 corner = { normals[p].x >= 0 ? maxBounds.x : minBounds.x,
+                            normals[p].y >= 0 ? maxBounds.y : minBounds.y,
+                            normals[p].z >= 0 ? maxBounds.z : minBounds.z };
+        if (Dot(normals[p], corner) + distances[p] < 0)  return false;
+    }
+    return true;
+}
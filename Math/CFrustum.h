@@ -0,0 +1,47 @@
+//--------------------------------------------------------------------------------------
+// Frustum class (cut down version) for visibility tests against a camera's view volume
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+
+#ifndef _CFRUSTUM_H_DEFINED_
+#define _CFRUSTUM_H_DEFINED_
+
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+
+
+// Frustum class - six planes with normals facing into the view volume
+class CFrustum
+{
+// Concrete class - public access
+public:
+    // Planes in the order left, right, bottom, top, near, far. A point p is inside a plane if Dot(normal, p) + distance >= 0
+    CVector3 normals[6];
+    float    distances[6];
+
+
+    /*-----------------------------------------------------------------------------------------
+        Constructors
+    -----------------------------------------------------------------------------------------*/
+
+    // Default constructor - leaves values uninitialised (for performance)
+    CFrustum() {}
+
+    // Extract the planes from a view-projection matrix (DirectX conventions: 0 <= z <= w)
+    // Pass world * view * projection to get the frustum in a model's local space
+    CFrustum(const CMatrix4x4& viewProjection);
+
+
+    /*-----------------------------------------------------------------------------------------
+        Member functions
+    -----------------------------------------------------------------------------------------*/
+
+    // Returns true if any part of the given sphere may be inside the frustum
+    bool IsSphereVisible(const CVector3& centre, float radius) const;
+
+    // Returns true if any part of the given axis-aligned box may be inside the frustum
+    bool IsBoxVisible(const CVector3& minBounds, const CVector3& maxBounds) const;
+};
+
+
+#endif // _CFRUSTUM_H_DEFINED_
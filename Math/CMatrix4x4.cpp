@@ -110,6 +110,23 @@ CMatrix4x4 operator*(const CMatrix4x4& m1, const CMatrix4x4& m2)
 }
 
 
+// Transform a point by an affine matrix (uses the translation in the matrix)
+CVector3 TransformPoint(const CVector3& p, const CMatrix4x4& m)
+{
+    return { p.x*m.e00 + p.y*m.e10 + p.z*m.e20 + m.e30,
+             p.x*m.e01 + p.y*m.e11 + p.z*m.e21 + m.e31,
+             p.x*m.e02 + p.y*m.e12 + p.z*m.e22 + m.e32 };
+}
+
+// Transform a direction by an affine matrix (ignores the translation in the matrix)
+CVector3 TransformVector(const CVector3& v, const CMatrix4x4& m)
+{
+    return { v.x*m.e00 + v.y*m.e10 + v.z*m.e20,
+             v.x*m.e01 + v.y*m.e11 + v.z*m.e21,
+             v.x*m.e02 + v.y*m.e12 + v.z*m.e22 };
+}
+
+
 
 /*-----------------------------------------------------------------------------------------
     Non-member functions
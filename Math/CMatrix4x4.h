@@ -69,6 +69,12 @@ public:
 // Matrix-matrix multiplication
 CMatrix4x4 operator*(const CMatrix4x4& m1, const CMatrix4x4& m2);
 
+// Transform a point by an affine matrix (uses the translation in the matrix)
+CVector3 TransformPoint(const CVector3& p, const CMatrix4x4& m);
+
+// Transform a direction by an affine matrix (ignores the translation in the matrix)
+CVector3 TransformVector(const CVector3& v, const CMatrix4x4& m);
+
 
 /*-----------------------------------------------------------------------------------------
   Non-member functions
@@ -0,0 +1,179 @@
+//--------------------------------------------------------------------------------------
+// Quaternion class (cut down version) to hold rotations
+//--------------------------------------------------------------------------------------
+
+#include "CQuaternion.h"
+
+#include <algorithm>
+
+
+/*-----------------------------------------------------------------------------------------
+    Non-member functions
+-----------------------------------------------------------------------------------------*/
+
+// Return unit length version of given quaternion
+CQuaternion Normalise(const CQuaternion& q)
+{
+    float lengthSq = Dot(q, q);
+    if (IsZero(lengthSq))  return QuaternionIdentity();
+
+    float invLength = InvSqrt(lengthSq);
+    return { q.w * invLength, q.x * invLength, q.y * invLength, q.z * invLength };
+}
+
+
+// Normalised linear interpolation between two rotations, t in range 0->1. Takes the shortest path
+// q and -q are the same rotation, so flip the second quaternion if the two are more than 90 degrees apart
+CQuaternion Nlerp(const CQuaternion& q1, const CQuaternion& q2, float t)
+{
+    float t2 = (Dot(q1, q2) < 0) ? -t : t;
+    float t1 = 1.0f - t;
+    return Normalise({ q1.w * t1 + q2.w * t2, q1.x * t1 + q2.x * t2, q1.y * t1 + q2.y * t2, q1.z * t1 + q2.z * t2 });
+}
+
+
+// Spherical linear interpolation between two rotations, t in range 0->1. Takes the shortest path at constant speed
+CQuaternion Slerp(const CQuaternion& q1, const CQuaternion& q2, float t)
+{
+    float cosAngle = Dot(q1, q2);
+    float sign = 1.0f;
+    if (cosAngle < 0)
+    {
+        cosAngle = -cosAngle;
+        sign = -1.0f;
+    }
+
+    // Nearly identical rotations, the sine below would be unstable so use linear interpolation
+    if (cosAngle > 0.9995f)  return Nlerp(q1, q2, t);
+
+    float angle = std::acos(cosAngle);
+    float invSin = 1.0f / std::sin(angle);
+    float t1 = std::sin((1.0f - t) * angle) * invSin;
+    float t2 = std::sin(t * angle) * invSin * sign;
+    return { q1.w * t1 + q2.w * t2, q1.x * t1 + q2.x * t2, q1.y * t1 + q2.y * t2, q1.z * t1 + q2.z * t2 };
+}
+
+
+// Rotate a vector by a unit quaternion, the same as multiplying by MatrixFromQuaternion(q)
+// Uses v' = v + w * t + (q.xyz x t), where t = 2 * (q.xyz x v), which is cheaper than building the matrix
+CVector3 Rotate(const CVector3& v, const CQuaternion& q)
+{
+    CVector3 axis = { q.x, q.y, q.z };
+    CVector3 t = Cross(axis, v) * 2.0f;
+    return v + t * q.w + Cross(axis, t);
+}
+
+
+// Return a rotation around the X, Y or Z axis or a given axis (which must be unit length). Angles in radians
+CQuaternion QuaternionRotationX(float x)  { return { std::cos(x * 0.5f), std::sin(x * 0.5f), 0, 0 }; }
+CQuaternion QuaternionRotationY(float y)  { return { std::cos(y * 0.5f), 0, std::sin(y * 0.5f), 0 }; }
+CQuaternion QuaternionRotationZ(float z)  { return { std::cos(z * 0.5f), 0, 0, std::sin(z * 0.5f) }; }
+
+CQuaternion QuaternionRotationAxis(const CVector3& axis, float angle)
+{
+    float s = std::sin(angle * 0.5f);
+    return { std::cos(angle * 0.5f), axis.x * s, axis.y * s, axis.z * s };
+}
+
+
+// Return the rotation from Euler angles (radians), rotating around Z, then X, then Y as MatrixRotationZ/X/Y do
+// Expanded form of QuaternionRotationZ(z) * QuaternionRotationX(x) * QuaternionRotationY(y)
+CQuaternion QuaternionFromEulerAngles(const CVector3& angles)
+{
+    float sX = std::sin(angles.x * 0.5f), cX = std::cos(angles.x * 0.5f);
+    float sY = std::sin(angles.y * 0.5f), cY = std::cos(angles.y * 0.5f);
+    float sZ = std::sin(angles.z * 0.5f), cZ = std::cos(angles.z * 0.5f);
+
+    return { cY * cX * cZ + sY * sX * sZ,
+             cY * sX * cZ + sY * cX * sZ,
+             sY * cX * cZ - cY * sX * sZ,
+             cY * cX * sZ - sY * sX * cZ };
+}
+
+
+// Return the Euler angles of a rotation, the same angles that CMatrix4x4::GetEulerAngles returns for its matrix
+// Only builds the matrix elements that are needed, and there is no scaling to remove
+CVector3 EulerAnglesFromQuaternion(const CQuaternion& q)
+{
+    float sX = -2 * (q.y * q.z - q.w * q.x); // -e21
+    float cX = std::sqrt(std::max(0.0f, 1.0f - sX * sX));
+
+    float sY, cY, sZ, cZ;
+    if (std::abs(cX) > 0.001f)
+    {
+        float invCX = 1.0f / cX;
+        sZ = 2 * (q.x * q.y + q.w * q.z) * invCX;           // e01
+        cZ = (1 - 2 * (q.x * q.x + q.z * q.z)) * invCX;     // e11
+        sY = 2 * (q.x * q.z + q.w * q.y) * invCX;           // e20
+        cY = (1 - 2 * (q.x * q.x + q.y * q.y)) * invCX;     // e22
+    }
+    else
+    {
+        // Gimbal lock - force Z angle to 0
+        sZ = 0.0f;
+        cZ = 1.0f;
+        sY = -2 * (q.x * q.z - q.w * q.y);                  // -e02
+        cY = 1 - 2 * (q.y * q.y + q.z * q.z);               // e00
+    }
+
+    return { std::atan2(sX, cX), std::atan2(sY, cY), std::atan2(sZ, cZ) };
+}
+
+
+// Return the rotation matrix equivalent to a unit quaternion
+// Laid out for row vectors (p * M) to match the rest of the matrix code
+CMatrix4x4 MatrixFromQuaternion(const CQuaternion& q)
+{
+    float xx = q.x * q.x,  yy = q.y * q.y,  zz = q.z * q.z;
+    float xy = q.x * q.y,  xz = q.x * q.z,  yz = q.y * q.z;
+    float wx = q.w * q.x,  wy = q.w * q.y,  wz = q.w * q.z;
+
+    CMatrix4x4 m;
+    m.e00 = 1 - 2 * (yy + zz);  m.e01 =     2 * (xy + wz);  m.e02 =     2 * (xz - wy);  m.e03 = 0;
+    m.e10 =     2 * (xy - wz);  m.e11 = 1 - 2 * (xx + zz);  m.e12 =     2 * (yz + wx);  m.e13 = 0;
+    m.e20 =     2 * (xz + wy);  m.e21 =     2 * (yz - wx);  m.e22 = 1 - 2 * (xx + yy);  m.e23 = 0;
+    m.e30 = 0;                  m.e31 = 0;                  m.e32 = 0;                  m.e33 = 1;
+    return m;
+}
+
+
+// Return the rotation held in a matrix, which must not contain scaling
+// Works from the largest of w, x, y or z to avoid dividing by a small number
+CQuaternion QuaternionFromMatrix(const CMatrix4x4& m)
+{
+    CQuaternion q;
+    float trace = m.e00 + m.e11 + m.e22;
+    if (trace > 0)
+    {
+        float s = 2.0f * std::sqrt(1.0f + trace);
+        q.w = 0.25f * s;
+        q.x = (m.e12 - m.e21) / s;
+        q.y = (m.e20 - m.e02) / s;
+        q.z = (m.e01 - m.e10) / s;
+    }
+    else if (m.e00 > m.e11 && m.e00 > m.e22)
+    {
+        float s = 2.0f * std::sqrt(1.0f + m.e00 - m.e11 - m.e22);
+        q.w = (m.e12 - m.e21) / s;
+        q.x = 0.25f * s;
+        q.y = (m.e01 + m.e10) / s;
+        q.z = (m.e02 + m.e20) / s;
+    }
+    else if (m.e11 > m.e22)
+    {
+        float s = 2.0f * std::sqrt(1.0f + m.e11 - m.e00 - m.e22);
+        q.w = (m.e20 - m.e02) / s;
+        q.x = (m.e01 + m.e10) / s;
+        q.y = 0.25f * s;
+        q.z = (m.e12 + m.e21) / s;
+    }
+    else
+    {
+        float s = 2.0f * std::sqrt(1.0f + m.e22 - m.e00 - m.e11);
+        q.w = (m.e01 - m.e10) / s;
+        q.x = (m.e02 + m.e20) / s;
+        q.y = (m.e12 + m.e21) / s;
+        q.z = 0.25f * s;
+    }
+    return Normalise(q);
+}
@@ -0,0 +1,135 @@
+//--------------------------------------------------------------------------------------
+// Quaternion class (cut down version) to hold rotations
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+
+#ifndef _CQUATERNION_H_DEFINED_
+#define _CQUATERNION_H_DEFINED_
+
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define QUATERNION_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+
+// Quaternion class - only unit quaternions (rotations) are expected in this app
+class CQuaternion
+{
+// Concrete class - public access
+public:
+    // Quaternion components, w is the real part
+    float w;
+    float x;
+    float y;
+    float z;
+
+    /*-----------------------------------------------------------------------------------------
+        Constructors
+    -----------------------------------------------------------------------------------------*/
+
+    // Default constructor - leaves values uninitialised (for performance)
+    CQuaternion() {}
+
+    // Construct with 4 values
+    CQuaternion(const float wIn, const float xIn, const float yIn, const float zIn)
+    {
+        w = wIn;
+        x = xIn;
+        y = yIn;
+        z = zIn;
+    }
+
+
+    /*-----------------------------------------------------------------------------------------
+        Operators
+    -----------------------------------------------------------------------------------------*/
+
+    // Combine rotations, see non-member operator* below
+    CQuaternion& operator*= (const CQuaternion& q);
+};
+
+
+/*-----------------------------------------------------------------------------------------
+    Non-member functions
+-----------------------------------------------------------------------------------------*/
+
+// Return the identity quaternion (no rotation)
+inline CQuaternion QuaternionIdentity()  { return { 1, 0, 0, 0 }; }
+
+// Dot product of two quaternions
+inline float Dot(const CQuaternion& q1, const CQuaternion& q2)  { return q1.w * q2.w + q1.x * q2.x + q1.y * q2.y + q1.z * q2.z; }
+
+// Inverse of a unit quaternion (the opposite rotation)
+inline CQuaternion Conjugate(const CQuaternion& q)  { return { q.w, -q.x, -q.y, -q.z }; }
+
+
+// Combine two rotations: q1 then q2. Ordered like matrices so that MatrixFromQuaternion(q1 * q2) is the same as
+// MatrixFromQuaternion(q1) * MatrixFromQuaternion(q2). This is the Hamilton product q2q1
+inline CQuaternion operator* (const CQuaternion& q1, const CQuaternion& q2)
+{
+#ifdef QUATERNION_USE_SSE
+    // Result = q2.w * (q1.w,  q1.x,  q1.y,  q1.z) + q2.x * (-q1.x, q1.w, -q1.z,  q1.y) +
+    //          q2.y * (-q1.y, q1.z,  q1.w, -q1.x) + q2.z * (-q1.z, -q1.y, q1.x,  q1.w)
+    const __m128 signs1 = _mm_set_ps( 0.0f, -0.0f,  0.0f, -0.0f); // _mm_set_ps lists the elements from last to first
+    const __m128 signs2 = _mm_set_ps(-0.0f,  0.0f,  0.0f, -0.0f);
+    const __m128 signs3 = _mm_set_ps( 0.0f,  0.0f, -0.0f, -0.0f);
+
+    __m128 a = _mm_loadu_ps(&q1.w);
+    __m128 result = _mm_mul_ps(_mm_set1_ps(q2.w), a);
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(q2.x), _mm_xor_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), signs1)));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(q2.y), _mm_xor_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)), signs2)));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(q2.z), _mm_xor_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 1, 2, 3)), signs3)));
+
+    CQuaternion q;
+    _mm_storeu_ps(&q.w, result);
+    return q;
+#else
+    return { q2.w * q1.w - q2.x * q1.x - q2.y * q1.y - q2.z * q1.z,
+             q2.w * q1.x + q2.x * q1.w + q2.y * q1.z - q2.z * q1.y,
+             q2.w * q1.y - q2.x * q1.z + q2.y * q1.w + q2.z * q1.x,
+             q2.w * q1.z + q2.x * q1.y - q2.y * q1.x + q2.z * q1.w };
+#endif
+}
+
+inline CQuaternion& CQuaternion::operator*= (const CQuaternion& q)  { return *this = *this * q; }
+
+
+// Rotate a vector by a unit quaternion, the same as multiplying by MatrixFromQuaternion(q)
+CVector3 Rotate(const CVector3& v, const CQuaternion& q);
+
+// Return unit length version of given quaternion
+CQuaternion Normalise(const CQuaternion& q);
+
+// Normalised linear interpolation between two rotations, t in range 0->1. Takes the shortest path
+// Much faster than Slerp and accurate enough for the small steps between animation keys or for blending
+CQuaternion Nlerp(const CQuaternion& q1, const CQuaternion& q2, float t);
+
+// Spherical linear interpolation between two rotations, t in range 0->1. Takes the shortest path at constant speed
+CQuaternion Slerp(const CQuaternion& q1, const CQuaternion& q2, float t);
+
+
+// Return a rotation around the X, Y or Z axis or a given axis (which must be unit length). Angles in radians
+CQuaternion QuaternionRotationX(float x);
+CQuaternion QuaternionRotationY(float y);
+CQuaternion QuaternionRotationZ(float z);
+CQuaternion QuaternionRotationAxis(const CVector3& axis, float angle);
+
+// Return the rotation from Euler angles (radians), rotating around Z, then X, then Y as MatrixRotationZ/X/Y do
+CQuaternion QuaternionFromEulerAngles(const CVector3& angles);
+
+// Return the Euler angles of a rotation, the same angles that CMatrix4x4::GetEulerAngles returns for its matrix
+CVector3 EulerAnglesFromQuaternion(const CQuaternion& q);
+
+
+// Return the rotation matrix equivalent to a unit quaternion
+CMatrix4x4 MatrixFromQuaternion(const CQuaternion& q);
+
+// Return the rotation held in a matrix, which must not contain scaling
+CQuaternion QuaternionFromMatrix(const CMatrix4x4& m);
+
+
+#endif // _CQUATERNION_H_DEFINED_
@@ -0,0 +1,138 @@
+//--------------------------------------------------------------------------------------
+// Cascaded shadow map fitting for directional lights
+//--------------------------------------------------------------------------------------
+
+#include "ShadowCascades.h"
+#include "MathHelpers.h"
+
+#include <cmath>
+#include <algorithm>
+
+
+// Split distances for the "practical" split scheme, a blend of logarithmic and uniform splits
+void CalculateCascadeSplits(float nearClip, float farClip, unsigned int numCascades, float lambda, float* splits)
+{
+    for (unsigned int i = 0; i <= numCascades; ++i)
+    {
+        float fraction = static_cast<float>(i) / numCascades;
+        float logSplit = nearClip * std::pow(farClip / nearClip, fraction);
+        float uniformSplit = nearClip + (farClip - nearClip) * fraction;
+        splits[i] = lambda * logSplit + (1 - lambda) * uniformSplit;
+    }
+
+    // Avoid rounding errors at the ends
+    splits[0] = nearClip;
+    splits[numCascades] = farClip;
+}
+
+
+// Fit cascades to the view of a camera
+void FitShadowCascades(const CMatrix4x4& cameraWorldMatrix, float fovX, float aspectRatio, float nearClip, float farClip,
+                       const CVector3& lightDirection, const CascadeSettings& settings, ShadowCascade* cascades)
+{
+    unsigned int numCascades = std::min(std::max(settings.numCascades, 1u), MAX_SHADOW_CASCADES);
+    float splits[MAX_SHADOW_CASCADES + 1];
+    CalculateCascadeSplits(nearClip, std::min(farClip, settings.shadowDistance), numCascades, settings.splitLambda, splits);
+
+    CVector3 cameraPosition = cameraWorldMatrix.GetPosition();
+    CVector3 cameraForward = Normalise(cameraWorldMatrix.GetZAxis());
+
+    // Square of the slope of the frustum's corner edges from the view direction
+    float tanX = std::tan(fovX * 0.5f);
+    float tanY = tanX / aspectRatio;
+    float cornerSlopeSq = tanX * tanX + tanY * tanY;
+
+    // Light space axes, fixed for a given light direction so snapping is consistent from frame to frame
+    CVector3 lightZ = Normalise(lightDirection);
+    CVector3 up = (std::abs(lightZ.y) < 0.99f) ? CVector3{ 0, 1, 0 } : CVector3{ 1, 0, 0 };
+    CVector3 lightX = Normalise(Cross(up, lightZ));
+    CVector3 lightY = Cross(lightZ, lightX);
+
+    for (unsigned int i = 0; i < numCascades; ++i)
+    {
+        auto& cascade = cascades[i];
+        float n = splits[i];
+        float f = splits[i + 1];
+        cascade.nearSplit = n;
+        cascade.farSplit = f;
+
+        // Smallest sphere around the slice: its centre is on the view axis, equally distant from the near and far
+        // corners, unless that is beyond the far plane (wide views), when the far corners alone decide it
+        float centreDistance = 0.5f * (n + f) * (1 + cornerSlopeSq);
+        float radius;
+        if (centreDistance < f)
+        {
+            radius = std::sqrt((f - centreDistance) * (f - centreDistance) + f * f * cornerSlopeSq);
+        }
+        else
+        {
+            centreDistance = f;
+            radius = f * std::sqrt(cornerSlopeSq);
+        }
+
+        // Round the radius up a little so rounding errors can't change the texel size between frames. Then add a
+        // texel's margin, since snapping below can move the centre up to a texel across
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+        radius *= static_cast<float>(settings.resolution) / (settings.resolution - 2);
+        CVector3 centre = cameraPosition + cameraForward * centreDistance;
+
+        // Snap the centre to whole texels across the light's view so the map's texels stay fixed in the world
+        float texelSize = 2 * radius / settings.resolution;
+        float centreX = std::floor(Dot(centre, lightX) / texelSize) * texelSize;
+        float centreY = std::floor(Dot(centre, lightY) / texelSize) * texelSize;
+        centre = lightX * centreX + lightY * centreY + lightZ * Dot(centre, lightZ);
+        cascade.centre = centre;
+        cascade.radius = radius;
+
+        // Light camera behind the sphere, far enough back to catch casters outside the slice
+        CVector3 lightPosition = centre - lightZ * (radius + settings.casterDistance);
+        CMatrix4x4 lightWorldMatrix = MatrixIdentity();
+        lightWorldMatrix.SetRow(0, lightX);
+        lightWorldMatrix.SetRow(1, lightY);
+        lightWorldMatrix.SetRow(2, lightZ);
+        lightWorldMatrix.SetRow(3, lightPosition);
+        cascade.viewMatrix = InverseAffine(lightWorldMatrix);
+
+        // Orthographic projection over the sphere, depth 0 at the light camera and 1 beyond the far side of the sphere
+        float depthRange = 2 * radius + settings.casterDistance;
+        cascade.projectionMatrix = { 1 / radius,       0.0f,             0.0f, 0.0f,
+                                           0.0f, 1 / radius,             0.0f, 0.0f,
+                                           0.0f,       0.0f, 1 / depthRange, 0.0f,
+                                           0.0f,       0.0f,             0.0f, 1.0f };
+        cascade.viewProjectionMatrix = cascade.viewMatrix * cascade.projectionMatrix;
+    }
+}
+
+
+// Returns true if a sphere may cast a shadow into the cascade
+bool IsCasterInCascade(const ShadowCascade& cascade, const CVector3& centre, float radius)
+{
+    // In light space the cascade is a box -r to r across and 0 to 2r + casterDistance deep. Anything towards the light
+    // from the far side of the box and overlapping it across may cast into it
+    CVector3 lightCentre = TransformPoint(centre, cascade.viewMatrix);
+    float reach = cascade.radius + radius;
+    float depthRange = 1 / cascade.projectionMatrix.e22;
+    return std::abs(lightCentre.x) <= reach && std::abs(lightCentre.y) <= reach && lightCentre.z - radius <= depthRange;
+}
+
+
+// Cull many casters against a set of cascades
+void CullCascadeCasters(const ShadowCascade* cascades, unsigned int numCascades,
+                        const CVector3* centres, const float* radii, unsigned int numCasters,
+                        uint8_t* cascadeMasks, unsigned int* casterCounts /*= nullptr*/)
+{
+    numCascades = std::min(numCascades, MAX_SHADOW_CASCADES);
+    for (unsigned int c = 0; c < numCasters; ++c)
+    {
+        uint8_t mask = 0;
+        for (unsigned int i = 0; i < numCascades; ++i)
+        {
+            if (IsCasterInCascade(cascades[i], centres[c], radii[c]))
+            {
+                mask |= 1 << i;
+                if (casterCounts)  ++casterCounts[i];
+            }
+        }
+        cascadeMasks[c] = mask;
+    }
+}
@@ -0,0 +1,78 @@
+//--------------------------------------------------------------------------------------
+// Cascaded shadow map fitting for directional lights
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+// A single shadow map stretched over a long view distance has far too few texels close to
+// the camera. Cascades split the view frustum into slices along its depth, each covered by
+// its own orthographic shadow map, with small slices near the camera and large ones further
+// away. This file does the CPU side: choosing the split distances, fitting an orthographic
+// light camera around each slice, and culling shadow casters per cascade. No DirectX in here.
+//
+// Each slice is enclosed in a bounding sphere rather than a tight box. The sphere's size
+// depends only on the split distances and field of view, not the camera's rotation, so the
+// cascade's texels keep the same world size as the camera turns. The sphere's centre is then
+// snapped to whole texels in light space so texels don't slide across the scene as the camera
+// moves. Together these stop shadow edges shimmering.
+
+#ifndef _SHADOW_CASCADES_H_DEFINED_
+#define _SHADOW_CASCADES_H_DEFINED_
+
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+
+#include <cstdint>
+
+// Most cascades supported
+const unsigned int MAX_SHADOW_CASCADES = 8;
+
+
+// Settings for splitting a view and fitting cascades to the slices
+struct CascadeSettings
+{
+    unsigned int numCascades    = 4;
+    float        splitLambda    = 0.9f;    // Blend from even splits (0) to logarithmic splits (1) - the "practical" split scheme
+    float        shadowDistance = 1000.0f; // Furthest distance from the camera shadows are drawn, if nearer than the far clip
+    unsigned int resolution     = 1024;    // Width and height of each cascade's map in texels, for snapping
+    float        casterDistance = 500.0f;  // How far back towards the light to include casters outside the slice
+};
+
+
+// The light camera for one cascade
+struct ShadowCascade
+{
+    float nearSplit; // Distances from the camera along its view direction covered by this cascade
+    float farSplit;
+
+    CVector3 centre; // Bounding sphere of the view slice after snapping to texels
+    float    radius;
+
+    CMatrix4x4 viewMatrix;
+    CMatrix4x4 projectionMatrix;     // Orthographic, standard depth (0 at the light camera, 1 furthest away)
+    CMatrix4x4 viewProjectionMatrix;
+};
+
+
+// Split distances for the "practical" split scheme: a blend of logarithmic splits (even texel density, but tiny near
+// slices) and uniform splits. Writes numCascades + 1 distances to splits, the first is nearClip, the last farClip
+void CalculateCascadeSplits(float nearClip, float farClip, unsigned int numCascades, float lambda, float* splits);
+
+// Fit cascades to the view of a camera with the given world matrix, horizontal field of view (radians), aspect
+// ratio (width / height) and near/far clip. lightDirection is the direction the light travels in. Writes
+// settings.numCascades cascades (at most MAX_SHADOW_CASCADES)
+void FitShadowCascades(const CMatrix4x4& cameraWorldMatrix, float fovX, float aspectRatio, float nearClip, float farClip,
+                       const CVector3& lightDirection, const CascadeSettings& settings, ShadowCascade* cascades);
+
+
+// Returns true if a sphere may cast a shadow into the cascade: it overlaps the cascade's box or lies between it and
+// the light. Casters further towards the light than the cascade's near plane are included too, they will be
+// clipped so should be avoided by choosing a large enough casterDistance
+bool IsCasterInCascade(const ShadowCascade& cascade, const CVector3& centre, float radius);
+
+// Cull many casters (bounding spheres) against a set of cascades. Writes a bit mask for each caster of the cascades
+// it may cast into, and adds the number of casters found in each cascade to casterCounts (if not null)
+void CullCascadeCasters(const ShadowCascade* cascades, unsigned int numCascades,
+                        const CVector3* centres, const float* radii, unsigned int numCasters,
+                        uint8_t* cascadeMasks, unsigned int* casterCounts = nullptr);
+
+
+#endif // _SHADOW_CASCADES_H_DEFINED_
@@ -6,10 +6,14 @@
 // expected to select these things. A later lab will introduce a more robust loader.
 
 #include "Mesh.h"
-#include "Shader.h" // Needed for helper function CreateSignatureForVertexLayout
+#include "InputLayout.h" // Vertex layouts shared between sub-meshes
 #include "CVector2.h" 
 #include "CVector3.h" 
 #include "GraphicsHelpers.h" // Helper functions to unclutter the code here
+#include "MathHelpers.h"
+#include "MeshSimplifier.h"
+#include "CFrustum.h"
+#include "Skinning.h"
 
 #include <assimp/Importer.hpp>
 #include <assimp/DefaultLogger.hpp>
@@ -17,12 +21,56 @@
 #include <assimp/scene.h>
 
 #include <memory>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+
+// Distance along a ray to where it hits a triangle (from either side), or maxDistance if it misses or the hit is further
+// away (Moller-Trumbore test). The direction need not be normalised, the distance is in multiples of its length
+static float RayTriangleDistance(const CVector3& origin, const CVector3& direction,
+                                 const CVector3& p0, const CVector3& p1, const CVector3& p2, float maxDistance)
+{
+    float edge1x = p1.x - p0.x, edge1y = p1.y - p0.y, edge1z = p1.z - p0.z;
+    float edge2x = p2.x - p0.x, edge2y = p2.y - p0.y, edge2z = p2.z - p0.z;
+
+    // Determinant of the system solved for the distance and the barycentric coordinates, zero if the ray is parallel
+    float px = direction.y * edge2z - direction.z * edge2y;
+    float py = direction.z * edge2x - direction.x * edge2z;
+    float pz = direction.x * edge2y - direction.y * edge2x;
+    float determinant = edge1x * px + edge1y * py + edge1z * pz;
+    if (determinant == 0)  return maxDistance;
+    float inverseDeterminant = 1 / determinant;
+
+    float tx = origin.x - p0.x, ty = origin.y - p0.y, tz = origin.z - p0.z;
+    float u = (tx * px + ty * py + tz * pz) * inverseDeterminant;
+    if (u < 0 || u > 1)  return maxDistance;
+
+    float qx = ty * edge1z - tz * edge1y;
+    float qy = tz * edge1x - tx * edge1z;
+    float qz = tx * edge1y - ty * edge1x;
+    float v = (direction.x * qx + direction.y * qy + direction.z * qz) * inverseDeterminant;
+    if (v < 0 || u + v > 1)  return maxDistance;
+
+    float distance = (edge2x * qx + edge2y * qy + edge2z * qz) * inverseDeterminant;
+    return (distance >= 0 && distance < maxDistance) ? distance : maxDistance;
+}
+
+
+// Settings for automatic level of detail generation. Each level aims for this fraction of the triangles of
+// the previous level, but stops early if the surface would move by more than the given fraction of the mesh size
+const float LOD_TRIANGLE_RATIO = 0.5f;
+const float LOD_MAX_ERROR[MAX_LODS] = { 0.0f, 0.01f, 0.025f, 0.05f };
+
+// A level is only kept if it removes at least this fraction of the triangles of the previous level
+const float LOD_MIN_REDUCTION = 0.2f;
 
 
 // Pass the name of the mesh file to load. Uses assimp (http://www.assimp.org/) to support many file types
 // Optionally request tangents to be calculated (for normal and parallax mapping - see later lab)
 // Will throw a std::runtime_error exception on failure (since constructors can't return errors).
 Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
+    : mFileName(fileName), mRequireTangents(requireTangents)
 {
     Assimp::Importer importer;
 
@@ -44,12 +92,13 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
                                aiProcess_FindInstances |
                                aiProcess_FindDegenerates |
                                aiProcess_RemoveRedundantMaterials |
-                               aiProcess_Debone |
+                               aiProcess_LimitBoneWeights |
                                aiProcess_RemoveComponent;
 
     // Flags to specify what mesh data to ignore
+    // Bone weights and animations are kept for skinned and animated meshes
     int removeComponents = aiComponent_LIGHTS | aiComponent_CAMERAS | aiComponent_TEXTURES | aiComponent_COLORS | 
-                           aiComponent_BONEWEIGHTS | aiComponent_ANIMATIONS | aiComponent_MATERIALS;
+                           aiComponent_MATERIALS;
 
     // Add / remove tangents as required by user
     if (requireTangents)
@@ -65,7 +114,7 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
     importer.SetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, 80.0f); // Smoothing angle for normals
     importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);  // Remove points and lines (keep triangles only)
     importer.SetPropertyBool(AI_CONFIG_PP_FD_REMOVE, true);                 // Remove degenerate triangles
-    importer.SetPropertyBool(AI_CONFIG_PP_DB_ALL_OR_NONE, true);            // Default to removing bones/weights from meshes that don't need skinning
+    importer.SetPropertyInteger(AI_CONFIG_PP_LBW_MAX_WEIGHTS, MAX_BONE_INFLUENCES); // Bones per vertex supported by skinning
   
     importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, removeComponents);
 
@@ -85,6 +134,7 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
     // A mesh is made of sub-meshes, each one can have a different material (texture)
     // Import each sub-mesh in the file to seperate index / vertex buffer (could share buffers between sub-meshes but that would make things more complex)
     mSubMeshes.resize(scene->mNumMeshes);
+    std::vector<std::vector<std::string>> boneNames(scene->mNumMeshes); // Bones are matched to nodes after the nodes are read
     for (unsigned int m = 0; m < scene->mNumMeshes; ++m)
     {
         aiMesh* assimpMesh = scene->mMeshes[m];
@@ -124,16 +174,24 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
             offset += 8;
         }
 
+        // Skinned sub-meshes have up to four bone indices (one byte each) and weights per vertex
+        unsigned int boneIndexOffset = offset;
+        unsigned int boneWeightOffset = offset + 4;
+        if (assimpMesh->HasBones())
+        {
+            if (assimpMesh->mNumBones > MAX_BONES)  throw std::runtime_error("Too many bones in sub-mesh " + subMeshName + " in " + fileName);
+            vertexElements.push_back( { "BoneIndices", 0, DXGI_FORMAT_R8G8B8A8_UINT,      0, boneIndexOffset,  D3D11_INPUT_PER_VERTEX_DATA, 0 } );
+            vertexElements.push_back( { "BoneWeights", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, boneWeightOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 } );
+            offset += 20;
+        }
+
         subMesh.vertexSize = offset;
 
 
-        // Create a "vertex layout" to describe to DirectX what is data in each vertex of this mesh
-        auto shaderSignature = CreateSignatureForVertexLayout(vertexElements.data(), static_cast<int>(vertexElements.size()));
-        HRESULT hr = gD3DDevice->CreateInputLayout(vertexElements.data(), static_cast<UINT>(vertexElements.size()),
-                                                   shaderSignature->GetBufferPointer(), shaderSignature->GetBufferSize(),
-                                                   &subMesh.vertexLayout);
-        if (shaderSignature)  shaderSignature->Release();
-        if (FAILED(hr))  throw std::runtime_error("Failure creating input layout for " + fileName);
+        // Get a "vertex layout" to describe to DirectX what is data in each vertex of this mesh. Sub-meshes with the same
+        // vertex elements share a layout, created once (see InputLayout.h)
+        subMesh.vertexLayout = CreateSharedInputLayout(vertexElements.data(), static_cast<unsigned int>(vertexElements.size()));
+        if (subMesh.vertexLayout == nullptr)  throw std::runtime_error("Failure creating input layout for " + fileName + ": " + gLastError);
 
 
 
@@ -197,6 +255,60 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
             }
         }
 
+        if (assimpMesh->HasBones())
+        {
+            // Assimp stores a list of weighted vertices for each bone, turn that into a list of bones for each vertex
+            // Zeroed first so unused influences have zero weight
+            for (unsigned int v = 0; v < subMesh.numVertices; ++v)
+            {
+                std::memset(vertices.get() + v * subMesh.vertexSize + boneIndexOffset, 0, 20);
+            }
+
+            subMesh.bones.resize(assimpMesh->mNumBones);
+            boneNames[m].resize(assimpMesh->mNumBones);
+            for (unsigned int b = 0; b < assimpMesh->mNumBones; ++b)
+            {
+                aiBone* assimpBone = assimpMesh->mBones[b];
+                boneNames[m][b] = assimpBone->mName.C_Str();
+                subMesh.bones[b].offsetMatrix.SetValues(&assimpBone->mOffsetMatrix.a1);
+                subMesh.bones[b].offsetMatrix.Transpose(); // Assimp stores matrices differently to this app
+
+                for (unsigned int w = 0; w < assimpBone->mNumWeights; ++w)
+                {
+                    auto& weight = assimpBone->mWeights[w];
+                    unsigned char* vertex = vertices.get() + weight.mVertexId * subMesh.vertexSize;
+                    uint8_t* boneIndices = vertex + boneIndexOffset;
+                    float*   boneWeights = reinterpret_cast<float*>(vertex + boneWeightOffset);
+
+                    // Fill the first free slot, or replace the smallest weight if this one is bigger
+                    unsigned int slot = 0;
+                    for (unsigned int i = 1; i < MAX_BONE_INFLUENCES; ++i)  if (boneWeights[i] < boneWeights[slot])  slot = i;
+                    if (weight.mWeight > boneWeights[slot])
+                    {
+                        boneIndices[slot] = static_cast<uint8_t>(b);
+                        boneWeights[slot] = weight.mWeight;
+                    }
+                }
+            }
+
+            // Weights must sum to 1
+            for (unsigned int v = 0; v < subMesh.numVertices; ++v)
+            {
+                float* boneWeights = reinterpret_cast<float*>(vertices.get() + v * subMesh.vertexSize + boneWeightOffset);
+                float total = boneWeights[0] + boneWeights[1] + boneWeights[2] + boneWeights[3];
+                if (total > 0)  for (unsigned int i = 0; i < MAX_BONE_INFLUENCES; ++i)  boneWeights[i] /= total;
+                else            boneWeights[0] = 1; // Unweighted vertex follows the first bone
+            }
+
+            subMesh.skinnedFormat.vertexSize       = subMesh.vertexSize;
+            subMesh.skinnedFormat.positionOffset   = positionOffset;
+            subMesh.skinnedFormat.normalOffset     = normalOffset;
+            subMesh.skinnedFormat.tangentOffset    = requireTangents ? tangentOffset : SkinnedVertexFormat::NO_TANGENTS;
+            subMesh.skinnedFormat.boneIndexOffset  = boneIndexOffset;
+            subMesh.skinnedFormat.boneWeightOffset = boneWeightOffset;
+            mIsSkinned = true;
+        }
+
 
         //-----------------------------------
 
@@ -211,6 +323,75 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
             *index++ = assimpMesh->mFaces[face].mIndices[2];
         }
 
+        // Split the full detail geometry into meshlets, which reorders the indices so each meshlet is contiguous
+        if (subMesh.bones.empty())
+        {
+            subMesh.meshlets = BuildMeshlets(vertices.get(), subMesh.vertexSize, subMesh.numVertices,
+                                             reinterpret_cast<uint32_t*>(indices.get()), subMesh.numIndices);
+        }
+
+
+        //-----------------------------------
+
+        // Generate lower levels of detail by simplifying the previous level. They share the vertex buffer so only
+        // the indices are new. All levels are stored one after another in a single index buffer
+        std::vector<uint32_t> allIndices(reinterpret_cast<uint32_t*>(indices.get()),
+                                         reinterpret_cast<uint32_t*>(indices.get()) + subMesh.numIndices);
+        subMesh.lodIndexStart[0] = 0;
+        subMesh.lodIndexCount[0] = subMesh.numIndices;
+        for (unsigned int lod = 1; lod < MAX_LODS; ++lod)
+        {
+            unsigned int previousStart = subMesh.lodIndexStart[lod - 1];
+            unsigned int previousCount = subMesh.lodIndexCount[lod - 1];
+            unsigned int targetCount = static_cast<unsigned int>(previousCount * LOD_TRIANGLE_RATIO) / 3 * 3;
+            std::vector<uint32_t> lodIndices = SimplifyMesh(vertices.get(), subMesh.vertexSize, subMesh.numVertices,
+                                                            allIndices.data() + previousStart, previousCount,
+                                                            targetCount, LOD_MAX_ERROR[lod]);
+            if (lodIndices.empty() || lodIndices.size() > previousCount * (1.0f - LOD_MIN_REDUCTION))  break;
+
+            subMesh.lodIndexStart[lod] = static_cast<unsigned int>(allIndices.size());
+            subMesh.lodIndexCount[lod] = static_cast<unsigned int>(lodIndices.size());
+            allIndices.insert(allIndices.end(), lodIndices.begin(), lodIndices.end());
+            subMesh.numLODs = lod + 1;
+        }
+        mNumLODs = std::max(mNumLODs, subMesh.numLODs);
+
+
+        // Bounding sphere for the sub-mesh, centred on the middle of its bounding box
+        CVector3 minBounds = *reinterpret_cast<CVector3*>(vertices.get() + positionOffset);
+        CVector3 maxBounds = minBounds;
+        for (unsigned int v = 1; v < subMesh.numVertices; ++v)
+        {
+            const CVector3& p = *reinterpret_cast<CVector3*>(vertices.get() + v * subMesh.vertexSize + positionOffset);
+            minBounds = { std::min(minBounds.x, p.x), std::min(minBounds.y, p.y), std::min(minBounds.z, p.z) };
+            maxBounds = { std::max(maxBounds.x, p.x), std::max(maxBounds.y, p.y), std::max(maxBounds.z, p.z) };
+        }
+        subMesh.boundingCentre = (minBounds + maxBounds) * 0.5f;
+        subMesh.boundingRadius = 0;
+        for (unsigned int v = 0; v < subMesh.numVertices; ++v)
+        {
+            const CVector3& p = *reinterpret_cast<CVector3*>(vertices.get() + v * subMesh.vertexSize + positionOffset);
+            subMesh.boundingRadius = std::max(subMesh.boundingRadius, Length(p - subMesh.boundingCentre));
+        }
+
+        // Keep the positions and full detail triangles for ray casts, the GPU buffers can't be read back
+        subMesh.positions.resize(subMesh.numVertices);
+        for (unsigned int v = 0; v < subMesh.numVertices; ++v)
+        {
+            subMesh.positions[v] = *reinterpret_cast<CVector3*>(vertices.get() + v * subMesh.vertexSize + positionOffset);
+        }
+        subMesh.indices.assign(allIndices.begin(), allIndices.begin() + subMesh.numIndices);
+        std::vector<BoundingBox> triangleBounds(subMesh.numIndices / 3);
+        for (unsigned int t = 0; t < triangleBounds.size(); ++t)
+        {
+            const CVector3& p0 = subMesh.positions[subMesh.indices[t * 3 + 0]];
+            const CVector3& p1 = subMesh.positions[subMesh.indices[t * 3 + 1]];
+            const CVector3& p2 = subMesh.positions[subMesh.indices[t * 3 + 2]];
+            triangleBounds[t] = { { Min(p0.x, p1.x, p2.x), Min(p0.y, p1.y, p2.y), Min(p0.z, p1.z, p2.z) },
+                                  { Max(p0.x, p1.x, p2.x), Max(p0.y, p1.y, p2.y), Max(p0.z, p1.z, p2.z) } };
+        }
+        subMesh.triangleBVH.Build(triangleBounds);
+
 
         //-----------------------------------
 
@@ -225,17 +406,27 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
         bufferDesc.MiscFlags = 0;
         initData.pSysMem = vertices.get(); // Fill the new vertex buffer with data loaded by assimp
     
-        hr = gD3DDevice->CreateBuffer(&bufferDesc, &initData, &subMesh.vertexBuffer);
+        HRESULT hr = gD3DDevice->CreateBuffer(&bufferDesc, &initData, &subMesh.vertexBuffer);
         if (FAILED(hr))  throw std::runtime_error("Failure creating vertex buffer for " + fileName);
 
+        // Skinned sub-meshes also get a dynamic vertex buffer for CPU skinning, which is filled from a copy of the vertices
+        if (!subMesh.bones.empty())
+        {
+            subMesh.bindPoseVertices.assign(vertices.get(), vertices.get() + bufferDesc.ByteWidth);
+            bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+            bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+            hr = gD3DDevice->CreateBuffer(&bufferDesc, &initData, &subMesh.skinnedVertexBuffer);
+            if (FAILED(hr))  throw std::runtime_error("Failure creating skinned vertex buffer for " + fileName);
+        }
+
 
         // Create GPU-side index buffer and copy the vertices imported by assimp into it
         bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER; // Indicate it is an index buffer
         bufferDesc.Usage = D3D11_USAGE_DEFAULT;         // Default usage for this buffer - we'll see other usages later
-        bufferDesc.ByteWidth = subMesh.numIndices * sizeof(DWORD); // Size of the buffer in bytes
+        bufferDesc.ByteWidth = static_cast<UINT>(allIndices.size() * sizeof(DWORD)); // Size of the buffer in bytes (all levels of detail)
         bufferDesc.CPUAccessFlags = 0;
         bufferDesc.MiscFlags = 0;
-        initData.pSysMem = indices.get(); // Fill the new index buffer with data loaded by assimp
+        initData.pSysMem = allIndices.data(); // Fill the new index buffer with data loaded by assimp
 
         hr = gD3DDevice->CreateBuffer(&bufferDesc, &initData, &subMesh.indexBuffer);
         if (FAILED(hr))  throw std::runtime_error("Failure creating index buffer for " + fileName);
@@ -249,6 +440,20 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
     // Uses recursive helper functions to build node hierarchy    
     mNodes.resize(CountNodes(scene->mRootNode));
     ReadNodes(scene->mRootNode, 0, 0);
+
+    // Connect bones to the nodes that move them
+    for (unsigned int m = 0; m < mSubMeshes.size(); ++m)
+    {
+        for (unsigned int b = 0; b < mSubMeshes[m].bones.size(); ++b)
+        {
+            mSubMeshes[m].bones[b].node = FindNode(boneNames[m][b]);
+            if (mSubMeshes[m].bones[b].node == mNodes.size())  throw std::runtime_error("Bone " + boneNames[m][b] + " has no node in " + fileName);
+        }
+    }
+
+    CalculateBounds();
+    CalculateNodeReach();
+    ReadAnimations(scene);
 }
 
 
@@ -256,12 +461,38 @@ Mesh::~Mesh()
 {
     for (auto& subMesh : mSubMeshes)
     {
+        if (subMesh.skinnedVertexBuffer)  subMesh.skinnedVertexBuffer->Release();
         if (subMesh.indexBuffer)   subMesh.indexBuffer ->Release();
         if (subMesh.vertexBuffer)  subMesh.vertexBuffer->Release();
         if (subMesh.vertexLayout)  subMesh.vertexLayout->Release();
     }
 }
 
+// Take the geometry of another mesh loaded from a newer version of the same file, swapping it with the geometry here.
+// Returns false and changes nothing if the nodes differ
+bool Mesh::ReplaceGeometry(Mesh& newMesh)
+{
+    if (newMesh.mNodes.size() != mNodes.size())  return false;
+    for (unsigned int node = 0; node < mNodes.size(); ++node)
+    {
+        if (newMesh.mNodes[node].name != mNodes[node].name ||
+            newMesh.mNodes[node].parentIndex != mNodes[node].parentIndex)  return false;
+    }
+
+    // Swap everything derived from the geometry, the node names and hierarchy are the same and the animations stay
+    std::swap(mSubMeshes, newMesh.mSubMeshes);
+    for (unsigned int node = 0; node < mNodes.size(); ++node)
+    {
+        std::swap(mNodes[node].subMeshes, newMesh.mNodes[node].subMeshes);
+    }
+    std::swap(mNumLODs, newMesh.mNumLODs);
+    std::swap(mNodeReach, newMesh.mNodeReach);
+    std::swap(mIsSkinned, newMesh.mIsSkinned);
+    std::swap(mBoundingCentre, newMesh.mBoundingCentre);
+    std::swap(mBoundingRadius, newMesh.mBoundingRadius);
+    return true;
+}
+
 // Helper function for Render function - sends the world matrix for the next object to render over to the GPU
 void Mesh::SetWorldMatrixOnGPU(CMatrix4x4 worldMatrix)
 {
@@ -274,17 +505,30 @@ void Mesh::SetWorldMatrixOnGPU(CMatrix4x4 worldMatrix)
 }
 
 // Helper function for Render function - renders all the submeshes of the given node. World matrix must already be set
-void Mesh::RenderNodeSubMeshes(unsigned int nodeIndex)
+void Mesh::RenderNodeSubMeshes(unsigned int nodeIndex, unsigned int lod /*= 0*/, bool cullBackFaces /*= false*/)
 {
+    // Meshlets are culled in the node's local space, so transform the frustum and camera into that space
+    // Only needed at full detail, lower levels of detail are drawn whole
+    CFrustum localFrustum;
+    CVector3 localCameraPosition;
+    bool cullMeshlets = (lod == 0);
+    if (cullMeshlets)
+    {
+        const CMatrix4x4& worldMatrix = gPerModelConstants.worldMatrix;
+        localFrustum = CFrustum(worldMatrix * gPerFrameConstants.viewProjectionMatrix);
+        localCameraPosition = TransformPoint(gPerFrameConstants.cameraPosition, InverseAffine(worldMatrix));
+    }
+
     auto& node = mNodes[nodeIndex];
     for (auto& subMeshIndex : node.subMeshes)
     {
         auto& subMesh = mSubMeshes[subMeshIndex];
 
-        // Set vertex buffer as next data source for GPU
+        // Set vertex buffer as next data source for GPU. Skinned sub-meshes may use a buffer skinned on the CPU
+        ID3D11Buffer* vertexBuffer = subMesh.bones.empty() ? subMesh.vertexBuffer : PrepareSkinning(subMeshIndex);
         UINT stride = subMesh.vertexSize;
         UINT offset = 0;
-        gD3DContext->IASetVertexBuffers(0, 1, &subMesh.vertexBuffer, &stride, &offset);
+        gD3DContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
 
         // Indicate the layout of vertex buffer
         gD3DContext->IASetInputLayout(subMesh.vertexLayout);
@@ -295,13 +539,34 @@ void Mesh::RenderNodeSubMeshes(unsigned int nodeIndex)
         // Using triangle lists only in this class
         gD3DContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-        // Render mesh
-        gD3DContext->DrawIndexed(subMesh.numIndices, 0, 0);
+        // Render mesh at the requested level of detail, or the lowest this sub-mesh has
+        unsigned int subMeshLOD = std::min(lod, subMesh.numLODs - 1);
+        if (!cullMeshlets || subMesh.meshlets.empty())
+        {
+            gD3DContext->DrawIndexed(subMesh.lodIndexCount[subMeshLOD], subMesh.lodIndexStart[subMeshLOD], 0);
+            gTrianglesRendered += subMesh.lodIndexCount[subMeshLOD] / 3;
+            continue;
+        }
+
+        // Full detail: cull the meshlets then draw the survivors. There is no multi-draw in DirectX 11 so each run of
+        // adjacent visible meshlets is drawn with one call
+        auto cullStart = std::chrono::high_resolution_clock::now();
+        static std::vector<IndexRange> visibleRanges; // Reused to avoid allocations each frame
+        visibleRanges.clear();
+        CullMeshlets(subMesh.meshlets.data(), static_cast<unsigned int>(subMesh.meshlets.size()), localFrustum,
+                     localCameraPosition, cullBackFaces, visibleRanges, &gMeshletStats);
+        gMeshletCullTime += std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - cullStart).count();
+
+        for (auto& range : visibleRanges)
+        {
+            gD3DContext->DrawIndexed(range.count, range.start, 0);
+            gTrianglesRendered += range.count / 3;
+        }
     }
 }
 
 
-// Render a given node in the mesh. Recursive function.
+// Render a given node in the mesh. Recursive function. Meshlets are frustum culled but not back face culled
 // - modelMatrices are sent from the Model - one matrix for each node in the mesh, representing it's current "pose". Matrices are relative to the parent node.
 // - nodeIndex is the index of the current node, for accessing the vectors of matrices and node information
 // - parentWorldMatrix is the world matrix that was calculated for the parent in a previous call, it's used to make relative matrices into absolute matrices
@@ -327,12 +592,14 @@ void Mesh::RenderRecursive(std::vector<CMatrix4x4>& modelMatrices, unsigned int
 
 
 // Render all the nodes in the mesh without recursion, faster alternative to above (lab exercise)
-void Mesh::Render(std::vector<CMatrix4x4>& modelMatrices)
+// Pass the level of detail to use, 0 is full detail. Set cullBackFaces if the mesh is drawn with back face culling
+void Mesh::Render(std::vector<CMatrix4x4>& modelMatrices, unsigned int lod /*= 0*/, bool cullBackFaces /*= true*/)
 {
     // Loop through all nodes. Node 0 is the root and the remaining nodes are in "flattened" depth-first order.
     // Parent nodes will always come before their children in the vector and we use that fact to avoid recursion.
     // We only needed the recursion to pass the parent's absolute world matrix to the children. Instead, store the
     // absolute world matrix then the children can refer back to their parent to get it. 
+    // All the matrices are calculated before anything is rendered since skinned sub-meshes need the matrices of their bones
     for (unsigned int nodeIndex = 0; nodeIndex < mNodes.size(); ++nodeIndex)
     {
         Node& thisNode = mNodes[nodeIndex]; // Use a reference to this node to make the variable name more readable. Use this trick to simplify your own code (no cost)
@@ -351,17 +618,81 @@ void Mesh::Render(std::vector<CMatrix4x4>& modelMatrices)
 		{
 			thisNode.absoluteMatrix = modelMatrices[nodeIndex] * mNodes[thisNode.parentIndex].absoluteMatrix;
 		}
+    }
+
+    for (unsigned int nodeIndex = 0; nodeIndex < mNodes.size(); ++nodeIndex)
+    {
+        Node& thisNode = mNodes[nodeIndex];
 
         // 2. Set that absolute world matrix on the GPU (call the function shortly above)
 		SetWorldMatrixOnGPU(thisNode.absoluteMatrix);
     
         // 3. Now the world matrix is ready on the GPU, render the sub-meshes for this node (function above)
-		RenderNodeSubMeshes(nodeIndex);
+		RenderNodeSubMeshes(nodeIndex, lod, cullBackFaces);
     }
 }
 
 
 
+// Cull the full detail meshlets of the whole mesh in its default pose, adding the results to stats without drawing
+void Mesh::CullAllMeshlets(const CMatrix4x4& worldMatrix, const CMatrix4x4& viewProjectionMatrix, const CVector3& cameraPosition,
+                           bool cullBackFaces, MeshletCullStats& stats)
+{
+    std::vector<IndexRange> visibleRanges;
+    for (unsigned int nodeIndex = 0; nodeIndex < mNodes.size(); ++nodeIndex)
+    {
+        Node& thisNode = mNodes[nodeIndex];
+        if (nodeIndex == 0)  thisNode.absoluteMatrix = worldMatrix;
+        else                 thisNode.absoluteMatrix = thisNode.defaultMatrix * mNodes[thisNode.parentIndex].absoluteMatrix;
+        if (thisNode.subMeshes.empty())  continue;
+
+        // Same as RenderNodeSubMeshes, cull in the node's local space
+        CFrustum localFrustum(thisNode.absoluteMatrix * viewProjectionMatrix);
+        CVector3 localCameraPosition = TransformPoint(cameraPosition, InverseAffine(thisNode.absoluteMatrix));
+        for (auto subMeshIndex : thisNode.subMeshes)
+        {
+            const SubMesh& subMesh = mSubMeshes[subMeshIndex];
+            if (subMesh.meshlets.empty())  continue;
+            visibleRanges.clear();
+            CullMeshlets(subMesh.meshlets.data(), static_cast<unsigned int>(subMesh.meshlets.size()), localFrustum,
+                         localCameraPosition, cullBackFaces, visibleRanges, &stats);
+        }
+    }
+}
+
+
+// Distance along a ray to the nearest triangle of the mesh posed by the given node matrices, or maxDistance if the ray
+// misses. The ray is taken into the space of each node rather than moving the triangles, distances along it stay the same
+float Mesh::RayCast(const std::vector<CMatrix4x4>& modelMatrices, const CVector3& origin, const CVector3& direction, float maxDistance)
+{
+    float nearest = maxDistance;
+    for (unsigned int nodeIndex = 0; nodeIndex < mNodes.size(); ++nodeIndex)
+    {
+        Node& thisNode = mNodes[nodeIndex];
+        if (nodeIndex == 0)  thisNode.absoluteMatrix = modelMatrices[nodeIndex];
+        else                 thisNode.absoluteMatrix = modelMatrices[nodeIndex] * mNodes[thisNode.parentIndex].absoluteMatrix;
+        if (thisNode.subMeshes.empty())  continue;
+
+        CMatrix4x4 inverseMatrix = InverseAffine(thisNode.absoluteMatrix);
+        CVector3 nodeOrigin    = TransformPoint(origin, inverseMatrix);
+        CVector3 nodeDirection = TransformVector(direction, inverseMatrix);
+        for (auto subMeshIndex : thisNode.subMeshes)
+        {
+            const SubMesh& subMesh = mSubMeshes[subMeshIndex];
+            auto TriangleHit = [&](uint32_t triangle, float maxDistance)
+            {
+                const uint32_t* index = &subMesh.indices[triangle * 3];
+                return RayTriangleDistance(nodeOrigin, nodeDirection, subMesh.positions[index[0]], subMesh.positions[index[1]],
+                                           subMesh.positions[index[2]], maxDistance);
+            };
+            uint32_t triangle;
+            nearest = subMesh.triangleBVH.RayCast(nodeOrigin, nodeDirection, nearest, TriangleHit, triangle);
+        }
+    }
+    return nearest;
+}
+
+
 //--------------------------------------------------------------------------------------
 // Helper functions
 //--------------------------------------------------------------------------------------
@@ -384,6 +715,7 @@ unsigned int Mesh::ReadNodes(aiNode* assimpNode, unsigned int nodeIndex, unsigne
     unsigned int thisIndex = nodeIndex;
     ++nodeIndex;
 
+    node.name = assimpNode->mName.C_Str();
     node.defaultMatrix.SetValues(&assimpNode->mTransformation.a1);
     node.defaultMatrix.Transpose(); // Assimp stores matrices differently to this app
 
@@ -402,3 +734,200 @@ unsigned int Mesh::ReadNodes(aiNode* assimpNode, unsigned int nodeIndex, unsigne
 
     return nodeIndex;
 }
+
+
+// Calculate the bounding sphere of the whole mesh from the sub-mesh bounds and the default node matrices
+// The bounds are relative to the root node so models can position them with their own world matrix
+void Mesh::CalculateBounds()
+{
+    std::vector<CMatrix4x4> absoluteMatrices(mNodes.size());
+    bool first = true;
+    for (unsigned int nodeIndex = 0; nodeIndex < mNodes.size(); ++nodeIndex)
+    {
+        auto& node = mNodes[nodeIndex];
+        absoluteMatrices[nodeIndex] = (nodeIndex == 0) ? MatrixIdentity() : node.defaultMatrix * absoluteMatrices[node.parentIndex];
+
+        CVector3 scale = absoluteMatrices[nodeIndex].GetScale();
+        float maxScale = Max(scale.x, scale.y, scale.z);
+        for (auto subMeshIndex : node.subMeshes)
+        {
+            auto& subMesh = mSubMeshes[subMeshIndex];
+            CVector3 centre = TransformPoint(subMesh.boundingCentre, absoluteMatrices[nodeIndex]);
+            float radius = subMesh.boundingRadius * maxScale;
+
+            // Grow the mesh sphere to contain the sub-mesh sphere
+            if (first)
+            {
+                mBoundingCentre = centre;
+                mBoundingRadius = radius;
+                first = false;
+            }
+            else
+            {
+                CVector3 offset = centre - mBoundingCentre;
+                float distance = Length(offset);
+                if (distance + radius > mBoundingRadius)
+                {
+                    if (distance + mBoundingRadius <= radius)
+                    {
+                        mBoundingCentre = centre;
+                        mBoundingRadius = radius;
+                    }
+                    else
+                    {
+                        float newRadius = (distance + radius + mBoundingRadius) * 0.5f;
+                        mBoundingCentre += offset * ((newRadius - mBoundingRadius) / distance);
+                        mBoundingRadius = newRadius;
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+// Find a node by name, returns the number of nodes if not found
+unsigned int Mesh::FindNode(const std::string& name)
+{
+    for (unsigned int nodeIndex = 0; nodeIndex < mNodes.size(); ++nodeIndex)
+    {
+        if (mNodes[nodeIndex].name == name)  return nodeIndex;
+    }
+    return static_cast<unsigned int>(mNodes.size());
+}
+
+
+// Read the animation clips from the assimp scene, must be called after the nodes have been read
+// Tracks for nodes that aren't in the hierarchy are ignored
+void Mesh::ReadAnimations(const aiScene* scene)
+{
+    for (unsigned int a = 0; a < scene->mNumAnimations; ++a)
+    {
+        aiAnimation* assimpAnimation = scene->mAnimations[a];
+        AnimationClip clip;
+
+        // Assimp times are in "ticks", convert to seconds
+        float ticksPerSecond = assimpAnimation->mTicksPerSecond > 0 ? static_cast<float>(assimpAnimation->mTicksPerSecond) : 25.0f;
+        float secondsPerTick = 1.0f / ticksPerSecond;
+        clip.name = assimpAnimation->mName.C_Str();
+        clip.duration = static_cast<float>(assimpAnimation->mDuration) * secondsPerTick;
+
+        for (unsigned int c = 0; c < assimpAnimation->mNumChannels; ++c)
+        {
+            aiNodeAnim* channel = assimpAnimation->mChannels[c];
+            unsigned int node = FindNode(channel->mNodeName.C_Str());
+            if (node == mNodes.size())  continue;
+
+            AnimationTrack track;
+            track.node = node;
+            for (unsigned int k = 0; k < channel->mNumPositionKeys; ++k)
+            {
+                auto& key = channel->mPositionKeys[k];
+                track.positionKeys.push_back({ static_cast<float>(key.mTime) * secondsPerTick, { key.mValue.x, key.mValue.y, key.mValue.z } });
+            }
+            for (unsigned int k = 0; k < channel->mNumRotationKeys; ++k)
+            {
+                auto& key = channel->mRotationKeys[k];
+                track.rotationKeys.push_back({ static_cast<float>(key.mTime) * secondsPerTick, { key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z } });
+            }
+            for (unsigned int k = 0; k < channel->mNumScalingKeys; ++k)
+            {
+                auto& key = channel->mScalingKeys[k];
+                track.scaleKeys.push_back({ static_cast<float>(key.mTime) * secondsPerTick, { key.mValue.x, key.mValue.y, key.mValue.z } });
+            }
+            clip.tracks.push_back(std::move(track));
+        }
+        AddAnimation(clip);
+    }
+}
+
+
+// Compress an animation clip and add it to the mesh, returns the index of the new clip
+unsigned int Mesh::AddAnimation(const AnimationClip& clip, const AnimationCompressionSettings& settings /*= {}*/)
+{
+    mRawAnimationBytes += AnimationMemoryUsage(clip);
+    mAnimations.push_back(CompressAnimation(clip, settings, mNodeReach.data()));
+    return static_cast<unsigned int>(mAnimations.size()) - 1;
+}
+
+
+// Bytes used by the animation clips, before and after compression
+void Mesh::AnimationMemory(size_t& rawBytes, size_t& compressedBytes)
+{
+    rawBytes = mRawAnimationBytes;
+    compressedBytes = 0;
+    for (auto& clip : mAnimations)  compressedBytes += clip.MemoryUsage();
+}
+
+
+// Calculate how far the geometry beneath each node reaches from the node, in the node's space. A rotation error of
+// e radians at a node moves this geometry by up to e * reach. Uses the default pose. Skinned geometry isn't counted
+void Mesh::CalculateNodeReach()
+{
+    mNodeReach.assign(mNodes.size(), 0.0f);
+
+    // Children are stored after their parents, so work backwards to have each node's reach before its parent's
+    for (unsigned int nodeIndex = static_cast<unsigned int>(mNodes.size()); nodeIndex-- > 0; )
+    {
+        auto& node = mNodes[nodeIndex];
+        for (auto subMeshIndex : node.subMeshes)
+        {
+            auto& subMesh = mSubMeshes[subMeshIndex];
+            if (subMesh.bones.empty())
+            {
+                mNodeReach[nodeIndex] = std::max(mNodeReach[nodeIndex], Length(subMesh.boundingCentre) + subMesh.boundingRadius);
+            }
+        }
+
+        if (nodeIndex > 0)
+        {
+            CVector3 scale = node.defaultMatrix.GetScale();
+            float childReach = Length(node.defaultMatrix.GetPosition()) + mNodeReach[nodeIndex] * Max(scale.x, scale.y, scale.z);
+            mNodeReach[node.parentIndex] = std::max(mNodeReach[node.parentIndex], childReach);
+        }
+    }
+}
+
+
+// Helper function for Render function - builds the bone matrices for a skinned sub-mesh from the current node
+// matrices, then either sends them to the GPU or skins the vertices on the CPU. Returns the vertex buffer to draw
+// The node absolute matrices must be up to date
+ID3D11Buffer* Mesh::PrepareSkinning(unsigned int subMeshIndex)
+{
+    auto& subMesh = mSubMeshes[subMeshIndex];
+    auto skinningStart = std::chrono::high_resolution_clock::now();
+
+    // Bone matrix: from the sub-mesh's space into the bone's space in the bind pose, then out to the world using the bone's current matrix
+    CMatrix4x4 palette[MAX_BONES];
+    for (unsigned int b = 0; b < subMesh.bones.size(); ++b)
+    {
+        palette[b] = subMesh.bones[b].offsetMatrix * mNodes[subMesh.bones[b].node].absoluteMatrix;
+    }
+
+    ID3D11Buffer* vertexBuffer = subMesh.vertexBuffer;
+    if (gCPUSkinning)
+    {
+        // Skin into the dynamic vertex buffer. The vertices end up in world space so the GPU bone matrices are set to
+        // identity, the weights of each vertex sum to 1 so the skinning shader then leaves them unchanged
+        D3D11_MAPPED_SUBRESOURCE mappedBuffer;
+        if (SUCCEEDED(gD3DContext->Map(subMesh.skinnedVertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedBuffer)))
+        {
+            SkinVerticesParallel(subMesh.bindPoseVertices.data(), static_cast<unsigned char*>(mappedBuffer.pData),
+                                 subMesh.numVertices, subMesh.skinnedFormat, palette);
+            gD3DContext->Unmap(subMesh.skinnedVertexBuffer, 0);
+            vertexBuffer = subMesh.skinnedVertexBuffer;
+        }
+        for (auto& boneMatrix : gPerBoneConstants.boneMatrices)  boneMatrix = MatrixIdentity();
+    }
+    else
+    {
+        std::copy(palette, palette + subMesh.bones.size(), gPerBoneConstants.boneMatrices);
+    }
+
+    UpdateConstantBuffer(gPerBoneConstantBuffer, gPerBoneConstants);
+    gD3DContext->VSSetConstantBuffers(2, 1, &gPerBoneConstantBuffer);
+
+    gSkinnedVertices += subMesh.numVertices;
+    gSkinningTime += std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - skinningStart).count();
+    return vertexBuffer;
+}
@@ -6,6 +6,11 @@
 // expected to select these things
 
 #include "common.h"
+#include "Meshlet.h"
+#include "Animation.h"
+#include "CompressedAnimation.h"
+#include "Skinning.h"
+#include "DynamicBVH.h"
 
 #include <assimp/scene.h>
 
@@ -15,6 +20,9 @@
 #ifndef _MESH_H_INCLUDED_
 #define _MESH_H_INCLUDED_
 
+// Maximum number of levels of detail generated for each sub-mesh (including the full detail original)
+const unsigned int MAX_LODS = 4;
+
 class Mesh
 {
 //--------------------------------------------------------------------------------------
@@ -29,21 +37,73 @@ public:
     ~Mesh();
 
 
+    // The file the mesh was loaded from and whether tangents were requested, for reloading
+    const std::string& FileName()  { return mFileName; }
+    bool RequiresTangents()  { return mRequireTangents; }
+
+    // Take the geometry of another mesh loaded from a newer version of the same file, swapping it with the geometry
+    // here. The hierarchy must have the same nodes, as models using this mesh keep their node matrices, and the
+    // animation clips here are kept. Returns false and changes nothing if the nodes differ. The other mesh is left with
+    // the old geometry, which is released when it is deleted
+    bool ReplaceGeometry(Mesh& newMesh);
+
     // How many nodes are in this mesh (seperate movable parts)
     unsigned int NumberNodes()  { return static_cast<unsigned int>(mNodes.size()); }
 
     // The default matrix for a given node - used to set the initial position for a new model
     CMatrix4x4 GetNodeDefaultMatrix(unsigned int node) { return mNodes[node].defaultMatrix; }
 
+    // Number of levels of detail available, the most of any sub-mesh. Sub-meshes with fewer levels use their lowest one
+    unsigned int NumberLODs()  { return mNumLODs; }
+
+    // Bounding sphere around the whole mesh in its default pose, relative to the root node
+    CVector3 BoundingCentre()  { return mBoundingCentre; }
+    float    BoundingRadius()  { return mBoundingRadius; }
+
+    // Animation clips imported with the mesh or added later, stored compressed. Models sample these to pose their nodes
+    unsigned int NumberAnimations()  { return static_cast<unsigned int>(mAnimations.size()); }
+    const CompressedAnimationClip& GetAnimation(unsigned int clip)  { return mAnimations[clip]; }
+
+    // Compress an animation clip and add it to the mesh, returns the index of the new clip. The rotation tolerance
+    // of each track is tightened for nodes with more geometry beneath them
+    unsigned int AddAnimation(const AnimationClip& clip, const AnimationCompressionSettings& settings = {});
+
+    // Bytes used by the animation clips, before and after compression
+    void AnimationMemory(size_t& rawBytes, size_t& compressedBytes);
 
-    // Render a given node in the mesh. Recursive function.
+    // Find a node by name, returns the number of nodes if not found
+    unsigned int FindNode(const std::string& name);
+
+    // True if any sub-mesh is deformed by bones. Skinned meshes must be drawn with the skinning vertex shader
+    bool IsSkinned()  { return mIsSkinned; }
+
+
+    // Render a given node in the mesh. Recursive function. Always uses full detail geometry
     // - modelMatrices are sent from the Model - one matrix for each node in the mesh, representing it's current "pose". Matrices are relative to the parent node.
     // - nodeIndex is the index of the current node, for accessing the vectors of matrices and node information
     // - parentWorldMatrix is the world matrix that was calculated for the parent in a previous call, it's used to make relative matrices into absolute matrices
+    // Skinned sub-meshes need every node's matrix before they are drawn, so only Render below supports them
     void RenderRecursive(std::vector<CMatrix4x4>& modelMatrices, unsigned int nodeIndex = 0, CMatrix4x4 parentWorldMatrix = MatrixIdentity());
 
     // Render all the nodes in the mesh without recursion, faster alternative to above (lab exercise)
-    void Render(std::vector<CMatrix4x4>& modelMatrices);
+    // Pass the level of detail to use, 0 is full detail. Full detail geometry is culled in meshlets against the
+    // view-projection matrix and camera position in gPerFrameConstants. Set cullBackFaces if the mesh is drawn
+    // with back face culling, then meshlets facing away from the camera are skipped too
+    // Skinned sub-meshes are skinned on the GPU, or on the CPU if gCPUSkinning is set
+    void Render(std::vector<CMatrix4x4>& modelMatrices, unsigned int lod = 0, bool cullBackFaces = true);
+
+
+    // Cull the full detail meshlets of the whole mesh in its default pose, with the root node placed by the given world
+    // matrix, for a camera with the given view-projection matrix and position. Nothing is drawn, the results are added
+    // to stats. For measuring culling, Render culls the meshlets itself
+    void CullAllMeshlets(const CMatrix4x4& worldMatrix, const CMatrix4x4& viewProjectionMatrix, const CVector3& cameraPosition,
+                         bool cullBackFaces, MeshletCullStats& stats);
+
+
+    // Distance along a ray to the nearest triangle of the mesh posed by the given node matrices (as passed to Render),
+    // or maxDistance if the ray misses. The direction need not be normalised, distances are in multiples of its length.
+    // Tests the full detail geometry, skinned sub-meshes in their bind pose
+    float RayCast(const std::vector<CMatrix4x4>& modelMatrices, const CVector3& origin, const CVector3& direction, float maxDistance);
 
 
 //--------------------------------------------------------------------------------------
@@ -61,7 +121,20 @@ private:
     void SetWorldMatrixOnGPU(CMatrix4x4 worldMatrix);
 
     // Helper function for Render function - renders all the submeshes of the given node. World matrix must already be set
-    void RenderNodeSubMeshes(unsigned int nodeIndex);
+    void RenderNodeSubMeshes(unsigned int nodeIndex, unsigned int lod = 0, bool cullBackFaces = false);
+
+    // Calculate the bounding sphere of the whole mesh from the sub-mesh bounds and the default node matrices
+    void CalculateBounds();
+
+    // Read the animation clips from the assimp scene, must be called after the nodes have been read
+    void ReadAnimations(const aiScene* scene);
+
+    // Calculate how far the geometry beneath each node reaches from the node, used to set animation tolerances
+    void CalculateNodeReach();
+
+    // Helper function for Render function - builds the bone matrices for a skinned sub-mesh from the current node
+    // matrices, then either sends them to the GPU or skins the vertices on the CPU. Returns the vertex buffer to draw
+    ID3D11Buffer* PrepareSkinning(unsigned int subMeshIndex);
 
 
 
@@ -70,6 +143,14 @@ private:
 //--------------------------------------------------------------------------------------
 private:
 
+    // A bone is a node in the hierarchy that deforms a skinned sub-mesh. The offset matrix takes vertices from the
+    // sub-mesh's space into the bone's space in the bind pose (sometimes called the inverse bind matrix)
+    struct Bone
+    {
+        unsigned int node;
+        CMatrix4x4   offsetMatrix;
+    };
+
     // A mesh is made of multiple sub-meshes. Each one uses a single material (texture).
     // Each sub-mesh has a vertex / index buffer on the GPU. Could share buffers for performance but that would be complex.
     struct SubMesh
@@ -83,6 +164,32 @@ private:
 
         unsigned int       numIndices = 0;
         ID3D11Buffer*      indexBuffer  = nullptr;
+
+        // Levels of detail. All levels use the vertex buffer above, their indices are stored one after
+        // another in the index buffer. Level 0 is the full detail geometry
+        unsigned int       numLODs = 1;
+        unsigned int       lodIndexStart[MAX_LODS] = {};
+        unsigned int       lodIndexCount[MAX_LODS] = {};
+
+        // Bounding sphere of the vertices, in the space of the node that uses this sub-mesh
+        CVector3           boundingCentre = { 0, 0, 0 };
+        float              boundingRadius = 0;
+
+        // Level 0 is split into meshlets that are culled individually. The level 0 indices are ordered by meshlet
+        // Not used for skinned sub-meshes as their bounds change as they animate
+        std::vector<Meshlet> meshlets;
+
+        // Skinning data, bones is empty if the sub-mesh is not skinned. CPU skinning reads the bind pose copy of the
+        // vertices and writes the dynamic vertex buffer each frame
+        std::vector<Bone>          bones;
+        SkinnedVertexFormat        skinnedFormat;
+        std::vector<unsigned char> bindPoseVertices;
+        ID3D11Buffer*              skinnedVertexBuffer = nullptr;
+
+        // CPU copy of the full detail positions and triangles, with a tree of the triangles' bounds, for ray casts
+        std::vector<CVector3> positions;
+        std::vector<uint32_t> indices;
+        DynamicBVH            triangleBVH;
     };
 
 
@@ -93,6 +200,7 @@ private:
     // given these default matrices as a starting position.
     struct Node
     {
+        std::string               name;           // Used to match nodes to bones and animation tracks
         CMatrix4x4                defaultMatrix;  // Starting position/rotation/scale for this node. Relative to parent. Used when first creating a model from this mesh
 
         CMatrix4x4                absoluteMatrix; // Absolute matrix for this node for the model currently being rendered. Not persistent data, used in Render function only
@@ -108,8 +216,21 @@ private:
 //--------------------------------------------------------------------------------------
 private:
 
+    std::string mFileName;
+    bool        mRequireTangents;
+
     std::vector<SubMesh> mSubMeshes; // The mesh geometry. Nodes refer to sub-meshes in this vector
     std::vector<Node>    mNodes;     // The mesh hierarchy. First entry is root. remainder aree stored in depth-first order
+
+    unsigned int mNumLODs = 1;
+
+    std::vector<CompressedAnimationClip> mAnimations;
+    size_t                               mRawAnimationBytes = 0; // Size of the clips before compression
+    std::vector<float>                   mNodeReach;
+    bool mIsSkinned = false;
+
+    CVector3 mBoundingCentre = { 0, 0, 0 };
+    float    mBoundingRadius = 0;
 };
 
 
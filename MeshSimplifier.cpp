@@ -0,0 +1,307 @@
+//--------------------------------------------------------------------------------------
+// Mesh simplification for automatic level of detail (LOD) generation
+//--------------------------------------------------------------------------------------
+
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+#include <cstring>
+
+
+//--------------------------------------------------------------------------------------
+// Helper types
+//--------------------------------------------------------------------------------------
+namespace
+{
+    // Symmetric 4x4 matrix measuring the sum of squared distances from a point to a set of planes
+    // Only the upper triangle is stored (10 values)
+    struct Quadric
+    {
+        double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+        double          a11 = 0, a12 = 0, a13 = 0;
+        double                   a22 = 0, a23 = 0;
+        double                            a33 = 0;
+
+        // Add the plane with given unit normal and distance from origin (n.p + d = 0), scaled by a weight
+        void AddPlane(const CVector3& n, float d, float weight)
+        {
+            a00 += weight * n.x * n.x;  a01 += weight * n.x * n.y;  a02 += weight * n.x * n.z;  a03 += weight * n.x * d;
+                                        a11 += weight * n.y * n.y;  a12 += weight * n.y * n.z;  a13 += weight * n.y * d;
+                                                                    a22 += weight * n.z * n.z;  a23 += weight * n.z * d;
+                                                                                                a33 += weight * d * d;
+        }
+
+        Quadric& operator+=(const Quadric& q)
+        {
+            a00 += q.a00;  a01 += q.a01;  a02 += q.a02;  a03 += q.a03;
+                           a11 += q.a11;  a12 += q.a12;  a13 += q.a13;
+                                          a22 += q.a22;  a23 += q.a23;
+                                                         a33 += q.a33;
+            return *this;
+        }
+
+        // Sum of squared distances from the point to the planes in this quadric (v^T Q v)
+        double Error(const CVector3& p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double e = a00*x*x + 2*a01*x*y + 2*a02*x*z + 2*a03*x
+                               +   a11*y*y + 2*a12*y*z + 2*a13*y
+                                           +   a22*z*z + 2*a23*z
+                                                       +   a33;
+            return e < 0 ? 0 : e; // Rounding can make the result slightly negative
+        }
+    };
+
+
+    // A possible edge collapse, moving vertex "from" onto vertex "to"
+    // The version numbers detect when either vertex has changed since the collapse was costed
+    struct Collapse
+    {
+        double       cost;
+        uint32_t     from;
+        uint32_t     to;
+        unsigned int fromVersion;
+        unsigned int toVersion;
+
+        bool operator>(const Collapse& c) const { return cost > c.cost; }
+    };
+
+
+    // Key for an undirected edge, used to count the triangles using each edge
+    inline uint64_t EdgeKey(uint32_t a, uint32_t b)
+    {
+        if (a > b)  std::swap(a, b);
+        return (static_cast<uint64_t>(a) << 32) | b;
+    }
+
+
+    // Key for an exact vertex position, used to find vertices that have been split along seams
+    struct PositionHash
+    {
+        size_t operator()(const CVector3& p) const
+        {
+            uint32_t h[3];
+            std::memcpy(h, &p.x, sizeof(h));
+            return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+        }
+    };
+    struct PositionEqual
+    {
+        bool operator()(const CVector3& a, const CVector3& b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+    };
+}
+
+
+//--------------------------------------------------------------------------------------
+// Simplification
+//--------------------------------------------------------------------------------------
+
+// Simplify an indexed triangle list, returns the new index list
+std::vector<uint32_t> SimplifyMesh(const unsigned char* vertexData, unsigned int vertexStride, unsigned int numVertices,
+                                   const uint32_t* indices, unsigned int numIndices,
+                                   unsigned int targetIndexCount, float maxError, float* resultError /*= nullptr*/)
+{
+    if (resultError)  *resultError = 0;
+
+    std::vector<uint32_t> triangles(indices, indices + numIndices); // Updated in place as edges collapse
+    unsigned int numTriangles = numIndices / 3;
+    if (numIndices <= targetIndexCount || numTriangles == 0)  return triangles;
+
+
+    //-----------------------------------
+    // Gather positions and find the size of the mesh (errors are measured relative to it)
+
+    std::vector<CVector3> positions(numVertices);
+    CVector3 minBounds = { 1e30f, 1e30f, 1e30f };
+    CVector3 maxBounds = { -1e30f, -1e30f, -1e30f };
+    for (unsigned int v = 0; v < numVertices; ++v)
+    {
+        positions[v] = CVector3(reinterpret_cast<const float*>(vertexData + v * vertexStride));
+        minBounds = { std::min(minBounds.x, positions[v].x), std::min(minBounds.y, positions[v].y), std::min(minBounds.z, positions[v].z) };
+        maxBounds = { std::max(maxBounds.x, positions[v].x), std::max(maxBounds.y, positions[v].y), std::max(maxBounds.z, positions[v].z) };
+    }
+    float meshSize = Length(maxBounds - minBounds);
+    if (meshSize <= 0)  return triangles;
+    double maxCost = static_cast<double>(maxError * meshSize) * (maxError * meshSize);
+
+
+    //-----------------------------------
+    // Lock vertices that must not move: those on open borders and those split for seams (UVs, hard normals)
+
+    std::vector<bool> locked(numVertices, false);
+
+    std::unordered_map<uint64_t, unsigned int> edgeUseCount;
+    edgeUseCount.reserve(numIndices);
+    for (unsigned int t = 0; t < numTriangles; ++t)
+    {
+        const uint32_t* tri = &triangles[t * 3];
+        ++edgeUseCount[EdgeKey(tri[0], tri[1])];
+        ++edgeUseCount[EdgeKey(tri[1], tri[2])];
+        ++edgeUseCount[EdgeKey(tri[2], tri[0])];
+    }
+    for (auto& edge : edgeUseCount)
+    {
+        if (edge.second == 1)
+        {
+            locked[static_cast<uint32_t>(edge.first >> 32)] = true;
+            locked[static_cast<uint32_t>(edge.first)] = true;
+        }
+    }
+
+    std::unordered_map<CVector3, uint32_t, PositionHash, PositionEqual> firstAtPosition;
+    firstAtPosition.reserve(numVertices);
+    for (uint32_t v = 0; v < numVertices; ++v)
+    {
+        auto inserted = firstAtPosition.insert({ positions[v], v });
+        if (!inserted.second)
+        {
+            locked[v] = true;
+            locked[inserted.first->second] = true;
+        }
+    }
+
+
+    //-----------------------------------
+    // Build vertex->triangle adjacency and the error quadric for each vertex
+
+    std::vector<std::vector<uint32_t>> vertexTriangles(numVertices);
+    std::vector<Quadric> quadrics(numVertices);
+    for (uint32_t t = 0; t < numTriangles; ++t)
+    {
+        const uint32_t* tri = &triangles[t * 3];
+        const CVector3& p0 = positions[tri[0]];
+        CVector3 normal = Cross(positions[tri[1]] - p0, positions[tri[2]] - p0);
+        float area = Length(normal);
+        if (area > 0)
+        {
+            normal *= 1.0f / area;
+            float d = -Dot(normal, p0);
+            for (int i = 0; i < 3; ++i)  quadrics[tri[i]].AddPlane(normal, d, 1.0f);
+        }
+        for (int i = 0; i < 3; ++i)  vertexTriangles[tri[i]].push_back(t);
+    }
+
+
+    //-----------------------------------
+    // Fill a priority queue with every possible collapse, cheapest first
+
+    std::vector<unsigned int> versions(numVertices, 0);
+    std::vector<bool> vertexAlive(numVertices, true);
+    std::vector<bool> triangleAlive(numTriangles, true);
+
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> collapses;
+    auto AddCollapse = [&](uint32_t from, uint32_t to)
+    {
+        if (locked[from])  return;
+        Quadric q = quadrics[from];
+        q += quadrics[to];
+        collapses.push({ q.Error(positions[to]), from, to, versions[from], versions[to] });
+    };
+
+    for (unsigned int t = 0; t < numTriangles; ++t)
+    {
+        const uint32_t* tri = &triangles[t * 3];
+        for (int i = 0; i < 3; ++i)
+        {
+            AddCollapse(tri[i], tri[(i + 1) % 3]);
+            AddCollapse(tri[(i + 1) % 3], tri[i]);
+        }
+    }
+
+
+    //-----------------------------------
+    // Collapse edges until the target is reached or the error gets too large
+
+    unsigned int numAliveTriangles = numTriangles;
+    double lastCost = 0;
+    while (numAliveTriangles * 3 > targetIndexCount && !collapses.empty())
+    {
+        Collapse collapse = collapses.top();
+        collapses.pop();
+        if (collapse.cost > maxCost)  break;
+
+        uint32_t from = collapse.from;
+        uint32_t to = collapse.to;
+        if (!vertexAlive[from] || !vertexAlive[to] ||
+            collapse.fromVersion != versions[from] || collapse.toVersion != versions[to])
+        {
+            continue; // Out of date, a newer entry for these vertices will be in the queue if still valid
+        }
+
+        // Reject the collapse if it would flip any of the remaining triangles around the "from" vertex
+        bool flips = false;
+        for (uint32_t t : vertexTriangles[from])
+        {
+            if (!triangleAlive[t])  continue;
+            uint32_t* tri = &triangles[t * 3];
+            if (tri[0] == to || tri[1] == to || tri[2] == to)  continue; // Will be removed by the collapse
+
+            int corner = (tri[0] == from) ? 0 : (tri[1] == from) ? 1 : 2;
+            const CVector3& p1 = positions[tri[(corner + 1) % 3]];
+            const CVector3& p2 = positions[tri[(corner + 2) % 3]];
+            CVector3 oldNormal = Cross(p1 - positions[from], p2 - positions[from]);
+            CVector3 newNormal = Cross(p1 - positions[to],   p2 - positions[to]);
+            if (Dot(oldNormal, newNormal) <= 0.1f * Length(oldNormal) * Length(newNormal))
+            {
+                flips = true;
+                break;
+            }
+        }
+        if (flips)  continue;
+
+        // Perform the collapse: triangles using the edge disappear, the others are moved over to the "to" vertex
+        for (uint32_t t : vertexTriangles[from])
+        {
+            if (!triangleAlive[t])  continue;
+            uint32_t* tri = &triangles[t * 3];
+            if (tri[0] == to || tri[1] == to || tri[2] == to)
+            {
+                triangleAlive[t] = false;
+                --numAliveTriangles;
+            }
+            else
+            {
+                for (int i = 0; i < 3; ++i)  if (tri[i] == from)  tri[i] = to;
+                vertexTriangles[to].push_back(t);
+            }
+        }
+        vertexTriangles[from].clear();
+        vertexAlive[from] = false;
+        quadrics[to] += quadrics[from];
+        ++versions[to];
+        lastCost = collapse.cost;
+
+        // Drop dead triangles from the "to" vertex and re-cost all the edges around it
+        auto& toTriangles = vertexTriangles[to];
+        toTriangles.erase(std::remove_if(toTriangles.begin(), toTriangles.end(), [&](uint32_t t) { return !triangleAlive[t]; }),
+                          toTriangles.end());
+        for (uint32_t t : toTriangles)
+        {
+            const uint32_t* tri = &triangles[t * 3];
+            for (int i = 0; i < 3; ++i)
+            {
+                if (tri[i] != to)
+                {
+                    AddCollapse(tri[i], to);
+                    AddCollapse(to, tri[i]);
+                }
+            }
+        }
+    }
+
+
+    //-----------------------------------
+    // Gather the remaining triangles
+
+    std::vector<uint32_t> result;
+    result.reserve(numAliveTriangles * 3);
+    for (unsigned int t = 0; t < numTriangles; ++t)
+    {
+        if (triangleAlive[t])  result.insert(result.end(), &triangles[t * 3], &triangles[t * 3] + 3);
+    }
+
+    if (resultError)  *resultError = static_cast<float>(std::sqrt(lastCost)) / meshSize;
+    return result;
+}
@@ -0,0 +1,31 @@
+//--------------------------------------------------------------------------------------
+// Mesh simplification for automatic level of detail (LOD) generation
+//--------------------------------------------------------------------------------------
+// Uses quadric error metrics (Garland & Heckbert) to repeatedly collapse the edge that
+// changes the surface the least. Edges are only ever collapsed onto one of their existing
+// vertices, so the simplified index lists can share the original vertex buffer.
+// No DirectX in here so it can be used (and tested) without a device.
+
+#ifndef _MESH_SIMPLIFIER_H_INCLUDED_
+#define _MESH_SIMPLIFIER_H_INCLUDED_
+
+#include "CVector3.h"
+
+#include <vector>
+#include <cstdint>
+
+
+// Simplify an indexed triangle list, returns the new index list
+// - vertexData / vertexStride / numVertices describe the vertex positions, which must be the first 3 floats of each vertex
+// - indices / numIndices is the triangle list to simplify
+// - targetIndexCount is the number of indices to aim for, simplification stops when it is reached
+// - maxError is the largest allowed surface deviation as a fraction of the mesh size, simplification stops early if
+//   no edge can be collapsed without exceeding it
+// - If resultError is not null it receives the error of the last collapse performed (same units as maxError)
+// Border edges and vertices that have been split for UV / normal seams are never moved so the mesh does not tear
+std::vector<uint32_t> SimplifyMesh(const unsigned char* vertexData, unsigned int vertexStride, unsigned int numVertices,
+                                   const uint32_t* indices, unsigned int numIndices,
+                                   unsigned int targetIndexCount, float maxError, float* resultError = nullptr);
+
+
+#endif //_MESH_SIMPLIFIER_H_INCLUDED_
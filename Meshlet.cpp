@@ -0,0 +1,215 @@
+//--------------------------------------------------------------------------------------
+// Meshlets - small clusters of triangles that can be culled individually on the CPU
+//--------------------------------------------------------------------------------------
+
+#include "Meshlet.h"
+
+#include <algorithm>
+
+
+//--------------------------------------------------------------------------------------
+// Meshlet building
+//--------------------------------------------------------------------------------------
+
+// Split a triangle list into meshlets. The indices are reordered in place so each meshlet's triangles are
+// contiguous, and the meshlets are returned in index buffer order.
+// Meshlets are grown from a seed triangle, each step adding the neighbouring triangle that brings in the fewest
+// new vertices and whose normal is closest to the meshlet's average normal. That keeps meshlets compact (tight
+// bounding spheres) and flat (narrow normal cones, so they can be back face culled more often)
+std::vector<Meshlet> BuildMeshlets(const unsigned char* vertexData, unsigned int vertexStride, unsigned int numVertices,
+                                   uint32_t* indices, unsigned int numIndices, unsigned int indexOffset /*= 0*/)
+{
+    std::vector<Meshlet> meshlets;
+    unsigned int numTriangles = numIndices / 3;
+    if (numTriangles == 0)  return meshlets;
+
+    auto Position = [&](uint32_t v) { return CVector3(reinterpret_cast<const float*>(vertexData + v * vertexStride)); };
+
+    // Unit normal of each triangle (zero for degenerate triangles)
+    std::vector<CVector3> normals(numTriangles);
+    for (unsigned int t = 0; t < numTriangles; ++t)
+    {
+        CVector3 p0 = Position(indices[t * 3]);
+        CVector3 normal = Cross(Position(indices[t * 3 + 1]) - p0, Position(indices[t * 3 + 2]) - p0);
+        float length = Length(normal);
+        normals[t] = (length > 0) ? normal * (1.0f / length) : CVector3{ 0, 0, 0 };
+    }
+
+    // Vertex->triangle adjacency, stored as one array with a start offset for each vertex
+    std::vector<unsigned int> adjacencyStart(numVertices + 1, 0);
+    for (unsigned int i = 0; i < numIndices; ++i)  ++adjacencyStart[indices[i] + 1];
+    for (unsigned int v = 0; v < numVertices; ++v)  adjacencyStart[v + 1] += adjacencyStart[v];
+    std::vector<unsigned int> adjacency(numIndices);
+    std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (unsigned int i = 0; i < numIndices; ++i)  adjacency[fill[indices[i]]++] = i / 3;
+
+
+    std::vector<uint32_t> reordered;
+    reordered.reserve(numIndices);
+    std::vector<bool> triangleUsed(numTriangles, false);
+    std::vector<unsigned int> vertexMeshlet(numVertices, ~0u); // Which meshlet last included each vertex
+
+    std::vector<unsigned int> meshletTriangles;
+    std::vector<uint32_t>     meshletVertices;
+    std::vector<unsigned int> candidates;
+
+    unsigned int seed = 0;
+    while (true)
+    {
+        // Next unused triangle in index order as a seed. The index order is already cache optimised, so nearby
+        // triangles tend to be spatially close
+        while (seed < numTriangles && triangleUsed[seed])  ++seed;
+        if (seed == numTriangles)  break;
+
+        unsigned int meshletIndex = static_cast<unsigned int>(meshlets.size());
+        meshletTriangles.clear();
+        meshletVertices.clear();
+        candidates.clear();
+        CVector3 normalSum = { 0, 0, 0 };
+
+        unsigned int triangle = seed;
+        while (true)
+        {
+            // Add triangle to the meshlet, and its neighbours to the candidates
+            triangleUsed[triangle] = true;
+            meshletTriangles.push_back(triangle);
+            normalSum += normals[triangle];
+            for (int i = 0; i < 3; ++i)
+            {
+                uint32_t v = indices[triangle * 3 + i];
+                if (vertexMeshlet[v] != meshletIndex)
+                {
+                    vertexMeshlet[v] = meshletIndex;
+                    meshletVertices.push_back(v);
+                    for (unsigned int a = adjacencyStart[v]; a < adjacencyStart[v + 1]; ++a)
+                    {
+                        if (!triangleUsed[adjacency[a]])  candidates.push_back(adjacency[a]);
+                    }
+                }
+            }
+            if (meshletTriangles.size() >= MESHLET_MAX_TRIANGLES)  break;
+
+            // Choose the best candidate to add next
+            float normalLength = Length(normalSum);
+            CVector3 averageNormal = (normalLength > 0) ? normalSum * (1.0f / normalLength) : CVector3{ 0, 0, 0 };
+            float bestScore = 1e30f;
+            unsigned int best = ~0u;
+            unsigned int kept = 0;
+            for (unsigned int c = 0; c < candidates.size(); ++c)
+            {
+                unsigned int t = candidates[c];
+                if (triangleUsed[t])  continue;
+                candidates[kept++] = t; // Compact the list as we go, removing used triangles
+
+                unsigned int newVertices = 0;
+                for (int i = 0; i < 3; ++i)  if (vertexMeshlet[indices[t * 3 + i]] != meshletIndex)  ++newVertices;
+                if (meshletVertices.size() + newVertices > MESHLET_MAX_VERTICES)  continue;
+
+                float score = newVertices + 2.0f * (1.0f - Dot(normals[t], averageNormal));
+                if (score < bestScore)
+                {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+            candidates.resize(kept);
+            if (best == ~0u)  break; // Meshlet is full of vertices, or there are no connected triangles left
+
+            triangle = best;
+        }
+
+
+        //-----------------------------------
+        // Write the meshlet's triangles and calculate its bounds
+
+        Meshlet meshlet;
+        meshlet.indexStart = indexOffset + static_cast<unsigned int>(reordered.size());
+        meshlet.indexCount = static_cast<unsigned int>(meshletTriangles.size() * 3);
+        for (auto t : meshletTriangles)  reordered.insert(reordered.end(), &indices[t * 3], &indices[t * 3] + 3);
+
+        // Bounding sphere centred on the bounding box
+        CVector3 minBounds = Position(meshletVertices[0]);
+        CVector3 maxBounds = minBounds;
+        for (auto v : meshletVertices)
+        {
+            CVector3 p = Position(v);
+            minBounds = { std::min(minBounds.x, p.x), std::min(minBounds.y, p.y), std::min(minBounds.z, p.z) };
+            maxBounds = { std::max(maxBounds.x, p.x), std::max(maxBounds.y, p.y), std::max(maxBounds.z, p.z) };
+        }
+        meshlet.centre = (minBounds + maxBounds) * 0.5f;
+        meshlet.radius = 0;
+        for (auto v : meshletVertices)  meshlet.radius = std::max(meshlet.radius, Length(Position(v) - meshlet.centre));
+
+        // Normal cone. If any normal is more than 90 degrees from the axis there is no viewpoint from which every
+        // triangle faces away, so mark the cone as never cullable
+        float normalLength = Length(normalSum);
+        meshlet.coneAxis = (normalLength > 0) ? normalSum * (1.0f / normalLength) : CVector3{ 0, 0, 1 };
+        float minDot = 1.0f;
+        for (auto t : meshletTriangles)  minDot = std::min(minDot, Dot(normals[t], meshlet.coneAxis));
+        meshlet.coneCutoff = (normalLength > 0 && minDot > 0) ? std::sqrt(1.0f - minDot * minDot) : 2.0f;
+
+        meshlets.push_back(meshlet);
+    }
+
+    std::copy(reordered.begin(), reordered.end(), indices);
+    return meshlets;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Meshlet culling
+//--------------------------------------------------------------------------------------
+
+// Cull meshlets against a frustum and camera position given in the same space as the meshlets
+// Ranges of indices to draw are appended to visibleRanges, with adjacent meshlets merged
+void CullMeshlets(const Meshlet* meshlets, unsigned int numMeshlets, const CFrustum& frustum, const CVector3& cameraPosition,
+                  bool cullBackFaces, std::vector<IndexRange>& visibleRanges, MeshletCullStats* stats /*= nullptr*/)
+{
+    size_t firstRange = visibleRanges.size();
+    unsigned int numCulled = 0;
+    unsigned int trianglesCulled = 0;
+    unsigned int trianglesTested = 0;
+
+    for (unsigned int m = 0; m < numMeshlets; ++m)
+    {
+        const Meshlet& meshlet = meshlets[m];
+        trianglesTested += meshlet.indexCount / 3;
+
+        bool visible = frustum.IsSphereVisible(meshlet.centre, meshlet.radius);
+
+        // Back facing test: every triangle faces away if the direction to the meshlet is inside the normal cone
+        // (widened by the bounding sphere so it holds for all points in the meshlet)
+        if (visible && cullBackFaces && meshlet.coneCutoff < 1.0f)
+        {
+            CVector3 toMeshlet = meshlet.centre - cameraPosition;
+            if (Dot(toMeshlet, meshlet.coneAxis) >= meshlet.coneCutoff * Length(toMeshlet) + meshlet.radius)
+            {
+                visible = false;
+            }
+        }
+
+        if (!visible)
+        {
+            ++numCulled;
+            trianglesCulled += meshlet.indexCount / 3;
+        }
+        else if (visibleRanges.size() > firstRange &&
+                 visibleRanges.back().start + visibleRanges.back().count == meshlet.indexStart)
+        {
+            visibleRanges.back().count += meshlet.indexCount;
+        }
+        else
+        {
+            visibleRanges.push_back({ meshlet.indexStart, meshlet.indexCount });
+        }
+    }
+
+    if (stats)
+    {
+        stats->meshletsTested  += numMeshlets;
+        stats->meshletsCulled  += numCulled;
+        stats->trianglesTested += trianglesTested;
+        stats->trianglesCulled += trianglesCulled;
+        stats->rangesSubmitted += static_cast<unsigned int>(visibleRanges.size() - firstRange);
+    }
+}
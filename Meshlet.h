@@ -0,0 +1,72 @@
+//--------------------------------------------------------------------------------------
+// Meshlets - small clusters of triangles that can be culled individually on the CPU
+//--------------------------------------------------------------------------------------
+// A sub-mesh is split into meshlets of up to MESHLET_MAX_TRIANGLES connected triangles.
+// Each meshlet has a bounding sphere for frustum culling and a cone containing all its
+// triangle normals, which allows whole clusters facing away from the camera to be skipped.
+// No DirectX in here so meshlets can be built and culled (and tested) without a device.
+
+#ifndef _MESHLET_H_INCLUDED_
+#define _MESHLET_H_INCLUDED_
+
+#include "CVector3.h"
+#include "CFrustum.h"
+
+#include <vector>
+#include <cstdint>
+
+
+// Size limits for a meshlet. Meshlets are grown to the maximum triangle count where the mesh is connected
+const unsigned int MESHLET_MAX_TRIANGLES = 128;
+const unsigned int MESHLET_MAX_VERTICES  = 96;
+
+
+struct Meshlet
+{
+    unsigned int indexStart; // Range of the index buffer holding this meshlet's triangles
+    unsigned int indexCount;
+
+    CVector3 centre;         // Bounding sphere
+    float    radius;
+
+    CVector3 coneAxis;       // Average direction of the triangle normals
+    float    coneCutoff;     // Sine of the cone half-angle, 1 or more if the cone is too wide to ever cull
+};
+
+
+// A range of indices to draw, produced by culling. Adjacent surviving meshlets are merged into a single range
+struct IndexRange
+{
+    unsigned int start;
+    unsigned int count;
+};
+
+
+// Counters for measuring the effectiveness of meshlet culling
+struct MeshletCullStats
+{
+    unsigned int meshletsTested    = 0;
+    unsigned int meshletsCulled    = 0;
+    unsigned int trianglesTested   = 0;
+    unsigned int trianglesCulled   = 0;
+    unsigned int rangesSubmitted   = 0;
+};
+
+
+// Split a triangle list into meshlets. The indices are reordered in place so each meshlet's triangles are
+// contiguous, and the meshlets are returned in index buffer order. indexOffset is added to each meshlet's
+// indexStart, for when the indices will sit part way into an index buffer.
+// - vertexData / vertexStride / numVertices describe the vertex positions, which must be the first 3 floats of each vertex
+std::vector<Meshlet> BuildMeshlets(const unsigned char* vertexData, unsigned int vertexStride, unsigned int numVertices,
+                                   uint32_t* indices, unsigned int numIndices, unsigned int indexOffset = 0);
+
+
+// Cull meshlets against a frustum and camera position given in the same space as the meshlets (e.g. pass a frustum
+// built from world * view-projection and the camera position transformed into model space). Set cullBackFaces if the
+// triangles will be drawn with back face culling, then meshlets that are entirely back facing are also removed.
+// Ranges of indices to draw are appended to visibleRanges, with adjacent meshlets merged. Stats are optional.
+void CullMeshlets(const Meshlet* meshlets, unsigned int numMeshlets, const CFrustum& frustum, const CVector3& cameraPosition,
+                  bool cullBackFaces, std::vector<IndexRange>& visibleRanges, MeshletCullStats* stats = nullptr);
+
+
+#endif //_MESHLET_H_INCLUDED_
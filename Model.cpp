@@ -9,6 +9,20 @@
 #include "Common.h"
 #include "GraphicsHelpers.h"
 #include "Mesh.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+// Level of detail selection. A model drops to level N+1 when the radius of its bounding sphere covers less than
+// LOD_SCREEN_SIZE[N] of the half-width of the screen. Hysteresis stops models flickering between two levels
+// when they sit near one of these sizes: a model must move this fraction past the size before the level changes
+const float LOD_SCREEN_SIZE[MAX_LODS - 1] = { 0.25f, 0.12f, 0.05f };
+const float LOD_HYSTERESIS = 0.15f;
+
+// Models per batch when updating animations over several threads
+const unsigned int ANIMATION_BATCH_SIZE = 32;
 
 
 Model::Model(Mesh* mesh, CVector3 position /*= { 0,0,0 }*/, CVector3 rotation /*= { 0,0,0 }*/, float scale /*= 1*/)
@@ -18,15 +32,188 @@ Model::Model(Mesh* mesh, CVector3 position /*= { 0,0,0 }*/, CVector3 rotation /*
     mWorldMatrices.resize(mesh->NumberNodes());
     for (int i = 0; i < mWorldMatrices.size(); ++i)
         mWorldMatrices[i] = mesh->GetNodeDefaultMatrix(i);
+
+    if (mesh->NumberAnimations() > 0)  PlayAnimation(0, 0);
 }
 
 
 
 // The render function simply passes this model's matrices over to Mesh:Render.
 // All other per-frame constants must have been set already along with shaders, textures, samplers, states etc.
-void Model::Render()
+// Set cullBackFaces if the current rasterizer state culls back faces, so meshlets facing away can be skipped
+void Model::Render(bool cullBackFaces /*= true*/)
+{
+    UpdateMatrices();
+    mMesh->Render(mWorldMatrices, mLOD, cullBackFaces);
+}
+
+
+// Choose the level of detail to render from the model's projected size on screen. Pass the position and
+// field of view (FOVx, radians) of the camera that will render the model. Call before Render each frame
+void Model::SelectLOD(CVector3 cameraPosition, float cameraFOV)
 {
-    mMesh->Render(mWorldMatrices);
+    unsigned int numLODs = mMesh->NumberLODs();
+    if (numLODs <= 1)
+    {
+        mLOD = 0;
+        return;
+    }
+
+    CVector3 centre;
+    float radius;
+    BoundingSphere(centre, radius);
+    float distance = Length(centre - cameraPosition);
+
+    // Fraction of the half-width of the screen covered by the sphere
+    float screenSize = (distance > radius) ? radius / (distance * std::tan(cameraFOV * 0.5f)) : 1.0f;
+
+    // Step to coarser levels while the model is clearly smaller than the current level's limit, or to
+    // finer levels while it is clearly larger than the previous level's limit
+    unsigned int lod = std::min(mLOD, numLODs - 1);
+    while (lod < numLODs - 1 && screenSize < LOD_SCREEN_SIZE[lod] * (1.0f - LOD_HYSTERESIS))  ++lod;
+    while (lod > 0 && screenSize > LOD_SCREEN_SIZE[lod - 1] * (1.0f + LOD_HYSTERESIS))  --lod;
+    mLOD = lod;
+}
+
+
+// Bounding sphere around the model in world space, for the mesh's default pose
+void Model::BoundingSphere(CVector3& centre, float& radius)
+{
+    // Root node matrix is the model's world matrix
+    UpdateMatrix(0);
+    auto& matrix = mWorldMatrices[0];
+    CVector3 scale = matrix.GetScale();
+    radius = mMesh->BoundingRadius() * Max(scale.x, scale.y, scale.z);
+    centre = TransformPoint(mMesh->BoundingCentre(), matrix);
+}
+
+
+// Distance along a ray to the nearest triangle of the model in its current pose, or maxDistance if the ray misses
+float Model::RayCast(const CVector3& origin, const CVector3& direction, float maxDistance)
+{
+    UpdateMatrices();
+    return mMesh->RayCast(mWorldMatrices, origin, direction, maxDistance);
+}
+
+
+// Start playing one of the mesh's animation clips, cross-fading from the current clip over the given time (seconds)
+void Model::PlayAnimation(unsigned int clip, float blendTime /*= 0.25f*/, bool loop /*= true*/)
+{
+    if (clip >= mMesh->NumberAnimations())  return;
+
+    // Nodes without tracks in a clip keep their default transform from the mesh
+    if (mDefaultPose.empty())
+    {
+        mDefaultPose.resize(mWorldMatrices.size());
+        for (unsigned int i = 0; i < mWorldMatrices.size(); ++i)
+            mDefaultPose[i] = TransformFromMatrix(mMesh->GetNodeDefaultMatrix(i));
+    }
+
+    if (mClip != NO_CLIP && blendTime > 0)
+    {
+        mPreviousClip = mClip;
+        mPreviousClipTime = mClipTime;
+        mPreviousLoop = mLoop;
+    }
+    else
+    {
+        mPreviousClip = NO_CLIP;
+    }
+    mClip = clip;
+    mClipTime = 0;
+    mLoop = loop;
+    mBlendTime = blendTime;
+    mBlendElapsed = 0;
+}
+
+
+// Advance the animation and pose the model's nodes from it. Does nothing if no clip is playing
+void Model::UpdateAnimation(float frameTime)
+{
+    if (mClip == NO_CLIP)  return;
+
+    frameTime *= mAnimationSpeed;
+    mClipTime += frameTime;
+    mPose = mDefaultPose;
+    SampleAnimation(mMesh->GetAnimation(mClip), mClipTime, mLoop, mPose.data());
+
+    // Cross-fade from the previous clip
+    if (mPreviousClip != NO_CLIP)
+    {
+        mPreviousClipTime += frameTime;
+        mBlendElapsed += std::abs(frameTime);
+        if (mBlendElapsed >= mBlendTime)
+        {
+            mPreviousClip = NO_CLIP;
+        }
+        else
+        {
+            mBlendPose = mDefaultPose;
+            SampleAnimation(mMesh->GetAnimation(mPreviousClip), mPreviousClipTime, mPreviousLoop, mBlendPose.data());
+            BlendPoses(mBlendPose.data(), mPose.data(), mBlendElapsed / mBlendTime, static_cast<unsigned int>(mPose.size()), mPose.data());
+        }
+    }
+
+    // Models keeping transforms take the pose directly, their matrices are built when next rendered
+    if (!mTransforms.empty())
+    {
+        for (unsigned int node = 1; node < mWorldMatrices.size(); ++node)
+        {
+            mTransforms[node] = mPose[node];
+            MarkDirty(node);
+        }
+        return;
+    }
+    for (unsigned int node = 1; node < mWorldMatrices.size(); ++node)
+    {
+        mWorldMatrices[node] = MatrixFromTransform(mPose[node]);
+    }
+}
+
+
+// Update the animation of many models, split into batches over the worker threads. The models must be distinct
+void Model::UpdateAnimations(Model* const* models, unsigned int numModels, float frameTime)
+{
+    ParallelFor(numModels, ANIMATION_BATCH_SIZE, [&](unsigned int start, unsigned int end)
+    {
+        for (unsigned int m = start; m < end; ++m)  models[m]->UpdateAnimation(frameTime);
+    });
+}
+
+
+// Keep a position, rotation (quaternion) and scale for each node alongside its matrix, see header
+void Model::UseTransforms(bool use)
+{
+    if (use == UsesTransforms())  return;
+    if (use)
+    {
+        mTransforms.resize(mWorldMatrices.size());
+        for (unsigned int node = 0; node < mWorldMatrices.size(); ++node)
+            mTransforms[node] = TransformFromMatrix(mWorldMatrices[node]);
+        mDirty.assign(mWorldMatrices.size(), false);
+    }
+    else
+    {
+        UpdateMatrices();
+        mTransforms.clear();
+        mDirty.clear();
+    }
+}
+
+
+// Rebuild the matrices of nodes whose transforms have changed
+void Model::UpdateMatrices()
+{
+    if (!mAnyDirty)  return;
+    for (unsigned int node = 0; node < mWorldMatrices.size(); ++node)
+    {
+        if (mDirty[node])
+        {
+            mWorldMatrices[node] = MatrixFromTransform(mTransforms[node]);
+            mDirty[node] = false;
+        }
+    }
+    mAnyDirty = false;
 }
 
 
@@ -34,6 +221,12 @@ void Model::Render()
 void Model::Control(int node, float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode turnLeft, KeyCode turnRight,
                                                KeyCode turnCW, KeyCode turnCCW, KeyCode moveForward, KeyCode moveBackward)
 {
+    if (!mTransforms.empty())
+    {
+        ControlTransform(node, frameTime, turnUp, turnDown, turnLeft, turnRight, turnCW, turnCCW, moveForward, moveBackward);
+        return;
+    }
+
     auto& matrix = mWorldMatrices[node]; // Use reference to node matrix to make code below more readable
 
 	if (KeyHeld( turnUp ))
@@ -73,3 +266,32 @@ void Model::Control(int node, float frameTime, KeyCode turnUp, KeyCode turnDown,
 		matrix.SetRow(3, matrix.GetRow(3) - localZDir * MOVEMENT_SPEED * frameTime);
 	}
 }
+
+
+// Version of Control for models keeping transforms. Rotations are applied in the node's local space (before the
+// existing rotation) as the matrix version does, which gives the same result for uniformly scaled nodes
+void Model::ControlTransform(int node, float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode turnLeft, KeyCode turnRight,
+                                                        KeyCode turnCW, KeyCode turnCCW, KeyCode moveForward, KeyCode moveBackward)
+{
+    auto& transform = mTransforms[node];
+    float angle = ROTATION_SPEED * frameTime;
+    bool changed = false;
+
+    if (KeyHeld( turnUp    ))  { transform.rotation = QuaternionRotationX( angle) * transform.rotation;  changed = true; }
+    if (KeyHeld( turnDown  ))  { transform.rotation = QuaternionRotationX(-angle) * transform.rotation;  changed = true; }
+    if (KeyHeld( turnRight ))  { transform.rotation = QuaternionRotationY( angle) * transform.rotation;  changed = true; }
+    if (KeyHeld( turnLeft  ))  { transform.rotation = QuaternionRotationY(-angle) * transform.rotation;  changed = true; }
+    if (KeyHeld( turnCW    ))  { transform.rotation = QuaternionRotationZ( angle) * transform.rotation;  changed = true; }
+    if (KeyHeld( turnCCW   ))  { transform.rotation = QuaternionRotationZ(-angle) * transform.rotation;  changed = true; }
+
+    // Local Z movement - the local Z axis is the Z axis rotated by the node's rotation
+    CVector3 localZDir = Rotate({ 0, 0, 1 }, transform.rotation);
+    if (KeyHeld( moveForward  ))  { transform.position = transform.position + localZDir * MOVEMENT_SPEED * frameTime;  changed = true; }
+    if (KeyHeld( moveBackward ))  { transform.position = transform.position - localZDir * MOVEMENT_SPEED * frameTime;  changed = true; }
+
+    if (changed)
+    {
+        transform.rotation = Normalise(transform.rotation); // Stop rounding errors building up
+        MarkDirty(node);
+    }
+}
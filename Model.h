@@ -8,6 +8,8 @@
 #include "CVector3.h"
 #include "CMatrix4x4.h"
 #include "Input.h"
+#include "Animation.h"
+#include "CQuaternion.h"
 
 #include <vector>
 
@@ -28,7 +30,39 @@ public:
 
     // The render function simply passes this model's matrices over to Mesh:Render.
     // All other per-frame constants must have been set already along with shaders, textures, samplers, states etc.
-    void Render();
+    // Set cullBackFaces if the current rasterizer state culls back faces, so meshlets facing away can be skipped
+    void Render(bool cullBackFaces = true);
+
+
+    // Choose the level of detail to render from the model's projected size on screen. Pass the position and
+    // field of view (FOVx, radians) of the camera that will render the model. Call before Render each frame
+    void SelectLOD(CVector3 cameraPosition, float cameraFOV);
+
+    // The level of detail chosen by the last call to SelectLOD (0 is full detail)
+    unsigned int LOD()  { return mLOD; }
+
+    // Bounding sphere around the model in world space, for the mesh's default pose
+    void BoundingSphere(CVector3& centre, float& radius);
+
+    // Distance along a ray to the nearest triangle of the model in its current pose, or maxDistance if the ray misses.
+    // The direction need not be normalised, distances are in multiples of its length
+    float RayCast(const CVector3& origin, const CVector3& direction, float maxDistance);
+
+
+    // Start playing one of the mesh's animation clips, cross-fading from the current clip over the given time (seconds)
+    // Models start playing their mesh's first clip if it has any
+    void PlayAnimation(unsigned int clip, float blendTime = 0.25f, bool loop = true);
+
+    // Advance the animation and pose the model's nodes from it. Does nothing if no clip is playing
+    // The root node is left alone since its matrix is the model's world matrix
+    void UpdateAnimation(float frameTime);
+
+    // Update the animation of many models, split into batches over the worker threads. The models must be distinct
+    static void UpdateAnimations(Model* const* models, unsigned int numModels, float frameTime);
+
+    // Playback speed of the animation, 1 is normal speed, negative plays backwards
+    void  SetAnimationSpeed(float speed)  { mAnimationSpeed = speed; }
+    float AnimationSpeed()  { return mAnimationSpeed; }
 
 
 	// Control a given node in the model using keys provided. Amount of motion performed depends on frame time
@@ -45,35 +79,84 @@ public:
     // The hierarchy is stored in depth-first order
 
 	// Getters - model only stores matrices. Position, rotation and scale are extracted if requested.
-	CVector3 Position(int node = 0)  { return mWorldMatrices[node].GetRow(3); }         // Position is on bottom row of matrix
-	CVector3 Rotation(int node = 0)  { return mWorldMatrices[node].GetEulerAngles(); }  // Getting angles from a matrix is complex - see .cpp file
-	CVector3 Scale(int node = 0)     { return { Length(mWorldMatrices[node].GetRow(0)),
-                                                Length(mWorldMatrices[node].GetRow(1)), 
-                                                Length(mWorldMatrices[node].GetRow(2)) }; } // Scale is length of rows 0-2 in matrix
-	CMatrix4x4 WorldMatrix(int node = 0)  { return mWorldMatrices[node]; }
+    // If the model keeps transforms (see UseTransforms below) they are read from those instead
+	CVector3 Position(int node = 0)  { return mTransforms.empty() ? mWorldMatrices[node].GetRow(3) : mTransforms[node].position; } // Position is on bottom row of matrix
+	CVector3 Rotation(int node = 0)  { return mTransforms.empty() ? mWorldMatrices[node].GetEulerAngles() : EulerAnglesFromQuaternion(mTransforms[node].rotation); } // Getting angles from a matrix is complex - see .cpp file
+	CVector3 Scale(int node = 0)
+    {
+        if (!mTransforms.empty())  return mTransforms[node].scale;
+        return { Length(mWorldMatrices[node].GetRow(0)),
+                 Length(mWorldMatrices[node].GetRow(1)), 
+                 Length(mWorldMatrices[node].GetRow(2)) }; // Scale is length of rows 0-2 in matrix
+    }
+	CMatrix4x4 WorldMatrix(int node = 0)  { UpdateMatrix(node);  return mWorldMatrices[node]; }
+
+    // Rotation as a quaternion
+    CQuaternion RotationQuaternion(int node = 0)  { return mTransforms.empty() ? TransformFromMatrix(mWorldMatrices[node]).rotation : mTransforms[node].rotation; }
 
     // Setters - model only stores matricies , so if user sets position, rotation or scale, just update those aspects of the matrix
-	void SetPosition(CVector3 position, int node = 0)  { mWorldMatrices[node].SetRow(3, position); }
+	void SetPosition(CVector3 position, int node = 0)
+    {
+        if (mTransforms.empty())  mWorldMatrices[node].SetRow(3, position);
+        else                      { mTransforms[node].position = position;  MarkDirty(node); }
+    }
 
 	void SetRotation(CVector3 rotation, int node = 0)
     {
+        if (!mTransforms.empty())
+        {
+            mTransforms[node].rotation = QuaternionFromEulerAngles(rotation);
+            MarkDirty(node);
+            return;
+        }
+
         // To put rotation angles into a matrix we need to build the matrix from scratch to make sure we retain existing scaling and position
         mWorldMatrices[node] = MatrixScaling(Scale(node)) *
                                MatrixRotationZ(rotation.z) * MatrixRotationX(rotation.x) * MatrixRotationY(rotation.y) *
                                MatrixTranslation(Position(node));
     }
 
+    void SetRotation(const CQuaternion& rotation, int node = 0)
+    {
+        if (mTransforms.empty())  mWorldMatrices[node] = MatrixFromTransform({ Position(node), rotation, Scale(node) });
+        else                      { mTransforms[node].rotation = rotation;  MarkDirty(node); }
+    }
+
 	// Two ways to set scale: x,y,z separately, or all to the same value
     // To set scale without affecting rotation, normalise each row, then multiply it by the scale value.
 	void SetScale(CVector3 scale, int node = 0)
     {
+        if (!mTransforms.empty())
+        {
+            mTransforms[node].scale = scale;
+            MarkDirty(node);
+            return;
+        }
         mWorldMatrices[node].SetRow(0, Normalise(mWorldMatrices[node].GetRow(0)) * scale.x); 
         mWorldMatrices[node].SetRow(1, Normalise(mWorldMatrices[node].GetRow(1)) * scale.y); 
         mWorldMatrices[node].SetRow(2, Normalise(mWorldMatrices[node].GetRow(2)) * scale.z); 
     }
 	void SetScale(float scale)  { SetScale({ scale, scale, scale });}
 
-    void SetWorldMatrix(CMatrix4x4 matrix, int node = 0)  { mWorldMatrices[node] = matrix; }
+    void SetWorldMatrix(CMatrix4x4 matrix, int node = 0)
+    {
+        mWorldMatrices[node] = matrix;
+        if (!mTransforms.empty())  { mTransforms[node] = TransformFromMatrix(matrix);  mDirty[node] = false; }
+    }
+
+
+    // Keep a position, rotation (quaternion) and scale for each node alongside its matrix. The setters above then
+    // change these and the matrix is only rebuilt when it is next used, which is much cheaper for models that are
+    // moved, rotated or animated every frame. Matrices must not contain shear when this is turned on
+    void UseTransforms(bool use);
+    bool UsesTransforms()  { return !mTransforms.empty(); }
+
+    // Rebuild the matrices of nodes whose transforms have changed. Called automatically when the matrices are used
+    void UpdateMatrices();
+
+    // All the node matrices (the root's is the world matrix, the others are relative to their parent), e.g. to hash
+    // the model's pose to spot movement
+    const std::vector<CMatrix4x4>& NodeMatrices()  { UpdateMatrices();  return mWorldMatrices; }
 
 
 	//-------------------------------------
@@ -86,6 +169,42 @@ private:
     // Now that meshes have multiple parts, we need multiple matrices. The root matrix (the first one) is the world matrix
     // for the entire model. The remaining matrices are relative to their parent part. The hierarchy is defined in the mesh (nodes)
 	std::vector<CMatrix4x4> mWorldMatrices;
+
+    // Current level of detail, kept between frames so changes of level can use hysteresis
+    unsigned int mLOD = 0;
+
+    // Animation playback. While cross-fading, the previous clip keeps playing and is blended out
+    static const unsigned int NO_CLIP = ~0u;
+    unsigned int mClip = NO_CLIP;
+    float        mClipTime = 0;
+    bool         mLoop = true;
+    unsigned int mPreviousClip = NO_CLIP;
+    float        mPreviousClipTime = 0;
+    bool         mPreviousLoop = true;
+    float        mBlendTime = 0;
+    float        mBlendElapsed = 0;
+    float        mAnimationSpeed = 1;
+
+    std::vector<NodeTransform> mDefaultPose; // Node transforms from the mesh, for nodes without animation tracks
+    std::vector<NodeTransform> mPose;
+    std::vector<NodeTransform> mBlendPose;
+
+    // Optional transform for each node (empty if not used) and whether the node's matrix needs rebuilding from it
+    std::vector<NodeTransform> mTransforms;
+    std::vector<bool>          mDirty;
+    bool                       mAnyDirty = false;
+
+    // Version of Control for models keeping transforms
+    void ControlTransform(int node, float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode turnLeft, KeyCode turnRight,
+                          KeyCode turnCW, KeyCode turnCCW, KeyCode moveForward, KeyCode moveBackward);
+
+    void MarkDirty(int node)  { mDirty[node] = true;  mAnyDirty = true; }
+    void UpdateMatrix(int node)
+    {
+        if (!mAnyDirty || !mDirty[node])  return;
+        mWorldMatrices[node] = MatrixFromTransform(mTransforms[node]);
+        mDirty[node] = false;
+    }
 };
 
 
@@ -0,0 +1,21 @@
+//--------------------------------------------------------------------------------------
+// Weighted Blended Transparency Composite Pixel Shader
+//--------------------------------------------------------------------------------------
+// Resolves the two targets of the weighted blended transparency pass (see WeightedOIT.h) into a colour and coverage,
+// alpha blended over the scene
+
+Texture2D Accumulation : register(t0);
+Texture2D Revealage    : register(t1);
+
+float4 main(float4 position : SV_Position) : SV_Target
+{
+    // The targets are the same size as the render target, so read the texel under the pixel without filtering
+    int3 texel = int3(position.xy, 0);
+    float revealage = Revealage.Load(texel).r;
+    if (revealage >= 1.0f)  discard; // Nothing transparent drawn here
+
+    // Weighted average colour of the layers, covering the share of the background they don't reveal
+    float4 accumulation = Accumulation.Load(texel);
+    float3 averageColour = accumulation.rgb / max(accumulation.a, 1e-5f);
+    return float4(averageColour, 1 - revealage);
+}
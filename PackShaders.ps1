@@ -0,0 +1,92 @@
+#--------------------------------------------------------------------------------------
+# Packs all the compiled shaders into one file
+#--------------------------------------------------------------------------------------
+# Writes every .cso file in a folder into a shader pack, run after each build by the Visual Studio
+# project. The layout must match ShaderPack.h: a header, a table of contents sorted by name (with
+# each shader's offset, size and a 64-bit FNV-1a hash of its bytecode, as HashBytes in Hash.h)
+# and then the bytecode, each shader starting on a 16 byte boundary.
+
+param(
+    [string]$ShaderDir = ".",          # Folder holding the .cso files
+    [string]$Pack = "Shaders.pack"     # Pack to write, relative to the shader folder
+)
+
+$ErrorActionPreference = "Stop"
+
+Add-Type -Language CSharp -TypeDefinition @"
+using System;
+using System.IO;
+using System.Text;
+
+public static class ShaderPacker
+{
+    const uint Magic = 0x4b415053; // "SPAK"
+    const uint Version = 1;
+    const int MaxName = 48;
+    const int HeaderSize = 16;
+    const int EntrySize = MaxName + 3 * 8;
+    const int Alignment = 16;
+
+    static ulong Hash(byte[] data)
+    {
+        ulong hash = 14695981039346656037UL;
+        foreach (byte b in data)  hash = unchecked((hash ^ b) * 1099511628211UL);
+        return hash;
+    }
+
+    public static void Write(string[] files, string packFile)
+    {
+        // Ordinal sort to match the strcmp used to search the table
+        Array.Sort(files, (a, b) => string.CompareOrdinal(Path.GetFileNameWithoutExtension(a), Path.GetFileNameWithoutExtension(b)));
+
+        var byteCodes = new byte[files.Length][];
+        var offsets = new ulong[files.Length];
+        ulong offset = (ulong)(HeaderSize + files.Length * EntrySize);
+        for (int i = 0; i < files.Length; ++i)
+        {
+            if (Path.GetFileNameWithoutExtension(files[i]).Length >= MaxName)
+            {
+                throw new Exception("Shader name too long for pack: " + files[i]);
+            }
+            byteCodes[i] = File.ReadAllBytes(files[i]);
+            offset = (offset + Alignment - 1) / Alignment * Alignment;
+            offsets[i] = offset;
+            offset += (ulong)byteCodes[i].Length;
+        }
+
+        // Write to a temporary file then replace, so a failed build never leaves half a pack
+        string tempFile = packFile + ".tmp";
+        using (var writer = new BinaryWriter(File.Create(tempFile)))
+        {
+            writer.Write(Magic);
+            writer.Write(Version);
+            writer.Write((uint)files.Length);
+            writer.Write(0u);
+
+            for (int i = 0; i < files.Length; ++i)
+            {
+                var name = new byte[MaxName];
+                Encoding.ASCII.GetBytes(Path.GetFileNameWithoutExtension(files[i]), 0,
+                                        Path.GetFileNameWithoutExtension(files[i]).Length, name, 0);
+                writer.Write(name);
+                writer.Write(offsets[i]);
+                writer.Write((ulong)byteCodes[i].Length);
+                writer.Write(Hash(byteCodes[i]));
+            }
+
+            for (int i = 0; i < files.Length; ++i)
+            {
+                while ((ulong)writer.BaseStream.Position < offsets[i])  writer.Write((byte)0);
+                writer.Write(byteCodes[i]);
+            }
+        }
+        if (File.Exists(packFile))  File.Delete(packFile);
+        File.Move(tempFile, packFile);
+    }
+}
+"@
+
+Set-Location $ShaderDir
+$files = @(Get-ChildItem -Filter "*.cso" | ForEach-Object { $_.FullName })
+[ShaderPacker]::Write($files, (Join-Path (Get-Location) $Pack))
+Write-Host "Packed $($files.Count) shaders into $Pack"
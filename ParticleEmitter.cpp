@@ -0,0 +1,137 @@
+//--------------------------------------------------------------------------------------
+// Particle emitters - drawing particle systems as camera facing quads
+//--------------------------------------------------------------------------------------
+
+#include "ParticleEmitter.h"
+#include "InputLayout.h"
+#include "Shader.h"
+#include "State.h"
+#include "Texture.h"
+#include "Camera.h"
+
+#include <vector>
+#include <chrono>
+#include <stdexcept>
+
+
+unsigned int gParticlesDrawn = 0;
+float gParticleSortTime = 0;
+float gParticleQuadTime = 0;
+
+
+// Throws std::runtime_error if the buffers can't be created
+ParticleEmitter::ParticleEmitter(const ParticleSettings& settings, Texture* texture, ID3D11BlendState* blendState)
+    : mParticles(settings), mTexture(texture), mSortParticles(blendState == gAlphaBlendingState)
+{
+    // Layout of ParticleVertex, colour is unpacked to floats 0 -> 1
+    D3D11_INPUT_ELEMENT_DESC vertexElements[] =
+    {
+        { "Position", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,  D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "UV",       0, DXGI_FORMAT_R32G32_FLOAT,    0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "Colour",   0, DXGI_FORMAT_R8G8B8A8_UNORM,  0, 20, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    };
+    mInputLayout = CreateSharedInputLayout(vertexElements, 3);
+    if (mInputLayout == nullptr)
+    {
+        delete mTexture;
+        throw std::runtime_error(gLastError);
+    }
+
+    unsigned int maxParticles = mParticles.MaxParticles();
+    D3D11_BUFFER_DESC bufferDesc = {};
+    bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    bufferDesc.Usage = D3D11_USAGE_DYNAMIC; // Rewritten every time the particles are drawn
+    bufferDesc.ByteWidth = maxParticles * 4 * sizeof(ParticleVertex);
+    bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    HRESULT hr = gD3DDevice->CreateBuffer(&bufferDesc, nullptr, &mVertexBuffer);
+
+    // Quad corners are top-left, top-right, bottom-left, bottom-right (see ParticleSystem::BuildQuads)
+    std::vector<uint32_t> indices(maxParticles * 6);
+    for (uint32_t quad = 0; quad < maxParticles; ++quad)
+    {
+        uint32_t* index = &indices[quad * 6];
+        uint32_t  first = quad * 4;
+        index[0] = first;      index[1] = first + 1;  index[2] = first + 2;
+        index[3] = first + 2;  index[4] = first + 1;  index[5] = first + 3;
+    }
+    bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+    bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+    bufferDesc.ByteWidth = static_cast<UINT>(indices.size() * sizeof(uint32_t));
+    bufferDesc.CPUAccessFlags = 0;
+    D3D11_SUBRESOURCE_DATA initData = {};
+    initData.pSysMem = indices.data();
+    if (SUCCEEDED(hr))  hr = gD3DDevice->CreateBuffer(&bufferDesc, &initData, &mIndexBuffer);
+    if (FAILED(hr))
+    {
+        if (mVertexBuffer)  mVertexBuffer->Release();
+        mInputLayout->Release();
+        delete mTexture;
+        throw std::runtime_error("Error creating particle buffers");
+    }
+
+    // Particles are tested against the depth buffer but don't write to it, so they don't hide each other
+    PipelineStateDesc desc;
+    desc.vertexShader = gParticleVertexShader;
+    desc.pixelShader = gParticlePixelShader;
+    desc.inputLayout = mInputLayout;
+    desc.blendState = blendState;
+    desc.rasterizerState = gCullNoneState;
+    desc.depthStencilState = gDepthReadOnlyState;
+    desc.samplerState = gTrilinearSampler;
+    mPipelineState = CreatePipelineState(desc);
+
+    desc.pixelShader = gParticleOITPixelShader;
+    desc.blendState = gOITBlendingState;
+    mOITPipelineState = CreatePipelineState(desc);
+}
+
+ParticleEmitter::~ParticleEmitter()
+{
+    if (mIndexBuffer)   mIndexBuffer->Release();
+    if (mVertexBuffer)  mVertexBuffer->Release();
+    if (mInputLayout)   mInputLayout->Release();
+    delete mTexture;
+}
+
+
+void ParticleEmitter::Update(float frameTime)
+{
+    mParticles.Update(frameTime);
+}
+
+
+// Sort the particles if blending needs it, then write their quads facing the camera and draw them. Weighted blended
+// transparency doesn't depend on the order so needs no sort
+void ParticleEmitter::Render(Camera* camera, bool weightedBlended /*= false*/)
+{
+    weightedBlended = weightedBlended && mSortParticles;
+    if (mParticles.NumParticles() == 0)  return;
+
+    CMatrix4x4 cameraMatrix = camera->WorldMatrix();
+    auto sortStart = std::chrono::high_resolution_clock::now();
+    const uint32_t* order = nullptr;
+    if (mSortParticles && !weightedBlended)  order = mParticles.SortBackToFront(camera->Position(), cameraMatrix.GetZAxis()).data();
+    auto quadStart = std::chrono::high_resolution_clock::now();
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    if (FAILED(gD3DContext->Map(mVertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))  return;
+    unsigned int numQuads = mParticles.BuildQuads(cameraMatrix.GetXAxis(), cameraMatrix.GetYAxis(),
+                                                  static_cast<ParticleVertex*>(mapped.pData), order);
+    gD3DContext->Unmap(mVertexBuffer, 0);
+    auto quadEnd = std::chrono::high_resolution_clock::now();
+    gParticleSortTime += std::chrono::duration<float>(quadStart - sortStart).count();
+    gParticleQuadTime += std::chrono::duration<float>(quadEnd - quadStart).count();
+
+    BindPipelineState(weightedBlended ? mOITPipelineState : mPipelineState);
+    BindObjectTexture(0, *mTexture->TextureSRV());
+
+    UINT stride = sizeof(ParticleVertex);
+    UINT offset = 0;
+    gD3DContext->IASetVertexBuffers(0, 1, &mVertexBuffer, &stride, &offset);
+    gD3DContext->IASetIndexBuffer(mIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+    gD3DContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    gD3DContext->DrawIndexed(numQuads * 6, 0, 0);
+
+    gTrianglesRendered += numQuads * 2;
+    gParticlesDrawn += numQuads;
+}
@@ -0,0 +1,71 @@
+//--------------------------------------------------------------------------------------
+// Particle emitters - drawing particle systems as camera facing quads
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+// Each emitter owns a particle system (see ParticleSystem.h), its texture and a dynamic vertex
+// buffer big enough for its whole pool. When drawn, alpha blended particles are sorted back to
+// front (other blending doesn't depend on the order), then every particle is expanded to a quad
+// facing the camera straight into the mapped vertex buffer and they are drawn in one call. The
+// index buffer of quads never changes. Particles don't write depth and aren't lit.
+//
+// Alpha blended particles can instead be drawn unsorted into the targets of weighted blended
+// transparency (see WeightedOIT.h), which replaces the sort with a full screen composite.
+
+#ifndef _PARTICLE_EMITTER_H_INCLUDED_
+#define _PARTICLE_EMITTER_H_INCLUDED_
+
+#include "Common.h"
+#include "ParticleSystem.h"
+#include "PipelineState.h"
+
+class Texture;
+class Camera;
+
+
+class ParticleEmitter
+{
+public:
+    // The emitter takes ownership of the texture, which must be loaded before the emitter is drawn. Throws
+    // std::runtime_error if the buffers can't be created
+    ParticleEmitter(const ParticleSettings& settings, Texture* texture, ID3D11BlendState* blendState);
+    ~ParticleEmitter();
+
+    // Prevent copying, the emitter owns DirectX objects
+    ParticleEmitter(const ParticleEmitter&) = delete;
+    ParticleEmitter& operator=(const ParticleEmitter&) = delete;
+
+    void Update(float frameTime);
+
+    // Draw the particles facing the camera, whose matrices must already be set in the per-frame constants. Pass true
+    // for weightedBlended to draw alpha blended particles unsorted into the weighted blended transparency targets,
+    // which must be set (see WeightedOIT::Begin)
+    void Render(Camera* camera, bool weightedBlended = false);
+
+    // Whether the particles are alpha blended, so need sorting or weighted blended transparency
+    bool IsAlphaBlended()  { return mSortParticles; }
+
+    ParticleSystem& Particles()  { return mParticles; }
+    Texture* ParticleTexture()   { return mTexture; }
+
+
+private:
+    ParticleSystem      mParticles;
+    Texture*            mTexture;
+    bool                mSortParticles; // Only alpha blending needs the particles in order
+    PipelineStateHandle mPipelineState;
+    PipelineStateHandle mOITPipelineState; // Writing the weighted blended transparency targets instead of blending
+
+    ID3D11InputLayout*  mInputLayout  = nullptr;
+    ID3D11Buffer*       mVertexBuffer = nullptr; // Four vertices for every particle in the pool, rewritten each draw
+    ID3D11Buffer*       mIndexBuffer  = nullptr; // Two triangles for every particle in the pool
+};
+
+
+// Statistics, reset at the start of each frame: particles drawn over all views and the CPU time spent sorting them
+// and building their quads in seconds
+extern unsigned int gParticlesDrawn;
+extern float gParticleSortTime;
+extern float gParticleQuadTime;
+
+
+#endif //_PARTICLE_EMITTER_H_INCLUDED_
@@ -0,0 +1,32 @@
+//--------------------------------------------------------------------------------------
+// Particle Weighted Blended Transparency Pixel Shader
+//--------------------------------------------------------------------------------------
+// Writes an alpha blended particle into the two targets of the weighted blended transparency pass (see WeightedOIT.h)
+// rather than blending it straight into the scene, so particles can be drawn in any order
+
+#include "Common.hlsli"
+
+Texture2D    ParticleTexture : register(t0);
+SamplerState TexSampler      : register(s0);
+
+struct OITOutput
+{
+    float4 accumulation : SV_Target0; // Premultiplied colour and alpha, scaled by the weight
+    float  revealage    : SV_Target1; // Alpha, the blend state multiplies the target by one minus this
+};
+
+OITOutput main(ParticlePixelShaderInput input)
+{
+    float4 colour = ParticleTexture.Sample(TexSampler, input.uv) * input.colour;
+
+    // Nearer and more opaque pixels count for more in the average, so they show in front of those behind. This is the
+    // depth weight suggested by McGuire and Bavoil for scenes over a few hundred units, using the distance along the
+    // view direction (w of the projected position)
+    float z = input.projectedPosition.w;
+    float weight = colour.a * clamp(10.0f / (1e-5f + pow(z / 5, 2) + pow(z / 200, 6)), 1e-2f, 3e3f);
+
+    OITOutput output;
+    output.accumulation = float4(colour.rgb * colour.a, colour.a) * weight;
+    output.revealage = colour.a;
+    return output;
+}
@@ -0,0 +1,267 @@
+//--------------------------------------------------------------------------------------
+// Particle simulation - a pool of particles spawned, moved and aged on the CPU
+//--------------------------------------------------------------------------------------
+
+#include "ParticleSystem.h"
+#include "ParallelFor.h"
+#include "RadixSort.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define PARTICLES_USE_SSE
+#include <emmintrin.h>
+#endif
+
+
+// Particles per batch when working over several threads, a multiple of 4. Large enough that the threading overhead is small
+const unsigned int PARTICLE_BATCH_SIZE = 16384;
+
+
+namespace
+{
+    // Pack a colour with components 0 -> 255 into 8-bit RGBA, red in the lowest byte
+    uint32_t PackColour(float r, float g, float b, float a)
+    {
+        auto Component = [](float c) { return static_cast<uint32_t>(std::min(std::max(c, 0.0f), 255.0f) + 0.5f); };
+        return Component(r) | Component(g) << 8 | Component(b) << 16 | Component(a) << 24;
+    }
+}
+
+
+ParticleSystem::ParticleSystem(const ParticleSettings& settings)
+    : mSettings(settings)
+{
+    mCapacity = (mSettings.maxParticles + 3) & ~3u;
+    for (auto values : { &mPositionX, &mPositionY, &mPositionZ, &mVelocityX, &mVelocityY, &mVelocityZ, &mAge, &mInverseLife, &mSize })
+    {
+        values->resize(mCapacity, 0.0f);
+    }
+    mColour.resize(mCapacity, 0);
+    mSortKeys.resize(mCapacity);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Update
+//--------------------------------------------------------------------------------------
+
+// Move and age the particles, remove those at the end of their life then spawn new ones
+void ParticleSystem::Update(float frameTime, bool parallel /*= true*/)
+{
+    unsigned int numToUpdate = (mNumParticles + 3) & ~3u;
+    if (parallel)
+    {
+        ParallelFor(numToUpdate, PARTICLE_BATCH_SIZE, [&](unsigned int start, unsigned int end) { Integrate(start, end, frameTime); });
+    }
+    else
+    {
+        Integrate(0, numToUpdate, frameTime);
+    }
+
+    // Replace dead particles with the last live one, checking the moved particle in its turn
+    for (unsigned int i = 0; i < mNumParticles; )
+    {
+        if (mAge[i] * mInverseLife[i] >= 1)  MoveParticle(--mNumParticles, i);
+        else                                 ++i;
+    }
+
+    // Spawn at a steady rate, carrying fractions of a particle over to later frames
+    mSpawnRemainder += mSettings.spawnRate * frameTime;
+    unsigned int numToSpawn = static_cast<unsigned int>(mSpawnRemainder);
+    mSpawnRemainder -= numToSpawn;
+    numToSpawn = std::min(numToSpawn, mSettings.maxParticles - mNumParticles);
+
+    std::uniform_real_distribution<float> spread(-1.0f, 1.0f);
+    uint32_t startColour = PackColour(mSettings.startColour.r * 255, mSettings.startColour.g * 255,
+                                      mSettings.startColour.b * 255, mSettings.startColour.a * 255);
+    for (unsigned int n = 0; n < numToSpawn; ++n)
+    {
+        unsigned int i = mNumParticles++;
+        mPositionX[i] = mPosition.x + mSettings.spawnRadius * spread(mRandom);
+        mPositionY[i] = mPosition.y + mSettings.spawnRadius * spread(mRandom);
+        mPositionZ[i] = mPosition.z + mSettings.spawnRadius * spread(mRandom);
+        mVelocityX[i] = mSettings.velocity.x + mSettings.velocitySpread.x * spread(mRandom);
+        mVelocityY[i] = mSettings.velocity.y + mSettings.velocitySpread.y * spread(mRandom);
+        mVelocityZ[i] = mSettings.velocity.z + mSettings.velocitySpread.z * spread(mRandom);
+        float life = mSettings.minLife + (mSettings.maxLife - mSettings.minLife) * (spread(mRandom) + 1) * 0.5f;
+        mAge[i] = 0;
+        mInverseLife[i] = 1 / std::max(life, 0.001f);
+        mSize[i] = mSettings.startSize;
+        mColour[i] = startColour;
+    }
+}
+
+
+// Move and age the particles in a range: add gravity and drag to the velocity, move by the velocity, then set size
+// and colour from the share of life used
+void ParticleSystem::Integrate(unsigned int start, unsigned int end, float frameTime)
+{
+    float dragScale = std::pow(1.0f - std::min(std::max(mSettings.drag, 0.0f), 1.0f), frameTime);
+    CVector3 gravityStep = mSettings.gravity * frameTime;
+    float sizeChange = mSettings.endSize - mSettings.startSize;
+    const ColourRGBA& startColour = mSettings.startColour;
+    ColourRGBA colourChange = { mSettings.endColour.r - startColour.r, mSettings.endColour.g - startColour.g,
+                                mSettings.endColour.b - startColour.b, mSettings.endColour.a - startColour.a };
+
+#ifdef PARTICLES_USE_SSE
+    const __m128 time = _mm_set1_ps(frameTime), drag = _mm_set1_ps(dragScale), one = _mm_set1_ps(1.0f);
+    const __m128 gravityX = _mm_set1_ps(gravityStep.x), gravityY = _mm_set1_ps(gravityStep.y), gravityZ = _mm_set1_ps(gravityStep.z);
+    const __m128 size0 = _mm_set1_ps(mSettings.startSize), sizeDelta = _mm_set1_ps(sizeChange);
+    const __m128 red0   = _mm_set1_ps(startColour.r * 255), redDelta   = _mm_set1_ps(colourChange.r * 255);
+    const __m128 green0 = _mm_set1_ps(startColour.g * 255), greenDelta = _mm_set1_ps(colourChange.g * 255);
+    const __m128 blue0  = _mm_set1_ps(startColour.b * 255), blueDelta  = _mm_set1_ps(colourChange.b * 255);
+    const __m128 alpha0 = _mm_set1_ps(startColour.a * 255), alphaDelta = _mm_set1_ps(colourChange.a * 255);
+
+    for (unsigned int i = start; i < end; i += 4)
+    {
+        __m128 age = _mm_add_ps(_mm_loadu_ps(&mAge[i]), time);
+        _mm_storeu_ps(&mAge[i], age);
+
+        __m128 velocityX = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&mVelocityX[i]), drag), gravityX);
+        __m128 velocityY = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&mVelocityY[i]), drag), gravityY);
+        __m128 velocityZ = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&mVelocityZ[i]), drag), gravityZ);
+        _mm_storeu_ps(&mVelocityX[i], velocityX);
+        _mm_storeu_ps(&mVelocityY[i], velocityY);
+        _mm_storeu_ps(&mVelocityZ[i], velocityZ);
+        _mm_storeu_ps(&mPositionX[i], _mm_add_ps(_mm_loadu_ps(&mPositionX[i]), _mm_mul_ps(velocityX, time)));
+        _mm_storeu_ps(&mPositionY[i], _mm_add_ps(_mm_loadu_ps(&mPositionY[i]), _mm_mul_ps(velocityY, time)));
+        _mm_storeu_ps(&mPositionZ[i], _mm_add_ps(_mm_loadu_ps(&mPositionZ[i]), _mm_mul_ps(velocityZ, time)));
+
+        // Share of life used, 0 -> 1
+        __m128 t = _mm_min_ps(_mm_mul_ps(age, _mm_loadu_ps(&mInverseLife[i])), one);
+        _mm_storeu_ps(&mSize[i], _mm_add_ps(size0, _mm_mul_ps(sizeDelta, t)));
+
+        // Round each component to an integer and pack the four into the bytes of a 32-bit colour
+        __m128i red   = _mm_cvtps_epi32(_mm_add_ps(red0,   _mm_mul_ps(redDelta,   t)));
+        __m128i green = _mm_cvtps_epi32(_mm_add_ps(green0, _mm_mul_ps(greenDelta, t)));
+        __m128i blue  = _mm_cvtps_epi32(_mm_add_ps(blue0,  _mm_mul_ps(blueDelta,  t)));
+        __m128i alpha = _mm_cvtps_epi32(_mm_add_ps(alpha0, _mm_mul_ps(alphaDelta, t)));
+        __m128i colour = _mm_or_si128(_mm_or_si128(red, _mm_slli_epi32(green, 8)),
+                                      _mm_or_si128(_mm_slli_epi32(blue, 16), _mm_slli_epi32(alpha, 24)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&mColour[i]), colour);
+    }
+#else
+    // Scalar version of the above
+    for (unsigned int i = start; i < end; ++i)
+    {
+        mAge[i] += frameTime;
+
+        mVelocityX[i] = mVelocityX[i] * dragScale + gravityStep.x;
+        mVelocityY[i] = mVelocityY[i] * dragScale + gravityStep.y;
+        mVelocityZ[i] = mVelocityZ[i] * dragScale + gravityStep.z;
+        mPositionX[i] += mVelocityX[i] * frameTime;
+        mPositionY[i] += mVelocityY[i] * frameTime;
+        mPositionZ[i] += mVelocityZ[i] * frameTime;
+
+        float t = std::min(mAge[i] * mInverseLife[i], 1.0f);
+        mSize[i] = mSettings.startSize + sizeChange * t;
+        mColour[i] = PackColour((startColour.r + colourChange.r * t) * 255, (startColour.g + colourChange.g * t) * 255,
+                                (startColour.b + colourChange.b * t) * 255, (startColour.a + colourChange.a * t) * 255);
+    }
+#endif
+}
+
+
+// Copy a particle over another
+void ParticleSystem::MoveParticle(unsigned int from, unsigned int to)
+{
+    mPositionX[to] = mPositionX[from];
+    mPositionY[to] = mPositionY[from];
+    mPositionZ[to] = mPositionZ[from];
+    mVelocityX[to] = mVelocityX[from];
+    mVelocityY[to] = mVelocityY[from];
+    mVelocityZ[to] = mVelocityZ[from];
+    mAge[to]         = mAge[from];
+    mInverseLife[to] = mInverseLife[from];
+    mSize[to]        = mSize[from];
+    mColour[to]      = mColour[from];
+}
+
+
+// Remove all the particles
+void ParticleSystem::Clear()
+{
+    mNumParticles = 0;
+    mSpawnRemainder = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Sorting and quads
+//--------------------------------------------------------------------------------------
+
+// Order of the live particles from back to front, by a radix sort of their depths
+const std::vector<uint32_t>& ParticleSystem::SortBackToFront(CVector3 cameraPosition, CVector3 cameraFacing,
+                                                             bool parallel /*= true*/)
+{
+    // Keys from the depths as DescendingFloatKey makes them, four at a time
+    auto MakeKeys = [&](unsigned int start, unsigned int end)
+    {
+#ifdef PARTICLES_USE_SSE
+        const __m128 cameraX = _mm_set1_ps(cameraPosition.x), cameraY = _mm_set1_ps(cameraPosition.y), cameraZ = _mm_set1_ps(cameraPosition.z);
+        const __m128 facingX = _mm_set1_ps(cameraFacing.x),   facingY = _mm_set1_ps(cameraFacing.y),   facingZ = _mm_set1_ps(cameraFacing.z);
+        const __m128i signBit = _mm_set1_epi32(static_cast<int>(0x80000000u)), allBits = _mm_set1_epi32(-1);
+        for (unsigned int i = start; i < end; i += 4)
+        {
+            __m128 depth = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&mPositionX[i]), cameraX), facingX),
+                                                 _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&mPositionY[i]), cameraY), facingY)),
+                                                 _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&mPositionZ[i]), cameraZ), facingZ));
+            __m128i bits = _mm_castps_si128(depth);
+            __m128i flip = _mm_or_si128(_mm_srai_epi32(bits, 31), signBit);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&mSortKeys[i]), _mm_xor_si128(_mm_xor_si128(bits, flip), allBits));
+        }
+#else
+        for (unsigned int i = start; i < end; ++i)
+        {
+            float depth = (mPositionX[i] - cameraPosition.x) * cameraFacing.x + (mPositionY[i] - cameraPosition.y) * cameraFacing.y +
+                          (mPositionZ[i] - cameraPosition.z) * cameraFacing.z;
+            mSortKeys[i] = DescendingFloatKey(depth);
+        }
+#endif
+    };
+    unsigned int numKeys = (mNumParticles + 3) & ~3u;
+    if (parallel)  ParallelFor(numKeys, PARTICLE_BATCH_SIZE, MakeKeys);
+    else           MakeKeys(0, numKeys);
+
+    // Sort arrays are all kept the size of the pool, so any of them can take the keys made in fours above
+    mOrder.resize(mCapacity);
+    mSortKeysTemp.resize(mCapacity);
+    mOrderTemp.resize(mCapacity);
+    for (unsigned int i = 0; i < mNumParticles; ++i)  mOrder[i] = i;
+    RadixSort(mSortKeys, mOrder, mSortKeysTemp, mOrderTemp, mNumParticles);
+    mOrder.resize(mNumParticles);
+    return mOrder;
+}
+
+
+// Write a quad facing the camera for each live particle, in the given order
+unsigned int ParticleSystem::BuildQuads(CVector3 cameraRight, CVector3 cameraUp, ParticleVertex* vertices,
+                                        const uint32_t* order /*= nullptr*/, bool parallel /*= true*/)
+{
+    auto Build = [&](unsigned int start, unsigned int end)
+    {
+        ParticleVertex* out = vertices + start * 4;
+        for (unsigned int q = start; q < end; ++q, out += 4)
+        {
+            unsigned int i = order ? order[q] : q;
+            float x = mPositionX[i], y = mPositionY[i], z = mPositionZ[i];
+            float halfSize = mSize[i] * 0.5f;
+            uint32_t colour = mColour[i];
+
+            // Offsets to the corners along the diagonals, written out rather than with vector operators as this is
+            // the innermost loop over every particle
+            float diagonal1X = (cameraUp.x - cameraRight.x) * halfSize, diagonal2X = (cameraUp.x + cameraRight.x) * halfSize;
+            float diagonal1Y = (cameraUp.y - cameraRight.y) * halfSize, diagonal2Y = (cameraUp.y + cameraRight.y) * halfSize;
+            float diagonal1Z = (cameraUp.z - cameraRight.z) * halfSize, diagonal2Z = (cameraUp.z + cameraRight.z) * halfSize;
+            out[0] = { { x + diagonal1X, y + diagonal1Y, z + diagonal1Z }, { 0, 0 }, colour };
+            out[1] = { { x + diagonal2X, y + diagonal2Y, z + diagonal2Z }, { 1, 0 }, colour };
+            out[2] = { { x - diagonal2X, y - diagonal2Y, z - diagonal2Z }, { 0, 1 }, colour };
+            out[3] = { { x - diagonal1X, y - diagonal1Y, z - diagonal1Z }, { 1, 1 }, colour };
+        }
+    };
+    if (parallel)  ParallelFor(mNumParticles, PARTICLE_BATCH_SIZE, Build);
+    else           Build(0, mNumParticles);
+    return mNumParticles;
+}
@@ -0,0 +1,120 @@
+//--------------------------------------------------------------------------------------
+// Particle simulation - a pool of particles spawned, moved and aged on the CPU
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+// Particles are held as a structure of arrays (one array per value, e.g. all the x positions
+// together) so the update works on four particles at a time with SSE, and large pools are
+// spread over the ParallelFor worker threads. Dead particles are replaced by the last live
+// one, so the live particles are always the first NumParticles() of the pool.
+// For alpha blending the particles can be sorted back to front with a radix sort on their
+// depth, then each is expanded to a quad facing the camera, ready to copy to a vertex buffer.
+// No DirectX in here so particles can be run (and tested) headless.
+
+#ifndef _PARTICLE_SYSTEM_H_INCLUDED_
+#define _PARTICLE_SYSTEM_H_INCLUDED_
+
+#include "CVector2.h"
+#include "CVector3.h"
+#include "ColourRGBA.h"
+
+#include <vector>
+#include <random>
+#include <cstdint>
+
+
+// How an emitter's particles start and change over their life
+struct ParticleSettings
+{
+    unsigned int maxParticles = 1000;
+    float        spawnRate = 100;   // Particles per second, while there is room in the pool
+    float        spawnRadius = 0;   // Particles start anywhere in a cube this distance either side of the emitter
+
+    float        minLife = 1;       // Seconds, each particle's life is random in this range
+    float        maxLife = 2;
+
+    CVector3     velocity = { 0, 0, 0 }; // Starting velocity...
+    CVector3     velocitySpread = { 0, 0, 0 }; // ...varied randomly by up to this much either way on each axis
+    CVector3     gravity = { 0, 0, 0 }; // Acceleration, units per second squared
+    float        drag = 0;          // Share of its velocity a particle loses each second, 0 to 1
+
+    // Quad width and colour at the start and end of life, varying linearly between
+    float        startSize = 1;
+    float        endSize = 1;
+    ColourRGBA   startColour = { 1, 1, 1, 1 };
+    ColourRGBA   endColour = { 1, 1, 1, 0 };
+};
+
+
+// One corner of a particle quad. Colour is 8-bit RGBA with red in the lowest byte
+struct ParticleVertex
+{
+    CVector3 position;
+    CVector2 uv;
+    uint32_t colour;
+};
+
+
+class ParticleSystem
+{
+public:
+    ParticleSystem(const ParticleSettings& settings);
+
+    // Move and age the particles, remove those at the end of their life then spawn new ones
+    void Update(float frameTime, bool parallel = true);
+
+    // Remove all the particles
+    void Clear();
+
+    // Order of the live particles from back to front along the camera's facing direction, sorted by their depth.
+    // The order is valid until the next Update
+    const std::vector<uint32_t>& SortBackToFront(CVector3 cameraPosition, CVector3 cameraFacing, bool parallel = true);
+
+    // Write four vertices per live particle, a quad facing the camera given the camera's right and up directions in
+    // world space: top-left, top-right, bottom-left then bottom-right. The particles are taken in the given order
+    // (e.g. from SortBackToFront), or as they are stored if it is null. Returns the number of quads written
+    unsigned int BuildQuads(CVector3 cameraRight, CVector3 cameraUp, ParticleVertex* vertices,
+                            const uint32_t* order = nullptr, bool parallel = true);
+
+
+    // Particles are spawned from here, those already spawned are unaffected by a move
+    CVector3 Position()  { return mPosition; }
+    void SetPosition(CVector3 position)  { mPosition = position; }
+
+    ParticleSettings& Settings()  { return mSettings; }
+
+    unsigned int NumParticles()  { return mNumParticles; }
+    unsigned int MaxParticles()  { return mSettings.maxParticles; }
+
+
+private:
+    // Move and age the particles in a range, start and end are multiples of 4 (see mCapacity)
+    void Integrate(unsigned int start, unsigned int end, float frameTime);
+
+    // Copy a particle over another
+    void MoveParticle(unsigned int from, unsigned int to);
+
+    ParticleSettings mSettings;
+    CVector3         mPosition = { 0, 0, 0 };
+
+    // The pool, one array per value. The arrays are rounded up to a multiple of 4 (mCapacity) so the SSE update can
+    // work in fours beyond the last live particle. Colour is 8-bit RGBA as in ParticleVertex
+    unsigned int mCapacity;
+    unsigned int mNumParticles = 0;
+    std::vector<float>    mPositionX, mPositionY, mPositionZ;
+    std::vector<float>    mVelocityX, mVelocityY, mVelocityZ;
+    std::vector<float>    mAge;
+    std::vector<float>    mInverseLife; // 1 / life, so the share of life used is age * inverse life
+    std::vector<float>    mSize;
+    std::vector<uint32_t> mColour;
+
+    // Fraction of a particle left over from spawning in earlier frames
+    float mSpawnRemainder = 0;
+    std::mt19937 mRandom;
+
+    // Sort keys and the order they give, and their copies for alternate passes of the radix sort
+    std::vector<uint32_t> mSortKeys, mSortKeysTemp;
+    std::vector<uint32_t> mOrder, mOrderTemp;
+};
+
+
+#endif //_PARTICLE_SYSTEM_H_INCLUDED_
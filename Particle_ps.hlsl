@@ -0,0 +1,15 @@
+//--------------------------------------------------------------------------------------
+// Particle Pixel Shader
+//--------------------------------------------------------------------------------------
+// Samples the particle texture and tints it with the particle's colour, which changes over its life
+
+#include "Common.hlsli"
+
+Texture2D    ParticleTexture : register(t0);
+SamplerState TexSampler      : register(s0);
+
+float4 main(ParticlePixelShaderInput input) : SV_Target
+{
+    // Alpha blended particles fade out through the alpha of their colour, additive ones as their colour goes to black
+    return ParticleTexture.Sample(TexSampler, input.uv) * input.colour;
+}
@@ -0,0 +1,20 @@
+//--------------------------------------------------------------------------------------
+// Particle Vertex Shader
+//--------------------------------------------------------------------------------------
+// Particle quads are built on the CPU in world space, already facing the camera (see ParticleSystem.h),
+// so only need projecting
+
+#include "Common.hlsli"
+
+ParticlePixelShaderInput main(ParticleVertex particleVertex)
+{
+    ParticlePixelShaderInput output;
+
+    float4 worldPosition = float4(particleVertex.position, 1);
+    output.projectedPosition = mul(gViewProjectionMatrix, worldPosition);
+
+    output.uv     = particleVertex.uv;
+    output.colour = particleVertex.colour;
+
+    return output;
+}
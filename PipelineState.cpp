@@ -0,0 +1,154 @@
+//--------------------------------------------------------------------------------------
+// Pipeline state objects
+//--------------------------------------------------------------------------------------
+
+#include "PipelineState.h"
+#include "State.h"
+#include "Hash.h"
+
+#include <vector>
+#include <unordered_map>
+
+
+// Registered descriptions, indexed by handle, and handles by hash of their description to find duplicates quickly
+std::vector<PipelineStateDesc> gPipelineStates;
+std::unordered_multimap<uint64_t, PipelineStateHandle> gPipelineStateLookup;
+
+// The state last bound and whether it was bound for reverse-Z, together with the objects actually set on the GPU
+PipelineStateHandle gBoundPipelineState = NO_PIPELINE_STATE;
+bool                gBoundReverseDepth = false;
+PipelineStateDesc   gBoundObjects;
+
+unsigned int gPipelineStateBinds = 0;
+unsigned int gPipelineStateChanges = 0;
+
+// Object textures known to be set on each slot, null if not known
+ID3D11ShaderResourceView* gBoundTextures[MAX_OBJECT_TEXTURES] = {};
+
+unsigned int gTextureBinds = 0;
+unsigned int gTextureChanges = 0;
+
+
+bool PipelineStateDesc::operator==(const PipelineStateDesc& other) const
+{
+    return vertexShader == other.vertexShader && pixelShader == other.pixelShader && inputLayout == other.inputLayout &&
+           blendState == other.blendState && rasterizerState == other.rasterizerState &&
+           depthStencilState == other.depthStencilState && samplerState == other.samplerState;
+}
+
+
+// Register a description, returns the handle of an identical one if it has been registered before
+PipelineStateHandle CreatePipelineState(const PipelineStateDesc& desc)
+{
+    // The description is only pointers, so has no padding and can be hashed as bytes
+    uint64_t hash = HashBytes(&desc, sizeof(desc));
+    auto matches = gPipelineStateLookup.equal_range(hash);
+    for (auto match = matches.first; match != matches.second; ++match)
+    {
+        if (gPipelineStates[match->second] == desc)  return match->second;
+    }
+
+    PipelineStateHandle handle = static_cast<PipelineStateHandle>(gPipelineStates.size());
+    gPipelineStates.push_back(desc);
+    gPipelineStateLookup.emplace(hash, handle);
+    return handle;
+}
+
+
+// The description for a handle
+const PipelineStateDesc& GetPipelineState(PipelineStateHandle handle)
+{
+    return gPipelineStates[handle];
+}
+
+
+// Set a pipeline state on the GPU, changing only what differs from the last state bound
+void BindPipelineState(PipelineStateHandle handle)
+{
+    ++gPipelineStateBinds;
+    if (handle == gBoundPipelineState && gReverseDepth == gBoundReverseDepth)  return;
+    ++gPipelineStateChanges;
+
+    PipelineStateDesc desc = gPipelineStates[handle];
+    if (gReverseDepth)  desc.depthStencilState = ReverseDepthState(desc.depthStencilState);
+
+    // Nothing is known to be set after an invalidate
+    bool all = (gBoundPipelineState == NO_PIPELINE_STATE);
+    if (all || desc.vertexShader != gBoundObjects.vertexShader)  gD3DContext->VSSetShader(desc.vertexShader, nullptr, 0);
+    if (all || desc.pixelShader  != gBoundObjects.pixelShader )  gD3DContext->PSSetShader(desc.pixelShader,  nullptr, 0);
+    if (desc.inputLayout && (all || desc.inputLayout != gBoundObjects.inputLayout))  gD3DContext->IASetInputLayout(desc.inputLayout);
+    if (all || desc.blendState        != gBoundObjects.blendState       )  gD3DContext->OMSetBlendState(desc.blendState, nullptr, 0xffffff);
+    if (all || desc.rasterizerState   != gBoundObjects.rasterizerState  )  gD3DContext->RSSetState(desc.rasterizerState);
+    if (all || desc.depthStencilState != gBoundObjects.depthStencilState)  gD3DContext->OMSetDepthStencilState(desc.depthStencilState, 0);
+    if (desc.samplerState && (all || desc.samplerState != gBoundObjects.samplerState))  gD3DContext->PSSetSamplers(0, 1, &desc.samplerState);
+
+    // A null layout leaves meshes to set their own, so the layout bound is no longer known (null here). A null
+    // sampler leaves the last one in place
+    if (!desc.samplerState)  desc.samplerState = all ? nullptr : gBoundObjects.samplerState;
+    gBoundObjects = desc;
+    gBoundPipelineState = handle;
+    gBoundReverseDepth = gReverseDepth;
+}
+
+
+// Forget which state is bound
+void InvalidatePipelineState()
+{
+    gBoundPipelineState = NO_PIPELINE_STATE;
+    gBoundObjects = PipelineStateDesc();
+    for (auto& texture : gBoundTextures)  texture = nullptr;
+}
+
+
+// Set an object's texture on a pixel shader slot, unless it is already set there
+void BindObjectTexture(unsigned int slot, ID3D11ShaderResourceView* srv)
+{
+    ++gTextureBinds;
+    if (srv != nullptr && gBoundTextures[slot] == srv)  return;
+    ++gTextureChanges;
+
+    gD3DContext->PSSetShaderResources(slot, 1, &srv);
+    gBoundTextures[slot] = srv;
+}
+
+
+// Rebuild the lookup after descriptions have been changed
+void RehashPipelineStates()
+{
+    gPipelineStateLookup.clear();
+    for (PipelineStateHandle handle = 0; handle < gPipelineStates.size(); ++handle)
+    {
+        gPipelineStateLookup.emplace(HashBytes(&gPipelineStates[handle], sizeof(PipelineStateDesc)), handle);
+    }
+    InvalidatePipelineState();
+}
+
+
+// Replace a shader in every registered description that uses it
+void ReplacePipelineStateShader(ID3D11VertexShader* oldShader, ID3D11VertexShader* newShader)
+{
+    for (auto& desc : gPipelineStates)  if (desc.vertexShader == oldShader)  desc.vertexShader = newShader;
+    RehashPipelineStates();
+}
+
+void ReplacePipelineStateShader(ID3D11PixelShader* oldShader, ID3D11PixelShader* newShader)
+{
+    for (auto& desc : gPipelineStates)  if (desc.pixelShader == oldShader)  desc.pixelShader = newShader;
+    RehashPipelineStates();
+}
+
+
+// Remove all the registered descriptions
+void ReleasePipelineStates()
+{
+    gPipelineStates.clear();
+    gPipelineStateLookup.clear();
+    InvalidatePipelineState();
+}
+
+
+// Number of different pipeline states registered
+unsigned int NumberPipelineStates()
+{
+    return static_cast<unsigned int>(gPipelineStates.size());
+}
@@ -0,0 +1,77 @@
+//--------------------------------------------------------------------------------------
+// Pipeline state objects
+//--------------------------------------------------------------------------------------
+// DirectX 11 sets shaders and states one at a time, so an object being drawn would carry a
+// pointer to each and set them all before every draw. Here the full set is bundled into an
+// immutable description and registered once, giving back a small integer handle. Identical
+// descriptions share a handle, so binding can skip all the work when the handle is the one
+// already bound, and otherwise only sets the parts that differ.
+// The objects in a description are not owned by the cache, they are released as before.
+
+#ifndef _PIPELINE_STATE_H_INCLUDED_
+#define _PIPELINE_STATE_H_INCLUDED_
+
+#include "Common.h"
+
+#include <cstdint>
+
+
+// Everything that is set on the GPU to draw an object, apart from its textures and constants
+struct PipelineStateDesc
+{
+    ID3D11VertexShader*      vertexShader      = nullptr;
+    ID3D11PixelShader*       pixelShader       = nullptr; // Can be null, e.g. for depth only rendering
+    ID3D11InputLayout*       inputLayout       = nullptr; // Null if the mesh sets the layout of each sub-mesh
+    ID3D11BlendState*        blendState        = nullptr;
+    ID3D11RasterizerState*   rasterizerState   = nullptr;
+    ID3D11DepthStencilState* depthStencilState = nullptr; // Standard depth version, swapped when rendering reverse-Z
+    ID3D11SamplerState*      samplerState      = nullptr; // Pixel shader sampler slot 0
+
+    bool operator==(const PipelineStateDesc& other) const;
+};
+
+// Identifies a registered description. Equal handles mean equal descriptions
+using PipelineStateHandle = uint32_t;
+const PipelineStateHandle NO_PIPELINE_STATE = ~0u;
+
+
+// Register a description, returns the handle of an identical one if it has been registered before
+PipelineStateHandle CreatePipelineState(const PipelineStateDesc& desc);
+
+// The description for a handle
+const PipelineStateDesc& GetPipelineState(PipelineStateHandle handle);
+
+// Set a pipeline state on the GPU, using the reverse-Z version of its depth state if gReverseDepth is set. Does
+// nothing if it is already set, otherwise only the parts that differ from the last state bound are changed
+void BindPipelineState(PipelineStateHandle handle);
+
+// Forget which state is bound, call after setting shaders or states directly rather than with the function above.
+// Also forgets the object textures bound below
+void InvalidatePipelineState();
+
+// Set an object's texture on a pixel shader slot (below MAX_OBJECT_TEXTURES). Does nothing if it is already set there,
+// e.g. when consecutive objects share a texture atlas
+const unsigned int MAX_OBJECT_TEXTURES = 8;
+void BindObjectTexture(unsigned int slot, ID3D11ShaderResourceView* srv);
+
+// Replace a shader in every registered description that uses it, e.g. when shaders are reloaded. Handles stay the same
+void ReplacePipelineStateShader(ID3D11VertexShader* oldShader, ID3D11VertexShader* newShader);
+void ReplacePipelineStateShader(ID3D11PixelShader*  oldShader, ID3D11PixelShader*  newShader);
+
+// Remove all the registered descriptions (the objects in them are not released)
+void ReleasePipelineStates();
+
+
+// Number of different pipeline states registered
+unsigned int NumberPipelineStates();
+
+// Statistics, reset at the start of each frame: calls to BindPipelineState and the ones that changed any state
+extern unsigned int gPipelineStateBinds;
+extern unsigned int gPipelineStateChanges;
+
+// Statistics, reset at the start of each frame: calls to BindObjectTexture and the ones that set a texture
+extern unsigned int gTextureBinds;
+extern unsigned int gTextureChanges;
+
+
+#endif //_PIPELINE_STATE_H_INCLUDED_
@@ -17,8 +17,8 @@ LightingPixelShaderInput main(BasicVertex modelVertex)
                                                              
     output.worldPosition = worldPosition.xyz; // Also pass world position to pixel shader for lighting
 
-    // Pass texture coordinates (UVs) on to the pixel shader
-    output.uv = modelVertex.uv;
+    // Pass texture coordinates (UVs) on to the pixel shader, moved to the texture's region if it is in an atlas
+    output.uv = modelVertex.uv * gUVScale + gUVOffset;
 
     return output;
 }
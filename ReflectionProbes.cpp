@@ -0,0 +1,222 @@
+//--------------------------------------------------------------------------------------
+// Dynamic reflection probes
+//--------------------------------------------------------------------------------------
+
+#include "ReflectionProbes.h"
+#include "Scene.h"
+#include "SceneObject.h"
+#include "GraphicsHelpers.h"
+#include "Hash.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+
+// Create the cube map array and views for up to maxProbes probes (at most MAX_REFLECTION_PROBES)
+ReflectionProbes::ReflectionProbes(unsigned int maxProbes)
+    : mMaxProbes(std::min(std::max(maxProbes, 1u), MAX_REFLECTION_PROBES))
+{
+    // Cube map array, 6 slices per probe, rendered to and sampled from
+    D3D11_TEXTURE2D_DESC textureDesc = {};
+    textureDesc.Width  = REFLECTION_PROBE_SIZE;
+    textureDesc.Height = REFLECTION_PROBE_SIZE;
+    textureDesc.MipLevels = 1;
+    textureDesc.ArraySize = 6 * mMaxProbes;
+    textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    textureDesc.SampleDesc.Count = 1;
+    textureDesc.SampleDesc.Quality = 0;
+    textureDesc.Usage = D3D11_USAGE_DEFAULT;
+    textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+    textureDesc.CPUAccessFlags = 0;
+    textureDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+    if (FAILED(gD3DDevice->CreateTexture2D(&textureDesc, nullptr, &mCubeTexture)))
+    {
+        throw std::runtime_error("Error creating reflection probe texture");
+    }
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format = textureDesc.Format;
+    srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
+    srvDesc.TextureCubeArray.MostDetailedMip = 0;
+    srvDesc.TextureCubeArray.MipLevels = 1;
+    srvDesc.TextureCubeArray.First2DArrayFace = 0;
+    srvDesc.TextureCubeArray.NumCubes = mMaxProbes;
+    if (FAILED(gD3DDevice->CreateShaderResourceView(mCubeTexture, &srvDesc, &mCubeSRV)))
+    {
+        throw std::runtime_error("Error creating reflection probe texture view");
+    }
+
+    // One render target view per face
+    mFaceRTVs.resize(6 * mMaxProbes, nullptr);
+    for (unsigned int face = 0; face < mFaceRTVs.size(); ++face)
+    {
+        D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
+        rtvDesc.Format = textureDesc.Format;
+        rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
+        rtvDesc.Texture2DArray.MipSlice = 0;
+        rtvDesc.Texture2DArray.FirstArraySlice = face;
+        rtvDesc.Texture2DArray.ArraySize = 1;
+        if (FAILED(gD3DDevice->CreateRenderTargetView(mCubeTexture, &rtvDesc, &mFaceRTVs[face])))
+        {
+            throw std::runtime_error("Error creating reflection probe render target");
+        }
+    }
+
+    // Faces are rendered one after another, each clearing depth first, so they can share one depth buffer
+    D3D11_TEXTURE2D_DESC depthDesc = textureDesc;
+    depthDesc.ArraySize = 1;
+    depthDesc.Format = DXGI_FORMAT_D32_FLOAT;
+    depthDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+    depthDesc.MiscFlags = 0;
+    if (FAILED(gD3DDevice->CreateTexture2D(&depthDesc, nullptr, &mDepthTexture)))
+    {
+        throw std::runtime_error("Error creating reflection probe depth buffer");
+    }
+
+    D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+    dsvDesc.Format = depthDesc.Format;
+    dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+    dsvDesc.Texture2D.MipSlice = 0;
+    if (FAILED(gD3DDevice->CreateDepthStencilView(mDepthTexture, &dsvDesc, &mDepthStencil)))
+    {
+        throw std::runtime_error("Error creating reflection probe depth buffer view");
+    }
+}
+
+
+ReflectionProbes::~ReflectionProbes()
+{
+    if (mDepthStencil)  mDepthStencil->Release();
+    if (mDepthTexture)  mDepthTexture->Release();
+    for (auto rtv : mFaceRTVs)  if (rtv)  rtv->Release();
+    if (mCubeSRV)      mCubeSRV->Release();
+    if (mCubeTexture)  mCubeTexture->Release();
+}
+
+
+// Add a probe, returns its index. Objects within the radius of the position are watched for movement
+unsigned int ReflectionProbes::AddProbe(CVector3 position, float radius)
+{
+    if (mProbes.size() >= mMaxProbes)  return mMaxProbes;
+
+    mProbes.emplace_back();
+    auto& probe = mProbes.back();
+    probe.position = position;
+    probe.radius = radius;
+    for (unsigned int face = 0; face < 6; ++face)
+    {
+        // 90 degree field of view and square aspect ratio so the six faces meet exactly
+        probe.faceCameras[face] = Camera(position, CUBE_FACE_ROTATIONS[face], PI / 2, 1.0f);
+        probe.faceCameras[face].SetReverseZ(true);
+    }
+    return static_cast<unsigned int>(mProbes.size()) - 1;
+}
+
+
+// Render the faces chosen for this frame
+void ReflectionProbes::Update(const std::vector<SceneObject*>& watchedObjects, SceneObject* hiddenObject)
+{
+    auto updateStart = std::chrono::high_resolution_clock::now();
+    unsigned int numProbes = static_cast<unsigned int>(mProbes.size());
+
+    // Mark probes for update
+    for (unsigned int p = 0; p < numProbes; ++p)
+    {
+        auto& probe = mProbes[p];
+        if (mUpdateMode == UpdateMode::OnChange)
+        {
+            uint64_t signature = ProbeSignature(p, watchedObjects, hiddenObject);
+            if (signature != probe.signature)
+            {
+                probe.signature = signature;
+                probe.dirtyFaces |= 0x3f;
+            }
+        }
+        else if (probe.dirtyFaces == 0)
+        {
+            probe.dirtyFaces = 0x3f;
+        }
+    }
+
+    // Take dirty faces up to the budget, starting from a different probe each frame and within each probe from the face
+    // after the last one rendered, so faces of probes that keep changing are still all updated in turn
+    SceneView views[MAX_VIEWS];
+    unsigned int numViews = 0;
+    unsigned int budget = std::min(mFacesPerFrame, MAX_VIEWS);
+    for (unsigned int i = 0; i < numProbes && numViews < budget; ++i)
+    {
+        unsigned int p = (mNextProbe + i) % numProbes;
+        auto& probe = mProbes[p];
+        unsigned int firstFace = probe.nextFace;
+        for (unsigned int i = 0; i < 6 && numViews < budget; ++i)
+        {
+            unsigned int face = (firstFace + i) % 6;
+            if (!(probe.dirtyFaces & (1 << face)))  continue;
+            probe.dirtyFaces &= ~(1 << face);
+            probe.nextFace = static_cast<uint8_t>((face + 1) % 6);
+
+            auto& view = views[numViews++];
+            view.camera = &probe.faceCameras[face];
+            view.renderTarget = mFaceRTVs[p * 6 + face];
+            view.depthStencil = mDepthStencil;
+            view.viewport = { 0, 0, static_cast<FLOAT>(REFLECTION_PROBE_SIZE), static_cast<FLOAT>(REFLECTION_PROBE_SIZE), 0.0f, 1.0f };
+            view.clearColour = true;
+            view.clearDepth = true;
+            view.hiddenObject = hiddenObject;
+        }
+    }
+    if (numProbes > 0)  mNextProbe = (mNextProbe + 1) % numProbes;
+
+    // The probe textures can't be read while they are being rendered to
+    if (numViews > 0)
+    {
+        ID3D11ShaderResourceView* nullSRV = nullptr;
+        gD3DContext->PSSetShaderResources(REFLECTION_PROBE_TEXTURE_SLOT, 1, &nullSRV);
+        RenderSceneFromCameras(views, numViews);
+    }
+
+    mFacesRendered = numViews;
+    mUpdateTime = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - updateStart).count();
+}
+
+
+// Send the probe positions to the GPU and select the cube map array for reflective pixel shaders
+void ReflectionProbes::Bind()
+{
+    gPerProbeConstants.numProbes = static_cast<unsigned int>(mProbes.size());
+    for (unsigned int p = 0; p < mProbes.size(); ++p)
+    {
+        gPerProbeConstants.probes[p].position = mProbes[p].position;
+        gPerProbeConstants.probes[p].radius = mProbes[p].radius;
+    }
+    UpdateConstantBuffer(gPerProbeConstantBuffer, gPerProbeConstants);
+    gD3DContext->PSSetConstantBuffers(3, 1, &gPerProbeConstantBuffer);
+    gD3DContext->PSSetShaderResources(REFLECTION_PROBE_TEXTURE_SLOT, 1, &mCubeSRV);
+}
+
+
+// Hash of the world matrices of the watched objects overlapping the probe, to spot movement
+// Only movement is tracked, changes to lighting don't cause updates in on-change mode
+uint64_t ReflectionProbes::ProbeSignature(unsigned int probe, const std::vector<SceneObject*>& watchedObjects, SceneObject* hiddenObject)
+{
+    auto& probeData = mProbes[probe];
+
+    uint64_t hash = HASH_START;
+    for (unsigned int i = 0; i < watchedObjects.size(); ++i)
+    {
+        auto object = watchedObjects[i];
+        if (object == hiddenObject || object->IsAlwaysVisible())  continue;
+
+        CVector3 centre;
+        float radius;
+        object->ObjectModel()->BoundingSphere(centre, radius);
+        if (Length(centre - probeData.position) > probeData.radius + radius)  continue;
+
+        CMatrix4x4 worldMatrix = object->ObjectModel()->WorldMatrix();
+        hash = HashBytes(&i, sizeof(i), hash);
+        hash = HashBytes(&worldMatrix, sizeof(worldMatrix), hash);
+    }
+    return hash;
+}
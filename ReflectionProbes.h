@@ -0,0 +1,102 @@
+//--------------------------------------------------------------------------------------
+// Dynamic reflection probes
+//--------------------------------------------------------------------------------------
+// Each probe is a point in the scene with a cube map of what can be seen from there, so
+// reflective objects can reflect the scene rather than a fixed skybox. All the cube maps
+// are held in one texture array. Rendering six faces for every probe every frame would be
+// expensive, so updates are amortised: a fixed number of faces are rendered each frame,
+// taking faces in turn (continuous mode) or only faces of probes where something inside
+// the probe's radius has moved (on-change mode). Faces chosen in the same frame are rendered
+// together as views of a single pass over the scene (see RenderSceneFromCameras)
+
+#ifndef _REFLECTION_PROBES_H_INCLUDED_
+#define _REFLECTION_PROBES_H_INCLUDED_
+
+#include "Common.h"
+#include "Camera.h"
+
+#include <vector>
+#include <cstdint>
+
+class SceneObject;
+
+// Size in pixels of each face of a probe's cube map
+const unsigned int REFLECTION_PROBE_SIZE = 128;
+
+// Texture slot of the probe cube map array in reflective pixel shaders
+const unsigned int REFLECTION_PROBE_TEXTURE_SLOT = 8;
+
+
+class ReflectionProbes
+{
+public:
+    // How to choose which faces to render each frame
+    enum class UpdateMode
+    {
+        Continuous, // Re-render faces in turn whether anything has changed or not
+        OnChange,   // Only re-render probes where objects within the radius have moved
+    };
+
+    // Create the cube map array and views for up to maxProbes probes (at most MAX_REFLECTION_PROBES)
+    // Will throw a std::runtime_error exception on failure (since constructors can't return errors)
+    ReflectionProbes(unsigned int maxProbes);
+    ~ReflectionProbes();
+
+    // Add a probe, returns its index. Objects within the radius of the position are watched for movement
+    unsigned int AddProbe(CVector3 position, float radius);
+    unsigned int NumberProbes()  { return static_cast<unsigned int>(mProbes.size()); }
+
+    void       SetUpdateMode(UpdateMode mode)  { mUpdateMode = mode; }
+    UpdateMode GetUpdateMode()  { return mUpdateMode; }
+
+    // Most faces rendered in one frame over all probes, bounding the cost of updates
+    void SetFacesPerFrame(unsigned int faces)  { mFacesPerFrame = faces; }
+
+
+    // Render the faces chosen for this frame. The watched objects are checked for movement in on-change mode
+    // hiddenObject is not drawn into the probes, normally the reflective object itself. Changes the render targets
+    // and per-frame constants, so call before setting up the main view. The per-frame lighting constants must be set
+    void Update(const std::vector<SceneObject*>& watchedObjects, SceneObject* hiddenObject);
+
+    // Send the probe positions to the GPU and select the cube map array for reflective pixel shaders
+    void Bind();
+
+
+    // Statistics for the last update
+    unsigned int FacesRendered()  { return mFacesRendered; }
+    float        UpdateTime()     { return mUpdateTime; } // Seconds of CPU time, including submitting the faces
+
+
+private:
+    // Hash of the world matrices of the watched objects overlapping the probe, to spot movement
+    uint64_t ProbeSignature(unsigned int probe, const std::vector<SceneObject*>& watchedObjects, SceneObject* hiddenObject);
+
+    struct Probe
+    {
+        CVector3 position;
+        float    radius;
+        uint8_t  dirtyFaces = 0x3f; // Bit for each face that needs rendering
+        uint8_t  nextFace = 0;      // Round robin start for choosing this probe's faces, so every face gets updated
+        uint64_t signature = 0;
+        Camera   faceCameras[6];
+    };
+    std::vector<Probe> mProbes;
+    unsigned int       mMaxProbes;
+    unsigned int       mNextProbe = 0; // Round robin start for choosing faces, so no probe is starved
+
+    UpdateMode   mUpdateMode = UpdateMode::OnChange;
+    unsigned int mFacesPerFrame = 1;
+
+    unsigned int mFacesRendered = 0;
+    float        mUpdateTime = 0;
+
+    // Cube map array (6 slices per probe), a render target view for each face and a shared depth buffer
+    ID3D11Texture2D*                     mCubeTexture = nullptr;
+    ID3D11ShaderResourceView*            mCubeSRV = nullptr;
+    std::vector<ID3D11RenderTargetView*> mFaceRTVs;
+    ID3D11Texture2D*                     mDepthTexture = nullptr;
+    ID3D11DepthStencilView*              mDepthStencil = nullptr;
+};
+
+
+#endif //_REFLECTION_PROBES_H_INCLUDED_
@@ -22,6 +22,7 @@
 
 #include <sstream>
 #include <memory>
+#include <chrono>
 
 #include "Texture.h"
 #define _CRTDBG_MAP_ALLOC
@@ -32,6 +33,26 @@
 #include <vector>
 
 #include "SceneObject.h"
+#include "PipelineState.h"
+#include "InputLayout.h"
+#include "ReflectionProbes.h"
+#include "ShadowMap.h"
+#include "CascadedShadowMap.h"
+#include "ParallelFor.h"
+#include "JobSystem.h"
+#include "Timer.h"
+#include "HotReload.h"
+#include "CFrustum.h"
+#include "BCDecoder.h"
+#include "TextureAtlas.h"
+#include "ParticleEmitter.h"
+#include "WeightedOIT.h"
+#include "RadixSort.h"
+#include "DynamicBVH.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
 
 //--------------------------------------------------------------------------------------
 // Scene Data
@@ -52,13 +73,71 @@ Mesh* gMeshes[NUM_MESHES];
 
 std::vector<SceneObject*> gObjects;
 
+// The bike reflects the reflection probes, so is left out of them, and its wheels are turned with T / G
+SceneObject* gBike = nullptr;
+
+// The troll, target of the picking benchmark (M)
+SceneObject* gTroll = nullptr;
+
 Camera* gCamera;
 
+// Second camera looking down over the scene, shown picture-in-picture. Press '6' to toggle
+Camera* gOverheadCamera;
+bool gPictureInPicture = false;
+const float PICTURE_IN_PICTURE_SIZE = 0.3f; // Fraction of the window width and height
+
+// Dynamic reflections for the bike. Press '7' to switch between updating continuously and when things move
+ReflectionProbes* gReflectionProbes;
+const unsigned int NUM_REFLECTION_PROBES = 3;
+const unsigned int REFLECTION_PROBE_FACES_PER_FRAME = 1;
+
+// Shadows from both lights, a cube map for the point light (light 1) and a single map for the spotlight (light 2)
+ShadowMap* gPointShadowMap;
+ShadowMap* gSpotShadowMap;
+const unsigned int POINT_SHADOW_MAP_SIZE = 512;
+const unsigned int SPOT_SHADOW_MAP_SIZE = 1024;
+const float POINT_SHADOW_RANGE = 200.0f; // Objects further than this from the light don't cast shadows
+const float SPOT_SHADOW_RANGE = 400.0f;
+std::vector<SceneObject*> gShadowCasters;
+
+// Sun with cascaded shadows fitted to the main camera's view. Press '8' to turn it on and off
+CascadedShadowMap* gSunShadowMap;
+CVector3 gSunDirection = { -0.4f, -1.0f, 0.3f }; // Direction the light travels in, normalised when used
+CVector3 gSunColour = { 0.35f, 0.33f, 0.3f };
+bool gSunOn = true;
+const unsigned int SUN_SHADOW_MAP_SIZE = 1024;
+const float SUN_SHADOW_DISTANCE = 1000.0f; // Shadows are fitted up to here rather than the camera's far clip
+const float SUN_SPLIT_LAMBDA = 0.9f;       // Mostly logarithmic splits, with enough uniform split to widen the nearest
+
 
 // Store lights in an array in this exercise
 const int NUM_LIGHTS = 2;
 std::vector<Light*> gLights;
 
+// Smoke drifting up over the scene, and sparks thrown off the orbiting light (which follow it)
+std::vector<ParticleEmitter*> gParticleEmitters;
+const CVector3 SMOKE_POSITION = { -40.0f, 2.0f, 10.0f };
+
+// Targets for drawing alpha blended particles with weighted blended transparency rather than sorting them. Press 'Y'
+// to switch between the two
+WeightedOIT* gWeightedOIT;
+bool gUseWeightedOIT = false;
+
+// Tree of the world bounds of the objects and lights, for culling and other spatial queries. Item values are indexes
+// into gSceneBVHObjects. Objects that are always visible aren't in the tree
+DynamicBVH gSceneBVH;
+std::vector<SceneObject*>        gSceneBVHObjects;
+std::vector<DynamicBVH::ItemID>  gSceneBVHItems;  // Item for each object above, NO_ITEM if it isn't in the tree
+std::vector<BoundingBox>         gSceneBVHBounds; // Bounds last given to the tree, to spot the objects that moved
+std::vector<BoundingBox>         gSceneBVHNewBounds; // Bounds this frame, kept to reuse the memory
+float gSceneBVHRebuildCost = 0;                   // SAH cost just after the last rebuild
+const float SCENE_BVH_REBUILD_RATIO = 1.5f;       // Rebuild when refitting has made the cost this many times worse
+
+// Object picked by clicking on it with the mouse, which the keys then control in place of the controllable objects.
+// Click on empty space to go back to those. Also the CPU time taken by the last pick, for the window title
+SceneObject* gPickedObject = nullptr;
+float gPickTime = 0;
+
 
 // Additional light information
 CVector3 gAmbientColour = { 0.3f, 0.4f, 0.5f }; // Background level of light
@@ -73,6 +152,94 @@ const float gLightOrbitSpeed = 0.7f;
 // Lock FPS to monitor refresh rate, which will typically set it to 60fps. Press 'p' to toggle to full fps
 bool lockFPS = true;
 
+// Rendering statistics for the current frame
+unsigned int gTrianglesRendered = 0;
+MeshletCullStats gMeshletStats;
+float gMeshletCullTime = 0;
+unsigned int gSkinnedVertices = 0;
+float gSkinningTime = 0;
+unsigned int gViewsRendered = 0;
+unsigned int gObjectsDrawn = 0;
+
+// Textures packed into atlases at startup, for the window title
+AtlasStats gAtlasStats;
+
+// Skin meshes on the CPU rather than in the vertex shader. Press '2' to toggle
+bool gCPUSkinning = false;
+
+// The camera being rendered uses reverse-Z projection. Press '5' to toggle it on the main camera
+bool gReverseDepth = false;
+
+// Result of the last benchmark for the window title. Press '3' for the animation benchmark, '4' for node rotation,
+// 'C' for meshlet culling,
+// '0' for software texture decoding, 'B' for particles, 'H' for the scene BVH, 'M' for picking, 'N' for the job system
+std::string gBenchmarkResult;
+
+// Time taken by InitGeometry and InitScene in seconds, for the window title. Shader loading is also shown on its own
+Timer gStartupTimer;
+float gStartupTime = 0;
+
+// The bike's wheels are turned by an animation clip rather than directly. Hold T / G to speed up / slow down
+const unsigned int WHEEL_SPIN_KEYS = 16;     // Keys per revolution
+const float        WHEEL_SPIN_MAX_SPEED = 4; // Revolutions per second
+
+// Animation benchmark: number of bike models and frames to update them for
+const unsigned int ANIMATION_BENCHMARK_MODELS = 4096;
+const unsigned int ANIMATION_BENCHMARK_FRAMES = 20;
+
+// Node rotation benchmark: number of bike models to turn every node of, and number of times to do so
+const unsigned int ROTATION_BENCHMARK_MODELS = 1024;
+const unsigned int ROTATION_BENCHMARK_FRAMES = 20;
+
+// Meshlet culling benchmark: each mesh is viewed from cameras spread around it, half of them looking to one side so
+// part of the mesh is off screen. The views are culled a number of times to give a measurable time
+const unsigned int MESHLET_BENCHMARK_VIEWS = 64;
+const unsigned int MESHLET_BENCHMARK_REPEATS = 100;
+const float        MESHLET_BENCHMARK_DISTANCE = 2.0f; // Camera distance from the mesh centre, in bounding radii
+
+// Texture decode benchmark: block compressed textures to decode in software (cooked ones are skipped if the cooker
+// hasn't been run) and the number of texels to fetch one at a time through a block cache, as a rasterizer would
+const char* DECODE_BENCHMARK_TEXTURES[] = { "Skybox.dds", "Cooked/brick1.dds", "Cooked/PatternDiffuseSpecular.dds",
+                                            "Cooked/PatternNormal.dds", "Cooked/CobbleNormalHeight.dds" };
+const unsigned int DECODE_BENCHMARK_FETCHES = 4 * 1024 * 1024;
+
+// Particle benchmark: size of the pool, filled and then updated, sorted and expanded to quads for a number of frames
+const unsigned int PARTICLE_BENCHMARK_PARTICLES = 1024 * 1024;
+const unsigned int PARTICLE_BENCHMARK_FRAMES = 20;
+
+// Scene BVH benchmark: numbers of boxes scattered through a cube of the given size, and the share moved before a refit
+const unsigned int BVH_BENCHMARK_SIZES[] = { 1000, 10000, 100000 };
+const float        BVH_BENCHMARK_SPREAD = 2000;
+const unsigned int BVH_BENCHMARK_QUERIES = 20;
+const unsigned int BVH_BENCHMARK_MOVE_EVERY = 10;
+
+// Objects per job when updating, culling and queueing objects on the worker threads
+const unsigned int SCENE_JOB_BATCH_SIZE = 16;
+
+// Job system benchmark: bike models scattered over a square of the given size, animated, posed, culled and queued for
+// a number of frames with each number of threads (up to the number the machine has)
+const unsigned int JOB_BENCHMARK_MODELS = 4096;
+const float        JOB_BENCHMARK_SPREAD = 2000;
+const unsigned int JOB_BENCHMARK_FRAMES = 20;
+const unsigned int JOB_BENCHMARK_THREADS[] = { 1, 2, 4, 8, 16, 32 };
+
+// Picking benchmark: rays are cast from the main camera through a grid of this many points across each side of
+// the troll's bounding sphere
+const unsigned int PICKING_BENCHMARK_GRID = 32;
+
+// DDS textures with mip chains stream their mips within this budget, as the main camera needs them (see TextureStreamer.h)
+D3DStreamingDevice* gStreamingDevice = nullptr;
+const size_t TEXTURE_STREAMING_BUDGET = 4 * 1024 * 1024;
+
+// Camera path recorded to replay texture streaming over. Press '9' to start recording and again to stop and replay
+struct CameraPathKey
+{
+    CVector3 position;
+    CVector3 rotation;
+};
+std::vector<CameraPathKey> gCameraPath;
+bool gRecordingCameraPath = false;
+
 
 //--------------------------------------------------------------------------------------
 // Constant Buffers
@@ -85,6 +252,78 @@ ID3D11Buffer*     gPerFrameConstantBuffer; // The GPU buffer that will recieve t
 PerModelConstants gPerModelConstants;     
 ID3D11Buffer*     gPerModelConstantBuffer;
 
+PerBoneConstants gPerBoneConstants;
+ID3D11Buffer*    gPerBoneConstantBuffer;
+
+PerProbeConstants gPerProbeConstants = {};
+ID3D11Buffer*     gPerProbeConstantBuffer;
+
+
+//--------------------------------------------------------------------------------------
+// Scene BVH
+//--------------------------------------------------------------------------------------
+
+// Box around an object's bounding sphere in world space, for the scene BVH
+BoundingBox WorldBounds(SceneObject* object)
+{
+    CVector3 centre;
+    float radius;
+    object->ObjectModel()->BoundingSphere(centre, radius);
+    return { { centre.x - radius, centre.y - radius, centre.z - radius }, { centre.x + radius, centre.y + radius, centre.z + radius } };
+}
+
+
+// Move the objects that have moved in the scene BVH and refit it, rebuilding it if it has become much less efficient.
+// Call once per frame after the objects have been updated
+void UpdateSceneBVH()
+{
+    // Find the bounds on the worker threads, which also builds the root matrices of models whose transforms changed
+    uint32_t numObjects = static_cast<uint32_t>(gSceneBVHObjects.size());
+    gSceneBVHNewBounds.resize(numObjects);
+    ParallelFor(numObjects, SCENE_JOB_BATCH_SIZE, [](unsigned int start, unsigned int end)
+    {
+        for (uint32_t i = start; i < end; ++i)
+        {
+            if (gSceneBVHItems[i] != DynamicBVH::NO_ITEM)  gSceneBVHNewBounds[i] = WorldBounds(gSceneBVHObjects[i]);
+        }
+    });
+
+    for (uint32_t i = 0; i < numObjects; ++i)
+    {
+        if (gSceneBVHItems[i] == DynamicBVH::NO_ITEM)  continue;
+        const BoundingBox& bounds = gSceneBVHNewBounds[i];
+        BoundingBox& previous = gSceneBVHBounds[i];
+        if (bounds.minBounds.x == previous.minBounds.x && bounds.minBounds.y == previous.minBounds.y &&
+            bounds.minBounds.z == previous.minBounds.z && bounds.maxBounds.x == previous.maxBounds.x &&
+            bounds.maxBounds.y == previous.maxBounds.y && bounds.maxBounds.z == previous.maxBounds.z)  continue;
+        previous = bounds;
+        gSceneBVH.Move(gSceneBVHItems[i], bounds);
+    }
+    gSceneBVH.Refit();
+
+    if (gSceneBVH.SAHCost() > gSceneBVHRebuildCost * SCENE_BVH_REBUILD_RATIO)
+    {
+        gSceneBVH.Rebuild();
+        gSceneBVHRebuildCost = gSceneBVH.SAHCost();
+    }
+}
+
+
+// Nearest object hit by a ray, testing the triangles of the objects whose boxes the scene BVH finds along it, nearest
+// first. Returns nullptr if nothing is hit within maxDistance, otherwise sets distance to the hit. Lights can't be
+// picked, nor can shells drawn with front faces culled (the skybox and the troll's outline)
+SceneObject* PickObject(const CVector3& origin, const CVector3& direction, float maxDistance, float& distance)
+{
+    auto ObjectHit = [&](uint32_t i, float maxDistance)
+    {
+        if (i >= gObjects.size() || gSceneBVHObjects[i]->RasterizerState() == gCullFrontState)  return maxDistance;
+        return gSceneBVHObjects[i]->ObjectModel()->RayCast(origin, direction, maxDistance);
+    };
+    uint32_t hit = 0;
+    distance = gSceneBVH.RayCast(origin, direction, maxDistance, ObjectHit, hit);
+    return distance < maxDistance ? gSceneBVHObjects[hit] : nullptr;
+}
+
 
 //--------------------------------------------------------------------------------------
 // Initialise scene geometry, constant buffers and states
@@ -94,8 +333,23 @@ ID3D11Buffer*     gPerModelConstantBuffer;
 // Returns true on success
 bool InitGeometry()
 {
+	gStartupTimer.Reset();
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 	
+    // Load the shaders required for the geometry we will use (see Shader.cpp / .h). Done before the meshes as their
+    // vertex layouts are created with signatures from the shader pack (see InputLayout.h)
+    if (!LoadShaders())
+    {
+        gLastError = "Error loading shaders";
+        return false;
+    }
+
+    // Only the lighting shader permutations this scene uses are loaded
+    if (!LoadShaderPermutations("ShaderPermutations.txt"))
+    {
+        return false;
+    }
+
     // Load mesh geometry data
     try 
     {
@@ -115,20 +369,38 @@ bool InitGeometry()
         return false;
     }
 
-
-    // Load the shaders required for the geometry we will use (see Shader.cpp / .h)
-    if (!LoadShaders())
+    // None of the meshes come with animations, so build a clip spinning the bike's wheels (nodes Frame_front and
+    // Frame_rear) once per second about their X axes
+    AnimationClip wheelSpin;
+    wheelSpin.name = "WheelSpin";
+    wheelSpin.duration = 1.0f;
+    for (auto nodeName : { "Frame_front", "Frame_rear" })
     {
-        gLastError = "Error loading shaders";
-        return false;
+        unsigned int node = gMeshes[7]->FindNode(nodeName);
+        if (node == gMeshes[7]->NumberNodes())  continue;
+
+        AnimationTrack track;
+        track.node = node;
+        for (unsigned int k = 0; k <= WHEEL_SPIN_KEYS; ++k)
+        {
+            float time = static_cast<float>(k) / WHEEL_SPIN_KEYS;
+            CMatrix4x4 matrix = MatrixRotationX(time * 2 * PI) * gMeshes[7]->GetNodeDefaultMatrix(node);
+            track.rotationKeys.push_back({ time, TransformFromMatrix(matrix).rotation });
+        }
+        wheelSpin.tracks.push_back(track);
     }
+    if (!wheelSpin.tracks.empty())  gMeshes[7]->AddAnimation(wheelSpin);
+
 
 
     // Create GPU-side constant buffers to receive the gPerFrameConstants and gPerModelConstants structures above
     // These allow us to pass data from CPU to shaders such as lighting information or matrices
     gPerFrameConstantBuffer = CreateConstantBuffer(sizeof(gPerFrameConstants));
     gPerModelConstantBuffer = CreateConstantBuffer(sizeof(gPerModelConstants));
-    if (gPerFrameConstantBuffer == nullptr || gPerModelConstantBuffer == nullptr)
+    gPerBoneConstantBuffer  = CreateConstantBuffer(sizeof(gPerBoneConstants));
+    gPerProbeConstantBuffer = CreateConstantBuffer(sizeof(gPerProbeConstants));
+    if (gPerFrameConstantBuffer == nullptr || gPerModelConstantBuffer == nullptr || gPerBoneConstantBuffer == nullptr ||
+        gPerProbeConstantBuffer == nullptr)
     {
         gLastError = "Error creating constant buffers";
         return false;
@@ -150,6 +422,19 @@ bool InitGeometry()
 // Returns true on success
 bool InitScene()
 {
+	// Lighting shader permutations used, all must be in ShaderPermutations.txt
+	ID3D11PixelShader* pixelLightingShader   = LightingPixelShader(ShaderNumLights(2));
+	ID3D11PixelShader* normalMappingShader   = LightingPixelShader(SHADER_NORMAL_MAP   | ShaderNumLights(2));
+	ID3D11PixelShader* parallaxMappingShader = LightingPixelShader(SHADER_PARALLAX     | ShaderNumLights(2));
+	ID3D11PixelShader* alphaTestShader       = LightingPixelShader(SHADER_ALPHA_TEST   | ShaderNumLights(2));
+	ID3D11PixelShader* reflectionShader      = LightingPixelShader(SHADER_REFLECTION   | ShaderNumLights(2));
+	ID3D11PixelShader* cellShadingShader     = LightingPixelShader(SHADER_CELL_SHADING | ShaderNumLights(2));
+	if (pixelLightingShader == nullptr || normalMappingShader == nullptr || parallaxMappingShader == nullptr ||
+	    alphaTestShader     == nullptr || reflectionShader    == nullptr || cellShadingShader     == nullptr)
+	{
+		return false; // gLastError is set by LightingPixelShader
+	}
+
 	//// Set up models ////
 	//Cubes
 	gObjects.push_back(new SceneObject(new Model(gMeshes[2]), new Texture("brick1.jpg"), gPixelLightingVertexShader,
@@ -159,12 +444,12 @@ bool InitScene()
 	gObjects.back()->ObjectModel()->SetPosition({ 50.0f, 10.0f, -40.0f });
 
 	gObjects.push_back(new SceneObject(new Model(gMeshes[2]), new Texture("StoneDiffuseSpecular.dds"),
-	                                   gPixelLightingVertexShader, gPixelLightingPixelShader, gNoBlendingState,
+	                                   gPixelLightingVertexShader, pixelLightingShader, gNoBlendingState,
 	                                   gCullBackState, gUseDepthBufferState, gAnisotropic4xSampler, false));
 	gObjects.back()->ObjectModel()->SetPosition({ -10.0f, 30.0f, 40.0f });
 
 	gObjects.push_back(new SceneObject(new Model(gMeshes[5]), new Texture("PatternDiffuseSpecular.dds"),
-	                                   gNormalMappingVertexShader, gNormalMappingPixelShader, gNoBlendingState,
+	                                   gNormalMappingVertexShader, normalMappingShader, gNoBlendingState,
 	                                   gCullBackState, gUseDepthBufferState, gAnisotropic4xSampler, true));
 	gObjects.back()->AddTexture(new Texture("PatternNormal.dds"));
 	gObjects.back()->ObjectModel()->SetPosition({ 50.0f, 10.0f,40.0f });
@@ -173,7 +458,7 @@ bool InitScene()
 
 	//Decals
 	gObjects.push_back(new SceneObject(new Model(gMeshes[6]), new Texture("Moogle.png"), gPixelLightingVertexShader,
-	                                   gTextureAlphaPixelShader, gMultiplicativeBlendingState, gCullBackState,
+	                                   alphaTestShader, gMultiplicativeBlendingState, gCullBackState,
 	                                   gUseDepthBufferState, gAnisotropic4xSampler, false));
 	gObjects.back()->ObjectModel()->SetPosition({ -10.0f, 30.0f, 39.9f });
 
@@ -185,7 +470,7 @@ bool InitScene()
 
 	//Teapot
 	gObjects.push_back(new SceneObject(new Model(gMeshes[0]), new Texture("MetalDiffuseSpecular.dds"),
-	                                   gPixelLightingVertexShader, gPixelLightingPixelShader, gNoBlendingState,
+	                                   gPixelLightingVertexShader, pixelLightingShader, gNoBlendingState,
 	                                   gCullBackState, gUseDepthBufferState, gAnisotropic4xSampler, true));
 	gObjects.back()->ObjectModel()->SetPosition({ 20.0f, 0.0f, 0.0f });
 	gObjects.back()->ObjectModel()->SetScale(1.5f);
@@ -198,15 +483,18 @@ bool InitScene()
 
 	//Ground
 	gObjects.push_back(new SceneObject(new Model(gMeshes[3]), new Texture("CobbleDiffuseSpecular.dds"),
-	                                   gNormalMappingVertexShader, gParallaxMappingPixelShader, gNoBlendingState,
+	                                   gNormalMappingVertexShader, parallaxMappingShader, gNoBlendingState,
 	                                   gCullBackState, gUseDepthBufferState, gAnisotropic4xSampler, false));
 	gObjects.back()->AddTexture(new Texture("CobbleNormalHeight.dds"));
 
 	//Bike
 	gObjects.push_back(new SceneObject(new Model(gMeshes[7]), new Texture("Skybox.dds"),
-		gReflectionVertexShader, gReflectionPixelShader, gNoBlendingState,
+		gReflectionVertexShader, reflectionShader, gNoBlendingState,
 		gCullBackState, gUseDepthBufferState, gAnisotropic4xSampler, true));
 	gObjects.back()->ObjectModel()->SetPosition({ -10.0f, 30.0f, -20.0f });
+	gObjects.back()->ObjectModel()->SetAnimationSpeed(0); // Wheels still until T / G pressed
+	gObjects.back()->ObjectModel()->UseTransforms(true);  // Animation writes transforms, matrices built when rendered
+	gBike = gObjects.back();
 
 	//Troll outline
 	gObjects.push_back(new SceneObject(new Model(gMeshes[8]), new Texture("Green.png"),
@@ -218,29 +506,20 @@ bool InitScene()
 
 	//Troll
 	gObjects.push_back(new SceneObject(new Model(gMeshes[8]), new Texture("Green.png"),
-		gPixelLightingVertexShader, gCellShadingPixelShader, gNoBlendingState,
+		gPixelLightingVertexShader, cellShadingShader, gNoBlendingState,
 		gCullBackState, gUseDepthBufferState, gAnisotropic4xSampler, true));
 	gObjects.back()->AddTexture(new Texture("CellGradient.png"));
 	gObjects.back()->ObjectModel()->SetPosition({ 60.0f, 0.0f, 0.0f });
 	gObjects.back()->ObjectModel()->SetRotation({ 0.0f, -90.0f, 0.0f });
 	gObjects.back()->ObjectModel()->SetScale(7.0f);
+	gTroll = gObjects.back();
 	
 	//Skybox
 	gObjects.push_back(new SceneObject(new Model(gMeshes[2]), new Texture("Skybox.dds"),
 		gSkyboxVertexShader, gSkyboxPixelShader, gNoBlendingState,
 		gCullFrontState, gSkyboxDepthBufferState, gTrilinearSampler, false));
 	gObjects.back()->ObjectModel()->SetScale(25.0f);
-	
-	for (auto object : gObjects)
-	{
-		for (auto texture : object->Textures())
-		{
-			if (!texture->Load())
-			{
-				return false;
-			}
-		}
-	}
+	gObjects.back()->SetAlwaysVisible(true); // Centred on whichever camera is rendering (see Skybox_vs.hlsl)
 	
 	//Light set up
 	for (int i = 0 ; i < NUM_LIGHTS; i++)
@@ -253,6 +532,35 @@ bool InitScene()
 	gLights[1]->ObjectModel()->SetRotation({ 0.0f, 1.7f, 0.0f });
 	gLights[1]->SetStrength(gLights[1]->Strength() * 3);
 
+	// Lights are moved and scaled every frame, keep transforms so their matrices are only rebuilt once per frame
+	for (auto light : gLights)  light->ObjectModel()->UseTransforms(true);
+
+	// Decals and light flares share atlases so runs of them draw without changing texture, and skip loading below
+	std::vector<SceneObject*> atlasObjects = { gObjects[3], gObjects[4] };
+	atlasObjects.insert(atlasObjects.end(), gLights.begin(), gLights.end());
+	if (!BuildTextureAtlases(atlasObjects, gAtlasStats))
+	{
+		return false;
+	}
+
+	// Streamed textures only load their smallest mips here, the rest follow as the camera needs them
+	gStreamingDevice = new D3DStreamingDevice;
+	StreamingSettings streamingSettings;
+	streamingSettings.budget = TEXTURE_STREAMING_BUDGET;
+	gTextureStreamer = new TextureStreamer(gStreamingDevice, streamingSettings);
+
+	for (auto object : gObjects)
+	{
+		for (auto texture : object->Textures())
+		{
+			if (!texture->Load())
+			{
+				return false;
+			}
+			WatchTexture(texture);
+		}
+	}
+	
 	for (auto light : gLights)
 	{
 		light->ObjectModel()->SetScale(pow(light->Strength(), 0.7f)); // Convert light strength into a nice value for the scale of the light
@@ -263,14 +571,124 @@ bool InitScene()
 			{
 				return false;
 			}
+			WatchTexture(texture);
 		}
 	}
-	
+
+	//// Particles ////
+	ParticleSettings smoke;
+	smoke.maxParticles = 2000;
+	smoke.spawnRate = 150;
+	smoke.spawnRadius = 2;
+	smoke.minLife = 6;
+	smoke.maxLife = 10;
+	smoke.velocity = { 0, 6, 0 };
+	smoke.velocitySpread = { 1.5f, 1, 1.5f };
+	smoke.gravity = { 1.5f, 0.5f, 0 }; // A light wind, and rising as it is warm
+	smoke.drag = 0.2f;
+	smoke.startSize = 4;
+	smoke.endSize = 20;
+	smoke.startColour = { 0.8f, 0.8f, 0.8f, 0.6f };
+	smoke.endColour = { 0.5f, 0.5f, 0.5f, 0 };
+
+	ParticleSettings sparks;
+	sparks.maxParticles = 1000;
+	sparks.spawnRate = 200;
+	sparks.minLife = 0.8f;
+	sparks.maxLife = 1.6f;
+	sparks.velocity = { 0, 8, 0 };
+	sparks.velocitySpread = { 6, 4, 6 };
+	sparks.gravity = { 0, -15, 0 };
+	sparks.drag = 0.1f;
+	sparks.startSize = 1.5f;
+	sparks.endSize = 0.3f;
+	sparks.startColour = { 1.0f, 0.9f, 0.6f, 1 };
+	sparks.endColour = { 0.3f, 0.05f, 0, 0 }; // Additive, so fading to black
+
+	try
+	{
+		gParticleEmitters.push_back(new ParticleEmitter(smoke, new Texture("Smoke.png"), gAlphaBlendingState));
+		gParticleEmitters.back()->Particles().SetPosition(SMOKE_POSITION);
+		gParticleEmitters.push_back(new ParticleEmitter(sparks, new Texture("Flare.jpg"), gAdditiveBlendingState));
+	}
+	catch (std::runtime_error e)
+	{
+		gLastError = e.what();
+		return false;
+	}
+	for (auto emitter : gParticleEmitters)
+	{
+		if (!emitter->ParticleTexture()->Load())
+		{
+			return false;
+		}
+		WatchTexture(emitter->ParticleTexture());
+	}
+
     //// Set up camera ////
     gCamera = new Camera();
     gCamera->SetPosition({ 15, 50,-120 });
     gCamera->SetRotation({ ToRadians(13), 0, 0 });
+    gCamera->SetReverseZ(true); // Better depth precision across the large hills mesh
+
+    gOverheadCamera = new Camera();
+    gOverheadCamera->SetPosition({ 20, 250, -150 });
+    gOverheadCamera->SetRotation({ ToRadians(55), 0, 0 });
+    gOverheadCamera->SetReverseZ(true);
+
+    // Reflection probes for the chrome bike: at its starting point, between the teapot and trolls, and near the sphere
+    try
+    {
+        gReflectionProbes = new ReflectionProbes(NUM_REFLECTION_PROBES);
+        gPointShadowMap = new ShadowMap(ShadowMap::Type::Point, POINT_SHADOW_MAP_SIZE, POINT_SHADOW_TEXTURE_SLOT);
+        gSpotShadowMap  = new ShadowMap(ShadowMap::Type::Spot,  SPOT_SHADOW_MAP_SIZE,  SPOT_SHADOW_TEXTURE_SLOT);
+
+        CascadeSettings sunSettings;
+        sunSettings.numCascades = NUM_SUN_CASCADES;
+        sunSettings.splitLambda = SUN_SPLIT_LAMBDA;
+        sunSettings.shadowDistance = SUN_SHADOW_DISTANCE;
+        sunSettings.resolution = SUN_SHADOW_MAP_SIZE;
+        gSunShadowMap = new CascadedShadowMap(sunSettings);
+
+        gWeightedOIT = new WeightedOIT(gViewportWidth, gViewportHeight);
+    }
+    catch (std::runtime_error e)
+    {
+        gLastError = e.what();
+        return false;
+    }
+    gReflectionProbes->AddProbe({ -10, 30, -20 }, 60);
+    gReflectionProbes->AddProbe({  40, 20,   0 }, 60);
+    gReflectionProbes->AddProbe({  15, 20,  50 }, 60);
+    gReflectionProbes->SetFacesPerFrame(REFLECTION_PROBE_FACES_PER_FRAME);
+
+    // The scene BVH holds all the objects and lights that are culled
+    gSceneBVHObjects.assign(gObjects.begin(), gObjects.end());
+    gSceneBVHObjects.insert(gSceneBVHObjects.end(), gLights.begin(), gLights.end());
+    for (uint32_t i = 0; i < gSceneBVHObjects.size(); ++i)
+    {
+        BoundingBox bounds = WorldBounds(gSceneBVHObjects[i]);
+        gSceneBVHBounds.push_back(bounds);
+        gSceneBVHItems.push_back(gSceneBVHObjects[i]->IsAlwaysVisible() ? DynamicBVH::NO_ITEM : gSceneBVH.Insert(bounds, i));
+    }
+    gSceneBVH.Rebuild();
+    gSceneBVHRebuildCost = gSceneBVH.SAHCost();
+
+    // Opaque objects cast shadows. Blended objects (decals) and those drawn inside out (skybox, outlines) don't
+    for (auto object : gObjects)
+    {
+        if (object->BlendState() == gNoBlendingState && object->RasterizerState() == gCullBackState &&
+            !object->IsAlwaysVisible())
+        {
+            gShadowCasters.push_back(object);
+        }
+    }
+
+    // Shaders, textures and meshes are reloaded when their files change. Not needed to run, so a failure is only reported
+    for (auto mesh : gMeshes)  WatchMesh(mesh);
+    if (!InitHotReload())  gHotReloadResult = ", Hot reload off: " + gLastError;
 
+    gStartupTime = gStartupTimer.GetTime();
     return true;
 }
 
@@ -278,8 +696,15 @@ bool InitScene()
 // Release the geometry and scene resources created above
 void ReleaseResources()
 {
+    ShutdownHotReload();
+    delete gTextureStreamer;  gTextureStreamer = nullptr; // Stops streaming before the textures are deleted
+    delete gStreamingDevice;  gStreamingDevice = nullptr;
+    ReleasePipelineStates();
+    ReleaseInputLayouts();
     ReleaseStates();
 
+    if (gPerBoneConstantBuffer)   gPerBoneConstantBuffer->Release();
+    if (gPerProbeConstantBuffer)  gPerProbeConstantBuffer->Release();
     if (gPerModelConstantBuffer)  gPerModelConstantBuffer->Release();
     if (gPerFrameConstantBuffer)  gPerFrameConstantBuffer->Release();
 
@@ -295,7 +720,21 @@ void ReleaseResources()
 		delete object;	object = nullptr;
 	}
 
+	for (auto emitter : gParticleEmitters)  delete emitter;
+	gParticleEmitters.clear();
+
 	delete gCamera;			 gCamera		  = nullptr;
+	delete gOverheadCamera;  gOverheadCamera  = nullptr;
+	delete gReflectionProbes; gReflectionProbes = nullptr;
+	delete gPointShadowMap;   gPointShadowMap   = nullptr;
+	delete gSpotShadowMap;    gSpotShadowMap    = nullptr;
+	delete gSunShadowMap;     gSunShadowMap     = nullptr;
+	delete gWeightedOIT;      gWeightedOIT      = nullptr;
+	gSceneBVH.Clear();
+	gSceneBVHObjects.clear();
+	gSceneBVHItems.clear();
+	gSceneBVHBounds.clear();
+	gShadowCasters.clear();
 
     for (auto mesh : gMeshes)
     {
@@ -309,30 +748,186 @@ void ReleaseResources()
 // Scene Rendering
 //--------------------------------------------------------------------------------------
 
-// Render everything in the scene from the given camera
-void RenderSceneFromCamera(Camera* camera)
+// An object to draw this frame, with a bit set for each view that may see it. Objects that blend with what is behind
+// them are drawn after the rest, sorted by the distance of their centre
+struct RenderQueueEntry
 {
-    // Set camera matrices in the constant buffer and send over to GPU
-    gPerFrameConstants.viewMatrix           = camera->ViewMatrix();
-    gPerFrameConstants.projectionMatrix     = camera->ProjectionMatrix();
-    gPerFrameConstants.viewProjectionMatrix = camera->ViewProjectionMatrix();
-    UpdateConstantBuffer(gPerFrameConstantBuffer, gPerFrameConstants);
-
-    // Indicate that the constant buffer we just updated is for use in the vertex shader (VS) and pixel shader (PS)
-    gD3DContext->VSSetConstantBuffers(0, 1, &gPerFrameConstantBuffer);
-    gD3DContext->PSSetConstantBuffers(0, 1, &gPerFrameConstantBuffer);
+    SceneObject* object;
+    Light*       light; // Set if the object is a light, which needs its colour sending to the GPU
+    uint32_t     viewMask;
+    bool         transparent;
+    CVector3     centre;
+};
+std::vector<RenderQueueEntry> gRenderQueue; // Kept between frames to reuse the memory
+
+// Views that may see each object in the scene BVH, and the objects found in each view. Kept to reuse the memory
+std::vector<uint32_t> gSceneViewMasks;
+std::vector<uint32_t> gSceneVisible[MAX_VIEWS];
+
+// Sort keys and draw order of the transparent objects and particle emitters in a view. Values below the size of the
+// queue are queue entries, the rest are emitters. Kept between frames to reuse the memory
+std::vector<uint32_t> gTransparentKeys, gTransparentOrder, gTransparentKeysTemp, gTransparentOrderTemp;
+
+unsigned int gTransparentsDrawn = 0;
+float gTransparentSortTime = 0;
+
+
+// Render the scene to several views. Visibility is found from the scene BVH and levels of detail chosen (from the
+// first view) in a single pass over the scene, as jobs on the worker threads, then each view draws the objects marked visible to it: opaque objects first, then
+// transparent objects and particles from back to front
+void RenderSceneFromCameras(const SceneView* views, unsigned int numViews)
+{
+    numViews = std::min(numViews, MAX_VIEWS);
+    if (numViews == 0)  return;
+
+    //// Visibility ////
+    CFrustum frustums[MAX_VIEWS];
+    for (unsigned int v = 0; v < numViews; ++v)  frustums[v] = CFrustum(views[v].camera->ViewProjectionMatrix());
+    uint32_t allViews = (numViews == 32) ? ~0u : (1u << numViews) - 1;
+
+    // Jobs on the worker threads, each waiting for the one before: every view's frustum finds the objects it may see
+    // in the scene BVH, then the views are gathered into a mask for each object, then the objects are queued
+    JobCounter viewsCulled, masksMerged, queueBuilt;
+    for (unsigned int v = 0; v < numViews; ++v)
+    {
+        RunJob([&frustums, v]() { gSceneBVH.QueryFrustum(frustums[v], gSceneVisible[v]); }, &viewsCulled);
+    }
 
-	gD3DContext->PSSetSamplers(1, 1, &gPointSampler);
-	for (auto object : gObjects)
-	{
-		object->Render();
-	}
-	
-    for (auto light : gLights)
+    RunJob([allViews, numViews]()
     {
-		gPerModelConstants.objectColour = light->Colour();
-		light->Render();
+        gSceneViewMasks.assign(gSceneBVHObjects.size(), 0);
+        for (uint32_t i = 0; i < gSceneBVHObjects.size(); ++i)
+        {
+            if (gSceneBVHItems[i] == DynamicBVH::NO_ITEM)  gSceneViewMasks[i] = allViews;
+        }
+        for (unsigned int v = 0; v < numViews; ++v)
+        {
+            for (auto i : gSceneVisible[v])  gSceneViewMasks[i] |= 1u << v;
+        }
+    }, &masksMerged, &viewsCulled);
+
+    // Queue the objects then the lights, in the order they were created. Objects that no view sees are left in the
+    // queue with no views, so they are skipped when drawing
+    CVector3 lodPosition = views[0].camera->Position();
+    float lodFOV = views[0].camera->FOV();
+    gRenderQueue.resize(gSceneBVHObjects.size());
+    ParallelJobs(static_cast<unsigned int>(gSceneBVHObjects.size()), SCENE_JOB_BATCH_SIZE,
+                 [lodPosition, lodFOV](unsigned int start, unsigned int end)
+    {
+        for (uint32_t i = start; i < end; ++i)
+        {
+            SceneObject* object = gSceneBVHObjects[i];
+            uint32_t viewMask = gSceneViewMasks[i];
+            CVector3 centre = { 0, 0, 0 };
+            if (viewMask != 0)
+            {
+                Model* model = object->ObjectModel();
+                float radius;
+                model->BoundingSphere(centre, radius);
+                model->SelectLOD(lodPosition, lodFOV);
+            }
+            Light* light = (i >= gObjects.size()) ? gLights[i - gObjects.size()] : nullptr;
+            bool transparent = (object->BlendState() != gNoBlendingState);
+            gRenderQueue[i] = { object, light, viewMask, transparent, centre };
+        }
+    }, queueBuilt, &masksMerged);
+    WaitForJobs(queueBuilt);
+
+
+    //// Draw each view ////
+    for (unsigned int v = 0; v < numViews; ++v)
+    {
+        auto& view = views[v];
+        Camera* camera = view.camera;
+
+        gD3DContext->OMSetRenderTargets(1, &view.renderTarget, view.depthStencil);
+        if (view.clearColour)  gD3DContext->ClearRenderTargetView(view.renderTarget, &gBackgroundColor.r);
+        if (view.clearDepth)   gD3DContext->ClearDepthStencilView(view.depthStencil, D3D11_CLEAR_DEPTH, camera->FarDepth(), 0);
+        gD3DContext->RSSetViewports(1, &view.viewport);
+
+        // Set camera matrices in the constant buffer and send over to GPU
+        gPerFrameConstants.viewMatrix           = camera->ViewMatrix();
+        gPerFrameConstants.projectionMatrix     = camera->ProjectionMatrix();
+        gPerFrameConstants.viewProjectionMatrix = camera->ViewProjectionMatrix();
+        gPerFrameConstants.cameraPosition       = camera->Position();
+        gPerFrameConstants.farDepth             = camera->FarDepth();
+        UpdateConstantBuffer(gPerFrameConstantBuffer, gPerFrameConstants);
+
+        // Objects pick the depth states matching the camera's projection
+        gReverseDepth = camera->ReverseZ();
+
+        // Indicate that the constant buffer we just updated is for use in the vertex shader (VS) and pixel shader (PS)
+        gD3DContext->VSSetConstantBuffers(0, 1, &gPerFrameConstantBuffer);
+        gD3DContext->PSSetConstantBuffers(0, 1, &gPerFrameConstantBuffer);
+
+        gD3DContext->PSSetSamplers(1, 1, &gPointSampler);
+        uint32_t viewBit = 1u << v;
+        auto DrawEntry = [&](const RenderQueueEntry& entry)
+        {
+            if (entry.light)  gPerModelConstants.objectColour = entry.light->Colour();
+            entry.object->Render();
+            ++gObjectsDrawn;
+        };
+
+        // Opaque objects in any order, they write depth so hide each other correctly
+        for (auto& entry : gRenderQueue)
+        {
+            if (entry.transparent || !(entry.viewMask & viewBit) || entry.object == view.hiddenObject)  continue;
+            DrawEntry(entry);
+        }
+
+        // Transparent objects, and particle emitters in the views that draw them, from back to front by the distance of
+        // their centre along the view direction. Each emitter also sorts its own particles if it needs to. Particles
+        // drawn with weighted blended transparency don't need sorting so are left for the pass after
+        auto sortStart = std::chrono::high_resolution_clock::now();
+        CVector3 cameraPosition = camera->Position();
+        CVector3 cameraFacing = camera->WorldMatrix().GetZAxis();
+        gTransparentKeys.clear();
+        gTransparentOrder.clear();
+        for (uint32_t i = 0; i < gRenderQueue.size(); ++i)
+        {
+            auto& entry = gRenderQueue[i];
+            if (!entry.transparent || !(entry.viewMask & viewBit) || entry.object == view.hiddenObject)  continue;
+            gTransparentKeys.push_back(DescendingFloatKey(Dot(entry.centre - cameraPosition, cameraFacing)));
+            gTransparentOrder.push_back(i);
+        }
+        bool weightedOIT = view.drawParticles && gUseWeightedOIT;
+        if (view.drawParticles)
+        {
+            for (uint32_t i = 0; i < gParticleEmitters.size(); ++i)
+            {
+                if (weightedOIT && gParticleEmitters[i]->IsAlphaBlended())  continue;
+                CVector3 emitterPosition = gParticleEmitters[i]->Particles().Position();
+                gTransparentKeys.push_back(DescendingFloatKey(Dot(emitterPosition - cameraPosition, cameraFacing)));
+                gTransparentOrder.push_back(static_cast<uint32_t>(gRenderQueue.size()) + i);
+            }
+        }
+        unsigned int numTransparent = static_cast<unsigned int>(gTransparentKeys.size());
+        gTransparentKeysTemp.resize(numTransparent);
+        gTransparentOrderTemp.resize(numTransparent);
+        RadixSort(gTransparentKeys, gTransparentOrder, gTransparentKeysTemp, gTransparentOrderTemp, numTransparent);
+        gTransparentSortTime += std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - sortStart).count();
+
+        for (unsigned int t = 0; t < numTransparent; ++t)
+        {
+            uint32_t index = gTransparentOrder[t];
+            if (index < gRenderQueue.size())  DrawEntry(gRenderQueue[index]);
+            else                              gParticleEmitters[index - gRenderQueue.size()]->Render(camera);
+        }
+        gTransparentsDrawn += numTransparent;
+
+        // Alpha blended particles in any order into the weighted blended targets, then blended over the view
+        if (weightedOIT)
+        {
+            gWeightedOIT->Begin(view.depthStencil);
+            for (auto emitter : gParticleEmitters)
+            {
+                if (emitter->IsAlphaBlended())  emitter->Render(camera, true);
+            }
+            gWeightedOIT->Composite(view.renderTarget, view.depthStencil);
+        }
     }
+    gViewsRendered += numViews;
 }
 
 
@@ -344,7 +939,7 @@ void RenderScene()
     //// Common settings ////
 
     // Set up the light information in the constant buffer
-    // Don't send to the GPU yet, the function RenderSceneFromCamera will do that
+    // Don't send to the GPU yet, the function RenderSceneFromCameras will do that
     gPerFrameConstants.light1Colour   = gLights[0]->Colour() * gLights[0]->Strength();
     gPerFrameConstants.light1Position = gLights[0]->ObjectModel()->Position();
 	
@@ -355,31 +950,96 @@ void RenderScene()
 
     gPerFrameConstants.ambientColour  = gAmbientColour;
     gPerFrameConstants.specularPower  = gSpecularPower;
-    gPerFrameConstants.cameraPosition = gCamera->Position();
+
+    gTrianglesRendered = 0;
+    gMeshletStats = MeshletCullStats();
+    gMeshletCullTime = 0;
+    gSkinnedVertices = 0;
+    gSkinningTime = 0;
+    gViewsRendered = 0;
+    gObjectsDrawn = 0;
+    gPipelineStateBinds = 0;
+    gPipelineStateChanges = 0;
+    gTextureBinds = 0;
+    gTextureChanges = 0;
+    gParticlesDrawn = 0;
+    gParticleSortTime = 0;
+    gParticleQuadTime = 0;
+    gTransparentsDrawn = 0;
+    gTransparentSortTime = 0;
+
+    // Other code may have changed shaders and states since the last frame
+    InvalidatePipelineState();
+
+    // Objects have moved since the last frame, the views rendered below all cull against the BVH
+    UpdateSceneBVH();
+
+
+    //// Shadow maps ////
+    // Re-render the shadow maps where the lights or casters have moved, then select them for the lit pixel shaders
+    gPointShadowMap->SetLight(gLights[0]->ObjectModel()->Position(), POINT_SHADOW_RANGE);
+    gSpotShadowMap->SetLight(gLights[1]->ObjectModel()->Position(), SPOT_SHADOW_RANGE, gLights[1]->ObjectModel()->Rotation(),
+                             ToRadians(SPOTLIGHT_ANGLE));
+    gPointShadowMap->Update(gShadowCasters);
+    gSpotShadowMap->Update(gShadowCasters);
+
+    gPerFrameConstants.light2ShadowMatrix = gSpotShadowMap->ShadowMatrix();
+    gPointShadowMap->CubeDepthParameters(gPerFrameConstants.light1ShadowDepthScale, gPerFrameConstants.light1ShadowDepthOffset);
+    gPerFrameConstants.light1ShadowTexelSize = 2.0f / gPointShadowMap->Size(); // A face spans -1 to 1 at distance 1
+    gPointShadowMap->Bind();
+    gSpotShadowMap->Bind();
+
+    // The sun's cascades follow the main camera so are rendered every frame
+    gPerFrameConstants.sunDirection = Normalise(gSunDirection);
+    gPerFrameConstants.sunColour = gSunOn ? gSunColour : CVector3{ 0, 0, 0 };
+    if (gSunOn)
+    {
+        gSunShadowMap->Update(gCamera, gPerFrameConstants.sunDirection, gShadowCasters);
+        for (unsigned int cascade = 0; cascade < NUM_SUN_CASCADES; ++cascade)
+        {
+            gPerFrameConstants.sunCascadeMatrices[cascade] = gSunShadowMap->CascadeMatrix(cascade);
+        }
+    }
+    gSunShadowMap->Bind();
 
 
+    //// Reflection probes ////
+    // Render this frame's share of the probe faces, without the bike, which is the object that reflects them
+    std::vector<SceneObject*> watchedObjects(gObjects.begin(), gObjects.end());
+    watchedObjects.insert(watchedObjects.end(), gLights.begin(), gLights.end());
+    gReflectionProbes->Update(watchedObjects, gBike);
+    gReflectionProbes->Bind();
+
 
     //// Main scene rendering ////
-    // Set the back buffer as the target for rendering and select the main depth buffer.
-    // When finished the back buffer is sent to the "front buffer" - which is the monitor.
-    gD3DContext->OMSetRenderTargets(1, &gBackBufferRenderTarget, gDepthStencil);
-
-    // Clear the back buffer to a fixed colour and the depth buffer to the far distance
-    gD3DContext->ClearRenderTargetView(gBackBufferRenderTarget, &gBackgroundColor.r);
-    gD3DContext->ClearDepthStencilView(gDepthStencil, D3D11_CLEAR_DEPTH, 1.0f, 0);
-
-    // Setup the viewport to the size of the main window
-    D3D11_VIEWPORT vp;
-    vp.Width  = static_cast<FLOAT>(gViewportWidth);
-    vp.Height = static_cast<FLOAT>(gViewportHeight);
-    vp.MinDepth = 0.0f;
-    vp.MaxDepth = 1.0f;
-    vp.TopLeftX = 0;
-    vp.TopLeftY = 0;
-    gD3DContext->RSSetViewports(1, &vp);
-
-    // Render the scene from the main camera
-    RenderSceneFromCamera(gCamera);
+    // Render to the back buffer with the main depth buffer. When finished the back buffer is sent to the
+    // "front buffer" - which is the monitor. The main view covers the whole window, clearing the back buffer to
+    // a fixed colour and the depth buffer to the far distance
+    SceneView views[2];
+    views[0].camera = gCamera;
+    views[0].renderTarget = gBackBufferRenderTarget;
+    views[0].depthStencil = gDepthStencil;
+    views[0].viewport = { 0, 0, static_cast<FLOAT>(gViewportWidth), static_cast<FLOAT>(gViewportHeight), 0.0f, 1.0f };
+    views[0].clearColour = true;
+    views[0].drawParticles = true;
+    unsigned int numViews = 1;
+
+    // Picture-in-picture from the overhead camera in the top right corner, drawn after the main view so clearing
+    // the depth buffer doesn't affect it
+    if (gPictureInPicture)
+    {
+        float width  = gViewportWidth  * PICTURE_IN_PICTURE_SIZE;
+        float height = gViewportHeight * PICTURE_IN_PICTURE_SIZE;
+        gOverheadCamera->SetAspectRatio(width / height);
+
+        views[1] = views[0];
+        views[1].camera = gOverheadCamera;
+        views[1].viewport = { gViewportWidth - width, 0, width, height, 0.0f, 1.0f };
+        views[1].clearColour = false; // Can't clear part of the target, but the skybox covers the whole view anyway
+        ++numViews;
+    }
+
+    RenderSceneFromCameras(views, numViews);
 
     //// Scene completion ////
     // When drawing to the off-screen back buffer is complete, we "present" the image to the front buffer (the screen)
@@ -392,24 +1052,657 @@ void RenderScene()
 // Scene Update
 //--------------------------------------------------------------------------------------
 
+// Time sampling the bike's wheel spin clip into the node matrices of many bike models, on one thread and then on
+// all the worker threads. Stores the results and the clip memory use in gBenchmarkResult for the window title
+void AnimationBenchmark()
+{
+    std::vector<std::unique_ptr<Model>> bikes;
+    std::vector<Model*> models;
+    for (unsigned int i = 0; i < ANIMATION_BENCHMARK_MODELS; ++i)
+    {
+        bikes.emplace_back(new Model(gMeshes[7]));
+        bikes.back()->SetAnimationSpeed(1.0f + 0.001f * i); // Spread the models through the clip
+        models.push_back(bikes.back().get());
+    }
+    const float frameTime = 1.0f / 60.0f;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (unsigned int frame = 0; frame < ANIMATION_BENCHMARK_FRAMES; ++frame)
+    {
+        for (auto model : models)  model->UpdateAnimation(frameTime);
+    }
+    auto middle = std::chrono::high_resolution_clock::now();
+    for (unsigned int frame = 0; frame < ANIMATION_BENCHMARK_FRAMES; ++frame)
+    {
+        Model::UpdateAnimations(models.data(), static_cast<unsigned int>(models.size()), frameTime);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    // Throughput in millions of nodes posed per second
+    float nodes = static_cast<float>(ANIMATION_BENCHMARK_MODELS) * gMeshes[7]->NumberNodes() * ANIMATION_BENCHMARK_FRAMES;
+    float singleTime = std::chrono::duration<float>(middle - start).count();
+    float parallelTime = std::chrono::duration<float>(end - middle).count();
+
+    size_t rawBytes, compressedBytes;
+    gMeshes[7]->AnimationMemory(rawBytes, compressedBytes);
+
+    std::ostringstream result;
+    result.precision(2);
+    result << std::fixed << ", Animating " << ANIMATION_BENCHMARK_MODELS << " bikes: "
+           << singleTime * 1000 / ANIMATION_BENCHMARK_FRAMES << "ms/frame 1 thread ("
+           << nodes / singleTime / 1000000 << "M nodes/s), "
+           << parallelTime * 1000 / ANIMATION_BENCHMARK_FRAMES << "ms/frame " << ParallelForThreads() << " threads ("
+           << nodes / parallelTime / 1000000 << "M nodes/s), clips " << rawBytes << " -> " << compressedBytes << " bytes";
+    gBenchmarkResult = result.str();
+}
+
+
+// Time culling the meshlets of the troll and the teapot from cameras spread around them, with back face culling. Stores
+// the share of triangles culled and the throughput in millions of triangles tested per second in gBenchmarkResult
+void MeshletBenchmark()
+{
+    struct BenchmarkMesh { const char* name; Mesh* mesh; };
+    const BenchmarkMesh meshes[] = { { "Troll", gMeshes[8] }, { "Teapot", gMeshes[0] } };
+
+    std::ostringstream result;
+    result.precision(1);
+    result << std::fixed << ", Meshlet culling";
+    for (auto& benchmarkMesh : meshes)
+    {
+        Mesh* mesh = benchmarkMesh.mesh;
+        CVector3 centre = mesh->BoundingCentre();
+        float radius = mesh->BoundingRadius();
+
+        // Cameras on a spiral around the mesh (a Fibonacci sphere), facing its centre or to one side of it
+        std::vector<Camera> cameras;
+        for (unsigned int view = 0; view < MESHLET_BENCHMARK_VIEWS; ++view)
+        {
+            float y = 1.0f - 2.0f * (view + 0.5f) / MESHLET_BENCHMARK_VIEWS;
+            float ring = std::sqrt(1.0f - y * y);
+            float angle = view * 2.39996323f; // Golden angle
+            CVector3 offset = { std::cos(angle) * ring, y, std::sin(angle) * ring };
+            CVector3 position = centre + offset * (radius * MESHLET_BENCHMARK_DISTANCE);
+
+            CVector3 facing = Normalise(-offset);
+            if (view % 2 == 1)  facing = Normalise(facing + Normalise(Cross(facing, { 0, 1, 0 })) * 0.5f);
+            cameras.emplace_back(position, CVector3{ std::asin(-facing.y), std::atan2(facing.x, facing.z), 0.0f });
+        }
+
+        MeshletCullStats stats;
+        for (auto& camera : cameras)
+        {
+            mesh->CullAllMeshlets(MatrixIdentity(), camera.ViewProjectionMatrix(), camera.Position(), true, stats);
+        }
+
+        MeshletCullStats timingStats;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (unsigned int repeat = 0; repeat < MESHLET_BENCHMARK_REPEATS; ++repeat)
+        {
+            for (auto& camera : cameras)
+            {
+                mesh->CullAllMeshlets(MatrixIdentity(), camera.ViewProjectionMatrix(), camera.Position(), true, timingStats);
+            }
+        }
+        float time = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+
+        float trianglesCulled = stats.trianglesTested > 0 ? 100.0f * stats.trianglesCulled / stats.trianglesTested : 0;
+        float meshletsCulled = stats.meshletsTested > 0 ? 100.0f * stats.meshletsCulled / stats.meshletsTested : 0;
+        result << ", " << benchmarkMesh.name << ": " << trianglesCulled << "% tris (" << meshletsCulled << "% meshlets) culled, "
+               << timingStats.trianglesTested / time / 1000000 << "M tris/s ("
+               << time * 1000000 / (MESHLET_BENCHMARK_REPEATS * MESHLET_BENCHMARK_VIEWS) << "us/view)";
+    }
+    gBenchmarkResult = result.str();
+}
+
+
+// Time turning every node of many bike models a little, comparing the matrix-only path (read Euler angles from the
+// matrix, rebuild the matrix from them) with models keeping transforms (quaternion multiply, matrix rebuilt lazily)
+void RotationBenchmark()
+{
+    std::vector<std::unique_ptr<Model>> matrixModels;
+    std::vector<std::unique_ptr<Model>> transformModels;
+    for (unsigned int i = 0; i < ROTATION_BENCHMARK_MODELS; ++i)
+    {
+        matrixModels.emplace_back(new Model(gMeshes[7]));
+        transformModels.emplace_back(new Model(gMeshes[7]));
+        transformModels.back()->UseTransforms(true);
+    }
+    const unsigned int numNodes = gMeshes[7]->NumberNodes();
+    const float turn = 0.01f;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (unsigned int frame = 0; frame < ROTATION_BENCHMARK_FRAMES; ++frame)
+    {
+        for (auto& model : matrixModels)
+        {
+            for (unsigned int node = 0; node < numNodes; ++node)
+            {
+                CVector3 rotation = model->Rotation(node);
+                rotation.y += turn;
+                model->SetRotation(rotation, node);
+            }
+        }
+    }
+    auto middle = std::chrono::high_resolution_clock::now();
+    CQuaternion turnQuaternion = QuaternionRotationY(turn);
+    for (unsigned int frame = 0; frame < ROTATION_BENCHMARK_FRAMES; ++frame)
+    {
+        for (auto& model : transformModels)
+        {
+            for (unsigned int node = 0; node < numNodes; ++node)
+            {
+                model->SetRotation(model->RotationQuaternion(node) * turnQuaternion, node);
+            }
+            model->UpdateMatrices(); // Include the cost of rebuilding the matrices, as rendering would
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    float nodes = static_cast<float>(ROTATION_BENCHMARK_MODELS) * numNodes * ROTATION_BENCHMARK_FRAMES;
+    float matrixTime = std::chrono::duration<float>(middle - start).count();
+    float transformTime = std::chrono::duration<float>(end - middle).count();
+
+    std::ostringstream result;
+    result.precision(1);
+    result << std::fixed << ", Node rotation: Euler/matrix " << matrixTime * 1e9f / nodes << "ns, quaternion/TRS "
+           << transformTime * 1e9f / nodes << "ns per node";
+    gBenchmarkResult = result.str();
+}
+
+
+// Let a texture streamer choose the mips to stream for the objects seen from a camera
+void UpdateTextureStreaming(TextureStreamer* streamer, Camera* camera)
+{
+    std::vector<TextureUse> uses;
+    for (auto object : gObjects)
+    {
+        if (object->IsAlwaysVisible())  continue; // The skybox surrounds the camera, its bounds don't say how big it looks
+
+        CVector3 centre;
+        float radius;
+        object->ObjectModel()->BoundingSphere(centre, radius);
+        for (auto texture : object->Textures())  uses.push_back({ texture, centre, radius });
+    }
+
+    float screenScale = gViewportWidth / (2 * std::tan(camera->FOV() / 2));
+    streamer->Update(uses, camera->Position(), CFrustum(camera->ViewProjectionMatrix()), screenScale);
+}
+
+
+// Replay the recorded camera path through a streamer with the scene's streamed textures and settings, on a simulated
+// device with mips read straight away (the upload limit still applies). Stores the residency of the wanted detail along
+// the path, the memory used and the streaming work done in gBenchmarkResult for the window title
+void TextureStreamingReplay()
+{
+    if (gCameraPath.empty())  return;
+
+    SimulatedStreamingDevice device;
+    StreamingSettings settings = gTextureStreamer->Settings();
+    settings.backgroundThread = false;
+    TextureStreamer streamer(&device, settings);
+    for (auto texture : gTextureStreamer->Textures())  streamer.Add(texture, gTextureStreamer->Image(texture));
+
+    Camera camera = *gCamera;
+    float totalResidency = 0;
+    float minResidency = 1;
+    unsigned int completeFrames = 0;
+    size_t peakBytes = 0;
+    for (auto& key : gCameraPath)
+    {
+        camera.SetPosition(key.position);
+        camera.SetRotation(key.rotation);
+        UpdateTextureStreaming(&streamer, &camera);
+
+        const StreamingStats& stats = streamer.Stats();
+        totalResidency += stats.Residency();
+        minResidency = std::min(minResidency, stats.Residency());
+        if (stats.residentWantedBytes == stats.wantedBytes)  ++completeFrames;
+        peakBytes = std::max(peakBytes, stats.residentBytes);
+    }
+
+    const StreamingStats& stats = streamer.Stats();
+    unsigned int numFrames = static_cast<unsigned int>(gCameraPath.size());
+    std::ostringstream result;
+    result.precision(1);
+    result << std::fixed << ", Streaming replay of " << numFrames << " frames: residency " << 100 * totalResidency / numFrames
+           << "% average, " << 100 * minResidency << "% lowest, complete in " << 100.0f * completeFrames / numFrames
+           << "% of frames, peak " << peakBytes / (1024.0f * 1024.0f) << "/" << settings.budget / (1024.0f * 1024.0f) << "MB, "
+           << stats.mipsLoaded << " mips loaded, " << stats.mipsDropped << " dropped";
+    gBenchmarkResult = result.str();
+}
+
+
+// Time decoding the top level of each image of some block compressed textures in software, on one thread and then on all
+// the worker threads, then fetching texels one at a time through a block cache along a wandering path (as a rasterizer
+// walking triangles would). Stores the throughput in megapixels per second in gBenchmarkResult for the window title
+void TextureDecodeBenchmark()
+{
+    float singleTime = 0, parallelTime = 0, fetchTime = 0;
+    uint64_t texels = 0, fetches = 0, hits = 0;
+    std::vector<uint8_t> rgba;
+    std::mt19937 random(0);
+    for (auto fileName : DECODE_BENCHMARK_TEXTURES)
+    {
+        std::unique_ptr<DDSFile> file;
+        try
+        {
+            file.reset(new DDSFile(fileName));
+        }
+        catch (std::runtime_error&)
+        {
+            continue; // Not cooked
+        }
+        if (BCBlockBytes(file->Format()) == 0)  continue;
+
+        for (unsigned int image = 0; image < file->ArraySize(); ++image)
+        {
+            const DDSSubresource& top = file->Subresource(image, 0);
+            rgba.resize(static_cast<size_t>(top.width) * top.height * 4);
+
+            auto start = std::chrono::high_resolution_clock::now();
+            DecodeBCImage(file->Format(), top, rgba.data(), false);
+            auto middle = std::chrono::high_resolution_clock::now();
+            DecodeBCImage(file->Format(), top, rgba.data(), true);
+            auto end = std::chrono::high_resolution_clock::now();
+            singleTime += std::chrono::duration<float>(middle - start).count();
+            parallelTime += std::chrono::duration<float>(end - middle).count();
+            texels += static_cast<uint64_t>(top.width) * top.height;
+        }
+
+        // Steps of up to 2 texels in each direction, wrapping at the edges
+        BCBlockCache cache(file->Format(), file->Subresource(0, 0));
+        uint32_t width = file->Width(), height = file->Height();
+        std::vector<int> steps(DECODE_BENCHMARK_FETCHES);
+        for (auto& step : steps)  step = static_cast<int>(random() % 25);
+        uint32_t x = width / 2, y = height / 2;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (auto step : steps)
+        {
+            x = (x + width  + step % 5 - 2) % width;
+            y = (y + height + step / 5 - 2) % height;
+            cache.Texel(x, y);
+        }
+        fetchTime += std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+        fetches += DECODE_BENCHMARK_FETCHES;
+        hits += cache.Hits();
+    }
+    if (texels == 0)  return;
+
+    float megapixels = texels / 1000000.0f;
+    std::ostringstream result;
+    result.precision(1);
+    result << std::fixed << ", Decoding " << megapixels << "MP of BC textures: " << megapixels / singleTime << "MP/s 1 thread, "
+           << megapixels / parallelTime << "MP/s " << ParallelForThreads() << " threads, single texels "
+           << fetches / fetchTime / 1000000 << "M/s (" << 100.0f * hits / fetches << "% block cache hits)";
+    gBenchmarkResult = result.str();
+}
+
+
+// Time updating a large pool of particles on one thread and then on all the worker threads, then sorting them and
+// expanding them to quads (into memory rather than a vertex buffer). Stores the times per frame in gBenchmarkResult
+// for the window title
+void ParticleBenchmark()
+{
+    ParticleSettings settings;
+    settings.maxParticles = PARTICLE_BENCHMARK_PARTICLES;
+    settings.spawnRate = PARTICLE_BENCHMARK_PARTICLES * 60.0f; // Fill the pool in the first frame
+    settings.spawnRadius = 100;
+    settings.minLife = 10; // Particles live through the benchmark
+    settings.maxLife = 20;
+    settings.velocitySpread = { 5, 5, 5 };
+    settings.gravity = { 0, -2, 0 };
+    settings.drag = 0.1f;
+    settings.endSize = 4;
+    ParticleSystem particles(settings);
+    const float frameTime = 1.0f / 60.0f;
+    particles.Update(frameTime);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (unsigned int frame = 0; frame < PARTICLE_BENCHMARK_FRAMES; ++frame)  particles.Update(frameTime, false);
+    auto middle = std::chrono::high_resolution_clock::now();
+    for (unsigned int frame = 0; frame < PARTICLE_BENCHMARK_FRAMES; ++frame)  particles.Update(frameTime);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    CMatrix4x4 cameraMatrix = gCamera->WorldMatrix();
+    std::vector<ParticleVertex> vertices(static_cast<size_t>(particles.NumParticles()) * 4);
+    float sortTime = 0, quadTime = 0;
+    for (unsigned int frame = 0; frame < PARTICLE_BENCHMARK_FRAMES; ++frame)
+    {
+        auto sortStart = std::chrono::high_resolution_clock::now();
+        const auto& order = particles.SortBackToFront(gCamera->Position(), cameraMatrix.GetZAxis());
+        auto quadStart = std::chrono::high_resolution_clock::now();
+        particles.BuildQuads(cameraMatrix.GetXAxis(), cameraMatrix.GetYAxis(), vertices.data(), order.data());
+        auto quadEnd = std::chrono::high_resolution_clock::now();
+        sortTime += std::chrono::duration<float>(quadStart - sortStart).count();
+        quadTime += std::chrono::duration<float>(quadEnd - quadStart).count();
+    }
+
+    float singleTime = std::chrono::duration<float>(middle - start).count();
+    float parallelTime = std::chrono::duration<float>(end - middle).count();
+    std::ostringstream result;
+    result.precision(2);
+    result << std::fixed << ", Updating " << particles.NumParticles() << " particles: "
+           << singleTime * 1000 / PARTICLE_BENCHMARK_FRAMES << "ms/frame 1 thread, "
+           << parallelTime * 1000 / PARTICLE_BENCHMARK_FRAMES << "ms/frame " << ParallelForThreads() << " threads, sort "
+           << sortTime * 1000 / PARTICLE_BENCHMARK_FRAMES << "ms, quads " << quadTime * 1000 / PARTICLE_BENCHMARK_FRAMES << "ms";
+    gBenchmarkResult = result.str();
+}
+
+
+// Time the scene BVH against testing every object, over random boxes scattered around the scene: a SAH build, culling
+// to the main camera's frustum, casting a ray from the camera to the nearest box, and refitting after moving some of
+// the boxes. Stores the results in gBenchmarkResult for the window title
+void BVHBenchmark()
+{
+    using Clock = std::chrono::high_resolution_clock;
+    auto Microseconds = [](Clock::time_point start, Clock::time_point end) { return std::chrono::duration<float>(end - start).count() * 1000000; };
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> position(-BVH_BENCHMARK_SPREAD / 2, BVH_BENCHMARK_SPREAD / 2);
+    std::uniform_real_distribution<float> size(1.0f, 10.0f);
+    CFrustum frustum(gCamera->ViewProjectionMatrix());
+    CVector3 rayOrigin = gCamera->Position();
+    CVector3 rayDirection = gCamera->WorldMatrix().GetZAxis();
+
+    std::ostringstream result;
+    result.precision(1);
+    result << std::fixed << ", BVH vs scan";
+    for (auto numBoxes : BVH_BENCHMARK_SIZES)
+    {
+        std::vector<BoundingBox> boxes(numBoxes);
+        for (auto& box : boxes)
+        {
+            CVector3 centre = { position(random), position(random), position(random) };
+            float radius = size(random);
+            box = { { centre.x - radius, centre.y - radius, centre.z - radius }, { centre.x + radius, centre.y + radius, centre.z + radius } };
+        }
+
+        DynamicBVH bvh;
+        auto buildStart = Clock::now();
+        bvh.Build(boxes);
+        auto buildEnd = Clock::now();
+
+        // Culling, the scan tests every box against the frustum
+        std::vector<uint32_t> visible;
+        auto cullStart = Clock::now();
+        for (unsigned int query = 0; query < BVH_BENCHMARK_QUERIES; ++query)  bvh.QueryFrustum(frustum, visible);
+        auto cullMiddle = Clock::now();
+        for (unsigned int query = 0; query < BVH_BENCHMARK_QUERIES; ++query)
+        {
+            visible.clear();
+            for (uint32_t i = 0; i < numBoxes; ++i)
+            {
+                if (frustum.IsBoxVisible(boxes[i].minBounds, boxes[i].maxBounds))  visible.push_back(i);
+            }
+        }
+        auto cullEnd = Clock::now();
+
+        // Nearest box hit by a ray, the scan does the slab test on every box
+        auto RayBoxDistance = [&](uint32_t i, float maxDistance)
+        {
+            float nearest = 0, furthest = maxDistance;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                float origin = (&rayOrigin.x)[axis], inverse = 1 / (&rayDirection.x)[axis];
+                float t1 = ((&boxes[i].minBounds.x)[axis] - origin) * inverse;
+                float t2 = ((&boxes[i].maxBounds.x)[axis] - origin) * inverse;
+                nearest = std::max(nearest, std::min(t1, t2));
+                furthest = std::min(furthest, std::max(t1, t2));
+            }
+            return nearest <= furthest ? nearest : maxDistance;
+        };
+        uint32_t hit = 0;
+        auto rayStart = Clock::now();
+        for (unsigned int query = 0; query < BVH_BENCHMARK_QUERIES; ++query)
+        {
+            bvh.RayCast(rayOrigin, rayDirection, BVH_BENCHMARK_SPREAD * 2, RayBoxDistance, hit);
+        }
+        auto rayMiddle = Clock::now();
+        for (unsigned int query = 0; query < BVH_BENCHMARK_QUERIES; ++query)
+        {
+            float nearest = BVH_BENCHMARK_SPREAD * 2;
+            for (uint32_t i = 0; i < numBoxes; ++i)  nearest = std::min(nearest, RayBoxDistance(i, nearest));
+        }
+        auto rayEnd = Clock::now();
+
+        // Refit after moving some of the boxes a little
+        std::uniform_real_distribution<float> step(-5.0f, 5.0f);
+        auto refitStart = Clock::now();
+        for (uint32_t i = 0; i < numBoxes; i += BVH_BENCHMARK_MOVE_EVERY)
+        {
+            CVector3 offset = { step(random), step(random), step(random) };
+            bvh.Move(i, { boxes[i].minBounds + offset, boxes[i].maxBounds + offset });
+        }
+        bvh.Refit();
+        auto refitEnd = Clock::now();
+
+        result << ", " << numBoxes / 1000 << "k: build " << Microseconds(buildStart, buildEnd) / 1000 << "ms, cull "
+               << Microseconds(cullStart, cullMiddle) / BVH_BENCHMARK_QUERIES << "us vs "
+               << Microseconds(cullMiddle, cullEnd) / BVH_BENCHMARK_QUERIES << "us, ray "
+               << Microseconds(rayStart, rayMiddle) / BVH_BENCHMARK_QUERIES << "us vs "
+               << Microseconds(rayMiddle, rayEnd) / BVH_BENCHMARK_QUERIES << "us, refit "
+               << Microseconds(refitStart, refitEnd) << "us";
+    }
+    gBenchmarkResult = result.str();
+}
+
+
+// Time a frame's object work as jobs for many bike models, with each number of threads in JOB_BENCHMARK_THREADS up to
+// the number available: animate them, build their node matrices, cull them against the main camera choosing levels of
+// detail, then queue the visible ones. Each step is a set of jobs waiting on the step before. Stores the time per
+// frame and the speed up over one thread in gBenchmarkResult for the window title
+void JobBenchmark()
+{
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> position(-JOB_BENCHMARK_SPREAD / 2, JOB_BENCHMARK_SPREAD / 2);
+    std::vector<std::unique_ptr<Model>> bikes;
+    std::vector<Model*> models;
+    for (unsigned int i = 0; i < JOB_BENCHMARK_MODELS; ++i)
+    {
+        bikes.emplace_back(new Model(gMeshes[7], { position(random), 0.0f, position(random) }));
+        bikes.back()->SetAnimationSpeed(1.0f + 0.001f * i); // Spread the models through the clip
+        bikes.back()->UseTransforms(true);
+        models.push_back(bikes.back().get());
+    }
+    CFrustum frustum(gCamera->ViewProjectionMatrix());
+    CVector3 cameraPosition = gCamera->Position();
+    float cameraFOV = gCamera->FOV();
+    const float frameTime = 1.0f / 60.0f;
+
+    std::vector<uint8_t> visible(JOB_BENCHMARK_MODELS);
+    std::vector<Model*> queue;
+    auto Frame = [&]()
+    {
+        JobCounter animated, posed, culled;
+        ParallelJobs(JOB_BENCHMARK_MODELS, SCENE_JOB_BATCH_SIZE, [&](unsigned int start, unsigned int end)
+        {
+            for (unsigned int m = start; m < end; ++m)  models[m]->UpdateAnimation(frameTime);
+        }, animated);
+        ParallelJobs(JOB_BENCHMARK_MODELS, SCENE_JOB_BATCH_SIZE, [&](unsigned int start, unsigned int end)
+        {
+            for (unsigned int m = start; m < end; ++m)  models[m]->UpdateMatrices();
+        }, posed, &animated);
+        ParallelJobs(JOB_BENCHMARK_MODELS, SCENE_JOB_BATCH_SIZE, [&](unsigned int start, unsigned int end)
+        {
+            for (unsigned int m = start; m < end; ++m)
+            {
+                CVector3 centre;
+                float radius;
+                models[m]->BoundingSphere(centre, radius);
+                visible[m] = frustum.IsSphereVisible(centre, radius);
+                if (visible[m])  models[m]->SelectLOD(cameraPosition, cameraFOV);
+            }
+        }, culled, &posed);
+        WaitForJobs(culled);
+
+        queue.clear();
+        for (unsigned int m = 0; m < JOB_BENCHMARK_MODELS; ++m)
+        {
+            if (visible[m])  queue.push_back(models[m]);
+        }
+    };
+
+    std::ostringstream result;
+    result.precision(2);
+    result << std::fixed << ", Jobs for " << JOB_BENCHMARK_MODELS << " bikes (animate, pose, cull, queue) in ms/frame by threads:";
+    float singleTime = 0;
+    for (auto numThreads : JOB_BENCHMARK_THREADS)
+    {
+        if (numThreads > JobThreads())  break;
+        SetActiveJobThreads(numThreads);
+        Frame(); // Warm up
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (unsigned int frame = 0; frame < JOB_BENCHMARK_FRAMES; ++frame)  Frame();
+        float time = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count() / JOB_BENCHMARK_FRAMES;
+
+        if (numThreads == 1)  singleTime = time;
+        result << " " << numThreads << ": " << time * 1000;
+        if (numThreads > 1)  result << " (" << singleTime / time << "x)";
+    }
+    SetActiveJobThreads(JobThreads());
+    result << ", " << queue.size() << " visible, " << JobThreads() << " threads available";
+    gBenchmarkResult = result.str();
+}
+
+
+// Time picking with rays from the main camera through a grid of points across the troll's bounding sphere, the same
+// path as a mouse click. Each ray is also cast at every pickable object in turn, without the scene BVH, to check the
+// pick. Stores the times, the share that hit the troll and the number of rays where the two disagree in gBenchmarkResult
+void PickingBenchmark()
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    CVector3 centre;
+    float radius;
+    gTroll->ObjectModel()->BoundingSphere(centre, radius);
+    CVector3 origin = gCamera->Position();
+    CMatrix4x4 cameraMatrix = gCamera->WorldMatrix();
+    CVector3 right = cameraMatrix.GetXAxis();
+    CVector3 up = cameraMatrix.GetYAxis();
+
+    float totalTime = 0, slowestTime = 0, bruteForceTime = 0;
+    unsigned int trollHits = 0, bruteForceTrollHits = 0, mismatches = 0;
+    for (unsigned int y = 0; y < PICKING_BENCHMARK_GRID; ++y)
+    {
+        for (unsigned int x = 0; x < PICKING_BENCHMARK_GRID; ++x)
+        {
+            float offsetX = (2.0f * (x + 0.5f) / PICKING_BENCHMARK_GRID - 1.0f) * radius;
+            float offsetY = (2.0f * (y + 0.5f) / PICKING_BENCHMARK_GRID - 1.0f) * radius;
+            CVector3 direction = centre + right * offsetX + up * offsetY - origin;
+
+            auto pickStart = Clock::now();
+            float distance;
+            SceneObject* picked = PickObject(origin, direction, 2.0f, distance);
+            float pickTime = std::chrono::duration<float>(Clock::now() - pickStart).count();
+
+            totalTime += pickTime;
+            slowestTime = std::max(slowestTime, pickTime);
+            if (picked == gTroll)  ++trollHits;
+
+            // The same objects as PickObject, each tested whatever its bounds
+            auto bruteForceStart = Clock::now();
+            SceneObject* nearestObject = nullptr;
+            float nearest = 2.0f;
+            for (auto object : gObjects)
+            {
+                if (object->RasterizerState() == gCullFrontState)  continue;
+                float objectDistance = object->ObjectModel()->RayCast(origin, direction, nearest);
+                if (objectDistance < nearest)
+                {
+                    nearest = objectDistance;
+                    nearestObject = object;
+                }
+            }
+            bruteForceTime += std::chrono::duration<float>(Clock::now() - bruteForceStart).count();
+
+            if (nearestObject == gTroll)  ++bruteForceTrollHits;
+            if (nearestObject != picked)  ++mismatches;
+        }
+    }
+
+    const unsigned int numPicks = PICKING_BENCHMARK_GRID * PICKING_BENCHMARK_GRID;
+    std::ostringstream result;
+    result.precision(1);
+    result << std::fixed << ", Picking " << numPicks << " rays at the troll: " << totalTime / numPicks * 1000000 << "us avg, "
+           << slowestTime * 1000000 << "us max, " << 100.0f * trollHits / numPicks << "% hit it. Testing every object: "
+           << bruteForceTime / numPicks * 1000000 << "us avg, " << 100.0f * bruteForceTrollHits / numPicks << "% hit it, "
+           << mismatches << " rays differ";
+    gBenchmarkResult = result.str();
+}
+
+
 // Update models and camera. frameTime is the time passed since the last frame
 void UpdateScene(float frameTime)
 {
+	// Swap in new versions of resources whose files have changed, before anything uses them this frame
+	UpdateHotReload();
+
 	gPerFrameConstants.gTime += frameTime;
 	
-	// Controls
+	// Click to pick the object under the mouse, through the scene BVH (as last rendered) and then the object's triangles
+	if (KeyHit(Mouse_LButton))
+	{
+		auto pickStart = std::chrono::high_resolution_clock::now();
+		CVector3 rayOrigin, rayDirection;
+		gCamera->PixelRay(GetMouseX(), GetMouseY(), gViewportWidth, gViewportHeight, rayOrigin, rayDirection);
+		float distance;
+		gPickedObject = PickObject(rayOrigin, rayDirection, gCamera->FarClip(), distance);
+		gPickTime = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - pickStart).count();
+	}
+
+	// Controls, for the picked object or if there isn't one the controllable objects
 	for (auto object : gObjects)
 	{
-		if (object->IsControllable())
+		if (gPickedObject != nullptr ? object == gPickedObject : object->IsControllable())
 		{
 			object->ObjectModel()->Control(0, frameTime, Key_I, Key_K, Key_J, Key_L, Key_U, Key_O, Key_Period, Key_Comma);
 		}
 	}
-	//Control bike's wheels
-	gObjects[8]->ObjectModel()->Control(1, frameTime, Key_T, Key_G, Key_0, Key_0, Key_0, Key_0, Key_0, Key_0);
-	gObjects[8]->ObjectModel()->Control(2, frameTime, Key_T, Key_G, Key_0, Key_0, Key_0, Key_0, Key_0, Key_0);
+	//Control bike's wheels by changing the speed of its wheel spin animation
+	Model* bike = gBike->ObjectModel();
+	float wheelSpeed = bike->AnimationSpeed();
+	if (KeyHeld(Key_T))  wheelSpeed = std::min(wheelSpeed + frameTime, WHEEL_SPIN_MAX_SPEED);
+	if (KeyHeld(Key_G))  wheelSpeed = std::max(wheelSpeed - frameTime, -WHEEL_SPIN_MAX_SPEED);
+	bike->SetAnimationSpeed(wheelSpeed);
 	
 	gCamera->Control(frameTime, Key_Up, Key_Down, Key_Left, Key_Right, Key_W, Key_S, Key_A, Key_D);
+
+	// Stream in the texture mips the main camera needs
+	UpdateTextureStreaming(gTextureStreamer, gCamera);
+	if (KeyHit(Key_9))
+	{
+		gRecordingCameraPath = !gRecordingCameraPath;
+		if (gRecordingCameraPath)
+		{
+			gCameraPath.clear();
+			gBenchmarkResult = ", Recording camera path (9 to stop)";
+		}
+		else
+		{
+			TextureStreamingReplay();
+		}
+	}
+	if (gRecordingCameraPath)  gCameraPath.push_back({ gCamera->Position(), gCamera->Rotation() });
+
+	if (KeyHit(Key_2))  gCPUSkinning = !gCPUSkinning;
+	if (KeyHit(Key_3))  AnimationBenchmark();
+	if (KeyHit(Key_4))  RotationBenchmark();
+	if (KeyHit(Key_C))  MeshletBenchmark();
+	if (KeyHit(Key_0))  TextureDecodeBenchmark();
+	if (KeyHit(Key_B))  ParticleBenchmark();
+	if (KeyHit(Key_Y))  gUseWeightedOIT = !gUseWeightedOIT;
+	if (KeyHit(Key_H))  BVHBenchmark();
+	if (KeyHit(Key_M))  PickingBenchmark();
+	if (KeyHit(Key_N))  JobBenchmark();
+	if (KeyHit(Key_5))  gCamera->SetReverseZ(!gCamera->ReverseZ());
+	if (KeyHit(Key_6))  gPictureInPicture = !gPictureInPicture;
+	if (KeyHit(Key_7))
+	{
+		bool continuous = (gReflectionProbes->GetUpdateMode() == ReflectionProbes::UpdateMode::Continuous);
+		gReflectionProbes->SetUpdateMode(continuous ? ReflectionProbes::UpdateMode::OnChange : ReflectionProbes::UpdateMode::Continuous);
+	}
+	if (KeyHit(Key_8))  gSunOn = !gSunOn;
 	
     // Orbit 1st light
 	static float rotate = 0.0f;
@@ -431,8 +1724,22 @@ void UpdateScene(float frameTime)
 	}
 	gLights[1]->SetColour(HSLToRGB(HSLColour));
 
-	//Skybox follows camera;
-	gObjects.back()->ObjectModel()->SetPosition(gCamera->Position());
+	// Particles, with the sparks following the orbiting light
+	gParticleEmitters[1]->Particles().SetPosition(gLights[0]->ObjectModel()->Position());
+
+	// Play animations (models whose mesh has no animations are unaffected), then build the node matrices they changed,
+	// while the particles update. All as jobs on the worker threads, this thread helps until they are done
+	std::vector<Model*> models;
+	for (auto object : gObjects)  models.push_back(object->ObjectModel());
+	unsigned int numModels = static_cast<unsigned int>(models.size());
+	JobCounter animationsDone, updatesDone;
+	RunJob([&models, numModels, frameTime]() { Model::UpdateAnimations(models.data(), numModels, frameTime); }, &animationsDone);
+	ParallelJobs(numModels, SCENE_JOB_BATCH_SIZE, [&models](unsigned int start, unsigned int end)
+	{
+		for (unsigned int m = start; m < end; ++m)  models[m]->UpdateMatrices();
+	}, updatesDone, &animationsDone);
+	for (auto emitter : gParticleEmitters)  RunJob([emitter, frameTime]() { emitter->Update(frameTime); }, &updatesDone);
+	WaitForJobs(updatesDone);
 
     // Toggle FPS limiting
     if (KeyHit(Key_P))  lockFPS = !lockFPS;
@@ -450,8 +1757,98 @@ void UpdateScene(float frameTime)
         std::ostringstream frameTimeMs;
         frameTimeMs.precision(2);
         frameTimeMs << std::fixed << avgFrameTime * 1000;
+
+        // Meshlet culling for the last frame: clusters culled, share of full detail triangles removed and CPU cost
+        std::ostringstream renderStats;
+        renderStats.precision(1);
+        float trianglesCulled = gMeshletStats.trianglesTested > 0 ? 100.0f * gMeshletStats.trianglesCulled / gMeshletStats.trianglesTested : 0;
+        renderStats << std::fixed << ", Meshlets culled: " << gMeshletStats.meshletsCulled << "/" << gMeshletStats.meshletsTested
+                     << " (" << trianglesCulled << "% tris, " << gMeshletStats.rangesSubmitted << " draws, "
+                     << gMeshletCullTime * 1000000 << "us)";
+
+        // Views rendered and object draws summed over the views
+        renderStats << ", Views: " << gViewsRendered << " (" << gObjectsDrawn << " draws)";
+
+        // Objects culled through the scene BVH, and its expected query cost (see DynamicBVH::SAHCost)
+        renderStats << ", Scene BVH: " << gSceneBVH.NumItems() << " objects in " << gSceneBVH.NumNodes() << " nodes (cost "
+                     << gSceneBVH.SAHCost() << ")";
+
+        // Object picked with the mouse and the time the pick took
+        if (gPickedObject != nullptr)
+        {
+            auto picked = std::find(gObjects.begin(), gObjects.end(), gPickedObject) - gObjects.begin();
+            renderStats << ", Picked: object " << picked << " (" << gPickTime * 1000000 << "us)";
+        }
+
+        // Unique pipeline states in the scene, and how many binds last frame actually changed state
+        renderStats << ", PSOs: " << NumberPipelineStates() << " (" << gPipelineStateChanges << "/" << gPipelineStateBinds
+                     << " binds changed state)";
+
+        // Images packed into atlases and how full they are, and how many object texture binds last frame changed texture
+        renderStats << ", Atlases: " << gAtlasStats.numImages << " images in " << gAtlasStats.numAtlases << " ("
+                     << gAtlasStats.Efficiency() * 100 << "% packed), textures " << gTextureChanges << "/" << gTextureBinds
+                     << " binds changed";
+
+        // Transparent objects and emitters drawn back to front last frame, and the CPU time sorting them
+        renderStats << ", Transparents: " << gTransparentsDrawn << " (sort " << gTransparentSortTime * 1000000 << "us)";
+
+        // Particles drawn last frame and the CPU time sorting them and building their quads, or with weighted blended
+        // transparency the alpha blended particles aren't sorted
+        renderStats << ", Particles" << (gUseWeightedOIT ? " (OIT)" : "") << ": " << gParticlesDrawn << " (sort "
+                     << gParticleSortTime * 1000000 << "us, quads " << gParticleQuadTime * 1000000 << "us)";
+
+        // Reflection probe faces updated last frame and the CPU time taken
+        bool continuous = (gReflectionProbes->GetUpdateMode() == ReflectionProbes::UpdateMode::Continuous);
+        renderStats << ", Probes (" << (continuous ? "continuous" : "on change") << "): " << gReflectionProbes->FacesRendered()
+                     << " faces, " << gReflectionProbes->UpdateTime() * 1000000 << "us";
+
+        // Shadow map faces re-rendered and casters drawn last frame, and the share of faces reused since the last update
+        unsigned int facesTested = gPointShadowMap->FacesTested() + gSpotShadowMap->FacesTested();
+        unsigned int cacheHits = gPointShadowMap->CacheHits() + gSpotShadowMap->CacheHits();
+        renderStats << ", Shadows: " << gPointShadowMap->FacesRendered() + gSpotShadowMap->FacesRendered() << " faces ("
+                     << gPointShadowMap->CasterDraws() + gSpotShadowMap->CasterDraws() << " draws), "
+                     << (facesTested > 0 ? 100.0f * cacheHits / facesTested : 0.0f) << "% cached";
+        gPointShadowMap->ResetCacheStatistics();
+        gSpotShadowMap->ResetCacheStatistics();
+
+        // Casters drawn into each of the sun's cascades last frame
+        if (gSunOn)
+        {
+            renderStats << ", Sun cascade draws:";
+            for (unsigned int cascade = 0; cascade < gSunShadowMap->NumberCascades(); ++cascade)
+            {
+                renderStats << (cascade == 0 ? " " : "/") << gSunShadowMap->CasterDraws(cascade);
+            }
+        }
+
+        // Skinning, only shown when there are skinned meshes in view
+        if (gSkinnedVertices > 0)
+        {
+            renderStats << ", Skinning (" << (gCPUSkinning ? "CPU" : "GPU") << "): " << gSkinnedVertices << " verts, "
+                         << gSkinningTime * 1000000 << "us";
+        }
+
+        // Startup, with shader loading shown separately from the rest (meshes, textures and scene setup)
+        renderStats << ", Startup: " << static_cast<int>(gStartupTime * 1000) << "ms (shaders "
+                    << static_cast<int>(gShaderLoadTime * 1000) << "ms, other "
+                    << static_cast<int>((gStartupTime - gShaderLoadTime) * 1000) << "ms)";
+
+        // Texture streaming: memory used, how much of the detail wanted is on the GPU, and mips streamed so far
+        const StreamingStats& streaming = gTextureStreamer->Stats();
+        renderStats << ", Streaming: " << streaming.residentBytes / (1024.0f * 1024.0f) << "/"
+                    << gTextureStreamer->Settings().budget / (1024.0f * 1024.0f) << "MB, "
+                    << static_cast<int>(streaming.Residency() * 100) << "% of wanted detail (" << streaming.mipsLoaded
+                    << " loads, " << streaming.mipsDropped << " drops)";
+
+        // Input layouts shared between sub-meshes, and any created by compiling a signature missing from InputSignatures.txt
+        renderStats << ", Input layouts: " << NumberInputLayouts() << " (" << gInputLayoutRequests << " sub-meshes";
+        if (gInputSignaturesCompiled > 0)  renderStats << ", " << gInputSignaturesCompiled << " signatures compiled";
+        renderStats << ")";
+
         std::string windowTitle = "CO2409 Assignment - Frame Time: " + frameTimeMs.str() +
-                                  "ms, FPS: " + std::to_string(static_cast<int>(1 / avgFrameTime + 0.5f));
+                                  "ms, FPS: " + std::to_string(static_cast<int>(1 / avgFrameTime + 0.5f)) +
+                                  ", Triangles: " + std::to_string(gTrianglesRendered) + renderStats.str() + gBenchmarkResult +
+                                  gHotReloadResult;
         SetWindowTextA(gHWnd, windowTitle.c_str());
         totalFrameTime = 0;
         frameCount = 0;
@@ -6,6 +6,11 @@
 #ifndef _SCENE_H_INCLUDED_
 #define _SCENE_H_INCLUDED_
 
+#include "Common.h"
+
+class Camera;
+class SceneObject;
+
 //--------------------------------------------------------------------------------------
 // Scene Geometry and Layout
 //--------------------------------------------------------------------------------------
@@ -28,6 +33,27 @@ void ReleaseResources();
 
 void RenderScene();
 
+// Most views that can be rendered together, one bit each in the object visibility masks
+const unsigned int MAX_VIEWS = 32;
+
+// A view of the scene: a camera and where to draw what it sees
+// Clearing affects the whole render target / depth buffer, so views sharing these must not clear over earlier views
+struct SceneView
+{
+    Camera*                 camera;
+    ID3D11RenderTargetView* renderTarget;
+    ID3D11DepthStencilView* depthStencil;
+    D3D11_VIEWPORT          viewport;
+    bool                    clearColour = false;
+    bool                    clearDepth  = true;
+    SceneObject*            hiddenObject = nullptr; // Optional object not to draw in this view (e.g. the object using a reflection probe)
+    bool                    drawParticles = false;  // Particles are sorted and expanded for each view, so only the main views draw them
+};
+
+// Render the scene to several views. Visibility is tested and levels of detail chosen (from the first view) in a
+// single pass over the scene, then each view draws the objects marked visible to it
+void RenderSceneFromCameras(const SceneView* views, unsigned int numViews);
+
 // frameTime is the time passed since the last frame
 void UpdateScene(float frameTime);
 
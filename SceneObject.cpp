@@ -1,4 +1,6 @@
 #include "SceneObject.h"
+#include "State.h"
+#include "Shader.h"
 
 SceneObject::SceneObject(Model* Model, Texture* Texture, ID3D11VertexShader* VertexShader,
 	ID3D11PixelShader* PixelShader, ID3D11BlendState* BlendState, ID3D11RasterizerState* RasterizerState,
@@ -6,13 +8,25 @@ SceneObject::SceneObject(Model* Model, Texture* Texture, ID3D11VertexShader* Ver
 {
 	model = Model;
 	textures.push_back(Texture);
-	vertexShader = VertexShader;
-	pixelShader = PixelShader;
-	blendState = BlendState;
-	rasterizerState = RasterizerState;
-	depthStencilState = DepthStencilState;
-	samplerState = SamplerState;
 	isControllable = control;
+
+	PipelineStateDesc desc;
+	desc.vertexShader = VertexShader;
+	desc.pixelShader = PixelShader;
+	desc.blendState = BlendState;
+	desc.rasterizerState = RasterizerState;
+	desc.depthStencilState = DepthStencilState;
+	desc.samplerState = SamplerState;
+	pipelineState = CreatePipelineState(desc);
+
+	// Shadows only need positions, skinned objects keep their vertex shader so the shadow follows the pose
+	PipelineStateDesc shadowDesc;
+	shadowDesc.vertexShader = (VertexShader == gSkinningVertexShader) ? VertexShader : gBasicTransformVertexShader;
+	shadowDesc.pixelShader = nullptr;
+	shadowDesc.blendState = gNoBlendingState;
+	shadowDesc.rasterizerState = gShadowCasterState;
+	shadowDesc.depthStencilState = gUseDepthBufferState;
+	shadowPipelineState = CreatePipelineState(shadowDesc);
 }
 
 SceneObject::~SceneObject()
@@ -44,49 +58,76 @@ bool SceneObject::IsControllable()
 	return isControllable;
 }
 
+void SceneObject::SetAlwaysVisible(bool visible)
+{
+	isAlwaysVisible = visible;
+}
+
+bool SceneObject::IsAlwaysVisible()
+{
+	return isAlwaysVisible;
+}
+
 ID3D11VertexShader* SceneObject::VertexShader()
 {
-	return vertexShader;
+	return GetPipelineState(pipelineState).vertexShader;
 }
 
 ID3D11PixelShader* SceneObject::PixelShader()
 {
-	return pixelShader;
+	return GetPipelineState(pipelineState).pixelShader;
 }
 
 ID3D11BlendState* SceneObject::BlendState()
 {
-	return  blendState;
+	return GetPipelineState(pipelineState).blendState;
 }
 
 ID3D11RasterizerState* SceneObject::RasterizerState()
 {
-	return rasterizerState;
+	return GetPipelineState(pipelineState).rasterizerState;
 }
 
 ID3D11DepthStencilState* SceneObject::DepthStencilState()
 {
-	return depthStencilState;
+	return GetPipelineState(pipelineState).depthStencilState;
 }
 
-ID3D11SamplerState** SceneObject::SamplerState()
+ID3D11SamplerState* SceneObject::SamplerState()
 {
-	return &samplerState;
+	return GetPipelineState(pipelineState).samplerState;
+}
+
+PipelineStateHandle SceneObject::PipelineState()
+{
+	return pipelineState;
+}
+
+PipelineStateHandle SceneObject::ShadowPipelineState()
+{
+	return shadowPipelineState;
 }
 
 void SceneObject::Render()
 {
-	gD3DContext->VSSetShader(vertexShader, nullptr, 0);
-	gD3DContext->PSSetShader(pixelShader, nullptr, 0);
-	gD3DContext->OMSetBlendState(blendState, nullptr, 0xffffff);
-	gD3DContext->OMSetDepthStencilState(depthStencilState, 0);
-	gD3DContext->RSSetState(rasterizerState);
-	gD3DContext->PSSetSamplers(0, 1, &samplerState);
+	BindPipelineState(pipelineState);
 
 	for (int i = 0; i < textures.size(); i++)
 	{
-		gD3DContext->PSSetShaderResources(i, 1, textures[i]->TextureSRV());
+		BindObjectTexture(i, *textures[i]->TextureSRV());
 	}
 
-	model->Render();
+	// Textures packed in an atlas are all in the same region of it (see TextureAtlas.h), so the first gives the UV mapping
+	gPerModelConstants.uvScale = textures[0]->UVScale();
+	gPerModelConstants.uvOffset = textures[0]->UVOffset();
+
+	// Meshlets facing away from the camera can only be skipped when the GPU would cull their triangles anyway
+	model->Render(RasterizerState() == gCullBackState);
+}
+
+void SceneObject::RenderShadow(bool cullBackFaces /*= true*/)
+{
+	BindPipelineState(shadowPipelineState);
+
+	model->Render(cullBackFaces);
 }
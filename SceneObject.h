@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "Texture.h"
+#include "PipelineState.h"
 
 class SceneObject
 {
@@ -20,21 +21,30 @@ public:
 	ID3D11BlendState* BlendState();
 	ID3D11RasterizerState* RasterizerState();
 	ID3D11DepthStencilState* DepthStencilState();
-	ID3D11SamplerState** SamplerState();
+	ID3D11SamplerState* SamplerState();
+
+	// The shaders and states above as one pipeline state, and the state used to render the object into shadow maps
+	PipelineStateHandle PipelineState();
+	PipelineStateHandle ShadowPipelineState();
 	virtual void Render();
 
+	// Render depth only into a shadow map, from the light camera in the per-frame constants. Pass false for
+	// cullBackFaces if the light camera is orthographic, meshlet back face culling needs a perspective view
+	void RenderShadow(bool cullBackFaces = true);
+
+	// Objects that are always visible (e.g. the skybox) are drawn in every view without testing their bounds
+	void SetAlwaysVisible(bool visible);
+	bool IsAlwaysVisible();
+
 private:
 	Model* model;
 	std::vector<Texture*> textures;
 
-	ID3D11VertexShader* vertexShader;
-	ID3D11PixelShader* pixelShader;
-	ID3D11BlendState* blendState;
-	ID3D11RasterizerState* rasterizerState;
-	ID3D11DepthStencilState* depthStencilState;
-	ID3D11SamplerState* samplerState;
+	PipelineStateHandle pipelineState;
+	PipelineStateHandle shadowPipelineState;
 
 	bool isControllable = false;
+	bool isAlwaysVisible = false;
 
 	
 };
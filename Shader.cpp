@@ -4,8 +4,20 @@
 //--------------------------------------------------------------------------------------
 
 #include "Shader.h"
+#include "ShaderPack.h"
+#include "PipelineState.h"
+#include "ParallelFor.h"
+#include "Timer.h"
 #include <fstream>
+#include <sstream>
 #include <vector>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+#include <cctype>
 #include <d3dcompiler.h>
 
 //--------------------------------------------------------------------------------------
@@ -16,71 +28,177 @@
 
 // Vertex and pixel shader DirectX objects
 ID3D11VertexShader* gPixelLightingVertexShader = nullptr;
-ID3D11PixelShader*  gPixelLightingPixelShader  = nullptr;
 ID3D11VertexShader* gBasicTransformVertexShader = nullptr;
 ID3D11PixelShader*  gLightModelPixelShader  = nullptr;
 ID3D11VertexShader* gWiggleVertexShader = nullptr;
 ID3D11PixelShader*  gTextureScrollPixelShader = nullptr;
 ID3D11PixelShader* gFadeTexturePixelShader = nullptr;
-ID3D11PixelShader* gNormalMappingPixelShader = nullptr;
 ID3D11VertexShader* gNormalMappingVertexShader = nullptr;
-ID3D11PixelShader* gParallaxMappingPixelShader = nullptr;
-ID3D11PixelShader* gTextureAlphaPixelShader = nullptr;
 ID3D11VertexShader* gSkyboxVertexShader = nullptr;
 ID3D11PixelShader* gSkyboxPixelShader = nullptr;
 ID3D11VertexShader* gReflectionVertexShader = nullptr;
-ID3D11PixelShader* gReflectionPixelShader = nullptr;
 ID3D11VertexShader* gCellShadingOutlineVertexShader = nullptr;
 ID3D11PixelShader* gCellShadingOutlinePixelShader = nullptr;
-ID3D11PixelShader* gCellShadingPixelShader = nullptr;
+ID3D11VertexShader* gSkinningVertexShader = nullptr;
+ID3D11VertexShader* gParticleVertexShader = nullptr;
+ID3D11PixelShader*  gParticlePixelShader = nullptr;
+ID3D11PixelShader*  gParticleOITPixelShader = nullptr;
+ID3D11VertexShader* gFullScreenVertexShader = nullptr;
+ID3D11PixelShader*  gOITCompositePixelShader = nullptr;
+
+// Lighting pixel shader permutations loaded, by feature bits
+std::unordered_map<uint32_t, ID3D11PixelShader*> gLightingPixelShaders;
+
+// The shader pack shaders are created from, kept mapped until the shaders are released. Null if there is no pack
+std::unique_ptr<ShaderPack> gShaderPack;
+
+// Time spent loading shaders in seconds, part of the startup time
+float gShaderLoadTime = 0;
+
+// Archive of all compiled shaders written by PackShaders.ps1 after each build
+const std::string SHADER_PACK_FILE = "Shaders.pack";
+
+// Source of the lighting shader permutations, and the define for each feature bit (see Lighting_ps.hlsl)
+const std::string PERMUTATION_SOURCE = "Lighting_ps";
+struct ShaderFeatureName
+{
+    const char* name;
+    uint32_t    bit;
+};
+const ShaderFeatureName SHADER_FEATURE_NAMES[] =
+{
+    { "NORMAL_MAP",   SHADER_NORMAL_MAP   },
+    { "PARALLAX",     SHADER_PARALLAX     },
+    { "CELL_SHADING", SHADER_CELL_SHADING },
+    { "REFLECTION",   SHADER_REFLECTION   },
+    { "ALPHA_TEST",   SHADER_ALPHA_TEST   },
+};
 
 
 //--------------------------------------------------------------------------------------
 // Shader creation / destruction
 //--------------------------------------------------------------------------------------
 
+// A shader to create, from the shader pack or its own file, and where to store it. Set one of the pointers
+struct ShaderCreation
+{
+    ShaderCreation(std::string shaderName, ID3D11VertexShader** shader) : name(shaderName), source(shaderName), vertexShader(shader) {}
+    ShaderCreation(std::string shaderName, ID3D11PixelShader**  shader) : name(shaderName), source(shaderName), pixelShader(shader) {}
+
+    std::string          name;   // Without extension
+    std::string          source; // .hlsl file without extension, for reloading. Differs from the name for permutations
+    uint32_t             features = 0; // Defines to compile the source with, for permutations
+    ID3D11VertexShader** vertexShader = nullptr;
+    ID3D11PixelShader**  pixelShader  = nullptr;
+};
+
+// Every shader created, so they can be found when their files change
+std::vector<ShaderCreation> gLoadedShaders;
+
+
+// Create a list of shaders, each from the shader pack if it is there, otherwise from its own .cso file. Shaders from the
+// pack are created straight from the mapped file after checking their hash. Creation is split over the worker threads,
+// which is safe as the D3D device is free-threaded. Returns false and sets gLastError if any shader could not be created,
+// those that could are still stored
+bool CreateShaders(std::vector<ShaderCreation>& shaders)
+{
+    ParallelFor(static_cast<unsigned int>(shaders.size()), 1, [&](unsigned int start, unsigned int end)
+    {
+        for (unsigned int i = start; i < end; ++i)
+        {
+            auto& shader = shaders[i];
+            const ShaderPackEntry* entry = gShaderPack ? gShaderPack->Find(shader.name) : nullptr;
+            if (entry == nullptr)
+            {
+                if (shader.vertexShader)  *shader.vertexShader = LoadVertexShader(shader.name);
+                else                      *shader.pixelShader  = LoadPixelShader (shader.name);
+                continue;
+            }
+
+            const void* byteCode = gShaderPack->Bytecode(*entry);
+            SIZE_T      size = static_cast<SIZE_T>(entry->size);
+            bool        valid = gShaderPack->Verify(*entry);
+            if (shader.vertexShader)
+            {
+                if (!valid || FAILED(gD3DDevice->CreateVertexShader(byteCode, size, nullptr, shader.vertexShader)))
+                {
+                    *shader.vertexShader = nullptr;
+                }
+            }
+            else
+            {
+                if (!valid || FAILED(gD3DDevice->CreatePixelShader(byteCode, size, nullptr, shader.pixelShader)))
+                {
+                    *shader.pixelShader = nullptr;
+                }
+            }
+        }
+    });
+
+    std::string failed;
+    for (auto& shader : shaders)
+    {
+        if ((shader.vertexShader && *shader.vertexShader == nullptr) || (shader.pixelShader && *shader.pixelShader == nullptr))
+        {
+            failed += (failed.empty() ? "" : ", ") + shader.name;
+        }
+        else
+        {
+            gLoadedShaders.push_back(shader);
+        }
+    }
+    if (!failed.empty())
+    {
+        gLastError = "Error loading shaders: " + failed;
+        return false;
+    }
+    return true;
+}
+
+
 // Load shaders required for this app, returns true on success
 bool LoadShaders()
 {
-    // Shaders must be added to the Visual Studio project to be compiled, they use the extension ".hlsl".
-    // To load them for use, include them here without the extension. Use the correct function for each.
-    // Ensure you release the shaders in the ShutdownDirect3D function below
-    gPixelLightingVertexShader  = LoadVertexShader("PixelLighting_vs"); // Note how the shader files are named to show what type they are
-    gPixelLightingPixelShader   = LoadPixelShader ("PixelLighting_ps");
-    gBasicTransformVertexShader = LoadVertexShader("BasicTransform_vs");
-    gLightModelPixelShader      = LoadPixelShader ("LightModel_ps");
-	gWiggleVertexShader = LoadVertexShader("Wiggle_vs");
-	gTextureScrollPixelShader = LoadPixelShader("TextureScroll_ps");
-	gFadeTexturePixelShader = LoadPixelShader("TextureFade_ps");
-	gNormalMappingPixelShader = LoadPixelShader("NormalMapping_ps");
-	gNormalMappingVertexShader = LoadVertexShader("NormalMapping_vs");
-	gParallaxMappingPixelShader = LoadPixelShader("ParallaxMapping_ps");
-	gTextureAlphaPixelShader = LoadPixelShader("TextureAlpha_ps");
-	gSkyboxVertexShader = LoadVertexShader("Skybox_vs");
-	gSkyboxPixelShader = LoadPixelShader("Skybox_ps");
-	gReflectionVertexShader = LoadVertexShader("Reflection_vs");
-	gReflectionPixelShader = LoadPixelShader("Reflection_ps");
-	gCellShadingOutlineVertexShader = LoadVertexShader("CellShadingOutline_vs");
-	gCellShadingOutlinePixelShader = LoadPixelShader("CellShadingOutline_ps");
-	gCellShadingPixelShader = LoadPixelShader("CellShading_ps");
-
-    if (gPixelLightingVertexShader  == nullptr || gPixelLightingPixelShader == nullptr ||
-        gBasicTransformVertexShader == nullptr || gLightModelPixelShader    == nullptr ||
-		gWiggleVertexShader == nullptr || gTextureScrollPixelShader == nullptr ||
-		gFadeTexturePixelShader == nullptr ||
-		gNormalMappingPixelShader == nullptr || gNormalMappingVertexShader == nullptr ||
-		gParallaxMappingPixelShader == nullptr ||
-		gTextureAlphaPixelShader == nullptr||
-		gSkyboxVertexShader == nullptr || gSkyboxPixelShader == nullptr ||
-		gReflectionVertexShader == nullptr || gReflectionPixelShader == nullptr ||
-		gCellShadingOutlineVertexShader == nullptr || gCellShadingOutlinePixelShader == nullptr ||
-		gCellShadingPixelShader == nullptr)
-    {
-        gLastError = "Error loading shaders";
-        return false;
+    Timer loadTimer;
+
+    // Shaders come from the shader pack if there is one, otherwise from their own files (see CreateShaders below)
+    try
+    {
+        gShaderPack = std::make_unique<ShaderPack>(SHADER_PACK_FILE);
+    }
+    catch (std::runtime_error&)
+    {
+        gShaderPack = nullptr;
     }
 
-    return true;
+    // Shaders must be added to the Visual Studio project to be compiled, they use the extension ".hlsl".
+    // To load them for use, include them here without the extension and with a pointer of the correct type.
+    // Ensure you release the shaders in the ReleaseShaders function below
+    std::vector<ShaderCreation> shaders =
+    {
+        { "PixelLighting_vs", &gPixelLightingVertexShader }, // Note how the shader files are named to show what type they are
+        { "BasicTransform_vs", &gBasicTransformVertexShader },
+        { "LightModel_ps", &gLightModelPixelShader },
+        { "Wiggle_vs", &gWiggleVertexShader },
+        { "TextureScroll_ps", &gTextureScrollPixelShader },
+        { "TextureFade_ps", &gFadeTexturePixelShader },
+        { "NormalMapping_vs", &gNormalMappingVertexShader },
+        { "Skybox_vs", &gSkyboxVertexShader },
+        { "Skybox_ps", &gSkyboxPixelShader },
+        { "Reflection_vs", &gReflectionVertexShader },
+        { "CellShadingOutline_vs", &gCellShadingOutlineVertexShader },
+        { "CellShadingOutline_ps", &gCellShadingOutlinePixelShader },
+        { "Skinning_vs", &gSkinningVertexShader },
+        { "Particle_vs", &gParticleVertexShader },
+        { "Particle_ps", &gParticlePixelShader },
+        { "ParticleOIT_ps", &gParticleOITPixelShader },
+        { "FullScreen_vs", &gFullScreenVertexShader },
+        { "OITComposite_ps", &gOITCompositePixelShader },
+    };
+    bool created = CreateShaders(shaders);
+
+    gShaderLoadTime += loadTimer.GetTime();
+    return created;
 }
 
 
@@ -88,25 +206,280 @@ void ReleaseShaders()
 {
     if (gLightModelPixelShader)       gLightModelPixelShader->Release();
     if (gBasicTransformVertexShader)  gBasicTransformVertexShader->Release();
-    if (gPixelLightingPixelShader)    gPixelLightingPixelShader->Release();
     if (gPixelLightingVertexShader)   gPixelLightingVertexShader->Release();
 	if (gTextureScrollPixelShader)	  gTextureScrollPixelShader->Release();
 	if (gWiggleVertexShader)		  gWiggleVertexShader->Release();
 	if (gFadeTexturePixelShader)	  gFadeTexturePixelShader->Release();
-	if (gNormalMappingPixelShader)	  gNormalMappingPixelShader->Release();
 	if (gNormalMappingVertexShader)	  gNormalMappingVertexShader->Release();
-	if (gParallaxMappingPixelShader)  gParallaxMappingPixelShader->Release();
-	if (gTextureAlphaPixelShader)	  gTextureAlphaPixelShader->Release();
 	if (gSkyboxVertexShader)		  gSkyboxVertexShader->Release();
 	if (gSkyboxPixelShader)			  gSkyboxPixelShader->Release();
 	if (gReflectionVertexShader)	  gReflectionVertexShader->Release();
-	if (gReflectionPixelShader)		  gReflectionPixelShader->Release();
 	if (gCellShadingOutlineVertexShader) gCellShadingOutlineVertexShader->Release();
 	if (gCellShadingOutlinePixelShader) gCellShadingOutlinePixelShader->Release();
-	if (gCellShadingPixelShader)	  gCellShadingPixelShader->Release();
+	if (gSkinningVertexShader)		  gSkinningVertexShader->Release();
+	if (gParticleVertexShader)		  gParticleVertexShader->Release();
+	if (gParticlePixelShader)		  gParticlePixelShader->Release();
+	if (gParticleOITPixelShader)	  gParticleOITPixelShader->Release();
+	if (gFullScreenVertexShader)	  gFullScreenVertexShader->Release();
+	if (gOITCompositePixelShader)	  gOITCompositePixelShader->Release();
+
+    for (auto& permutation : gLightingPixelShaders)  permutation.second->Release();
+    gLightingPixelShaders.clear();
+
+    gLoadedShaders.clear();
+    gShaderPack = nullptr;
+}
+
+
+// The bytecode of a shader in the shader pack, checking its hash. Returns false if there is no pack, the shader
+// isn't in it or its bytecode is damaged
+bool FindPackedShader(const std::string& shaderName, const void*& byteCode, size_t& size)
+{
+    const ShaderPackEntry* entry = gShaderPack ? gShaderPack->Find(shaderName) : nullptr;
+    if (entry == nullptr || !gShaderPack->Verify(*entry))  return false;
+
+    byteCode = gShaderPack->Bytecode(*entry);
+    size = static_cast<size_t>(entry->size);
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Lighting shader permutations
+//--------------------------------------------------------------------------------------
+
+// Load the lighting shader permutations in a list file, returns false on failure
+bool LoadShaderPermutations(const std::string& listFile)
+{
+    std::ifstream list(listFile);
+    if (!list.is_open())
+    {
+        gLastError = "Error opening shader permutation list " + listFile;
+        return false;
+    }
+
+    Timer loadTimer;
+
+    // Read the whole list first so the permutations can be created together
+    std::vector<uint32_t> permutations;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(list, line))
+    {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos)  continue;
+
+        uint32_t features;
+        if (!ParseShaderFeatures(line, features))
+        {
+            gLastError = "Unknown shader feature on line " + std::to_string(lineNumber) + " of " + listFile;
+            return false;
+        }
+        if (gLightingPixelShaders.count(features) == 0)
+        {
+            gLightingPixelShaders[features] = nullptr;
+            permutations.push_back(features);
+        }
+    }
+
+    std::vector<ShaderCreation> shaders;
+    for (auto features : permutations)
+    {
+        shaders.push_back({ ShaderPermutationName(features), &gLightingPixelShaders[features] });
+        shaders.back().source = PERMUTATION_SOURCE;
+        shaders.back().features = features;
+    }
+    bool created = CreateShaders(shaders);
+
+    // Remove the permutations that failed so they are not looked up or released
+    for (auto features : permutations)
+    {
+        if (gLightingPixelShaders[features] == nullptr)  gLightingPixelShaders.erase(features);
+    }
+
+    gShaderLoadTime += loadTimer.GetTime();
+    if (!created)
+    {
+        gLastError += " - has CompileShaderPermutations.ps1 been run?";
+    }
+    return created;
+}
+
+
+// The lighting pixel shader with the given features, nullptr if that permutation was not loaded
+ID3D11PixelShader* LightingPixelShader(uint32_t features)
+{
+    if (features & SHADER_PARALLAX)  features |= SHADER_NORMAL_MAP;
+
+    auto permutation = gLightingPixelShaders.find(features);
+    if (permutation == gLightingPixelShaders.end())
+    {
+        gLastError = "Shader permutation " + ShaderPermutationName(features) + " is not in the permutation list";
+        return nullptr;
+    }
+    return permutation->second;
+}
+
+
+// Convert a line of a permutation list to feature bits, returns false if it has an unknown or invalid feature
+bool ParseShaderFeatures(const std::string& line, uint32_t& features)
+{
+    const std::string numLightsName = "NUM_LIGHTS=";
+
+    features = 0;
+    unsigned int numLights = 2;
+    std::istringstream words(line);
+    std::string word;
+    while (words >> word)
+    {
+        auto feature = std::find_if(std::begin(SHADER_FEATURE_NAMES), std::end(SHADER_FEATURE_NAMES),
+                                    [&](const ShaderFeatureName& f) { return word == f.name; });
+        if (feature != std::end(SHADER_FEATURE_NAMES))
+        {
+            features |= feature->bit;
+            if (feature->bit == SHADER_PARALLAX)  features |= SHADER_NORMAL_MAP;
+        }
+        else if (word.compare(0, numLightsName.length(), numLightsName) == 0 && word.length() == numLightsName.length() + 1 &&
+                 word.back() >= '0' && word.back() <= '2')
+        {
+            numLights = word.back() - '0';
+        }
+        else  return false;
+    }
+
+    // The normal map and cell map share a texture slot
+    if ((features & SHADER_NORMAL_MAP) && (features & SHADER_CELL_SHADING))  return false;
+
+    features |= ShaderNumLights(numLights);
+    return true;
+}
+
+
+// Name of the compiled file for a permutation, without the .cso extension. Must match CompileShaderPermutations.ps1
+std::string ShaderPermutationName(uint32_t features)
+{
+    return "Lighting_ps_" + std::to_string(features);
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Hot reloading
+//--------------------------------------------------------------------------------------
+
+// Compile a shader from its source at run time, the lighting permutation source is given the defines for the features.
+// Returns nullptr and puts the compiler's messages in gLastError on failure
+ID3DBlob* CompileShader(const std::string& source, const std::string& target, uint32_t features)
+{
+    // The defines must stay alive until the compile is done
+    std::vector<std::string> values;
+    std::vector<D3D_SHADER_MACRO> defines;
+    values.reserve(std::size(SHADER_FEATURE_NAMES) + 1);
+    for (auto& feature : SHADER_FEATURE_NAMES)
+    {
+        values.push_back((features & feature.bit) ? "1" : "0");
+        defines.push_back({ feature.name, values.back().c_str() });
+    }
+    values.push_back(std::to_string((features & SHADER_NUM_LIGHTS_MASK) >> SHADER_NUM_LIGHTS_SHIFT));
+    defines.push_back({ "NUM_LIGHTS", values.back().c_str() });
+    defines.push_back({ nullptr, nullptr });
+
+    std::string fileName = source + ".hlsl";
+    std::wstring wideFileName(fileName.begin(), fileName.end());
+    ID3DBlob* byteCode = nullptr;
+    ID3DBlob* errors = nullptr;
+    HRESULT hr = D3DCompileFromFile(wideFileName.c_str(), source == PERMUTATION_SOURCE ? defines.data() : nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
+                                    "main", target.c_str(), D3DCOMPILE_OPTIMIZATION_LEVEL3, 0, &byteCode, &errors);
+    if (FAILED(hr))
+    {
+        gLastError = "Error compiling " + fileName;
+        if (errors)  gLastError += ": " + std::string(static_cast<const char*>(errors->GetBufferPointer()), errors->GetBufferSize());
+    }
+    if (errors)  errors->Release();
+    return SUCCEEDED(hr) ? byteCode : nullptr;
 }
 
 
+// Recreate the shaders affected by a changed file and swap them in, see Shader.h
+bool ReloadShaders(const std::string& changedFile, unsigned int& numReloaded)
+{
+    numReloaded = 0;
+    size_t dot = changedFile.find_last_of('.');
+    if (dot == std::string::npos)  return true;
+    std::string stem = changedFile.substr(0, dot);
+    std::string extension = changedFile.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (extension != ".cso" && extension != ".hlsl" && extension != ".hlsli")  return true;
+
+    // Create all the new shaders before replacing any, so a failure leaves all the old ones in place
+    std::vector<ShaderCreation*> replaced;
+    std::vector<ID3D11DeviceChild*> newShaders;
+    auto releaseNew = [&]() { for (auto shader : newShaders)  shader->Release(); };
+    for (auto& shader : gLoadedShaders)
+    {
+        ID3D11VertexShader* vertexShader = nullptr;
+        ID3D11PixelShader*  pixelShader  = nullptr;
+        if (extension == ".cso" && shader.name == stem)
+        {
+            if (shader.vertexShader)  vertexShader = LoadVertexShader(shader.name);
+            else                      pixelShader  = LoadPixelShader (shader.name);
+            if (vertexShader == nullptr && pixelShader == nullptr)  gLastError = "Error loading " + changedFile;
+        }
+        else if ((extension == ".hlsl" && shader.source == stem) || extension == ".hlsli")
+        {
+            // Any shader might use an include file, so they are all rebuilt
+            ID3DBlob* byteCode = CompileShader(shader.source, shader.vertexShader ? "vs_5_0" : "ps_5_0", shader.features);
+            if (byteCode)
+            {
+                if (shader.vertexShader)
+                {
+                    gD3DDevice->CreateVertexShader(byteCode->GetBufferPointer(), byteCode->GetBufferSize(), nullptr, &vertexShader);
+                }
+                else
+                {
+                    gD3DDevice->CreatePixelShader(byteCode->GetBufferPointer(), byteCode->GetBufferSize(), nullptr, &pixelShader);
+                }
+                byteCode->Release();
+            }
+        }
+        else
+        {
+            continue;
+        }
+
+        if (vertexShader == nullptr && pixelShader == nullptr)
+        {
+            releaseNew();
+            return false;
+        }
+        replaced.push_back(&shader);
+        newShaders.push_back(vertexShader ? static_cast<ID3D11DeviceChild*>(vertexShader) : pixelShader);
+    }
+
+    // Swap in the new shaders, everywhere the old ones are used
+    for (size_t i = 0; i < replaced.size(); ++i)
+    {
+        auto& shader = *replaced[i];
+        if (shader.vertexShader)
+        {
+            auto newShader = static_cast<ID3D11VertexShader*>(newShaders[i]);
+            ReplacePipelineStateShader(*shader.vertexShader, newShader);
+            (*shader.vertexShader)->Release();
+            *shader.vertexShader = newShader;
+        }
+        else
+        {
+            auto newShader = static_cast<ID3D11PixelShader*>(newShaders[i]);
+            ReplacePipelineStateShader(*shader.pixelShader, newShader);
+            (*shader.pixelShader)->Release();
+            *shader.pixelShader = newShader;
+        }
+    }
+    numReloaded = static_cast<unsigned int>(replaced.size());
+    return true;
+}
+
 
 // Load a vertex shader, include the file in the project and pass the name (without the .hlsl extension)
 // to this function. The returned pointer needs to be released before quitting. Returns nullptr on failure. 
@@ -174,48 +547,6 @@ ID3D11PixelShader* LoadPixelShader(std::string shaderName)
     return shader;
 }
 
-// Very advanced topic: When creating a vertex layout for geometry (see Scene.cpp), you need the signature
-// (bytecode) of a shader that uses that vertex layout. This is an annoying requirement and tends to create
-// unnecessary coupling between shaders and vertex buffers.
-// This is a trick to simplify things - pass a vertex layout to this function and it will write and compile
-// a temporary shader to match. You don't need to know about the actual shaders in use in the app.
-// Release the signature (called a ID3DBlob!) after use. Returns nullptr on failure.
-ID3DBlob* CreateSignatureForVertexLayout(const D3D11_INPUT_ELEMENT_DESC vertexLayout[], int numElements)
-{
-    std::string shaderSource = "float4 main(";
-    for (int elt = 0; elt < numElements; ++elt)
-    {
-        auto& format = vertexLayout[elt].Format;
-        // This list should be more complete for production use
-        if      (format == DXGI_FORMAT_R32G32B32A32_FLOAT) shaderSource += "float4";
-        else if (format == DXGI_FORMAT_R32G32B32_FLOAT)    shaderSource += "float3";
-        else if (format == DXGI_FORMAT_R32G32_FLOAT)       shaderSource += "float2";
-        else if (format == DXGI_FORMAT_R32_FLOAT)          shaderSource += "float";
-        else return nullptr; // Unsupported type in layout
-
-        uint8_t index = static_cast<uint8_t>(vertexLayout[elt].SemanticIndex);
-        std::string semanticName = vertexLayout[elt].SemanticName;
-        semanticName += ('0' + index);
-
-        shaderSource += " ";
-        shaderSource += semanticName;
-        shaderSource += " : ";
-        shaderSource += semanticName;
-        if (elt != numElements - 1)  shaderSource += " , ";
-    }
-    shaderSource += ") : SV_Position {return 0;}";
-
-    ID3DBlob* compiledShader;
-    HRESULT hr = D3DCompile(shaderSource.c_str(), shaderSource.length(), NULL, NULL, NULL, "main",
-        "vs_5_0", D3DCOMPILE_OPTIMIZATION_LEVEL0, 0, &compiledShader, NULL);
-    if (FAILED(hr))
-    {
-        return nullptr;
-    }
-
-    return compiledShader;
-}
-
 
 //--------------------------------------------------------------------------------------
 // Constant buffer creation / destruction
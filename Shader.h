@@ -7,6 +7,8 @@
 
 #include "Common.h"
 
+#include <cstdint>
+
 //--------------------------------------------------------------------------------------
 // Global Variables
 //--------------------------------------------------------------------------------------
@@ -16,35 +18,94 @@
 
 // Vertex and pixel shader DirectX objects
 extern ID3D11VertexShader* gPixelLightingVertexShader;
-extern ID3D11PixelShader*  gPixelLightingPixelShader;
 extern ID3D11VertexShader* gBasicTransformVertexShader;
 extern ID3D11PixelShader*  gLightModelPixelShader;
 extern ID3D11VertexShader* gWiggleVertexShader;
 extern ID3D11PixelShader*  gTextureScrollPixelShader;
 extern ID3D11PixelShader*  gFadeTexturePixelShader;
 extern ID3D11VertexShader* gNormalMappingVertexShader;
-extern ID3D11PixelShader* gNormalMappingPixelShader;
-extern ID3D11PixelShader* gParallaxMappingPixelShader;
-extern ID3D11PixelShader* gTextureAlphaPixelShader;
 extern ID3D11VertexShader* gSkyboxVertexShader;
 extern ID3D11PixelShader* gSkyboxPixelShader;
 extern ID3D11VertexShader* gReflectionVertexShader;
-extern ID3D11PixelShader* gReflectionPixelShader;
 extern ID3D11VertexShader* gCellShadingOutlineVertexShader;
 extern ID3D11PixelShader* gCellShadingOutlinePixelShader;
-extern ID3D11PixelShader* gCellShadingPixelShader;
+extern ID3D11VertexShader* gSkinningVertexShader;
+extern ID3D11VertexShader* gParticleVertexShader;
+extern ID3D11PixelShader*  gParticlePixelShader;
+extern ID3D11PixelShader*  gParticleOITPixelShader;
+extern ID3D11VertexShader* gFullScreenVertexShader;
+extern ID3D11PixelShader*  gOITCompositePixelShader;
+
+// Total time spent in LoadShaders and LoadShaderPermutations in seconds, reported separately from the rest of startup
+extern float gShaderLoadTime;
 
 
 //--------------------------------------------------------------------------------------
 // Shader creation / destruction
 //--------------------------------------------------------------------------------------
 
-// Load shaders required for this app, returns true on success
+// Load shaders required for this app, returns true on success. Shaders are created from the shader pack (see
+// ShaderPack.h) if it exists, or otherwise from their own .cso files
 bool LoadShaders();
 
-// Release shaders used by the app
+// Release shaders used by the app, including the lighting shader permutations
 void ReleaseShaders();
 
+// The bytecode of a shader in the shader pack, checking its hash. Returns false if there is no pack, the shader
+// isn't in it or its bytecode is damaged
+bool FindPackedShader(const std::string& shaderName, const void*& byteCode, size_t& size);
+
+
+//--------------------------------------------------------------------------------------
+// Lighting shader permutations
+//--------------------------------------------------------------------------------------
+// The lit materials share one pixel shader source, Lighting_ps.hlsl, with features turned on by
+// defines. Each combination used is compiled offline to "Lighting_ps_<features>.cso" by
+// CompileShaderPermutations.ps1, from a list of the combinations a scene needs. The same list is
+// read at run time so only those permutations are loaded, then they are looked up by feature bits.
+//
+// The list has one permutation per line, each the names of its features separated by spaces, with
+// the number of lights given as NUM_LIGHTS=n (2 if not given). A line of just NUM_LIGHTS=2 is the
+// plain lit material. Blank lines and anything after a # are ignored.
+
+// Feature bits, the names and meanings must match Lighting_ps.hlsl and CompileShaderPermutations.ps1
+const uint32_t SHADER_NORMAL_MAP   = 1 << 0;
+const uint32_t SHADER_PARALLAX     = 1 << 1; // Implies SHADER_NORMAL_MAP, which is added if missing
+const uint32_t SHADER_CELL_SHADING = 1 << 2;
+const uint32_t SHADER_REFLECTION   = 1 << 3;
+const uint32_t SHADER_ALPHA_TEST   = 1 << 4;
+
+// The number of local lights used (0 to 2) is held in two bits above the features
+const uint32_t SHADER_NUM_LIGHTS_SHIFT = 5;
+const uint32_t SHADER_NUM_LIGHTS_MASK  = 3 << SHADER_NUM_LIGHTS_SHIFT;
+inline uint32_t ShaderNumLights(unsigned int numLights)  { return numLights << SHADER_NUM_LIGHTS_SHIFT; }
+
+
+// Load the lighting shader permutations in a list file (see above), returns false on failure
+bool LoadShaderPermutations(const std::string& listFile);
+
+// The lighting pixel shader with the given features, loaded by the function above. Returns nullptr and sets
+// gLastError if the permutation was not in the list loaded. The shader is released by ReleaseShaders
+ID3D11PixelShader* LightingPixelShader(uint32_t features);
+
+// Convert a line of a permutation list to feature bits, returns false if it has an unknown or invalid feature
+bool ParseShaderFeatures(const std::string& line, uint32_t& features);
+
+// Name of the compiled file for a permutation, without the .cso extension
+std::string ShaderPermutationName(uint32_t features);
+
+
+//--------------------------------------------------------------------------------------
+// Hot reloading
+//--------------------------------------------------------------------------------------
+
+// Recreate the shaders affected by a changed file (name relative to the working folder) and swap them in: a .cso
+// reloads the shader of that name, a .hlsl is compiled again for each shader built from it (with the defines of
+// each lighting permutation) and an .hlsli compiles every shader again. Other files are ignored. The new shaders
+// replace the old ones in the globals above and in all pipeline states, so call between frames. Sets numReloaded
+// to the number of shaders replaced. Returns false and sets gLastError if any failed, then none are replaced
+bool ReloadShaders(const std::string& changedFile, unsigned int& numReloaded);
+
 
 //--------------------------------------------------------------------------------------
 // Constant buffer creation / destruction
@@ -64,8 +125,5 @@ ID3D11Buffer* CreateConstantBuffer(int size);
 ID3D11VertexShader* LoadVertexShader(std::string shaderName);
 ID3D11PixelShader*  LoadPixelShader (std::string shaderName);
 
-// Helper function. Returns nullptr on failure.
-ID3DBlob* CreateSignatureForVertexLayout(const D3D11_INPUT_ELEMENT_DESC vertexLayout[], int numElements);
-
 
 #endif //_SHADER_H_INCLUDED_
@@ -0,0 +1,64 @@
+//--------------------------------------------------------------------------------------
+// Archive of compiled shaders
+//--------------------------------------------------------------------------------------
+
+#include "ShaderPack.h"
+#include "Hash.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+
+// Map a shader pack and check its header and table of contents
+ShaderPack::ShaderPack(const std::string& fileName)
+    : mFile(fileName)
+{
+    if (mFile.Size() < sizeof(ShaderPackHeader))
+    {
+        throw std::runtime_error("Shader pack " + fileName + " is too small");
+    }
+
+    auto header = static_cast<const ShaderPackHeader*>(mFile.Data());
+    if (header->magic != SHADER_PACK_MAGIC || header->version != SHADER_PACK_VERSION)
+    {
+        throw std::runtime_error(fileName + " is not a shader pack or is from a different version");
+    }
+
+    mNumShaders = header->numShaders;
+    mEntries = reinterpret_cast<const ShaderPackEntry*>(header + 1);
+    if (sizeof(ShaderPackHeader) + mNumShaders * sizeof(ShaderPackEntry) > mFile.Size())
+    {
+        throw std::runtime_error("Shader pack " + fileName + " is damaged");
+    }
+
+    // Check everything Find and Bytecode rely on, so they can't read outside the file
+    for (uint32_t i = 0; i < mNumShaders; ++i)
+    {
+        const ShaderPackEntry& entry = mEntries[i];
+        if (entry.name[SHADER_PACK_MAX_NAME - 1] != '\0' || entry.offset > mFile.Size() ||
+            entry.size > mFile.Size() - entry.offset ||
+            (i > 0 && std::strcmp(mEntries[i - 1].name, entry.name) >= 0))
+        {
+            throw std::runtime_error("Shader pack " + fileName + " is damaged");
+        }
+    }
+}
+
+
+// Find a shader by name (no extension), returns nullptr if it is not in the pack
+const ShaderPackEntry* ShaderPack::Find(const std::string& name)
+{
+    // The table is sorted by name
+    auto end = mEntries + mNumShaders;
+    auto entry = std::lower_bound(mEntries, end, name.c_str(),
+                                  [](const ShaderPackEntry& e, const char* n) { return std::strcmp(e.name, n) < 0; });
+    return (entry != end && name == entry->name) ? entry : nullptr;
+}
+
+
+// Check a shader's bytecode against its hash
+bool ShaderPack::Verify(const ShaderPackEntry& entry)
+{
+    return HashBytes(Bytecode(entry), static_cast<size_t>(entry.size)) == entry.hash;
+}
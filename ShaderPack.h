@@ -0,0 +1,68 @@
+//--------------------------------------------------------------------------------------
+// Archive of compiled shaders
+//--------------------------------------------------------------------------------------
+// All the compiled shader objects (.cso) in one file, written after each build by PackShaders.ps1.
+// The file is memory mapped and shaders are created straight from the mapped bytes, so there is
+// one file open at startup and no copying. A table of contents, sorted by name, gives each
+// shader's place in the file and a hash of its bytecode to check for damage.
+//
+// Layout: ShaderPackHeader, then numShaders ShaderPackEntry, then the bytecode of each shader
+// starting on a 16 byte boundary. Must match PackShaders.ps1
+
+#ifndef _SHADER_PACK_H_INCLUDED_
+#define _SHADER_PACK_H_INCLUDED_
+
+#include "MappedFile.h"
+
+#include <string>
+#include <cstdint>
+
+
+const uint32_t SHADER_PACK_MAGIC   = 0x4b415053; // "SPAK"
+const uint32_t SHADER_PACK_VERSION = 1;
+const uint32_t SHADER_PACK_MAX_NAME = 48;        // Including the terminating null
+
+struct ShaderPackHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t numShaders;
+    uint32_t padding;
+};
+
+struct ShaderPackEntry
+{
+    char     name[SHADER_PACK_MAX_NAME]; // File name without the .cso extension, null terminated
+    uint64_t offset;                     // Of the bytecode from the start of the file
+    uint64_t size;
+    uint64_t hash;                       // HashBytes of the bytecode (see Hash.h)
+};
+
+
+class ShaderPack
+{
+public:
+    // Map a shader pack and check its header and table of contents
+    // Will throw a std::runtime_error exception on failure (since constructors can't return errors)
+    ShaderPack(const std::string& fileName);
+
+    // Find a shader by name (no extension), returns nullptr if it is not in the pack
+    const ShaderPackEntry* Find(const std::string& name);
+
+    // The bytecode of a shader in the pack, valid while the pack exists
+    const void* Bytecode(const ShaderPackEntry& entry)  { return static_cast<const char*>(mFile.Data()) + entry.offset; }
+
+    // Check a shader's bytecode against its hash. Reads every byte, so is worth doing on a worker thread
+    bool Verify(const ShaderPackEntry& entry);
+
+    uint32_t NumberShaders()  { return mNumShaders; }
+
+
+private:
+    MappedFile             mFile;
+    const ShaderPackEntry* mEntries;
+    uint32_t               mNumShaders;
+};
+
+
+#endif //_SHADER_PACK_H_INCLUDED_
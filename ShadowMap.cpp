@@ -0,0 +1,202 @@
+//--------------------------------------------------------------------------------------
+// Shadow maps for spot and point lights
+//--------------------------------------------------------------------------------------
+
+#include "ShadowMap.h"
+#include "SceneObject.h"
+#include "State.h"
+#include "GraphicsHelpers.h"
+#include "CFrustum.h"
+#include "Hash.h"
+
+#include <stdexcept>
+
+// Distance from the light of its cameras' near clip. Larger values give more depth precision, but casters closer
+// to the light than this are missed
+const float SHADOW_NEAR_CLIP = 1.0f;
+
+
+// Create the depth texture and views
+ShadowMap::ShadowMap(Type type, unsigned int size, unsigned int textureSlot)
+    : mType(type), mSize(size), mTextureSlot(textureSlot)
+{
+    mFaces.resize(type == Type::Point ? 6 : 1);
+
+    // Depth texture, one slice per face, rendered to as a depth buffer and sampled as a float texture
+    D3D11_TEXTURE2D_DESC textureDesc = {};
+    textureDesc.Width  = size;
+    textureDesc.Height = size;
+    textureDesc.MipLevels = 1;
+    textureDesc.ArraySize = static_cast<UINT>(mFaces.size());
+    textureDesc.Format = DXGI_FORMAT_R32_TYPELESS; // Typeless so it can be viewed as both depth and float
+    textureDesc.SampleDesc.Count = 1;
+    textureDesc.SampleDesc.Quality = 0;
+    textureDesc.Usage = D3D11_USAGE_DEFAULT;
+    textureDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+    textureDesc.CPUAccessFlags = 0;
+    textureDesc.MiscFlags = (type == Type::Point) ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+    if (FAILED(gD3DDevice->CreateTexture2D(&textureDesc, nullptr, &mTexture)))
+    {
+        throw std::runtime_error("Error creating shadow map texture");
+    }
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+    if (type == Type::Point)
+    {
+        srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+        srvDesc.TextureCube.MostDetailedMip = 0;
+        srvDesc.TextureCube.MipLevels = 1;
+    }
+    else
+    {
+        srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+        srvDesc.Texture2D.MostDetailedMip = 0;
+        srvDesc.Texture2D.MipLevels = 1;
+    }
+    if (FAILED(gD3DDevice->CreateShaderResourceView(mTexture, &srvDesc, &mSRV)))
+    {
+        throw std::runtime_error("Error creating shadow map texture view");
+    }
+
+    // One depth view per face
+    for (unsigned int face = 0; face < mFaces.size(); ++face)
+    {
+        D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+        dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+        dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+        dsvDesc.Texture2DArray.MipSlice = 0;
+        dsvDesc.Texture2DArray.FirstArraySlice = face;
+        dsvDesc.Texture2DArray.ArraySize = 1;
+        if (FAILED(gD3DDevice->CreateDepthStencilView(mTexture, &dsvDesc, &mFaces[face].depthStencil)))
+        {
+            throw std::runtime_error("Error creating shadow map depth view");
+        }
+    }
+}
+
+
+ShadowMap::~ShadowMap()
+{
+    for (auto& face : mFaces)  if (face.depthStencil)  face.depthStencil->Release();
+    if (mSRV)      mSRV->Release();
+    if (mTexture)  mTexture->Release();
+}
+
+
+// Position the light's cameras. Shadow maps use standard depth (not reverse-Z), the range is short enough that
+// precision isn't a problem and it keeps the depth comparison in the shaders simple
+void ShadowMap::SetLight(CVector3 position, float range, CVector3 rotation /*= { 0, 0, 0 }*/, float coneAngle /*= PI / 2*/)
+{
+    for (unsigned int face = 0; face < mFaces.size(); ++face)
+    {
+        auto& camera = mFaces[face].camera;
+        camera.SetPosition(position);
+        camera.SetRotation(mType == Type::Point ? CUBE_FACE_ROTATIONS[face] : rotation);
+        camera.SetFOV(mType == Type::Point ? PI / 2 : coneAngle);
+        camera.SetAspectRatio(1.0f);
+        camera.SetNearClip(SHADOW_NEAR_CLIP);
+        camera.SetFarClip(range);
+    }
+}
+
+
+// Re-render the faces whose light or casters have changed since they were last rendered
+void ShadowMap::Update(const std::vector<SceneObject*>& casters)
+{
+    mFacesRendered = 0;
+    mCasterDraws = 0;
+    unsigned int numFaces = static_cast<unsigned int>(mFaces.size());
+
+    // Find the faces each caster can be seen from
+    CFrustum frustums[6];
+    for (unsigned int face = 0; face < numFaces; ++face)  frustums[face] = CFrustum(mFaces[face].camera.ViewProjectionMatrix());
+    mCasterFaces.resize(casters.size());
+    for (unsigned int i = 0; i < casters.size(); ++i)
+    {
+        CVector3 centre;
+        float radius;
+        casters[i]->ObjectModel()->BoundingSphere(centre, radius);
+        mCasterFaces[i] = 0;
+        for (unsigned int face = 0; face < numFaces; ++face)
+        {
+            if (frustums[face].IsSphereVisible(centre, radius))  mCasterFaces[i] |= 1 << face;
+        }
+    }
+
+    bool unbound = false;
+    for (unsigned int face = 0; face < numFaces; ++face)
+    {
+        auto& faceData = mFaces[face];
+        Camera& camera = faceData.camera;
+
+        // Hash the camera and the node matrices (so animation counts as movement) of the casters in this face
+        CMatrix4x4 viewProjection = camera.ViewProjectionMatrix();
+        uint64_t signature = HashBytes(&viewProjection, sizeof(viewProjection));
+        for (unsigned int i = 0; i < casters.size(); ++i)
+        {
+            if (!(mCasterFaces[i] & (1 << face)))  continue;
+            auto& matrices = casters[i]->ObjectModel()->NodeMatrices();
+            signature = HashBytes(&i, sizeof(i), signature);
+            signature = HashBytes(matrices.data(), matrices.size() * sizeof(CMatrix4x4), signature);
+        }
+
+        ++mFacesTested;
+        if (faceData.rendered && signature == faceData.signature)
+        {
+            ++mCacheHits;
+            continue;
+        }
+        faceData.signature = signature;
+        faceData.rendered = true;
+
+        // The map can't be read while it is being rendered to
+        if (!unbound)
+        {
+            ID3D11ShaderResourceView* nullSRV = nullptr;
+            gD3DContext->PSSetShaderResources(mTextureSlot, 1, &nullSRV);
+            unbound = true;
+        }
+
+        // Depth only, no render target
+        gD3DContext->OMSetRenderTargets(0, nullptr, faceData.depthStencil);
+        gD3DContext->ClearDepthStencilView(faceData.depthStencil, D3D11_CLEAR_DEPTH, 1.0f, 0);
+        D3D11_VIEWPORT viewport = { 0, 0, static_cast<FLOAT>(mSize), static_cast<FLOAT>(mSize), 0.0f, 1.0f };
+        gD3DContext->RSSetViewports(1, &viewport);
+
+        gPerFrameConstants.viewMatrix           = camera.ViewMatrix();
+        gPerFrameConstants.projectionMatrix     = camera.ProjectionMatrix();
+        gPerFrameConstants.viewProjectionMatrix = viewProjection;
+        gPerFrameConstants.cameraPosition       = camera.Position();
+        gPerFrameConstants.farDepth             = camera.FarDepth();
+        UpdateConstantBuffer(gPerFrameConstantBuffer, gPerFrameConstants);
+        gD3DContext->VSSetConstantBuffers(0, 1, &gPerFrameConstantBuffer);
+        gReverseDepth = false;
+
+        for (unsigned int i = 0; i < casters.size(); ++i)
+        {
+            if (!(mCasterFaces[i] & (1 << face)))  continue;
+            casters[i]->RenderShadow();
+            ++mCasterDraws;
+        }
+        ++mFacesRendered;
+    }
+}
+
+
+// Select the shadow map and the comparison sampler for the lit pixel shaders
+void ShadowMap::Bind()
+{
+    gD3DContext->PSSetShaderResources(mTextureSlot, 1, &mSRV);
+    gD3DContext->PSSetSamplers(SHADOW_SAMPLER_SLOT, 1, &gShadowSampler);
+}
+
+
+// Depth stored in the cube map for a distance z along a face's axis is scale + offset / z, the projection's
+// depth (z * scale + offset) divided by w (= z)
+void ShadowMap::CubeDepthParameters(float& scale, float& offset)
+{
+    CMatrix4x4 projection = mFaces[0].camera.ProjectionMatrix();
+    scale  = projection.e22;
+    offset = projection.e32;
+}
@@ -0,0 +1,105 @@
+//--------------------------------------------------------------------------------------
+// Shadow maps for spot and point lights
+//--------------------------------------------------------------------------------------
+// A shadow map holds the depth of the nearest surface seen from a light. Lit pixel shaders
+// compare their own depth from the light against it to find whether they are in shadow,
+// filtering several comparisons to soften the edges (percentage closer filtering, PCF - see
+// Shadows.hlsli). Spot lights need one map covering the cone, point lights need a cube map.
+//
+// Casters are culled against each face's frustum on the CPU before drawing. A face is only
+// re-rendered when its light has moved or the casters in its frustum have changed, which is
+// spotted by comparing a hash of the face's camera and the casters' node matrices with the
+// one from the last render. Static lights over static geometry then cost nothing per frame.
+
+#ifndef _SHADOW_MAP_H_INCLUDED_
+#define _SHADOW_MAP_H_INCLUDED_
+
+#include "Common.h"
+#include "Camera.h"
+
+#include <vector>
+#include <cstdint>
+
+class SceneObject;
+
+// Texture slots used by lit pixel shaders (see Shadows.hlsli)
+const unsigned int SPOT_SHADOW_TEXTURE_SLOT  = 9;
+const unsigned int POINT_SHADOW_TEXTURE_SLOT = 10;
+const unsigned int SHADOW_SAMPLER_SLOT       = 2;
+
+
+class ShadowMap
+{
+public:
+    enum class Type
+    {
+        Spot,  // A single map looking along the light's facing
+        Point, // A cube map, six faces looking along each axis
+    };
+
+    // Create the depth texture and views. size is the width and height of each face in texels. The map is bound to
+    // the given texture slot for the lit pixel shaders
+    // Will throw a std::runtime_error exception on failure (since constructors can't return errors)
+    ShadowMap(Type type, unsigned int size, unsigned int textureSlot);
+    ~ShadowMap();
+
+    // Position the light. Casters beyond the range from the light don't cast shadows. Spot lights also need their
+    // rotation (Euler angles, as for models) and the full angle of their cone (radians). Point lights ignore both
+    void SetLight(CVector3 position, float range, CVector3 rotation = { 0, 0, 0 }, float coneAngle = PI / 2);
+
+
+    // Re-render the faces whose light or casters have changed since they were last rendered. Only the casters in
+    // each face's frustum are drawn. Changes the render targets and per-frame camera constants, so call before
+    // setting up the views that use the map
+    void Update(const std::vector<SceneObject*>& casters);
+
+    // Select the shadow map and the comparison sampler for the lit pixel shaders
+    void Bind();
+
+
+    // For the per-frame constants: the matrix from world space into the spot light's map, and for point lights the
+    // values giving the depth stored in the cube map for a distance z along a face's axis: depth = scale + offset / z
+    CMatrix4x4 ShadowMatrix()  { return mFaces[0].camera.ViewProjectionMatrix(); }
+    void CubeDepthParameters(float& scale, float& offset);
+
+    // Width and height of each face in texels
+    unsigned int Size()  { return mSize; }
+
+
+    // Statistics for the last update: faces re-rendered and casters drawn into them
+    unsigned int FacesRendered()  { return mFacesRendered; }
+    unsigned int CasterDraws()    { return mCasterDraws;   }
+
+    // Faces checked and faces that didn't need rendering, counted since the last reset
+    unsigned int FacesTested()  { return mFacesTested; }
+    unsigned int CacheHits()    { return mCacheHits;   }
+    void ResetCacheStatistics()  { mFacesTested = 0;  mCacheHits = 0; }
+
+
+private:
+    struct Face
+    {
+        Camera                  camera;
+        ID3D11DepthStencilView* depthStencil = nullptr;
+        uint64_t                signature = 0; // Hash of the camera and casters when the face was last rendered
+        bool                    rendered = false;
+    };
+    std::vector<Face> mFaces;
+
+    Type         mType;
+    unsigned int mSize;
+    unsigned int mTextureSlot;
+
+    std::vector<uint8_t> mCasterFaces; // Faces whose frustum contains each caster, reused between updates
+
+    unsigned int mFacesRendered = 0;
+    unsigned int mCasterDraws = 0;
+    unsigned int mFacesTested = 0;
+    unsigned int mCacheHits = 0;
+
+    ID3D11Texture2D*          mTexture = nullptr;
+    ID3D11ShaderResourceView* mSRV = nullptr;
+};
+
+
+#endif //_SHADOW_MAP_H_INCLUDED_
@@ -0,0 +1,95 @@
+//--------------------------------------------------------------------------------------
+// Shadow map sampling for lit pixel shaders
+//--------------------------------------------------------------------------------------
+// Include after Common.hlsli. The maps are rendered by the ShadowMap and CascadedShadowMap classes
+// in C++, the slots here must match the ones used there (ShadowMap.h, CascadedShadowMap.h)
+//
+// Each lookup uses percentage closer filtering (PCF): several nearby texels are compared with
+// the pixel's depth from the light and the results averaged, softening the shadow edges. The
+// comparison sampler also filters each comparison bilinearly, so a few taps go a long way.
+
+
+Texture2D              SpotShadowMap  : register(t9);  // Depth seen from light 2 (the spotlight)
+TextureCube            PointShadowMap : register(t10); // Depth seen from light 1 (the point light), one face per axis
+Texture2DArray         SunShadowMap   : register(t11); // Depth seen from the sun, one slice per cascade
+SamplerComparisonState ShadowSampler  : register(s2);
+
+
+// Fraction of light 2 reaching a world position: 0 in full shadow, 1 fully lit. 3x3 texel PCF
+float SpotShadow(float3 worldPosition)
+{
+    float4 lightPosition = mul(gLight2ShadowMatrix, float4(worldPosition, 1.0f));
+    float3 shadowPosition = lightPosition.xyz / lightPosition.w;
+
+    // Projected x and y are -1 to 1 with y up, convert to texture coordinates 0 to 1 with v down
+    float2 shadowUV = float2(0.5f * shadowPosition.x + 0.5f, -0.5f * shadowPosition.y + 0.5f);
+
+    float lit = 0;
+    [unroll] for (int y = -1; y <= 1; ++y)
+    {
+        [unroll] for (int x = -1; x <= 1; ++x)
+        {
+            lit += SpotShadowMap.SampleCmpLevelZero(ShadowSampler, shadowUV, shadowPosition.z, int2(x, y));
+        }
+    }
+    return lit / 9.0f;
+}
+
+
+// Fraction of light 1 reaching a world position: 0 in full shadow, 1 fully lit
+// Cube maps can't take texel offsets, so the PCF taps offset the lookup direction towards the corners of a cube
+// about one texel across
+float PointShadow(float3 worldPosition)
+{
+    float3 fromLight = worldPosition - gLight1Position;
+
+    // The face used is the one for the largest component, the distance along its axis gives the depth stored there
+    float3 absFromLight = abs(fromLight);
+    float  faceDistance = max(absFromLight.x, max(absFromLight.y, absFromLight.z));
+    float  depth = gLight1ShadowDepthScale + gLight1ShadowDepthOffset / faceDistance;
+
+    float texel = faceDistance * gLight1ShadowTexelSize;
+    float lit = 0;
+    [unroll] for (int corner = 0; corner < 8; ++corner)
+    {
+        float3 offset = float3((corner & 1) ? texel : -texel, (corner & 2) ? texel : -texel, (corner & 4) ? texel : -texel);
+        lit += PointShadowMap.SampleCmpLevelZero(ShadowSampler, fromLight + offset, depth);
+    }
+    return lit / 8.0f;
+}
+
+
+// Fraction of the sun's light reaching a world position: 0 in full shadow, 1 fully lit. Uses the first (most detailed)
+// cascade containing the position, with 3x3 texel PCF. Positions beyond all the cascades are lit
+float SunShadow(float3 worldPosition)
+{
+    [unroll] for (uint cascade = 0; cascade < NUM_SUN_CASCADES; ++cascade)
+    {
+        // Orthographic projection, so no divide by w. Leave a border for the PCF taps
+        float3 shadowPosition = mul(gSunCascadeMatrices[cascade], float4(worldPosition, 1.0f)).xyz;
+        if (all(abs(shadowPosition.xy) < 0.99f) && shadowPosition.z < 1.0f)
+        {
+            float3 shadowUV = float3(0.5f * shadowPosition.x + 0.5f, -0.5f * shadowPosition.y + 0.5f, cascade);
+            float lit = 0;
+            [unroll] for (int y = -1; y <= 1; ++y)
+            {
+                [unroll] for (int x = -1; x <= 1; ++x)
+                {
+                    lit += SunShadowMap.SampleCmpLevelZero(ShadowSampler, shadowUV, shadowPosition.z, int2(x, y));
+                }
+            }
+            return lit / 9.0f;
+        }
+    }
+    return 1.0f;
+}
+
+
+// Diffuse and specular light from the sun, which has no attenuation, reduced by its shadows
+void SunLight(float3 worldPosition, float3 worldNormal, float3 cameraDirection, out float3 diffuse, out float3 specular)
+{
+    float3 sunDirection = -gSunDirection;
+    diffuse = gSunColour * max(dot(worldNormal, sunDirection), 0) * SunShadow(worldPosition);
+    float3 halfway = normalize(sunDirection + cameraDirection);
+    specular = diffuse * pow(max(dot(worldNormal, halfway), 0), gSpecularPower);
+}
@@ -0,0 +1,108 @@
+//--------------------------------------------------------------------------------------
+// Skinning - deforming vertices by a weighted blend of bone matrices
+//--------------------------------------------------------------------------------------
+
+#include "Skinning.h"
+#include "ParallelFor.h"
+
+#include <cstring>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define SKINNING_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+
+// Vertices per batch when skinning over several threads. Large enough that the threading overhead is small
+const unsigned int SKINNING_BATCH_SIZE = 2048;
+
+
+//--------------------------------------------------------------------------------------
+// Skinning
+//--------------------------------------------------------------------------------------
+
+// Skin a range of vertices, copying them from source to destination
+void SkinVertices(const unsigned char* source, unsigned char* destination, unsigned int start, unsigned int end,
+                  const SkinnedVertexFormat& format, const CMatrix4x4* palette)
+{
+    const unsigned char* in  = source      + start * format.vertexSize;
+    unsigned char*       out = destination + start * format.vertexSize;
+    bool hasTangents = (format.tangentOffset != SkinnedVertexFormat::NO_TANGENTS);
+
+    for (unsigned int v = start; v < end; ++v, in += format.vertexSize, out += format.vertexSize)
+    {
+        // Copy the whole vertex so UVs etc. are carried over, then overwrite the skinned parts
+        std::memcpy(out, in, format.vertexSize);
+
+        const uint8_t* bones = in + format.boneIndexOffset;
+        float weights[MAX_BONE_INFLUENCES];
+        std::memcpy(weights, in + format.boneWeightOffset, sizeof(weights));
+
+#ifdef SKINNING_USE_SSE
+        // Blend the first three rows of the bone matrices (rotation/scale and translation) four floats at a time
+        __m128 row0 = _mm_setzero_ps(), row1 = _mm_setzero_ps(), row2 = _mm_setzero_ps(), row3 = _mm_setzero_ps();
+        for (unsigned int i = 0; i < MAX_BONE_INFLUENCES; ++i)
+        {
+            if (weights[i] == 0)  continue;
+            const float* m = &palette[bones[i]].e00;
+            __m128 weight = _mm_set1_ps(weights[i]);
+            row0 = _mm_add_ps(row0, _mm_mul_ps(weight, _mm_loadu_ps(m)));
+            row1 = _mm_add_ps(row1, _mm_mul_ps(weight, _mm_loadu_ps(m + 4)));
+            row2 = _mm_add_ps(row2, _mm_mul_ps(weight, _mm_loadu_ps(m + 8)));
+            row3 = _mm_add_ps(row3, _mm_mul_ps(weight, _mm_loadu_ps(m + 12)));
+        }
+
+        // Row vector times matrix: x * row0 + y * row1 + z * row2 (+ row3 for points)
+        auto Transform = [&](unsigned int offset, bool isPoint)
+        {
+            float p[3];
+            std::memcpy(p, in + offset, sizeof(p));
+            __m128 result = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p[0]), row0),
+                                                  _mm_mul_ps(_mm_set1_ps(p[1]), row1)),
+                                                  _mm_mul_ps(_mm_set1_ps(p[2]), row2));
+            if (isPoint)  result = _mm_add_ps(result, row3);
+
+            float r[4];
+            _mm_storeu_ps(r, result);
+            std::memcpy(out + offset, r, 12); // Only write 3 floats, the 4th would overwrite the next vertex element
+        };
+#else
+        // Scalar version of the above
+        float blended[16] = {};
+        for (unsigned int i = 0; i < MAX_BONE_INFLUENCES; ++i)
+        {
+            if (weights[i] == 0)  continue;
+            const float* m = &palette[bones[i]].e00;
+            for (int e = 0; e < 16; ++e)  blended[e] += weights[i] * m[e];
+        }
+
+        auto Transform = [&](unsigned int offset, bool isPoint)
+        {
+            float p[3];
+            std::memcpy(p, in + offset, sizeof(p));
+            float r[3];
+            for (int c = 0; c < 3; ++c)
+            {
+                r[c] = p[0] * blended[c] + p[1] * blended[4 + c] + p[2] * blended[8 + c] + (isPoint ? blended[12 + c] : 0.0f);
+            }
+            std::memcpy(out + offset, r, sizeof(r));
+        };
+#endif
+
+        Transform(format.positionOffset, true);
+        Transform(format.normalOffset, false);
+        if (hasTangents)  Transform(format.tangentOffset, false);
+    }
+}
+
+
+// Skin a whole mesh, split into batches over the worker threads
+void SkinVerticesParallel(const unsigned char* source, unsigned char* destination, unsigned int numVertices,
+                          const SkinnedVertexFormat& format, const CMatrix4x4* palette)
+{
+    ParallelFor(numVertices, SKINNING_BATCH_SIZE, [&](unsigned int start, unsigned int end)
+    {
+        SkinVertices(source, destination, start, end, format, palette);
+    });
+}
@@ -0,0 +1,48 @@
+//--------------------------------------------------------------------------------------
+// Skinning - deforming vertices by a weighted blend of bone matrices
+//--------------------------------------------------------------------------------------
+// The CPU skinning path, an alternative to skinning in the vertex shader (Skinning_vs.hlsl).
+// Works on any vertex layout: the format structure gives the offsets of the data used.
+// Uses SSE where available and spreads large meshes over the ParallelFor worker threads.
+// No DirectX in here so skinning can be run (and tested) headless.
+
+#ifndef _SKINNING_H_INCLUDED_
+#define _SKINNING_H_INCLUDED_
+
+#include "CMatrix4x4.h"
+
+
+// Maximum number of bones in a sub-mesh. Must match the array size in the skinning vertex shader
+const unsigned int MAX_BONES = 64;
+
+// Maximum number of bones that can influence a single vertex
+const unsigned int MAX_BONE_INFLUENCES = 4;
+
+
+// Where the skinning data is in each vertex. Bone indices are 4 bytes, weights are 4 floats that sum to 1.
+// Tangents are optional, set tangentOffset to NO_TANGENTS if there are none
+struct SkinnedVertexFormat
+{
+    static const unsigned int NO_TANGENTS = ~0u;
+
+    unsigned int vertexSize;
+    unsigned int positionOffset;
+    unsigned int normalOffset;
+    unsigned int tangentOffset = NO_TANGENTS;
+    unsigned int boneIndexOffset;
+    unsigned int boneWeightOffset;
+};
+
+
+// Skin a range of vertices. Each source vertex is copied to the destination with its position, normal (and tangent)
+// transformed by the weighted blend of its bone matrices from the palette. Normals are not renormalised (the pixel
+// shaders normalise them) so palettes should not contain non-uniform scaling
+void SkinVertices(const unsigned char* source, unsigned char* destination, unsigned int start, unsigned int end,
+                  const SkinnedVertexFormat& format, const CMatrix4x4* palette);
+
+// As above for a whole mesh, split into batches over the worker threads
+void SkinVerticesParallel(const unsigned char* source, unsigned char* destination, unsigned int numVertices,
+                          const SkinnedVertexFormat& format, const CMatrix4x4* palette);
+
+
+#endif //_SKINNING_H_INCLUDED_
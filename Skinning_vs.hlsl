@@ -0,0 +1,32 @@
+//--------------------------------------------------------------------------------------
+// Skinning Vertex Shader
+//--------------------------------------------------------------------------------------
+// Deforms each vertex by a weighted blend of up to four bone matrices, then outputs the
+// same data as the pixel lighting vertex shader so it can be used with the lit pixel shaders
+
+#include "Common.hlsli"
+
+LightingPixelShaderInput main(SkinnedVertex modelVertex)
+{
+    LightingPixelShaderInput output;
+
+    // Blend the bone matrices by the vertex weights. The bone matrices already include the world matrix
+    float4x4 skinMatrix = gBoneMatrices[modelVertex.bones.x] * modelVertex.weights.x +
+                          gBoneMatrices[modelVertex.bones.y] * modelVertex.weights.y +
+                          gBoneMatrices[modelVertex.bones.z] * modelVertex.weights.z +
+                          gBoneMatrices[modelVertex.bones.w] * modelVertex.weights.w;
+
+    float4 modelPosition = float4(modelVertex.position, 1);
+    float4 worldPosition     = mul(skinMatrix,        modelPosition);
+    float4 viewPosition      = mul(gViewMatrix,       worldPosition);
+    output.projectedPosition = mul(gProjectionMatrix, viewPosition);
+
+    // Normals are transformed the same way (bones should not contain non-uniform scaling)
+    float4 modelNormal = float4(modelVertex.normal, 0);
+    output.worldNormal = mul(skinMatrix, modelNormal).xyz;
+
+    output.worldPosition = worldPosition.xyz;
+    output.uv = modelVertex.uv;
+
+    return output;
+}
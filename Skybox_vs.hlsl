@@ -4,13 +4,14 @@ SkyboxPixelShaderInput main(SkyboxVertex modelVertex)
 {
 	SkyboxPixelShaderInput output;
 
-	// Input position is x,y,z only
-	float4 modelPosition = float4(modelVertex.position, 1);
+	// Transform by the rotation and scale of the world and view matrices only (w = 0 ignores their translations) so the
+	// skybox is always centred on the camera, whichever camera is rendering
+	float3 worldDirection = mul(gWorldMatrix, float4(modelVertex.position, 0)).xyz;
+	float4 viewPosition = float4(mul(gViewMatrix, float4(worldDirection, 0)).xyz, 1);
+	output.projectedPosition = mul(gProjectionMatrix, viewPosition);
 
-	// Multiply by the world matrix passed from C++ to transform the model vertex position into world space.
-	float4 worldPosition = mul(gWorldMatrix, modelPosition);
-	float4 viewPosition = mul(gViewMatrix, worldPosition);
-	output.projectedPosition = mul(gProjectionMatrix, viewPosition).xyww;
+	// Place the skybox at the furthest depth (z = w gives depth 1, or z = 0 with reverse-Z projection)
+	output.projectedPosition.z = output.projectedPosition.w * gFarDepth;
 	
 	// Pass texture coordinates (UVs) on to the pixel shader
 	output.position = modelVertex.position;
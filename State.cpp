@@ -21,17 +21,20 @@
 ID3D11SamplerState* gPointSampler         = nullptr;
 ID3D11SamplerState* gTrilinearSampler     = nullptr;
 ID3D11SamplerState* gAnisotropic4xSampler = nullptr;
+ID3D11SamplerState* gShadowSampler        = nullptr;
 
 // Blend states allow us to switch between blending modes (none, additive, multiplicative etc.)
 ID3D11BlendState* gNoBlendingState       = nullptr;
 ID3D11BlendState* gAdditiveBlendingState = nullptr;
 ID3D11BlendState* gMultiplicativeBlendingState = nullptr;
 ID3D11BlendState* gAlphaBlendingState = nullptr;
+ID3D11BlendState* gOITBlendingState = nullptr;
 
 // Rasterizer states affect how triangles are drawn
 ID3D11RasterizerState* gCullBackState  = nullptr;
 ID3D11RasterizerState* gCullFrontState = nullptr;
 ID3D11RasterizerState* gCullNoneState  = nullptr;
+ID3D11RasterizerState* gShadowCasterState = nullptr;
 
 // Depth-stencil states allow us change how the depth buffer is used
 ID3D11DepthStencilState* gUseDepthBufferState = nullptr;
@@ -39,6 +42,10 @@ ID3D11DepthStencilState* gSkyboxDepthBufferState = nullptr;
 ID3D11DepthStencilState* gDepthReadOnlyState  = nullptr;
 ID3D11DepthStencilState* gNoDepthBufferState  = nullptr;
 
+ID3D11DepthStencilState* gUseDepthBufferReverseState    = nullptr;
+ID3D11DepthStencilState* gSkyboxDepthBufferReverseState = nullptr;
+ID3D11DepthStencilState* gDepthReadOnlyReverseState     = nullptr;
+
 
 
 //--------------------------------------------------------------------------------------
@@ -108,6 +115,27 @@ bool CreateStates()
 	}
 
 
+	////-------- Shadow map comparison --------////
+	// Sampling returns the fraction of the (bilinear) texels whose depth passes the comparison rather than the depth
+	// itself, so each tap of percentage closer filtering (PCF) is already smoothed. Outside the map is unshadowed
+	samplerDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT;
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_BORDER;
+	samplerDesc.BorderColor[0] = samplerDesc.BorderColor[1] = samplerDesc.BorderColor[2] = samplerDesc.BorderColor[3] = 1.0f;
+	samplerDesc.ComparisonFunc = D3D11_COMPARISON_LESS_EQUAL; // Lit if the pixel's depth is not beyond the stored depth
+	samplerDesc.MaxAnisotropy = 1;
+
+	samplerDesc.MaxLOD = 0;
+	samplerDesc.MinLOD = 0;
+
+	if (FAILED(gD3DDevice->CreateSamplerState(&samplerDesc, &gShadowSampler)))
+	{
+		gLastError = "Error creating shadow sampler";
+		return false;
+	}
+
+
     //--------------------------------------------------------------------------------------
 	// Rasterizer States
 	//--------------------------------------------------------------------------------------
@@ -156,6 +184,23 @@ bool CreateStates()
         gLastError = "Error creating cull-none state";
         return false;
     }
+
+
+    ////-------- Shadow casters --------////
+    // Used when rendering shadow maps. Depth is pushed away from the light, more on surfaces at a steep angle to it,
+    // so lit surfaces don't shadow themselves (shadow acne)
+    rasterizerDesc.FillMode              = D3D11_FILL_SOLID;
+    rasterizerDesc.CullMode              = D3D11_CULL_BACK;
+    rasterizerDesc.DepthBias             = 100;
+    rasterizerDesc.SlopeScaledDepthBias  = 2.0f;
+    rasterizerDesc.DepthBiasClamp        = 0.0f;
+    rasterizerDesc.DepthClipEnable       = TRUE;
+
+    if (FAILED(gD3DDevice->CreateRasterizerState(&rasterizerDesc, &gShadowCasterState)))
+    {
+        gLastError = "Error creating shadow caster state";
+        return false;
+    }
 	
 	
     //--------------------------------------------------------------------------------------
@@ -242,6 +287,35 @@ bool CreateStates()
 		gLastError = "Error creating alpha-blend state";
 		return false;
 	}
+
+	////-------- Weighted Blended OIT State --------////
+	// Two render targets blended differently (see WeightedOIT.h): weighted colours and alphas are summed in the first,
+	// the second is multiplied by one minus each alpha, written by the pixel shader to every channel
+	blendDesc.IndependentBlendEnable = TRUE;
+	blendDesc.RenderTarget[0].BlendEnable = TRUE;
+	blendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
+	blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_ONE;
+	blendDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+	blendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+	blendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ONE;
+	blendDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	blendDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+
+	blendDesc.RenderTarget[1].BlendEnable = TRUE;
+	blendDesc.RenderTarget[1].SrcBlend = D3D11_BLEND_ZERO;
+	blendDesc.RenderTarget[1].DestBlend = D3D11_BLEND_INV_SRC_COLOR;
+	blendDesc.RenderTarget[1].BlendOp = D3D11_BLEND_OP_ADD;
+	blendDesc.RenderTarget[1].SrcBlendAlpha = D3D11_BLEND_ZERO;
+	blendDesc.RenderTarget[1].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+	blendDesc.RenderTarget[1].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	blendDesc.RenderTarget[1].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+
+	if (FAILED(gD3DDevice->CreateBlendState(&blendDesc, &gOITBlendingState)))
+	{
+		gLastError = "Error creating weighted blended OIT state";
+		return false;
+	}
+	blendDesc.IndependentBlendEnable = FALSE;
 	
 	//--------------------------------------------------------------------------------------
 	// Depth-Stencil States
@@ -306,6 +380,22 @@ bool CreateStates()
         return false;
     }
 
+
+	////-------- Reverse-Z versions of the states above --------////
+    // With reverse-Z projection nearer depths are larger, so the comparisons are flipped
+    ID3D11DepthStencilState* forwardStates[] = { gUseDepthBufferState, gSkyboxDepthBufferState, gDepthReadOnlyState };
+    ID3D11DepthStencilState** reverseStates[] = { &gUseDepthBufferReverseState, &gSkyboxDepthBufferReverseState, &gDepthReadOnlyReverseState };
+    for (int i = 0; i < 3; ++i)
+    {
+        forwardStates[i]->GetDesc(&depthStencilDesc);
+        depthStencilDesc.DepthFunc = (depthStencilDesc.DepthFunc == D3D11_COMPARISON_LESS) ? D3D11_COMPARISON_GREATER : D3D11_COMPARISON_GREATER_EQUAL;
+        if (FAILED(gD3DDevice->CreateDepthStencilState(&depthStencilDesc, reverseStates[i])))
+        {
+            gLastError = "Error creating reverse-Z depth state";
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -313,6 +403,9 @@ bool CreateStates()
 // Release DirectX state objects
 void ReleaseStates()
 {
+    if (gUseDepthBufferReverseState)    gUseDepthBufferReverseState->Release();
+    if (gSkyboxDepthBufferReverseState) gSkyboxDepthBufferReverseState->Release();
+    if (gDepthReadOnlyReverseState)     gDepthReadOnlyReverseState->Release();
     if (gUseDepthBufferState)    gUseDepthBufferState->Release();
 	if (gSkyboxDepthBufferState) gSkyboxDepthBufferState->Release();
     if (gDepthReadOnlyState)     gDepthReadOnlyState->Release();
@@ -320,11 +413,24 @@ void ReleaseStates()
     if (gCullBackState)          gCullBackState->Release();
     if (gCullFrontState)         gCullFrontState->Release();
     if (gCullNoneState)          gCullNoneState->Release();
+    if (gShadowCasterState)      gShadowCasterState->Release();
     if (gNoBlendingState)        gNoBlendingState->Release();
     if (gAdditiveBlendingState)  gAdditiveBlendingState->Release();
 	if (gMultiplicativeBlendingState) gMultiplicativeBlendingState->Release();
+    if (gOITBlendingState)       gOITBlendingState->Release();
 	if (gAlphaBlendingState)	 gAlphaBlendingState->Release();
+    if (gShadowSampler)          gShadowSampler->Release();
     if (gAnisotropic4xSampler)   gAnisotropic4xSampler->Release();
     if (gTrilinearSampler)       gTrilinearSampler->Release();
     if (gPointSampler)           gPointSampler->Release();
 }
+
+
+// Return the reverse-Z version of one of the depth states above, or the state itself if it doesn't test depth
+ID3D11DepthStencilState* ReverseDepthState(ID3D11DepthStencilState* state)
+{
+    if (state == gUseDepthBufferState)     return gUseDepthBufferReverseState;
+    if (state == gSkyboxDepthBufferState)  return gSkyboxDepthBufferReverseState;
+    if (state == gDepthReadOnlyState)      return gDepthReadOnlyReverseState;
+    return state;
+}
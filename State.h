@@ -21,21 +21,29 @@
 extern ID3D11SamplerState* gPointSampler;
 extern ID3D11SamplerState* gTrilinearSampler;
 extern ID3D11SamplerState* gAnisotropic4xSampler;
+extern ID3D11SamplerState* gShadowSampler; // Comparison sampler for shadow maps
 
 extern ID3D11BlendState* gNoBlendingState;
 extern ID3D11BlendState* gAdditiveBlendingState;
 extern ID3D11BlendState* gMultiplicativeBlendingState;
 extern ID3D11BlendState* gAlphaBlendingState;
+extern ID3D11BlendState* gOITBlendingState; // Accumulation and revealage targets for weighted blended transparency
 
 extern ID3D11RasterizerState*   gCullBackState;
 extern ID3D11RasterizerState*   gCullFrontState;
 extern ID3D11RasterizerState*   gCullNoneState;
+extern ID3D11RasterizerState*   gShadowCasterState; // Back face culling with depth bias, for rendering shadow maps
 
 extern ID3D11DepthStencilState* gUseDepthBufferState;
 extern ID3D11DepthStencilState* gSkyboxDepthBufferState;
 extern ID3D11DepthStencilState* gDepthReadOnlyState;
 extern ID3D11DepthStencilState* gNoDepthBufferState;
 
+// Versions of the depth states above for reverse-Z rendering, where nearer depths are larger
+extern ID3D11DepthStencilState* gUseDepthBufferReverseState;
+extern ID3D11DepthStencilState* gSkyboxDepthBufferReverseState;
+extern ID3D11DepthStencilState* gDepthReadOnlyReverseState;
+
 
 //--------------------------------------------------------------------------------------
 // State creation / destruction
@@ -47,5 +55,8 @@ bool CreateStates();
 // Release DirectX state objects
 void ReleaseStates();
 
+// Return the reverse-Z version of one of the depth states above, or the state itself if it doesn't test depth
+ID3D11DepthStencilState* ReverseDepthState(ID3D11DepthStencilState* state);
+
 
 #endif //_STATE_H_INCLUDED_
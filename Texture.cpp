@@ -1,6 +1,34 @@
 #include "Texture.h"
 
 #include "GraphicsHelpers.h"
+#include "DDSFile.h"
+
+#include <memory>
+#include <stdexcept>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+TextureStreamer* gTextureStreamer = nullptr;
+
+namespace
+{
+	// Folder the texture cooker writes to, see CookTextures.txt
+	const std::string COOKED_TEXTURE_FOLDER = "Cooked/";
+}
+
+// The file to load for a texture: its cooked version if there is one that is no older than the original,
+// otherwise the original
+std::string TextureFileToLoad(const std::string& fileName)
+{
+	std::string baseName = fileName.substr(0, fileName.find_last_of('.'));
+	std::string cookedName = COOKED_TEXTURE_FOLDER + baseName + ".dds";
+
+	struct stat original, cooked;
+	if (stat(cookedName.c_str(), &cooked) != 0)  return fileName;
+	if (stat(fileName.c_str(), &original) == 0 && original.st_mtime > cooked.st_mtime)  return fileName;
+	return cookedName;
+}
 
 Texture::Texture(std::string filename)
 {
@@ -15,7 +43,21 @@ Texture::~Texture()
 
 bool Texture::Load()
 {
-	if (!LoadTexture(fileName, &textureResource, &textureSRV))
+	if (inAtlas)  return true; // Loaded with its atlas
+
+	std::string loadName = TextureFileToLoad(fileName);
+	StreamedImage image;
+	if (gTextureStreamer && ReadStreamableDDS(loadName, image))
+	{
+		if (!gTextureStreamer->Add(this, image))
+		{
+			gLastError = "Error loading texture " + fileName;
+			return false;
+		}
+		return true;
+	}
+
+	if (!LoadTexture(loadName, &textureResource, &textureSRV))
 	{
 		gLastError = "Error loading texture " + fileName;
 		return false;
@@ -27,3 +69,161 @@ ID3D11ShaderResourceView** Texture::TextureSRV()
 {
 	return &textureSRV;
 }
+
+const std::string& Texture::FileName()
+{
+	return fileName;
+}
+
+bool Texture::Reload()
+{
+	// An edited original is newer than its cooked version, so is loaded until it is cooked again
+	std::string loadName = TextureFileToLoad(fileName);
+
+	// Streamed textures start again from their smallest mips
+	if (gTextureStreamer && gTextureStreamer->IsStreamed(this))
+	{
+		StreamedImage image;
+		if (!ReadStreamableDDS(loadName, image) || !gTextureStreamer->Restart(this, image))
+		{
+			gLastError = "Error reloading texture " + fileName;
+			return false;
+		}
+		return true;
+	}
+
+	ID3D11Resource* newResource = nullptr;
+	ID3D11ShaderResourceView* newSRV = nullptr;
+	if (!LoadTexture(loadName, &newResource, &newSRV))
+	{
+		gLastError = "Error reloading texture " + fileName;
+		return false;
+	}
+	Replace(newResource, newSRV);
+
+	// A texture in an atlas now has its own, the new file may not fit its region
+	inAtlas = false;
+	uvScale = { 1, 1 };
+	uvOffset = { 0, 0 };
+	return true;
+}
+
+ID3D11Resource* Texture::Resource()
+{
+	return textureResource;
+}
+
+void Texture::Replace(ID3D11Resource* resource, ID3D11ShaderResourceView* srv)
+{
+	if (textureResource) textureResource->Release();
+	if (textureSRV) textureSRV->Release();
+	textureResource = resource;
+	textureSRV = srv;
+}
+
+void Texture::SetAtlas(ID3D11Resource* atlas, ID3D11ShaderResourceView* atlasSRV, CVector2 regionScale, CVector2 regionOffset)
+{
+	atlas->AddRef();
+	atlasSRV->AddRef();
+	Replace(atlas, atlasSRV);
+	inAtlas = true;
+	uvScale = regionScale;
+	uvOffset = regionOffset;
+}
+
+bool Texture::IsInAtlas()
+{
+	return inAtlas;
+}
+
+CVector2 Texture::UVScale()
+{
+	return uvScale;
+}
+
+CVector2 Texture::UVOffset()
+{
+	return uvOffset;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Texture streaming
+//--------------------------------------------------------------------------------------
+
+bool D3DStreamingDevice::ReadMip(const StreamedImage& image, unsigned int mip, MipData& data)
+{
+	std::shared_ptr<DDSFile> file;
+	try
+	{
+		file = std::make_shared<DDSFile>(image.fileName);
+	}
+	catch (std::runtime_error&)
+	{
+		return false;
+	}
+
+	// The file may have changed since the image was read, a reload will follow but the mip must still be where expected
+	if (file->ArraySize() != 1 || file->NumberMips() != image.mips.size() || file->Format() != image.format)  return false;
+	const DDSSubresource& subresource = file->Subresource(0, mip);
+	if (subresource.fileOffset != image.mips[mip].fileOffset || subresource.size != image.mips[mip].size)  return false;
+
+	// Touch each page so the OS reads the mip from disk here on the streaming thread, rather than when the main
+	// thread uploads it
+	const volatile char* bytes = static_cast<const char*>(subresource.data);
+	for (size_t offset = 0; offset < subresource.size; offset += 4096)  (void)bytes[offset];
+	(void)bytes[subresource.size - 1];
+
+	data.owner = file;
+	data.data = subresource.data;
+	data.size = subresource.size;
+	return true;
+}
+
+bool D3DStreamingDevice::SetResidentMips(Texture* texture, const StreamedImage& image, unsigned int firstMip,
+                                         unsigned int oldFirstMip, const std::vector<MipData>& newMips)
+{
+	unsigned int numMips = static_cast<unsigned int>(image.mips.size());
+	if (firstMip < oldFirstMip && newMips.size() < std::min(oldFirstMip, numMips) - firstMip)  return false;
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = image.mips[firstMip].width;
+	desc.Height = image.mips[firstMip].height;
+	desc.MipLevels = numMips - firstMip;
+	desc.ArraySize = 1;
+	desc.Format = static_cast<DXGI_FORMAT>(image.format);
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	ID3D11Texture2D* newTexture = nullptr;
+	if (FAILED(gD3DDevice->CreateTexture2D(&desc, nullptr, &newTexture)))  return false;
+
+	// New mips are uploaded, those the old texture holds are copied across on the GPU
+	for (unsigned int mip = firstMip; mip < numMips; ++mip)
+	{
+		UINT subresource = mip - firstMip;
+		if (mip < oldFirstMip)
+		{
+			const auto& data = newMips[mip - firstMip];
+			if (data.data == nullptr || data.size < image.mips[mip].size)
+			{
+				newTexture->Release();
+				return false;
+			}
+			gD3DContext->UpdateSubresource(newTexture, subresource, nullptr, data.data, image.mips[mip].rowPitch, 0);
+		}
+		else
+		{
+			gD3DContext->CopySubresourceRegion(newTexture, subresource, 0, 0, 0, texture->Resource(), mip - oldFirstMip, nullptr);
+		}
+	}
+
+	ID3D11ShaderResourceView* newSRV = nullptr;
+	if (FAILED(gD3DDevice->CreateShaderResourceView(newTexture, nullptr, &newSRV)))
+	{
+		newTexture->Release();
+		return false;
+	}
+	texture->Replace(newTexture, newSRV);
+	return true;
+}
@@ -2,17 +2,62 @@
 #include <d3d11.h>
 #include <string>
 
+#include "TextureStreamer.h"
+#include "CVector2.h"
+
 class Texture
 {
 public:
 	Texture(std::string filename);
 	~Texture();
+
+	// Load the texture, or its version in the Cooked folder if the texture cooker has made one since the file last
+	// changed. DDS files with mip chains are streamed if there is a texture streamer (gTextureStreamer), so only their
+	// smallest mips are loaded here
 	bool Load();
 	ID3D11ShaderResourceView** TextureSRV();
+	const std::string& FileName();
+
+	// Load the file again, replacing the texture if it succeeds. Users holding the pointer from TextureSRV see the new
+	// texture. Returns false and keeps the old texture on failure
+	bool Reload();
+
+	// The texture on the GPU, and replace it with a new one and its view, releasing the old ones
+	ID3D11Resource* Resource();
+	void Replace(ID3D11Resource* resource, ID3D11ShaderResourceView* srv);
+
+	// Use a region of a texture atlas (see TextureAtlas.h), taking a reference to the atlas and its view. Load then
+	// does nothing, and models using the texture map their UVs to the region with the scale and offset. Reloading the
+	// texture takes it back out of the atlas, since the file may no longer fit its region
+	void SetAtlas(ID3D11Resource* atlas, ID3D11ShaderResourceView* atlasSRV, CVector2 regionScale, CVector2 regionOffset);
+	bool IsInAtlas();
+	CVector2 UVScale();
+	CVector2 UVOffset();
 
 private:
 	std::string fileName;
-	ID3D11Resource* textureResource;
-	ID3D11ShaderResourceView* textureSRV;
+	ID3D11Resource* textureResource = nullptr;
+	ID3D11ShaderResourceView* textureSRV = nullptr;
+
+	bool inAtlas = false;
+	CVector2 uvScale = { 1, 1 };
+	CVector2 uvOffset = { 0, 0 };
+};
+
+// The file Texture::Load reads for an image file: its version in the Cooked folder if the texture cooker has made one
+// since the file last changed, otherwise the file itself
+std::string TextureFileToLoad(const std::string& fileName);
+
+
+// Streams mips from DDS files into Texture objects, replacing the GPU texture with one holding the resident mips.
+// Mips are uploaded straight from the memory mapped file, which is only kept mapped until they have been uploaded
+class D3DStreamingDevice : public StreamingDevice
+{
+public:
+	bool ReadMip(const StreamedImage& image, unsigned int mip, MipData& data) override;
+	bool SetResidentMips(Texture* texture, const StreamedImage& image, unsigned int firstMip,
+	                     unsigned int oldFirstMip, const std::vector<MipData>& newMips) override;
 };
 
+// Streamer used when loading textures, they are loaded whole if it is null. Delete it before the textures
+extern TextureStreamer* gTextureStreamer;
@@ -0,0 +1,335 @@
+//--------------------------------------------------------------------------------------
+// Packing small textures into shared atlas textures
+//--------------------------------------------------------------------------------------
+
+#include "TextureAtlas.h"
+#include "RectPacker.h"
+#include "BCDecoder.h"
+#include "GraphicsHelpers.h"
+
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+
+namespace
+{
+    // Mips in each atlas. Images are placed on a grid of the texels of the smallest mip, with a gutter of one of its
+    // texels around them, so fewer mips waste less space
+    const unsigned int ATLAS_MIP_LEVELS = 4;
+    const uint32_t     ATLAS_ALIGNMENT  = 1 << (ATLAS_MIP_LEVELS - 1);
+    const uint32_t     ATLAS_GUTTER     = ATLAS_ALIGNMENT;
+
+    // Largest atlas, and largest image worth packing (bigger ones gain little and would take up most of an atlas)
+    const uint32_t ATLAS_MAX_SIZE       = 2048;
+    const uint32_t ATLAS_MAX_IMAGE_SIZE = 256;
+
+    // An image to pack: its top level in RGBA, where it goes and the textures that use it
+    struct AtlasImage
+    {
+        std::string          fileName;
+        bool                 sRGB = false;
+        uint32_t             width = 0;
+        uint32_t             height = 0;
+        std::vector<uint8_t> rgba;
+        bool                 placed = false;
+        uint32_t             x = 0; // Top-left of the image's cell (including the gutter) in its atlas
+        uint32_t             y = 0;
+        std::vector<Texture*> textures;
+    };
+
+    uint32_t RoundUp(uint32_t value, uint32_t multiple)  { return (value + multiple - 1) / multiple * multiple; }
+    uint32_t CellWidth(const AtlasImage& image)   { return RoundUp(image.width  + 2 * ATLAS_GUTTER, ATLAS_ALIGNMENT); }
+    uint32_t CellHeight(const AtlasImage& image)  { return RoundUp(image.height + 2 * ATLAS_GUTTER, ATLAS_ALIGNMENT); }
+
+
+    // Load the top level of an image file to the GPU as Texture::Load would (so from its cooked version if it has one,
+    // which is usually block compressed) and copy it back to the CPU as RGBA. Returns false if the image can't be
+    // loaded or its format can't be packed
+    bool ReadImage(AtlasImage& image)
+    {
+        ID3D11Resource* resource = nullptr;
+        ID3D11ShaderResourceView* srv = nullptr;
+        if (!LoadTexture(TextureFileToLoad(image.fileName), &resource, &srv))  return false;
+        srv->Release();
+
+        ID3D11Texture2D* texture = nullptr;
+        HRESULT hr = resource->QueryInterface(__uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&texture));
+        resource->Release();
+        if (FAILED(hr))  return false; // Not a 2D texture
+
+        D3D11_TEXTURE2D_DESC desc;
+        texture->GetDesc(&desc);
+        bool isBGRA = (desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM || desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB ||
+                       desc.Format == DXGI_FORMAT_B8G8R8X8_UNORM || desc.Format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB);
+        bool isRGBA = (desc.Format == DXGI_FORMAT_R8G8B8A8_UNORM || desc.Format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB);
+        bool isBC = BCBlockBytes(desc.Format) > 0 && desc.Format != DXGI_FORMAT_BC6H_UF16 && desc.Format != DXGI_FORMAT_BC6H_SF16;
+        if ((!isBGRA && !isRGBA && !isBC) || desc.ArraySize != 1 || (desc.MiscFlags & D3D11_RESOURCE_MISC_TEXTURECUBE) ||
+            desc.Width > ATLAS_MAX_IMAGE_SIZE || desc.Height > ATLAS_MAX_IMAGE_SIZE)
+        {
+            texture->Release();
+            return false;
+        }
+        image.width = desc.Width;
+        image.height = desc.Height;
+        image.sRGB = (desc.Format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB || desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB ||
+                      desc.Format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB || desc.Format == DXGI_FORMAT_BC1_UNORM_SRGB ||
+                      desc.Format == DXGI_FORMAT_BC2_UNORM_SRGB || desc.Format == DXGI_FORMAT_BC3_UNORM_SRGB ||
+                      desc.Format == DXGI_FORMAT_BC7_UNORM_SRGB);
+
+        // Copy the top level to a texture the CPU can read
+        D3D11_TEXTURE2D_DESC stagingDesc = desc;
+        stagingDesc.MipLevels = 1;
+        stagingDesc.Usage = D3D11_USAGE_STAGING;
+        stagingDesc.BindFlags = 0;
+        stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+        stagingDesc.MiscFlags = 0;
+        ID3D11Texture2D* staging = nullptr;
+        hr = gD3DDevice->CreateTexture2D(&stagingDesc, nullptr, &staging);
+        if (SUCCEEDED(hr))  gD3DContext->CopySubresourceRegion(staging, 0, 0, 0, 0, texture, 0, nullptr);
+        texture->Release();
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        if (SUCCEEDED(hr))  hr = gD3DContext->Map(staging, 0, D3D11_MAP_READ, 0, &mapped);
+        if (FAILED(hr))
+        {
+            if (staging)  staging->Release();
+            return false;
+        }
+
+        image.rgba.resize(static_cast<size_t>(image.width) * image.height * 4);
+        if (isBC)
+        {
+            DDSSubresource subresource = {};
+            subresource.data = mapped.pData;
+            subresource.rowPitch = mapped.RowPitch;
+            subresource.width = image.width;
+            subresource.height = image.height;
+            subresource.size = mapped.RowPitch * ((image.height + 3) / 4);
+            DecodeBCImage(desc.Format, subresource, image.rgba.data(), false);
+        }
+        else
+        {
+            bool opaque = (desc.Format == DXGI_FORMAT_B8G8R8X8_UNORM || desc.Format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB);
+            for (uint32_t y = 0; y < image.height; ++y)
+            {
+                const uint8_t* in = static_cast<const uint8_t*>(mapped.pData) + static_cast<size_t>(y) * mapped.RowPitch;
+                uint8_t* out = image.rgba.data() + static_cast<size_t>(y) * image.width * 4;
+                std::memcpy(out, in, image.width * 4);
+                if (isBGRA)
+                {
+                    for (uint32_t x = 0; x < image.width; ++x, out += 4)
+                    {
+                        std::swap(out[0], out[2]);
+                        if (opaque)  out[3] = 255;
+                    }
+                }
+            }
+        }
+        gD3DContext->Unmap(staging, 0);
+        staging->Release();
+        return true;
+    }
+
+
+    // Place the cells of images in a packer of the given size, tallest first. If all is set they must all fit, otherwise
+    // those that don't are left unplaced. Returns false if all is set and they don't fit
+    bool PackImages(std::vector<AtlasImage*>& images, uint32_t width, uint32_t height, bool all)
+    {
+        std::sort(images.begin(), images.end(), [](const AtlasImage* a, const AtlasImage* b)
+        {
+            return CellHeight(*a) != CellHeight(*b) ? CellHeight(*a) > CellHeight(*b) : CellWidth(*a) > CellWidth(*b);
+        });
+        RectPacker packer(width, height);
+        for (auto image : images)
+        {
+            image->placed = packer.Insert(CellWidth(*image), CellHeight(*image), image->x, image->y);
+            if (!image->placed && all)  return false;
+        }
+        return true;
+    }
+
+
+    // Average 2x2 texels to make the next mip, in linear space for sRGB atlases
+    std::vector<uint8_t> HalveImage(const std::vector<uint8_t>& rgba, uint32_t width, uint32_t height, bool sRGB)
+    {
+        static float toLinear[256];
+        static bool tableMade = false;
+        if (!tableMade)
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                float c = i / 255.0f;
+                toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            tableMade = true;
+        }
+
+        uint32_t halfWidth = std::max(width / 2, 1u), halfHeight = std::max(height / 2, 1u);
+        std::vector<uint8_t> half(static_cast<size_t>(halfWidth) * halfHeight * 4);
+        for (uint32_t y = 0; y < halfHeight; ++y)
+        {
+            for (uint32_t x = 0; x < halfWidth; ++x)
+            {
+                const uint8_t* texels[4] =
+                {
+                    &rgba[(static_cast<size_t>(y * 2) * width + x * 2) * 4],
+                    &rgba[(static_cast<size_t>(y * 2) * width + std::min(x * 2 + 1, width - 1)) * 4],
+                    &rgba[(static_cast<size_t>(std::min(y * 2 + 1, height - 1)) * width + x * 2) * 4],
+                    &rgba[(static_cast<size_t>(std::min(y * 2 + 1, height - 1)) * width + std::min(x * 2 + 1, width - 1)) * 4],
+                };
+                uint8_t* out = &half[(static_cast<size_t>(y) * halfWidth + x) * 4];
+                for (unsigned int channel = 0; channel < 4; ++channel)
+                {
+                    if (sRGB && channel < 3)
+                    {
+                        float sum = 0;
+                        for (auto texel : texels)  sum += toLinear[texel[channel]];
+                        float c = sum / 4;
+                        c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1 / 2.4f) - 0.055f;
+                        out[channel] = static_cast<uint8_t>(std::min(c, 1.0f) * 255 + 0.5f);
+                    }
+                    else
+                    {
+                        unsigned int sum = 0;
+                        for (auto texel : texels)  sum += texel[channel];
+                        out[channel] = static_cast<uint8_t>((sum + 2) / 4);
+                    }
+                }
+            }
+        }
+        return half;
+    }
+
+
+    // Pack images into one atlas and point their textures at it. Images that don't fit in the largest atlas are left
+    // out (and their textures load normally). Returns false on failure with gLastError set
+    bool BuildAtlas(std::vector<AtlasImage*> images, bool sRGB, AtlasStats& stats)
+    {
+        // Smallest power of two atlas that fits them all, square or twice as wide as high. Only the largest atlas
+        // may leave some out
+        uint64_t cellArea = 0;
+        for (auto image : images)  cellArea += static_cast<uint64_t>(CellWidth(*image)) * CellHeight(*image);
+        uint32_t width = ATLAS_ALIGNMENT, height = ATLAS_ALIGNMENT;
+        while (static_cast<uint64_t>(width) * height < cellArea && height < ATLAS_MAX_SIZE)
+        {
+            (width == height ? width : height) *= 2;
+        }
+        while (!PackImages(images, width, height, !(width == ATLAS_MAX_SIZE && height == ATLAS_MAX_SIZE)))
+        {
+            (width == height ? width : height) *= 2;
+        }
+        if (std::none_of(images.begin(), images.end(), [](const AtlasImage* image) { return image->placed; }))
+        {
+            return true; // Nothing fits, so no atlas
+        }
+
+        // Fill each cell with its image, the gutter and any rounding repeating the image's edge texels
+        std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4, 0);
+        for (auto image : images)
+        {
+            if (!image->placed)  continue;
+            for (uint32_t cellY = 0; cellY < CellHeight(*image); ++cellY)
+            {
+                uint32_t sourceY = std::min(static_cast<uint32_t>(std::max(static_cast<int>(cellY) - static_cast<int>(ATLAS_GUTTER), 0)), image->height - 1);
+                for (uint32_t cellX = 0; cellX < CellWidth(*image); ++cellX)
+                {
+                    uint32_t sourceX = std::min(static_cast<uint32_t>(std::max(static_cast<int>(cellX) - static_cast<int>(ATLAS_GUTTER), 0)), image->width - 1);
+                    std::memcpy(&rgba[(static_cast<size_t>(image->y + cellY) * width + image->x + cellX) * 4],
+                                &image->rgba[(static_cast<size_t>(sourceY) * image->width + sourceX) * 4], 4);
+                }
+            }
+        }
+
+        // Mips, all made up front for an immutable texture
+        unsigned int numMips = 1;
+        while (numMips < ATLAS_MIP_LEVELS && (width >> numMips) > 0 && (height >> numMips) > 0)  ++numMips;
+        std::vector<std::vector<uint8_t>> mips = { std::move(rgba) };
+        std::vector<D3D11_SUBRESOURCE_DATA> initialData(numMips);
+        for (unsigned int mip = 0; mip < numMips; ++mip)
+        {
+            uint32_t mipWidth = std::max(width >> mip, 1u), mipHeight = std::max(height >> mip, 1u);
+            if (mip > 0)  mips.push_back(HalveImage(mips[mip - 1], std::max(width >> (mip - 1), 1u), std::max(height >> (mip - 1), 1u), sRGB));
+            initialData[mip].pSysMem = mips[mip].data();
+            initialData[mip].SysMemPitch = mipWidth * 4;
+            initialData[mip].SysMemSlicePitch = mipWidth * mipHeight * 4;
+        }
+
+        D3D11_TEXTURE2D_DESC desc = {};
+        desc.Width = width;
+        desc.Height = height;
+        desc.MipLevels = numMips;
+        desc.ArraySize = 1;
+        desc.Format = sRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+        desc.SampleDesc.Count = 1;
+        desc.Usage = D3D11_USAGE_IMMUTABLE;
+        desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        ID3D11Texture2D* atlas = nullptr;
+        ID3D11ShaderResourceView* atlasSRV = nullptr;
+        if (FAILED(gD3DDevice->CreateTexture2D(&desc, initialData.data(), &atlas)) ||
+            FAILED(gD3DDevice->CreateShaderResourceView(atlas, nullptr, &atlasSRV)))
+        {
+            if (atlas)  atlas->Release();
+            gLastError = "Error creating texture atlas";
+            return false;
+        }
+
+        // The textures each hold a reference to the atlas, ours are released once they all have one
+        for (auto image : images)
+        {
+            if (!image->placed)  continue;
+            CVector2 scale  = { static_cast<float>(image->width) / width, static_cast<float>(image->height) / height };
+            CVector2 offset = { static_cast<float>(image->x + ATLAS_GUTTER) / width, static_cast<float>(image->y + ATLAS_GUTTER) / height };
+            for (auto texture : image->textures)  texture->SetAtlas(atlas, atlasSRV, scale, offset);
+
+            stats.numTextures += static_cast<unsigned int>(image->textures.size());
+            ++stats.numImages;
+            stats.imageTexels += static_cast<uint64_t>(image->width) * image->height;
+        }
+        ++stats.numAtlases;
+        stats.atlasTexels += static_cast<uint64_t>(width) * height;
+        atlasSRV->Release();
+        atlas->Release();
+        return true;
+    }
+}
+
+
+// Pack the textures of the objects given into atlases
+bool BuildTextureAtlases(const std::vector<SceneObject*>& objects, AtlasStats& stats)
+{
+    stats = AtlasStats();
+
+    // Each file is packed once, shared by all the textures using it
+    std::vector<AtlasImage> images;
+    std::map<std::string, size_t> imageIndices;
+    for (auto object : objects)
+    {
+        std::vector<Texture*> textures = object->Textures();
+        bool sameFile = true;
+        for (auto texture : textures)  sameFile = sameFile && texture->FileName() == textures[0]->FileName();
+        if (textures.empty() || !sameFile)  continue;
+
+        auto found = imageIndices.find(textures[0]->FileName());
+        if (found == imageIndices.end())
+        {
+            found = imageIndices.emplace(textures[0]->FileName(), images.size()).first;
+            images.emplace_back();
+            images.back().fileName = textures[0]->FileName();
+        }
+        auto& users = images[found->second].textures;
+        users.insert(users.end(), textures.begin(), textures.end());
+    }
+
+    // Images that can't be read or packed are left for their textures to load normally (and report any error)
+    std::vector<AtlasImage*> linearImages, sRGBImages;
+    for (auto& image : images)
+    {
+        if (!ReadImage(image))  continue;
+        (image.sRGB ? sRGBImages : linearImages).push_back(&image);
+    }
+
+    if (!linearImages.empty() && !BuildAtlas(linearImages, false, stats))  return false;
+    if (!sRGBImages.empty()   && !BuildAtlas(sRGBImages,   true,  stats))  return false;
+    return true;
+}
@@ -0,0 +1,51 @@
+//--------------------------------------------------------------------------------------
+// Packing small textures into shared atlas textures
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+// Decals and sprites use small textures each with their own view, so every one of them
+// changes the bound texture when drawn. Packed into an atlas they share one texture and view,
+// so a run of them is drawn without rebinding (see BindObjectTexture in PipelineState.h), and
+// each object instead maps its UVs into its texture's region (the vertex shader applies
+// gUVScale / gUVOffset, set from Texture::UVScale / UVOffset).
+//
+// Images are loaded as Texture::Load would, from their cooked versions if they have them, and
+// read back from the GPU, so any 8-bit RGBA or BGRA format or BC1-BC5/BC7 (decoded with
+// BCDecoder) can be packed, and are written to 8-bit RGBA atlases.
+// sRGB and linear images go in separate atlases. Each image is surrounded by a gutter of copies
+// of its edge texels and placed on a grid aligned to the atlas's smallest mip, so no mip blends
+// one image into another and bilinear filtering at the edges reads the image's own border.
+// Packing uses the skyline packer in RectPacker.h, in the smallest power of two atlas that fits.
+//
+// Only the top level of each image is packed and the atlas has a limited number of mips (see
+// ATLAS_MIP_LEVELS). Objects whose models wrap UVs outside 0-1 can't use an atlas.
+
+#ifndef _TEXTURE_ATLAS_H_INCLUDED_
+#define _TEXTURE_ATLAS_H_INCLUDED_
+
+#include "SceneObject.h"
+
+#include <vector>
+#include <cstdint>
+
+
+// What was packed, for display
+struct AtlasStats
+{
+    unsigned int numTextures = 0; // Texture objects now using an atlas
+    unsigned int numImages   = 0; // Different files among them, each packed once
+    unsigned int numAtlases  = 0;
+    uint64_t     imageTexels = 0; // Area of the images packed, without gutters
+    uint64_t     atlasTexels = 0; // Area of the atlases' top levels
+
+    float Efficiency() const  { return atlasTexels > 0 ? static_cast<float>(imageTexels) / atlasTexels : 0; }
+};
+
+
+// Pack the textures of the objects given into atlases. Call before the textures are loaded: those packed then skip
+// loading. An object is only packed if all its textures are the same file (so one UV mapping serves them all) and
+// the file is small and in a supported format, others are left to load their textures normally. Returns false on
+// failure with gLastError set
+bool BuildTextureAtlases(const std::vector<SceneObject*>& objects, AtlasStats& stats);
+
+
+#endif //_TEXTURE_ATLAS_H_INCLUDED_
@@ -0,0 +1,200 @@
+//--------------------------------------------------------------------------------------
+// Texture cooker - converts the textures listed in a file to compressed DDS files
+//--------------------------------------------------------------------------------------
+// Usage: TextureCooker <list file> <output folder> [-force]
+//
+// Each line of the list is a texture file, relative to the list's folder, and its usage (see
+// TextureCooker.h), with # starting a comment. Each is written to the output folder as a .dds
+// file of the same name, which the app loads in place of the original (see Texture.cpp).
+// Textures whose output is newer than both the texture and the list are skipped unless -force
+// is given. Run before each build of the app by the Visual Studio project.
+//
+// Images are decoded with WIC, uncompressed .dds files are read directly. Textures are cooked one
+// after another, each spread over all the threads, and the time taken and quality are reported.
+
+#include "TextureCooker.h"
+#include "ParallelFor.h"
+
+#include <Windows.h>
+#include <wincodec.h>
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <chrono>
+#include <vector>
+#include <stdexcept>
+#include <cmath>
+
+namespace fs = std::filesystem;
+
+
+namespace
+{
+    struct CookEntry
+    {
+        fs::path     file;
+        TextureUsage usage;
+    };
+
+    // Read the list of textures, throws on a bad line
+    std::vector<CookEntry> ReadCookList(const fs::path& listFile)
+    {
+        std::ifstream list(listFile);
+        if (!list.is_open())  throw std::runtime_error("Error opening texture list " + listFile.string());
+
+        std::vector<CookEntry> entries;
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(list, line))
+        {
+            ++lineNumber;
+            line = line.substr(0, line.find('#'));
+            std::istringstream words(line);
+            std::string file, usage, extra;
+            if (!(words >> file))  continue;
+
+            CookEntry entry;
+            if (!(words >> usage) || !ParseTextureUsage(usage, entry.usage) || (words >> extra))
+            {
+                throw std::runtime_error("Bad usage on line " + std::to_string(lineNumber) + " of " + listFile.string());
+            }
+            entry.file = listFile.parent_path() / file;
+            entries.push_back(entry);
+        }
+        return entries;
+    }
+
+
+    // Decode an image file to 8-bit RGBA with WIC, throws on failure
+    CookerImage LoadImageWIC(IWICImagingFactory* factory, const fs::path& file)
+    {
+        IWICBitmapDecoder*     decoder = nullptr;
+        IWICBitmapFrameDecode* frame = nullptr;
+        IWICFormatConverter*   converter = nullptr;
+        auto release = [&]()
+        {
+            if (converter)  converter->Release();
+            if (frame)      frame->Release();
+            if (decoder)    decoder->Release();
+        };
+
+        CookerImage image;
+        HRESULT hr = factory->CreateDecoderFromFilename(file.wstring().c_str(), nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, &decoder);
+        if (SUCCEEDED(hr))  hr = decoder->GetFrame(0, &frame);
+        if (SUCCEEDED(hr))  hr = factory->CreateFormatConverter(&converter);
+        if (SUCCEEDED(hr))  hr = converter->Initialize(frame, GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0, WICBitmapPaletteTypeCustom);
+        if (SUCCEEDED(hr))  hr = converter->GetSize(&image.width, &image.height);
+        if (SUCCEEDED(hr))
+        {
+            image.rgba.resize(static_cast<size_t>(image.width) * image.height * 4);
+            hr = converter->CopyPixels(nullptr, image.width * 4, static_cast<UINT>(image.rgba.size()), image.rgba.data());
+        }
+        release();
+        if (FAILED(hr))  throw std::runtime_error("Error decoding " + file.string());
+        return image;
+    }
+
+
+    const char* FormatName(uint32_t format)
+    {
+        switch (format)
+        {
+        case 71:  return "BC1";
+        case 77:  return "BC3";
+        case 83:  return "BC5";
+        case 98:  return "BC7";
+        default:  return "RGBA8";
+        }
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3 || (argc == 4 && std::string(argv[3]) != "-force") || argc > 4)
+    {
+        std::cerr << "Usage: TextureCooker <list file> <output folder> [-force]\n";
+        return 1;
+    }
+    fs::path listFile = argv[1];
+    fs::path outputFolder = argv[2];
+    bool force = (argc == 4);
+
+    if (FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED)))
+    {
+        std::cerr << "TextureCooker: error initialising COM\n";
+        return 1;
+    }
+    IWICImagingFactory* factory = nullptr;
+    if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory))))
+    {
+        std::cerr << "TextureCooker: error creating WIC factory\n";
+        CoUninitialize();
+        return 1;
+    }
+
+    int numCooked = 0, numUpToDate = 0, numFailed = 0;
+    auto startTime = std::chrono::steady_clock::now();
+    try
+    {
+        std::vector<CookEntry> entries = ReadCookList(listFile);
+        fs::create_directories(outputFolder);
+        auto listTime = fs::last_write_time(listFile);
+
+        std::cout << std::fixed;
+        for (auto& entry : entries)
+        {
+            fs::path output = outputFolder / entry.file.filename().replace_extension(".dds");
+            std::string name = entry.file.filename().string();
+            try
+            {
+                if (!force && fs::exists(output) && fs::last_write_time(output) >= fs::last_write_time(entry.file) &&
+                    fs::last_write_time(output) >= listTime)
+                {
+                    ++numUpToDate;
+                    continue;
+                }
+
+                auto textureStart = std::chrono::steady_clock::now();
+                CookerImage image = (entry.file.extension() == ".dds" || entry.file.extension() == ".DDS")
+                                    ? ReadUncompressedDDS(entry.file.string()) : LoadImageWIC(factory, entry.file);
+                CookResult result = CookTexture(image, entry.usage, output.string());
+                float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - textureStart).count();
+
+                std::cout << "  " << std::left << std::setw(28) << name << std::setw(6) << FormatName(result.format) << std::right
+                          << std::setw(5) << result.width << "x" << std::left << std::setw(5) << result.height << std::right
+                          << std::setw(3) << result.numMips << " mips" << std::setw(8) << (result.bytes + 1023) / 1024 << " KB  ";
+                if (std::isinf(result.psnr))  std::cout << "lossless";
+                else                          std::cout << std::setprecision(1) << std::setw(5) << result.psnr << " dB";
+                std::cout << std::setw(8) << static_cast<int>(seconds * 1000) << " ms";
+                if (result.width != image.width || result.height != image.height)
+                {
+                    std::cout << "  (resized from " << image.width << "x" << image.height << ")";
+                }
+                std::cout << "\n";
+                ++numCooked;
+            }
+            catch (std::exception& e)
+            {
+                std::cerr << "TextureCooker: error cooking " << name << ": " << e.what() << "\n";
+                ++numFailed;
+            }
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "TextureCooker: " << e.what() << "\n";
+        ++numFailed;
+    }
+
+    float totalSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "TextureCooker: " << numCooked << " cooked, " << numUpToDate << " up to date, " << numFailed << " failed in "
+              << std::setprecision(2) << totalSeconds << "s on " << ParallelForThreads() << " threads\n";
+
+    factory->Release();
+    CoUninitialize();
+    return numFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,717 @@
+//--------------------------------------------------------------------------------------
+// Offline conversion of images to block compressed DDS files with mip maps
+//--------------------------------------------------------------------------------------
+
+#include "TextureCooker.h"
+#include "DDSFile.h"
+#include "ParallelFor.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define COOKER_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+
+namespace
+{
+    // The DXGI_FORMAT values written or read, so this file doesn't need the DirectX headers
+    const uint32_t FORMAT_R8G8B8A8_UNORM      = 28;
+    const uint32_t FORMAT_R8G8B8A8_UNORM_SRGB = 29;
+    const uint32_t FORMAT_BC1_UNORM           = 71;
+    const uint32_t FORMAT_BC3_UNORM           = 77;
+    const uint32_t FORMAT_BC5_UNORM           = 83;
+    const uint32_t FORMAT_B8G8R8A8_UNORM      = 87;
+    const uint32_t FORMAT_B8G8R8X8_UNORM      = 88;
+    const uint32_t FORMAT_B8G8R8A8_UNORM_SRGB = 91;
+    const uint32_t FORMAT_B8G8R8X8_UNORM_SRGB = 93;
+    const uint32_t FORMAT_BC7_UNORM           = 98;
+
+    // Block rows encoded per batch of ParallelFor, and image rows filtered per batch
+    const unsigned int BLOCK_ROWS_PER_BATCH = 4;
+    const unsigned int FILTER_ROWS_PER_BATCH = 16;
+
+
+    //--------------------------------------------------------------------------------------
+    // Linear images and mip filtering
+    //--------------------------------------------------------------------------------------
+
+    // An image with four floats per texel: linear colour, or a vector in -1 -> 1 for normal maps, then alpha 0 -> 1
+    struct LinearImage
+    {
+        uint32_t           width;
+        uint32_t           height;
+        std::vector<float> texels;
+
+        float* Texel(uint32_t x, uint32_t y)  { return &texels[(static_cast<size_t>(y) * width + x) * 4]; }
+    };
+
+    float SRGBToLinear(float c)
+    {
+        return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float LinearToSRGB(float c)
+    {
+        return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    }
+
+    uint8_t ToByte(float c)
+    {
+        return static_cast<uint8_t>(std::min(std::max(c, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+
+
+    LinearImage ToLinear(const CookerImage& image, TextureUsage usage)
+    {
+        float decode[256];
+        for (int i = 0; i < 256; ++i)
+        {
+            decode[i] = (usage == TextureUsage::NormalMap) ? i / 127.5f - 1.0f : SRGBToLinear(i / 255.0f);
+        }
+
+        LinearImage linear{ image.width, image.height, std::vector<float>(image.rgba.size()) };
+        for (size_t i = 0; i < image.rgba.size(); i += 4)
+        {
+            linear.texels[i + 0] = decode[image.rgba[i + 0]];
+            linear.texels[i + 1] = decode[image.rgba[i + 1]];
+            linear.texels[i + 2] = decode[image.rgba[i + 2]];
+            linear.texels[i + 3] = image.rgba[i + 3] / 255.0f;
+        }
+        return linear;
+    }
+
+    CookerImage FromLinear(const LinearImage& linear, TextureUsage usage)
+    {
+        CookerImage image{ linear.width, linear.height, std::vector<uint8_t>(linear.texels.size()) };
+        for (size_t i = 0; i < linear.texels.size(); i += 4)
+        {
+            for (size_t c = 0; c < 3; ++c)
+            {
+                float value = linear.texels[i + c];
+                image.rgba[i + c] = (usage == TextureUsage::NormalMap) ? ToByte(value * 0.5f + 0.5f) : ToByte(LinearToSRGB(value));
+            }
+            image.rgba[i + 3] = ToByte(linear.texels[i + 3]);
+        }
+        return image;
+    }
+
+
+    // Resize with bilinear filtering, used to make block compressed textures a multiple of 4 across
+    LinearImage Resize(LinearImage& source, uint32_t width, uint32_t height)
+    {
+        LinearImage result{ width, height, std::vector<float>(static_cast<size_t>(width) * height * 4) };
+        float scaleX = static_cast<float>(source.width)  / width;
+        float scaleY = static_cast<float>(source.height) / height;
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            float sourceY = std::max((y + 0.5f) * scaleY - 0.5f, 0.0f);
+            uint32_t y0 = std::min(static_cast<uint32_t>(sourceY), source.height - 1);
+            uint32_t y1 = std::min(y0 + 1, source.height - 1);
+            float fy = sourceY - y0;
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                float sourceX = std::max((x + 0.5f) * scaleX - 0.5f, 0.0f);
+                uint32_t x0 = std::min(static_cast<uint32_t>(sourceX), source.width - 1);
+                uint32_t x1 = std::min(x0 + 1, source.width - 1);
+                float fx = sourceX - x0;
+
+                float* out = result.Texel(x, y);
+                for (int c = 0; c < 4; ++c)
+                {
+                    float top    = source.Texel(x0, y0)[c] * (1 - fx) + source.Texel(x1, y0)[c] * fx;
+                    float bottom = source.Texel(x0, y1)[c] * (1 - fx) + source.Texel(x1, y1)[c] * fx;
+                    out[c] = top * (1 - fy) + bottom * fy;
+                }
+            }
+        }
+        return result;
+    }
+
+
+    // Next mip down: each texel is the average of a 2x2 square. Odd sizes repeat the last row or column
+    LinearImage HalveImage(LinearImage& source, bool renormalise)
+    {
+        uint32_t width  = std::max(1u, source.width  / 2);
+        uint32_t height = std::max(1u, source.height / 2);
+        LinearImage result{ width, height, std::vector<float>(static_cast<size_t>(width) * height * 4) };
+
+        ParallelFor(height, FILTER_ROWS_PER_BATCH, [&](unsigned int start, unsigned int end)
+        {
+            for (uint32_t y = start; y < end; ++y)
+            {
+                uint32_t y0 = std::min(y * 2, source.height - 1);
+                uint32_t y1 = std::min(y * 2 + 1, source.height - 1);
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    uint32_t x0 = std::min(x * 2, source.width - 1);
+                    uint32_t x1 = std::min(x * 2 + 1, source.width - 1);
+                    float* out = result.Texel(x, y);
+#ifdef COOKER_USE_SSE
+                    __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(source.Texel(x0, y0)), _mm_loadu_ps(source.Texel(x1, y0))),
+                                            _mm_add_ps(_mm_loadu_ps(source.Texel(x0, y1)), _mm_loadu_ps(source.Texel(x1, y1))));
+                    _mm_storeu_ps(out, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        out[c] = 0.25f * (source.Texel(x0, y0)[c] + source.Texel(x1, y0)[c] +
+                                          source.Texel(x0, y1)[c] + source.Texel(x1, y1)[c]);
+                    }
+#endif
+                    if (renormalise)
+                    {
+                        float length = std::sqrt(out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+                        if (length > 0)  for (int c = 0; c < 3; ++c)  out[c] /= length;
+                    }
+                }
+            }
+        });
+        return result;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Block encoders
+    //--------------------------------------------------------------------------------------
+    // Each encodes a 4x4 block of texels (in rows, top first) and also gives back the texels the GPU will decode,
+    // which is used to measure the quality
+
+    using Block = uint8_t[16][4];
+
+    int Square(int x)  { return x * x; }
+
+    // Main axis of a set of points (the direction they vary most along) by power iteration on their covariance
+    template <int N>
+    void PrincipalAxis(const float points[16][N], float mean[N], float axis[N])
+    {
+        for (int c = 0; c < N; ++c)
+        {
+            mean[c] = 0;
+            for (int i = 0; i < 16; ++i)  mean[c] += points[i][c];
+            mean[c] /= 16;
+        }
+        float covariance[N][N] = {};
+        for (int i = 0; i < 16; ++i)
+        {
+            for (int a = 0; a < N; ++a)
+            {
+                for (int b = 0; b < N; ++b)  covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+            }
+        }
+        for (int c = 0; c < N; ++c)  axis[c] = 1;
+        for (int iteration = 0; iteration < 8; ++iteration)
+        {
+            float next[N] = {};
+            float length = 0;
+            for (int a = 0; a < N; ++a)
+            {
+                for (int b = 0; b < N; ++b)  next[a] += covariance[a][b] * axis[b];
+                length += next[a] * next[a];
+            }
+            length = std::sqrt(length);
+            if (length < 1e-6f)  break; // All the same colour, any axis will do
+            for (int c = 0; c < N; ++c)  axis[c] = next[c] / length;
+        }
+    }
+
+
+    // BC1 colour endpoints are 5:6:5, expanded to 8 bits by repeating the top bits
+    uint16_t To565(const float colour[3])
+    {
+        int r = static_cast<int>(std::min(std::max(colour[0], 0.0f), 255.0f) * 31 / 255 + 0.5f);
+        int g = static_cast<int>(std::min(std::max(colour[1], 0.0f), 255.0f) * 63 / 255 + 0.5f);
+        int b = static_cast<int>(std::min(std::max(colour[2], 0.0f), 255.0f) * 31 / 255 + 0.5f);
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void From565(uint16_t c, int colour[3])
+    {
+        int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+        colour[0] = (r << 3) | (r >> 2);
+        colour[1] = (g << 2) | (g >> 4);
+        colour[2] = (b << 3) | (b >> 2);
+    }
+
+    // Choose the nearest of the four colours of a pair of endpoints for each texel, returns the total error
+    int BC1Indices(const Block texels, uint16_t c0, uint16_t c1, uint32_t& indices, Block decoded)
+    {
+        int palette[4][3];
+        From565(c0, palette[0]);
+        From565(c1, palette[1]);
+        for (int c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+        }
+
+        int totalError = 0;
+        indices = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0, bestError = std::numeric_limits<int>::max();
+            for (int p = 0; p < (c0 == c1 ? 1 : 4); ++p)
+            {
+                int error = Square(texels[i][0] - palette[p][0]) + Square(texels[i][1] - palette[p][1]) + Square(texels[i][2] - palette[p][2]);
+                if (error < bestError)  { best = p; bestError = error; }
+            }
+            indices |= static_cast<uint32_t>(best) << (i * 2);
+            totalError += bestError;
+            for (int c = 0; c < 3; ++c)  decoded[i][c] = static_cast<uint8_t>(palette[best][c]);
+        }
+        return totalError;
+    }
+
+    // Colour part of BC1 and BC3, always in four colour mode. Fills the RGB of decoded
+    void EncodeColourBlock(const Block texels, uint8_t out[8], Block decoded)
+    {
+        float points[16][3];
+        for (int i = 0; i < 16; ++i)  for (int c = 0; c < 3; ++c)  points[i][c] = texels[i][c];
+        float mean[3], axis[3];
+        PrincipalAxis<3>(points, mean, axis);
+
+        // Endpoints at the ends of the colours' spread along the axis
+        float minT = 0, maxT = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            float t = (points[i][0] - mean[0]) * axis[0] + (points[i][1] - mean[1]) * axis[1] + (points[i][2] - mean[2]) * axis[2];
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+        float end0[3], end1[3];
+        for (int c = 0; c < 3; ++c)
+        {
+            end0[c] = mean[c] + axis[c] * maxT;
+            end1[c] = mean[c] + axis[c] * minT;
+        }
+        // The larger endpoint goes first to select four colour mode
+        uint16_t c0 = To565(end0), c1 = To565(end1);
+        if (c0 < c1)  std::swap(c0, c1);
+        uint32_t indices = 0;
+        int error = BC1Indices(texels, c0, c1, indices, decoded);
+
+        // Refine once: the endpoints that best fit the chosen indices by least squares
+        if (c0 != c1)
+        {
+            const float weights[4] = { 1.0f, 0.0f, 2.0f / 3, 1.0f / 3 }; // Share of c0 for each index
+            float aa = 0, ab = 0, bb = 0, ax[3] = {}, bx[3] = {};
+            for (int i = 0; i < 16; ++i)
+            {
+                float a = weights[(indices >> (i * 2)) & 3], b = 1 - a;
+                aa += a * a;  ab += a * b;  bb += b * b;
+                for (int c = 0; c < 3; ++c)  { ax[c] += a * texels[i][c];  bx[c] += b * texels[i][c]; }
+            }
+            float determinant = aa * bb - ab * ab;
+            if (std::abs(determinant) > 1e-6f)
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    end0[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+                    end1[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+                }
+                uint16_t r0 = To565(end0), r1 = To565(end1);
+                uint32_t refinedIndices = 0;
+                if (r0 < r1)  std::swap(r0, r1);
+                Block refinedDecoded;
+                int refinedError = BC1Indices(texels, r0, r1, refinedIndices, refinedDecoded);
+                if (refinedError < error)
+                {
+                    c0 = r0;  c1 = r1;  indices = refinedIndices;
+                    for (int i = 0; i < 16; ++i)  std::memcpy(decoded[i], refinedDecoded[i], 3);
+                }
+            }
+        }
+
+        // Equal endpoints would select three colour mode, where index 3 is transparent black. Only index 0 is used
+        // then, which means the same colour in both modes
+        out[0] = c0 & 0xff;  out[1] = c0 >> 8;
+        out[2] = c1 & 0xff;  out[3] = c1 >> 8;
+        for (int b = 0; b < 4; ++b)  out[4 + b] = (indices >> (b * 8)) & 0xff;
+    }
+
+
+    // Single channel block: BC4, the alpha of BC3 and each channel of BC5. Fills the given channel of decoded
+    void EncodeChannelBlock(const Block texels, int channel, uint8_t out[8], Block decoded)
+    {
+        int low = 255, high = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            low  = std::min<int>(low,  texels[i][channel]);
+            high = std::max<int>(high, texels[i][channel]);
+        }
+
+        // Eight value mode (first endpoint larger): the endpoints and six values evenly between
+        int palette[8] = { high, low };
+        for (int k = 1; k < 7; ++k)  palette[k + 1] = ((7 - k) * high + k * low + 3) / 7;
+
+        uint64_t indices = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0;
+            if (high != low)
+            {
+                int bestError = 256;
+                for (int p = 0; p < 8; ++p)
+                {
+                    int error = std::abs(texels[i][channel] - palette[p]);
+                    if (error < bestError)  { best = p; bestError = error; }
+                }
+            }
+            indices |= static_cast<uint64_t>(best) << (i * 3);
+            decoded[i][channel] = static_cast<uint8_t>(palette[best]);
+        }
+
+        out[0] = static_cast<uint8_t>(high);
+        out[1] = static_cast<uint8_t>(low);
+        for (int b = 0; b < 6; ++b)  out[2 + b] = (indices >> (b * 8)) & 0xff;
+    }
+
+
+    // BC7 in mode 6 only: one pair of RGBA endpoints of 7 bits plus a shared low bit each, and 4-bit indices
+    void EncodeBC7Block(const Block texels, uint8_t out[16], Block decoded)
+    {
+        float points[16][4];
+        for (int i = 0; i < 16; ++i)  for (int c = 0; c < 4; ++c)  points[i][c] = texels[i][c];
+        float mean[4], axis[4];
+        PrincipalAxis<4>(points, mean, axis);
+
+        float minT = 0, maxT = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            float t = 0;
+            for (int c = 0; c < 4; ++c)  t += (points[i][c] - mean[c]) * axis[c];
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+
+        // Quantise each endpoint, trying both values of its low bit
+        int endpoints[2][4], pBits[2];
+        for (int e = 0; e < 2; ++e)
+        {
+            float target[4];
+            for (int c = 0; c < 4; ++c)  target[c] = std::min(std::max(mean[c] + axis[c] * (e == 0 ? minT : maxT), 0.0f), 255.0f);
+
+            float bestError = std::numeric_limits<float>::max();
+            for (int p = 0; p < 2; ++p)
+            {
+                int values[4];
+                float error = 0;
+                for (int c = 0; c < 4; ++c)
+                {
+                    values[c] = std::min(std::max(static_cast<int>((target[c] - p) / 2 + 0.5f), 0), 127);
+                    float difference = target[c] - (values[c] * 2 + p);
+                    error += difference * difference;
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    pBits[e] = p;
+                    std::copy(values, values + 4, endpoints[e]);
+                }
+            }
+        }
+
+        const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+        int palette[16][4];
+        for (int w = 0; w < 16; ++w)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                int e0 = endpoints[0][c] * 2 + pBits[0], e1 = endpoints[1][c] * 2 + pBits[1];
+                palette[w][c] = ((64 - weights[w]) * e0 + weights[w] * e1 + 32) >> 6;
+            }
+        }
+        int indices[16];
+        for (int i = 0; i < 16; ++i)
+        {
+            int bestError = std::numeric_limits<int>::max();
+            for (int w = 0; w < 16; ++w)
+            {
+                int error = 0;
+                for (int c = 0; c < 4; ++c)  error += Square(texels[i][c] - palette[w][c]);
+                if (error < bestError)  { bestError = error; indices[i] = w; }
+            }
+            for (int c = 0; c < 4; ++c)  decoded[i][c] = static_cast<uint8_t>(palette[indices[i]][c]);
+        }
+
+        // The first texel's index is stored without its top bit, so it must be below 8. Swap the endpoints if not
+        if (indices[0] >= 8)
+        {
+            std::swap(endpoints[0], endpoints[1]);
+            std::swap(pBits[0], pBits[1]);
+            for (int i = 0; i < 16; ++i)  indices[i] = 15 - indices[i];
+        }
+
+        // Bits from the lowest up: mode 6 as six 0s and a 1, R0 R1 G0 G1 B0 B1 A0 A1, P0 P1, then the indices
+        std::memset(out, 0, 16);
+        unsigned int position = 0;
+        auto write = [&](unsigned int value, unsigned int numBits)
+        {
+            for (unsigned int bit = 0; bit < numBits; ++bit, ++position)
+            {
+                if (value & (1u << bit))  out[position / 8] |= static_cast<uint8_t>(1u << (position % 8));
+            }
+        };
+        write(1 << 6, 7);
+        for (int c = 0; c < 4; ++c)
+        {
+            write(endpoints[0][c], 7);
+            write(endpoints[1][c], 7);
+        }
+        write(pBits[0], 1);
+        write(pBits[1], 1);
+        for (int i = 0; i < 16; ++i)  write(indices[i], i == 0 ? 3 : 4);
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Encoding images
+    //--------------------------------------------------------------------------------------
+
+    uint32_t BlockBytes(uint32_t format)
+    {
+        if (format == FORMAT_BC1_UNORM)  return 8;
+        if (format == FORMAT_R8G8B8A8_UNORM)  return 0;
+        return 16;
+    }
+
+    // Encode a whole mip, appending it to data. Fills decoded with what the GPU will see, the same size as the image
+    void EncodeImage(const CookerImage& image, uint32_t format, std::vector<uint8_t>& data, CookerImage& decoded)
+    {
+        decoded = image;
+        uint32_t blockBytes = BlockBytes(format);
+        if (blockBytes == 0)
+        {
+            data.insert(data.end(), image.rgba.begin(), image.rgba.end());
+            return;
+        }
+
+        uint32_t blocksAcross = (image.width + 3) / 4, blocksDown = (image.height + 3) / 4;
+        size_t start = data.size();
+        data.resize(start + static_cast<size_t>(blocksAcross) * blocksDown * blockBytes);
+
+        ParallelFor(blocksDown, BLOCK_ROWS_PER_BATCH, [&](unsigned int startRow, unsigned int endRow)
+        {
+            for (uint32_t by = startRow; by < endRow; ++by)
+            {
+                for (uint32_t bx = 0; bx < blocksAcross; ++bx)
+                {
+                    // Blocks hanging over the edge of small mips repeat the edge texels, the GPU ignores them
+                    Block texels, result;
+                    for (int i = 0; i < 16; ++i)
+                    {
+                        uint32_t x = std::min(bx * 4 + i % 4, image.width - 1);
+                        uint32_t y = std::min(by * 4 + i / 4, image.height - 1);
+                        std::memcpy(texels[i], &image.rgba[(static_cast<size_t>(y) * image.width + x) * 4], 4);
+                        std::memcpy(result[i], texels[i], 4);
+                    }
+
+                    uint8_t* out = &data[start + (static_cast<size_t>(by) * blocksAcross + bx) * blockBytes];
+                    if (format == FORMAT_BC1_UNORM)
+                    {
+                        EncodeColourBlock(texels, out, result);
+                    }
+                    else if (format == FORMAT_BC3_UNORM)
+                    {
+                        EncodeChannelBlock(texels, 3, out, result);
+                        EncodeColourBlock(texels, out + 8, result);
+                    }
+                    else if (format == FORMAT_BC5_UNORM)
+                    {
+                        EncodeChannelBlock(texels, 0, out, result);
+                        EncodeChannelBlock(texels, 1, out + 8, result);
+                    }
+                    else
+                    {
+                        EncodeBC7Block(texels, out, result);
+                    }
+
+                    for (int i = 0; i < 16; ++i)
+                    {
+                        uint32_t x = bx * 4 + i % 4, y = by * 4 + i / 4;
+                        if (x < image.width && y < image.height)
+                        {
+                            std::memcpy(&decoded.rgba[(static_cast<size_t>(y) * image.width + x) * 4], result[i], 4);
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+
+    // Peak signal to noise ratio of the channels a format keeps, in dB
+    double PSNR(const CookerImage& original, const CookerImage& decoded, uint32_t format)
+    {
+        int numChannels = (format == FORMAT_BC1_UNORM) ? 3 : (format == FORMAT_BC5_UNORM) ? 2 : 4;
+        double sumSquares = 0;
+        for (size_t i = 0; i < original.rgba.size(); i += 4)
+        {
+            for (int c = 0; c < numChannels; ++c)  sumSquares += Square(original.rgba[i + c] - decoded.rgba[i + c]);
+        }
+        double meanSquare = sumSquares / (static_cast<double>(original.rgba.size() / 4) * numChannels);
+        if (meanSquare == 0)  return std::numeric_limits<double>::infinity();
+        return 10 * std::log10(255.0 * 255.0 / meanSquare);
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // DDS files
+    //--------------------------------------------------------------------------------------
+
+    // Original header (after the magic number) and DX10 header, see DDSFile.cpp
+    struct DDSHeader
+    {
+        uint32_t size, flags, height, width, pitchOrLinearSize, depth, mipMapCount, reserved1[11];
+        uint32_t pfSize, pfFlags, pfFourCC, pfRGBBitCount, pfRBitMask, pfGBitMask, pfBBitMask, pfABitMask;
+        uint32_t caps, caps2, caps3, caps4, reserved2;
+    };
+    struct DDSHeaderDX10
+    {
+        uint32_t dxgiFormat, resourceDimension, miscFlag, arraySize, miscFlags2;
+    };
+    static_assert(sizeof(DDSHeader) == 124 && sizeof(DDSHeaderDX10) == 20, "DDS header layout");
+
+    // Always written with the DX10 header, which can express every format used
+    void WriteDDS(const std::string& fileName, uint32_t format, uint32_t width, uint32_t height, uint32_t numMips,
+                  uint32_t topLevelBytes, const std::vector<uint8_t>& data)
+    {
+        DDSHeader header = {};
+        header.size = sizeof(DDSHeader);
+        header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000; // Caps, height, width, pixel format, mip count
+        header.flags |= (BlockBytes(format) > 0) ? 0x80000 : 0x8; // Linear size or pitch
+        header.height = height;
+        header.width = width;
+        header.pitchOrLinearSize = (BlockBytes(format) > 0) ? topLevelBytes : width * 4;
+        header.mipMapCount = numMips;
+        header.pfSize = 32;
+        header.pfFlags = 0x4; // Four CC
+        header.pfFourCC = 0x30315844; // "DX10"
+        header.caps = 0x1000 | (numMips > 1 ? 0x400008 : 0); // Texture, and mip map / complex
+
+        DDSHeaderDX10 dx10 = {};
+        dx10.dxgiFormat = format;
+        dx10.resourceDimension = 3; // 2D texture
+        dx10.arraySize = 1;
+
+        std::ofstream file(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+        const uint32_t magic = 0x20534444; // "DDS "
+        file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(&dx10), sizeof(dx10));
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if (!file)  throw std::runtime_error("Error writing " + fileName);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Cooking
+//--------------------------------------------------------------------------------------
+
+// Usage from its name in CookTextures.txt
+bool ParseTextureUsage(const std::string& name, TextureUsage& usage)
+{
+    if      (name == "Colour")           usage = TextureUsage::Colour;
+    else if (name == "DiffuseSpecular")  usage = TextureUsage::DiffuseSpecular;
+    else if (name == "NormalMap")        usage = TextureUsage::NormalMap;
+    else if (name == "Lookup")           usage = TextureUsage::Lookup;
+    else return false;
+    return true;
+}
+
+
+// Read the top level of an uncompressed 32-bit DDS file
+CookerImage ReadUncompressedDDS(const std::string& fileName)
+{
+    DDSFile file(fileName);
+    uint32_t format = file.Format();
+    bool bgr = (format == FORMAT_B8G8R8A8_UNORM || format == FORMAT_B8G8R8X8_UNORM ||
+                format == FORMAT_B8G8R8A8_UNORM_SRGB || format == FORMAT_B8G8R8X8_UNORM_SRGB);
+    bool noAlpha = (format == FORMAT_B8G8R8X8_UNORM || format == FORMAT_B8G8R8X8_UNORM_SRGB);
+    if (!bgr && format != FORMAT_R8G8B8A8_UNORM && format != FORMAT_R8G8B8A8_UNORM_SRGB)
+    {
+        throw std::runtime_error(fileName + " is already compressed");
+    }
+    if (file.ArraySize() != 1)  throw std::runtime_error(fileName + " is a cube map or array, which can't be cooked");
+
+    const DDSSubresource& top = file.Subresource(0, 0);
+    CookerImage image{ top.width, top.height, std::vector<uint8_t>(static_cast<size_t>(top.width) * top.height * 4) };
+    const uint8_t* source = static_cast<const uint8_t*>(top.data);
+    for (size_t i = 0; i < image.rgba.size(); i += 4)
+    {
+        image.rgba[i + 0] = source[i + (bgr ? 2 : 0)];
+        image.rgba[i + 1] = source[i + 1];
+        image.rgba[i + 2] = source[i + (bgr ? 0 : 2)];
+        image.rgba[i + 3] = noAlpha ? 255 : source[i + 3];
+    }
+    return image;
+}
+
+
+// DXGI_FORMAT a texture will be cooked to
+uint32_t CookedFormat(TextureUsage usage, const CookerImage& image)
+{
+    bool opaque = true;
+    for (size_t i = 3; i < image.rgba.size() && opaque; i += 4)  opaque = (image.rgba[i] == 255);
+
+    switch (usage)
+    {
+    case TextureUsage::Colour:           return opaque ? FORMAT_BC1_UNORM : FORMAT_BC7_UNORM;
+    case TextureUsage::DiffuseSpecular:  return FORMAT_BC3_UNORM;
+    case TextureUsage::NormalMap:        return opaque ? FORMAT_BC5_UNORM : FORMAT_BC7_UNORM;
+    default:                             return FORMAT_R8G8B8A8_UNORM;
+    }
+}
+
+
+// Build the mip chain, compress it and write a DDS file
+CookResult CookTexture(const CookerImage& image, TextureUsage usage, const std::string& outputFileName)
+{
+    if (image.width == 0 || image.height == 0 || image.rgba.size() != static_cast<size_t>(image.width) * image.height * 4)
+    {
+        throw std::runtime_error("Bad image for " + outputFileName);
+    }
+
+    CookResult result;
+    result.format = CookedFormat(usage, image);
+    bool blockCompressed = (BlockBytes(result.format) > 0);
+
+    LinearImage linear = ToLinear(image, usage);
+    CookerImage top = image;
+    if (blockCompressed && (image.width % 4 != 0 || image.height % 4 != 0))
+    {
+        linear = Resize(linear, (image.width + 3) & ~3u, (image.height + 3) & ~3u);
+        top = FromLinear(linear, usage);
+    }
+    result.width = linear.width;
+    result.height = linear.height;
+
+    // Lookups are sampled at exact coordinates, so have no mips
+    result.numMips = 1;
+    if (usage != TextureUsage::Lookup)
+    {
+        while ((std::max(result.width, result.height) >> result.numMips) > 0)  ++result.numMips;
+    }
+
+    std::vector<uint8_t> data;
+    CookerImage decoded;
+    EncodeImage(top, result.format, data, decoded);
+    result.psnr = PSNR(top, decoded, result.format);
+    uint32_t topLevelBytes = static_cast<uint32_t>(data.size());
+
+    for (uint32_t mip = 1; mip < result.numMips; ++mip)
+    {
+        linear = HalveImage(linear, usage == TextureUsage::NormalMap);
+        EncodeImage(FromLinear(linear, usage), result.format, data, decoded);
+    }
+
+    WriteDDS(outputFileName, result.format, result.width, result.height, result.numMips, topLevelBytes, data);
+    result.bytes = 4 + sizeof(DDSHeader) + sizeof(DDSHeaderDX10) + data.size();
+    return result;
+}
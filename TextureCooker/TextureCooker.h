@@ -0,0 +1,76 @@
+//--------------------------------------------------------------------------------------
+// Offline conversion of images to block compressed DDS files with mip maps
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+// Used by the TextureCooker tool (CookTextures.cpp), which cooks the textures listed in
+// CookTextures.txt before each build so the app loads ready-made DDS files instead of decoding
+// images and generating mips on every launch.
+//
+// Mips are filtered in linear space: colour channels are converted from sRGB before averaging
+// and back after, so mips don't darken. Normal maps are filtered as vectors and renormalised.
+// The format depends on the usage of the texture:
+//   Colour           BC1, or BC7 if any texel is not fully opaque (decals and sprites)
+//   DiffuseSpecular  BC3, the specular level in alpha gets its own channel
+//   NormalMap        BC5 (x and y only, shaders rebuild z), or BC7 if there is a height in alpha
+//   Lookup           Uncompressed with no mips (e.g. cell shading ramps, where block artefacts show)
+// Block compressed textures must be a multiple of 4 texels across, others are resized to fit.
+//
+// The encoders are simple: colours are fitted along the main axis of each block's colours and
+// refined once. BC7 uses only mode 6 (one pair of RGBA endpoints per block). The quality of each
+// texture is reported as the PSNR of its top level.
+//
+// Has no DirectX or Windows dependency, formats are given as DXGI_FORMAT values.
+
+#ifndef _TEXTURE_COOKER_H_INCLUDED_
+#define _TEXTURE_COOKER_H_INCLUDED_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+enum class TextureUsage
+{
+    Colour,
+    DiffuseSpecular,
+    NormalMap,
+    Lookup,
+};
+
+// Usage from its name in CookTextures.txt (case sensitive, as written above). Returns false if not recognised
+bool ParseTextureUsage(const std::string& name, TextureUsage& usage);
+
+
+// An image as 8-bit RGBA, rows top to bottom with no padding
+struct CookerImage
+{
+    uint32_t             width = 0;
+    uint32_t             height = 0;
+    std::vector<uint8_t> rgba;
+};
+
+// Read the top level of an uncompressed 32-bit DDS file (e.g. a normal map saved without compression)
+// Will throw a std::runtime_error exception on failure
+CookerImage ReadUncompressedDDS(const std::string& fileName);
+
+
+// What was written for a texture
+struct CookResult
+{
+    uint32_t format;  // DXGI_FORMAT
+    uint32_t width;   // Top level, after any resize
+    uint32_t height;
+    uint32_t numMips;
+    uint64_t bytes;   // Size of the file written
+    double   psnr;    // Of the top level against the image given, in dB. Infinite if there was no loss
+};
+
+// DXGI_FORMAT a texture will be cooked to
+uint32_t CookedFormat(TextureUsage usage, const CookerImage& image);
+
+// Build the mip chain, compress it and write a DDS file. The work is spread over threads with ParallelFor
+// Will throw a std::runtime_error exception on failure
+CookResult CookTexture(const CookerImage& image, TextureUsage usage, const std::string& outputFileName);
+
+
+#endif //_TEXTURE_COOKER_H_INCLUDED_
@@ -1,4 +1,5 @@
 #include "Common.hlsli"
+#include "Lighting.hlsli"
 
 Texture2D DiffuseSpecularMap1 : register(t0);
 Texture2D DiffuseSpecularMap2 : register(t1);
@@ -21,32 +22,8 @@ input.worldNormal = normalize(input.worldNormal);
 // Direction from pixel to camera
 float3 cameraDirection = normalize(gCameraPosition - input.worldPosition);
 
-//Light 1
-// Direction and distance from pixel to light
-float3 light1Direction = normalize(gLight1Position - input.worldPosition);
-float3 light1Dist = length(gLight1Position - input.worldPosition);
-
-float3 diffuseLight1 = gLight1Colour * max(dot(input.worldNormal, light1Direction), 0) / light1Dist;
-float3 halfway = normalize(light1Direction + cameraDirection);
-float3 specularLight1 = diffuseLight1 * pow(max(dot(input.worldNormal, halfway), 0), gSpecularPower); // Multiplying by diffuseLight instead of light colour - my own personal preference
-
-//Light 2
-float3 light2Vector = gLight2Position - input.worldPosition;
-float  light2Distance = length(light2Vector);
-float3 light2Direction = light2Vector / light2Distance;
-float3 diffuseLight2 = 0;
-float3 specularLight2 = 0;
-if (dot(gLight2Facing, -light2Direction) > gLight2CosHalfAngle)
-{
-	diffuseLight2 = gLight2Colour * max(dot(input.worldNormal, light2Direction), 0) / light2Distance;
-	halfway = normalize(light2Direction + cameraDirection);
-	specularLight2 = diffuseLight2 * pow(max(dot(input.worldNormal, halfway), 0), gSpecularPower);
-}
-
-
-// Sum the effect of the lights - add the ambient at this stage rather than for each light
-float3 diffuseLight = gAmbientColour + diffuseLight1 + diffuseLight2;
-float3 specularLight = specularLight1 + specularLight2;
+float3 diffuseLight, specularLight;
+CalculateLighting(input.worldPosition, input.worldNormal, cameraDirection, diffuseLight, specularLight);
 
 
 // Sample diffuse material and specular material colour for this pixel from a texture
@@ -0,0 +1,372 @@
+//--------------------------------------------------------------------------------------
+// Streaming of texture mip levels within a memory budget
+//--------------------------------------------------------------------------------------
+
+#include "TextureStreamer.h"
+#include "DDSFile.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+
+//--------------------------------------------------------------------------------------
+// Streamable images
+//--------------------------------------------------------------------------------------
+
+// Find the format and mips of a DDS file. Returns false if the file can't be read or isn't streamable
+bool ReadStreamableDDS(const std::string& fileName, StreamedImage& image)
+{
+    try
+    {
+        DDSFile file(fileName);
+        if (file.ArraySize() != 1 || file.NumberMips() < 2)  return false;
+
+        StreamedImage result;
+        result.fileName = fileName;
+        result.format = file.Format();
+        result.blockCompressed = file.IsBlockCompressed();
+        for (auto& subresource : file.Subresources())
+        {
+            result.mips.push_back({ subresource.fileOffset, subresource.size, subresource.rowPitch,
+                                    subresource.width, subresource.height });
+        }
+        image = std::move(result);
+        return true;
+    }
+    catch (std::runtime_error&)
+    {
+        return false; // Not a DDS file that can be used at all, loading it whole will report the error
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Simulated device
+//--------------------------------------------------------------------------------------
+
+bool SimulatedStreamingDevice::ReadMip(const StreamedImage& image, unsigned int mip, MipData& data)
+{
+    data = MipData(); // Nothing is uploaded, so there is no need for the data
+    ++mReads;
+    mBytesRead += image.mips[mip].size;
+    return true;
+}
+
+bool SimulatedStreamingDevice::SetResidentMips(Texture*, const StreamedImage&, unsigned int, unsigned int,
+                                               const std::vector<MipData>&)
+{
+    ++mTexturesCreated;
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Streamer
+//--------------------------------------------------------------------------------------
+
+TextureStreamer::TextureStreamer(StreamingDevice* device, const StreamingSettings& settings)
+    : mDevice(device), mSettings(settings)
+{
+    if (mSettings.backgroundThread)  mThread = std::thread(&TextureStreamer::StreamMips, this);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    if (mThread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mWakeThread.notify_one();
+        mThread.join();
+    }
+}
+
+
+// Start streaming a texture, loading its base mips now. Returns false on failure
+bool TextureStreamer::Add(Texture* texture, const StreamedImage& image)
+{
+    if (IsStreamed(texture) || image.mips.empty())  return false;
+
+    StreamedTexture streamed;
+    streamed.texture = texture;
+    streamed.residentMip = static_cast<unsigned int>(image.mips.size()); // Nothing yet, Restart loads the base mips
+    mTextures.push_back(streamed);
+    mTextureIndexes[texture] = static_cast<unsigned int>(mTextures.size() - 1);
+
+    if (!Restart(texture, image))
+    {
+        mTextureIndexes.erase(texture);
+        mTextures.pop_back();
+        return false;
+    }
+    return true;
+}
+
+
+// Whether a texture has been added
+bool TextureStreamer::IsStreamed(Texture* texture)
+{
+    return mTextureIndexes.count(texture) > 0;
+}
+
+
+// Start a texture again from its base mips with a new image. Returns false on failure
+bool TextureStreamer::Restart(Texture* texture, const StreamedImage& image)
+{
+    auto found = mTextureIndexes.find(texture);
+    if (found == mTextureIndexes.end() || image.mips.empty())  return false;
+    auto& streamed = mTextures[found->second];
+
+    // Base mips are the ones baseSize across and smaller. Block compressed textures must be a multiple of 4 texels
+    // across at their most detailed mip, so may need to keep a larger base
+    unsigned int numMips = static_cast<unsigned int>(image.mips.size());
+    unsigned int baseMip = 0;
+    while (baseMip < numMips - 1 && std::max(image.mips[baseMip].width, image.mips[baseMip].height) > mSettings.baseSize)  ++baseMip;
+    if (image.blockCompressed)
+    {
+        while (baseMip > 0 && (image.mips[baseMip].width % 4 != 0 || image.mips[baseMip].height % 4 != 0))  --baseMip;
+    }
+
+    std::vector<MipData> baseMips(numMips - baseMip);
+    for (unsigned int mip = baseMip; mip < numMips; ++mip)
+    {
+        if (!mDevice->ReadMip(image, mip, baseMips[mip - baseMip]))  return false;
+    }
+
+    // The old texture is replaced entirely, there is nothing to copy from it
+    if (!mDevice->SetResidentMips(texture, image, baseMip, numMips, baseMips))  return false;
+
+    streamed.image = image;
+    streamed.baseMip = baseMip;
+    streamed.residentMip = baseMip;
+    streamed.wantedMip = baseMip;
+    streamed.reading = false;
+    ++streamed.generation;
+    UpdateStats();
+    return true;
+}
+
+
+// Once per frame: choose the mips wanted, give the GPU the mips read and drop and request mips within the budget
+void TextureStreamer::Update(const std::vector<TextureUse>& uses, const CVector3& cameraPosition, const CFrustum& frustum,
+                             float screenScale)
+{
+    ++mFrame;
+
+    // The mip wanted for a use is the one with about as many texels across as pixels the object covers. The distance
+    // is to the nearest point of the bounding sphere so detail arrives before the camera gets close
+    for (auto& streamed : mTextures)
+    {
+        streamed.wantedMip = streamed.baseMip;
+        streamed.screenSize = 0;
+    }
+    for (auto& use : uses)
+    {
+        auto found = mTextureIndexes.find(use.texture);
+        if (found == mTextureIndexes.end() || !frustum.IsSphereVisible(use.centre, use.radius))  continue;
+        auto& streamed = mTextures[found->second];
+
+        float distance = std::max(Length(use.centre - cameraPosition) - use.radius, use.radius * 0.01f);
+        float pixels = 2 * use.radius * screenScale / distance;
+        float texels = pixels * mSettings.texelsPerPixel;
+        float mipsBelowTop = std::log2(std::max(streamed.image.mips[0].width, streamed.image.mips[0].height) / std::max(texels, 1.0f));
+        unsigned int mip = static_cast<unsigned int>(std::min(std::max(mipsBelowTop, 0.0f), static_cast<float>(streamed.baseMip)));
+
+        streamed.wantedMip = std::min(streamed.wantedMip, mip);
+        streamed.screenSize = std::max(streamed.screenSize, pixels);
+        streamed.lastUsedFrame = mFrame;
+    }
+
+    // Give the GPU the mips read since the last update, up to the upload limit. The rest wait for the next update
+    size_t uploaded = 0;
+    if (mSettings.backgroundThread)
+    {
+        std::vector<MipRead> finished;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            finished.swap(mFinished);
+        }
+        std::vector<MipRead> waiting;
+        for (auto& read : finished)
+        {
+            size_t size = read.image.mips[read.mip].size;
+            if (uploaded > 0 && uploaded + size > mSettings.uploadBytesPerFrame)
+            {
+                waiting.push_back(std::move(read));
+                continue;
+            }
+            uploaded += size;
+            ApplyRead(read);
+        }
+        if (!waiting.empty())
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mFinished.insert(mFinished.begin(), std::make_move_iterator(waiting.begin()), std::make_move_iterator(waiting.end()));
+        }
+    }
+
+    // Request the next mip of textures short of their wanted mip, the ones furthest short and then the largest on
+    // screen first. Room is made in the budget when the mip is requested and kept until it arrives
+    std::vector<unsigned int> requests;
+    for (unsigned int i = 0; i < mTextures.size(); ++i)
+    {
+        if (mTextures[i].wantedMip < mTextures[i].residentMip && !mTextures[i].reading)  requests.push_back(i);
+    }
+    std::sort(requests.begin(), requests.end(), [&](unsigned int a, unsigned int b)
+    {
+        unsigned int shortA = mTextures[a].residentMip - mTextures[a].wantedMip;
+        unsigned int shortB = mTextures[b].residentMip - mTextures[b].wantedMip;
+        if (shortA != shortB)  return shortA > shortB;
+        return mTextures[a].screenSize > mTextures[b].screenSize;
+    });
+
+    std::vector<MipRead> newReads;
+    for (auto index : requests)
+    {
+        auto& streamed = mTextures[index];
+        unsigned int mip = streamed.residentMip - 1;
+        size_t size = streamed.image.mips[mip].size;
+        if (!mSettings.backgroundThread && uploaded > 0 && uploaded + size > mSettings.uploadBytesPerFrame)  break;
+        if (!MakeRoom(size, index))  continue;
+
+        MipRead read;
+        read.index = index;
+        read.generation = streamed.generation;
+        read.mip = mip;
+        read.image = streamed.image;
+        streamed.reading = true;
+        mReservedBytes += size;
+
+        if (mSettings.backgroundThread)
+        {
+            newReads.push_back(std::move(read));
+        }
+        else
+        {
+            read.succeeded = mDevice->ReadMip(read.image, read.mip, read.data);
+            uploaded += size;
+            ApplyRead(read);
+        }
+    }
+    if (!newReads.empty())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mRequested.insert(mRequested.end(), std::make_move_iterator(newReads.begin()), std::make_move_iterator(newReads.end()));
+        }
+        mWakeThread.notify_one();
+    }
+
+    UpdateStats();
+}
+
+
+// The textures added and their images
+std::vector<Texture*> TextureStreamer::Textures()
+{
+    std::vector<Texture*> textures;
+    for (auto& streamed : mTextures)  textures.push_back(streamed.texture);
+    return textures;
+}
+
+const StreamedImage& TextureStreamer::Image(Texture* texture)
+{
+    return mTextures[mTextureIndexes.at(texture)].image;
+}
+
+
+// Body of the streaming thread, reading mips as they are requested
+void TextureStreamer::StreamMips()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true)
+    {
+        mWakeThread.wait(lock, [&] { return mStop || !mRequested.empty(); });
+        if (mStop)  return;
+
+        MipRead read = std::move(mRequested.front());
+        mRequested.erase(mRequested.begin());
+
+        // Read without holding the lock so more requests can be added meanwhile
+        lock.unlock();
+        read.succeeded = mDevice->ReadMip(read.image, read.mip, read.data);
+        lock.lock();
+        mFinished.push_back(std::move(read));
+    }
+}
+
+
+// Give the GPU a mip that has been read, if it is still wanted
+void TextureStreamer::ApplyRead(MipRead& read)
+{
+    mReservedBytes -= read.image.mips[read.mip].size;
+
+    // Ignore reads for an image since restarted, or that no longer follow on from the resident mips because mips
+    // were dropped meanwhile
+    auto& streamed = mTextures[read.index];
+    if (read.generation != streamed.generation)  return;
+    streamed.reading = false;
+    if (!read.succeeded || read.mip + 1 != streamed.residentMip)  return;
+
+    std::vector<MipData> newMips(1);
+    newMips[0] = std::move(read.data);
+    if (!mDevice->SetResidentMips(streamed.texture, streamed.image, read.mip, streamed.residentMip, newMips))  return;
+    streamed.residentMip = read.mip;
+    mStats.residentBytes += streamed.image.mips[read.mip].size;
+    ++mStats.mipsLoaded;
+}
+
+
+// Drop mips that are not wanted, least recently used first, until the given bytes fit in the budget
+bool TextureStreamer::MakeRoom(size_t bytes, unsigned int keep)
+{
+    while (mStats.residentBytes + mReservedBytes + bytes > mSettings.budget)
+    {
+        // Only mips more detailed than wanted can go. Textures not used this frame want only their base mips
+        unsigned int victim = static_cast<unsigned int>(mTextures.size());
+        for (unsigned int i = 0; i < mTextures.size(); ++i)
+        {
+            auto& streamed = mTextures[i];
+            if (i == keep || streamed.residentMip >= streamed.wantedMip)  continue;
+            if (victim == mTextures.size() || streamed.lastUsedFrame < mTextures[victim].lastUsedFrame)  victim = i;
+        }
+        if (victim == mTextures.size())  return false;
+
+        auto& streamed = mTextures[victim];
+        if (!mDevice->SetResidentMips(streamed.texture, streamed.image, streamed.residentMip + 1, streamed.residentMip, {}))
+        {
+            return false;
+        }
+        mStats.residentBytes -= streamed.image.mips[streamed.residentMip].size;
+        ++streamed.residentMip;
+        ++mStats.mipsDropped;
+    }
+    return true;
+}
+
+
+// Bytes of an image's mips from the given mip on
+size_t TextureStreamer::MipBytes(const StreamedImage& image, unsigned int firstMip)
+{
+    size_t bytes = 0;
+    for (unsigned int mip = firstMip; mip < image.mips.size(); ++mip)  bytes += image.mips[mip].size;
+    return bytes;
+}
+
+
+void TextureStreamer::UpdateStats()
+{
+    mStats.numTextures = static_cast<unsigned int>(mTextures.size());
+    mStats.residentBytes = 0;
+    mStats.wantedBytes = 0;
+    mStats.residentWantedBytes = 0;
+    for (auto& streamed : mTextures)
+    {
+        mStats.residentBytes += MipBytes(streamed.image, streamed.residentMip);
+        mStats.wantedBytes += MipBytes(streamed.image, streamed.wantedMip);
+        mStats.residentWantedBytes += MipBytes(streamed.image, std::max(streamed.residentMip, streamed.wantedMip));
+    }
+}
@@ -0,0 +1,249 @@
+//--------------------------------------------------------------------------------------
+// Streaming of texture mip levels within a memory budget
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+// DDS textures with a mip chain are not loaded whole. When one is added only its smallest mips
+// (baseSize across and below) are loaded, so it can be used straight away. Each frame the size
+// on screen of the objects using a texture decides the most detailed mip worth having. Missing
+// mips are read from the file on a background thread one level at a time, and the texture is
+// replaced on the GPU by one with the extra level. The streamed mips are kept within a byte
+// budget: when a new level doesn't fit, levels more detailed than currently wanted are dropped,
+// from the least recently used texture first. Base mips count against the budget but are never
+// dropped.
+//
+// All the file and GPU work goes through a StreamingDevice, so the streamer runs without DirectX
+// against a fake device. SimulatedStreamingDevice only keeps count, and is used to replay a
+// recorded camera path and report how much of the wanted detail was resident along it.
+
+#ifndef _TEXTURE_STREAMER_H_INCLUDED_
+#define _TEXTURE_STREAMER_H_INCLUDED_
+
+#include "CVector3.h"
+#include "CFrustum.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+
+class Texture; // Textures are only used to identify what is streamed, the streamer never touches them
+
+
+//--------------------------------------------------------------------------------------
+// Streamable images
+//--------------------------------------------------------------------------------------
+
+// A mip level of a streamed image and where its data is in the file
+struct StreamedMip
+{
+    uint64_t fileOffset;
+    uint32_t size;     // Bytes
+    uint32_t rowPitch; // Bytes from one row of pixels to the next, or one row of 4x4 blocks for compressed formats
+    uint32_t width;
+    uint32_t height;
+};
+
+// An image whose mips can be streamed from a file
+struct StreamedImage
+{
+    std::string              fileName;
+    uint32_t                 format = 0; // DXGI_FORMAT of the texture to create
+    bool                     blockCompressed = false;
+    std::vector<StreamedMip> mips;       // Most detailed first
+};
+
+// Find the format and mips of a DDS file (see DDSFile). Returns false if the file can't be read or isn't streamable:
+// only single 2D textures with more than one mip are streamed, arrays, cube maps and anything else are loaded whole
+// as before
+bool ReadStreamableDDS(const std::string& fileName, StreamedImage& image);
+
+
+//--------------------------------------------------------------------------------------
+// Devices
+//--------------------------------------------------------------------------------------
+
+// Data of a mip that has been read. It may point into a memory mapped file rather than be a copy, owner keeps
+// whatever holds it alive until the mip has been given to the GPU
+struct MipData
+{
+    std::shared_ptr<const void> owner;
+    const void*                 data = nullptr;
+    size_t                      size = 0;
+};
+
+// Everything the streamer needs from files and the GPU, so it can be run against a fake device
+class StreamingDevice
+{
+public:
+    virtual ~StreamingDevice() = default;
+
+    // Read a mip level of an image from its file. Called on the streaming thread. Returns false on failure
+    virtual bool ReadMip(const StreamedImage& image, unsigned int mip, MipData& data) = 0;
+
+    // Give a texture a GPU texture holding mips firstMip onwards of its image, replacing the one holding mips
+    // oldFirstMip onwards (oldFirstMip is the number of mips if there is none). Mips in both are copied from the old
+    // texture, newMips holds the data for the rest in order from firstMip, and is empty when mips are dropped.
+    // Called on the main thread. Returns false and keeps the old texture on failure
+    virtual bool SetResidentMips(Texture* texture, const StreamedImage& image, unsigned int firstMip,
+                                 unsigned int oldFirstMip, const std::vector<MipData>& newMips) = 0;
+};
+
+
+// Fake device that reads and creates nothing, only counting what it is asked to do
+class SimulatedStreamingDevice : public StreamingDevice
+{
+public:
+    bool ReadMip(const StreamedImage& image, unsigned int mip, MipData& data) override;
+    bool SetResidentMips(Texture* texture, const StreamedImage& image, unsigned int firstMip,
+                         unsigned int oldFirstMip, const std::vector<MipData>& newMips) override;
+
+    unsigned int NumberReads()          { return mReads; }
+    size_t       BytesRead()            { return mBytesRead; }
+    unsigned int NumberTexturesCreated() { return mTexturesCreated; }
+
+private:
+    unsigned int mReads = 0;
+    size_t       mBytesRead = 0;
+    unsigned int mTexturesCreated = 0;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Streamer
+//--------------------------------------------------------------------------------------
+
+struct StreamingSettings
+{
+    size_t       budget = 4 * 1024 * 1024;           // Most bytes of mips kept on the GPU
+    unsigned int baseSize = 64;                      // Mips this wide or smaller are loaded when added and never dropped
+    size_t       uploadBytesPerFrame = 1024 * 1024;  // Most mip data given to the GPU each frame, to spread the cost
+    float        texelsPerPixel = 1.0f;              // Detail wanted: texture texels across per pixel the object covers
+    bool         backgroundThread = true;            // If false mips are read during Update, so results depend only on
+                                                     // the camera and not on timing (used for replays)
+};
+
+// An object using a texture, with its bounding sphere in world space
+struct TextureUse
+{
+    Texture* texture;
+    CVector3 centre;
+    float    radius;
+};
+
+// Statistics. The totals count since the streamer was created, the rest are for the last update
+struct StreamingStats
+{
+    unsigned int numTextures = 0;
+    size_t       residentBytes = 0;       // All mips on the GPU
+    size_t       wantedBytes = 0;         // Size of every texture at its wanted mip
+    size_t       residentWantedBytes = 0; // Part of the above that is on the GPU
+    unsigned int mipsLoaded = 0;
+    unsigned int mipsDropped = 0;
+
+    // Fraction of the wanted detail that is resident, 1 if everything wanted is on the GPU
+    float Residency() const  { return wantedBytes > 0 ? static_cast<float>(residentWantedBytes) / wantedBytes : 1.0f; }
+};
+
+
+class TextureStreamer
+{
+public:
+    // The device must outlive the streamer
+    TextureStreamer(StreamingDevice* device, const StreamingSettings& settings);
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // Start streaming a texture (see ReadStreamableDDS), loading its base mips now. Returns false on failure
+    bool Add(Texture* texture, const StreamedImage& image);
+
+    // Whether a texture has been added
+    bool IsStreamed(Texture* texture);
+
+    // Start a texture again from its base mips with a new image, e.g. when its file has changed. Mips being read for
+    // the old image are thrown away. Returns false on failure, then the old mips stay in use
+    bool Restart(Texture* texture, const StreamedImage& image);
+
+    // Once per frame: choose the mips wanted from the objects using each texture that are inside the camera's
+    // frustum, give the GPU the mips read since the last update, and drop and request mips to move towards the
+    // wanted mips within the budget. screenScale converts size over distance to pixels: the viewport width over
+    // 2 * tan(FOVx / 2). Textures with no use this frame want only their base mips
+    void Update(const std::vector<TextureUse>& uses, const CVector3& cameraPosition, const CFrustum& frustum,
+                float screenScale);
+
+    // The textures added and their images, e.g. to add the same textures to another streamer
+    std::vector<Texture*> Textures();
+    const StreamedImage& Image(Texture* texture);
+
+    const StreamingSettings& Settings()  { return mSettings; }
+    const StreamingStats&    Stats()     { return mStats; }
+
+
+private:
+    // A texture being streamed
+    struct StreamedTexture
+    {
+        Texture*      texture;
+        StreamedImage image;
+        unsigned int  baseMip;            // Mips from here on are always resident
+        unsigned int  residentMip;        // Most detailed mip on the GPU
+        unsigned int  wantedMip;          // Most detailed mip wanted this frame
+        float         screenSize = 0;     // Largest use this frame in pixels, to load for the biggest uses first
+        unsigned int  lastUsedFrame = 0;  // Last frame it was used, textures used longest ago lose their mips first
+        bool          reading = false;    // A mip is being read
+        unsigned int  generation = 0;     // Counts restarts, so reads for an old image are ignored
+    };
+
+    // A mip to read, and the data once read
+    struct MipRead
+    {
+        unsigned int  index;      // Into mTextures
+        unsigned int  generation;
+        unsigned int  mip;
+        StreamedImage image;      // Copied so the streaming thread never reads mTextures
+        MipData       data;
+        bool          succeeded = false;
+    };
+
+    // Body of the streaming thread, reading mips as they are requested
+    void StreamMips();
+
+    // Give the GPU a mip that has been read, if it is still wanted and there is room
+    void ApplyRead(MipRead& read);
+
+    // Drop mips that are not wanted, least recently used first, until the given bytes fit in the budget. The
+    // texture at index keep is left alone. Returns false if there isn't enough that can be dropped
+    bool MakeRoom(size_t bytes, unsigned int keep);
+
+    // Bytes of an image's mips from the given mip on
+    static size_t MipBytes(const StreamedImage& image, unsigned int firstMip);
+
+    void UpdateStats();
+
+
+    StreamingDevice*  mDevice;
+    StreamingSettings mSettings;
+    StreamingStats    mStats;
+    unsigned int      mFrame = 0;
+    size_t            mReservedBytes = 0; // Budget kept for the mips being read
+
+    std::vector<StreamedTexture>              mTextures;
+    std::unordered_map<Texture*, unsigned int> mTextureIndexes;
+
+    // Reads requested and finished, shared with the streaming thread
+    std::thread             mThread;
+    std::mutex              mMutex;
+    std::condition_variable mWakeThread;
+    bool                    mStop = false;
+    std::vector<MipRead>    mRequested;
+    std::vector<MipRead>    mFinished;
+};
+
+
+#endif //_TEXTURE_STREAMER_H_INCLUDED_
@@ -0,0 +1,151 @@
+//--------------------------------------------------------------------------------------
+// Watches a folder for files being changed
+//--------------------------------------------------------------------------------------
+
+#include "FileWatcher.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+
+// Start watching a folder
+FileWatcher::FileWatcher(const std::string& folder)
+{
+#ifdef _WIN32
+    // Overlapped so the thread can wait for a change or the stop event, whichever comes first
+    mFolder = CreateFileA(folder.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                          nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (mFolder == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("Error watching folder " + folder);
+    }
+    mStopEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    if (mStopEvent == nullptr)
+    {
+        CloseHandle(mFolder);
+        throw std::runtime_error("Error watching folder " + folder);
+    }
+#else
+    mInotify = inotify_init1(IN_NONBLOCK);
+    if (mInotify < 0 || inotify_add_watch(mInotify, folder.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        if (mInotify >= 0)  close(mInotify);
+        throw std::runtime_error("Error watching folder " + folder);
+    }
+#endif
+
+    mThread = std::thread(&FileWatcher::Watch, this);
+}
+
+
+FileWatcher::~FileWatcher()
+{
+    mStop = true;
+#ifdef _WIN32
+    SetEvent(mStopEvent);
+#endif
+    mThread.join();
+
+#ifdef _WIN32
+    CloseHandle(mStopEvent);
+    CloseHandle(mFolder);
+#else
+    close(mInotify);
+#endif
+}
+
+
+// Names of the files changed since the last call, relative to the folder
+std::vector<std::string> FileWatcher::TakeChanges()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::vector<std::string> changes;
+    changes.swap(mChanges);
+    return changes;
+}
+
+
+// Add a changed file name to the list, called from the watching thread
+void FileWatcher::AddChange(const std::string& fileName)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (std::find(mChanges.begin(), mChanges.end(), fileName) == mChanges.end())  mChanges.push_back(fileName);
+}
+
+
+// Body of the watching thread
+void FileWatcher::Watch()
+{
+#ifdef _WIN32
+    // Notifications are DWORD aligned records of variable length
+    alignas(DWORD) char buffer[16384];
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    HANDLE waitFor[2] = { overlapped.hEvent, mStopEvent };
+
+    while (!mStop)
+    {
+        ResetEvent(overlapped.hEvent);
+        if (!ReadDirectoryChangesW(mFolder, buffer, sizeof(buffer), FALSE,
+                                   FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, nullptr, &overlapped, nullptr))
+        {
+            break;
+        }
+
+        DWORD bytes = 0;
+        if (WaitForMultipleObjects(2, waitFor, FALSE, INFINITE) != WAIT_OBJECT_0 ||
+            !GetOverlappedResult(mFolder, &overlapped, &bytes, FALSE))
+        {
+            CancelIoEx(mFolder, &overlapped);
+            GetOverlappedResult(mFolder, &overlapped, &bytes, TRUE); // The buffer is in use until the read completes
+            break;
+        }
+        if (bytes == 0)  continue; // Too many changes for the buffer, they are lost
+
+        auto info = reinterpret_cast<FILE_NOTIFY_INFORMATION*>(buffer);
+        while (true)
+        {
+            if (info->Action != FILE_ACTION_REMOVED && info->Action != FILE_ACTION_RENAMED_OLD_NAME)
+            {
+                int length = static_cast<int>(info->FileNameLength / sizeof(WCHAR));
+                int size = WideCharToMultiByte(CP_UTF8, 0, info->FileName, length, nullptr, 0, nullptr, nullptr);
+                std::string fileName(size, '\0');
+                WideCharToMultiByte(CP_UTF8, 0, info->FileName, length, &fileName[0], size, nullptr, nullptr);
+                AddChange(fileName);
+            }
+            if (info->NextEntryOffset == 0)  break;
+            info = reinterpret_cast<FILE_NOTIFY_INFORMATION*>(reinterpret_cast<char*>(info) + info->NextEntryOffset);
+        }
+    }
+    CloseHandle(overlapped.hEvent);
+
+#else
+    // Events are variable length, the buffer must be aligned for the first
+    alignas(inotify_event) char buffer[16384];
+    pollfd waitFor = { mInotify, POLLIN, 0 };
+    while (!mStop)
+    {
+        // Wake regularly to check for the stop flag
+        if (poll(&waitFor, 1, 100) <= 0)  continue;
+
+        ssize_t bytes;
+        while ((bytes = read(mInotify, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* event = buffer; event < buffer + bytes; )
+            {
+                auto info = reinterpret_cast<inotify_event*>(event);
+                if (info->len > 0)  AddChange(info->name);
+                event += sizeof(inotify_event) + info->len;
+            }
+        }
+    }
+#endif
+}
@@ -0,0 +1,57 @@
+//--------------------------------------------------------------------------------------
+// Watches a folder for files being changed
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+// A background thread waits on the OS for changes (ReadDirectoryChangesW on Windows, inotify on
+// Linux) and collects the names of the files written, created or renamed into the folder. The
+// owner takes the collected names whenever it is ready, e.g. once per frame. Sub-folders are not
+// watched.
+
+#ifndef _FILE_WATCHER_H_INCLUDED_
+#define _FILE_WATCHER_H_INCLUDED_
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+
+class FileWatcher
+{
+public:
+    // Start watching a folder
+    // Will throw a std::runtime_error exception on failure (since constructors can't return errors)
+    FileWatcher(const std::string& folder);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Names of the files changed since the last call, relative to the folder. A file written several times is
+    // listed once
+    std::vector<std::string> TakeChanges();
+
+
+private:
+    // Body of the watching thread
+    void Watch();
+
+    // Add a changed file name to the list, called from the watching thread
+    void AddChange(const std::string& fileName);
+
+    std::thread              mThread;
+    std::atomic<bool>        mStop{ false };
+    std::mutex               mMutex;   // Protects mChanges
+    std::vector<std::string> mChanges;
+
+#ifdef _WIN32
+    void* mFolder    = nullptr; // Windows handles, kept as void* so this header doesn't need Windows.h
+    void* mStopEvent = nullptr;
+#else
+    int   mInotify = -1;
+#endif
+};
+
+
+#endif //_FILE_WATCHER_H_INCLUDED_
@@ -4,6 +4,9 @@
 
 #include "GraphicsHelpers.h"
 #include "../Shader.h"
+#include "../DDSFile.h"
+#include <vector>
+#include <stdexcept>
 #include <cmath>
 #include <cctype>
 #include <atlbase.h> // C-string to unicode conversion function CA2CT
@@ -12,6 +15,72 @@
 // Texture Loading
 //--------------------------------------------------------------------------------------
 
+// Create a texture from a DDS file. The initial data of each subresource points straight into the memory mapped
+// file, so the driver reads the file in place rather than from a copy of it. Returns false on failure
+bool LoadDDSTexture(const std::string& filename, ID3D11Resource** texture, ID3D11ShaderResourceView** textureSRV)
+{
+    try
+    {
+        DDSFile file(filename);
+
+        std::vector<D3D11_SUBRESOURCE_DATA> initialData;
+        for (auto& subresource : file.Subresources())
+        {
+            initialData.push_back({ subresource.data, subresource.rowPitch, subresource.size });
+        }
+
+        D3D11_TEXTURE2D_DESC textureDesc = {};
+        textureDesc.Width = file.Width();
+        textureDesc.Height = file.Height();
+        textureDesc.MipLevels = file.NumberMips();
+        textureDesc.ArraySize = file.ArraySize();
+        textureDesc.Format = static_cast<DXGI_FORMAT>(file.Format());
+        textureDesc.SampleDesc.Count = 1;
+        textureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+        textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        textureDesc.MiscFlags = file.IsCubeMap() ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+        ID3D11Texture2D* newTexture = nullptr;
+        if (FAILED(gD3DDevice->CreateTexture2D(&textureDesc, initialData.data(), &newTexture)))  return false;
+
+        D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+        srvDesc.Format = textureDesc.Format;
+        if (file.IsCubeMap() && file.ArraySize() == 6)
+        {
+            srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+            srvDesc.TextureCube.MipLevels = textureDesc.MipLevels;
+        }
+        else if (file.IsCubeMap())
+        {
+            srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
+            srvDesc.TextureCubeArray.MipLevels = textureDesc.MipLevels;
+            srvDesc.TextureCubeArray.NumCubes = textureDesc.ArraySize / 6;
+        }
+        else if (file.ArraySize() > 1)
+        {
+            srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+            srvDesc.Texture2DArray.MipLevels = textureDesc.MipLevels;
+            srvDesc.Texture2DArray.ArraySize = textureDesc.ArraySize;
+        }
+        else
+        {
+            srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+            srvDesc.Texture2D.MipLevels = textureDesc.MipLevels;
+        }
+        if (FAILED(gD3DDevice->CreateShaderResourceView(newTexture, &srvDesc, textureSRV)))
+        {
+            newTexture->Release();
+            return false;
+        }
+        *texture = newTexture;
+        return true;
+    }
+    catch (std::runtime_error&)
+    {
+        return false; // Missing, unsupported or damaged file
+    }
+}
+
+
 // Using Microsoft's open source DirectX Tool Kit (DirectXTK) to simplify texture loading
 // This function requires you to pass a ID3D11Resource* (e.g. &gTilesDiffuseMap), which manages the GPU memory for the
 // texture and also a ID3D11ShaderResourceView* (e.g. &gTilesDiffuseMapSRV), which allows us to use the texture in shaders
@@ -23,7 +92,7 @@ bool LoadTexture(std::string filename, ID3D11Resource** texture, ID3D11ShaderRes
     if (filename.size() >= 4 &&
         std::equal(dds.rbegin(), dds.rend(), filename.rbegin(), [](unsigned char a, unsigned char b) { return std::tolower(a) == std::tolower(b); }))
     {
-        return SUCCEEDED(DirectX::CreateDDSTextureFromFile(gD3DDevice, CA2CT(filename.c_str()), texture, textureSRV));
+        return LoadDDSTexture(filename, texture, textureSRV);
     }
     else
     {
@@ -7,7 +7,6 @@
 #define _SCENE_HELPERS_H_INCLUDED_
 
 #include <WICTextureLoader.h>
-#include <DDSTextureLoader.h>
 
 #include "CMatrix4x4.h"
 #include "../Common.h"
@@ -34,12 +33,16 @@ void UpdateConstantBuffer(ID3D11Buffer* buffer, const T& bufferData)
 // Texture Loading
 //--------------------------------------------------------------------------------------
 
-// Using Microsoft's open source DirectX Tool Kit (DirectXTK) to simplify file loading
+// Using Microsoft's open source DirectX Tool Kit (DirectXTK) to simplify file loading, except for DDS files, which are
+// read in place from a memory mapping (see DDSFile and LoadDDSTexture)
 // This function requires you to pass a ID3D11Resource* (e.g. &gTilesDiffuseMap), which manages the GPU memory for the
 // texture and also a ID3D11ShaderResourceView* (e.g. &gTilesDiffuseMapSRV), which allows us to use the texture in shaders
 // The function will fill in these pointers with usable data. Returns false on failure
 bool LoadTexture(std::string filename, ID3D11Resource** texture, ID3D11ShaderResourceView** textureSRV);
 
+// Create a texture from a DDS file: 2D textures, texture arrays and cube maps. Returns false on failure
+bool LoadDDSTexture(const std::string& filename, ID3D11Resource** texture, ID3D11ShaderResourceView** textureSRV);
+
 
 //--------------------------------------------------------------------------------------
 // Camera helpers
@@ -0,0 +1,26 @@
+//--------------------------------------------------------------------------------------
+// Hashing of raw bytes
+//--------------------------------------------------------------------------------------
+// Used to spot changes in scene data (e.g. objects moving) by comparing a hash with the
+// one from the previous frame. Not suitable for anything security related.
+
+#ifndef _HASH_H_INCLUDED_
+#define _HASH_H_INCLUDED_
+
+#include <cstdint>
+#include <cstddef>
+
+// Starting value for a new hash
+const uint64_t HASH_START = 14695981039346656037ull;
+
+// Add some bytes to a 64-bit FNV-1a hash, returns the updated hash. Start with HASH_START and chain calls to
+// hash several values
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash = HASH_START)
+{
+    auto bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)  hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+
+#endif //_HASH_H_INCLUDED_
@@ -0,0 +1,390 @@
+//--------------------------------------------------------------------------------------
+// Job system - small pieces of work spread over a pool of worker threads
+//--------------------------------------------------------------------------------------
+
+#include "JobSystem.h"
+
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+
+
+// Jobs each thread can have queued at once. A thread adding a job to a full deque runs it straight away instead
+const int64_t JOB_DEQUE_CAPACITY = 4096;
+
+// Times an idle worker looks for a job again (yielding in between) before going to sleep
+const unsigned int JOB_IDLE_SPINS = 64;
+
+
+struct Job
+{
+    std::function<void()> function;
+    JobCounter*            counter;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Work stealing deque
+//--------------------------------------------------------------------------------------
+namespace
+{
+    // Fixed size Chase-Lev deque. The owning thread pushes and pops at the bottom, other threads steal from the top.
+    // Memory orders as given by Le, Pop, Cohen and Nardelli, "Correct and Efficient Work-Stealing for Weak Memory Models"
+    class WorkStealingDeque
+    {
+    public:
+        // Owner only. Returns false if the deque is full
+        bool Push(Job* job)
+        {
+            int64_t bottom = mBottom.load(std::memory_order_relaxed);
+            int64_t top = mTop.load(std::memory_order_acquire);
+            if (bottom - top >= JOB_DEQUE_CAPACITY)  return false;
+
+            mJobs[bottom & (JOB_DEQUE_CAPACITY - 1)].store(job, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            mBottom.store(bottom + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // Owner only. Takes the newest job, returns nullptr if empty
+        Job* Pop()
+        {
+            int64_t bottom = mBottom.load(std::memory_order_relaxed) - 1;
+            mBottom.store(bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t top = mTop.load(std::memory_order_relaxed);
+            if (top > bottom)
+            {
+                mBottom.store(bottom + 1, std::memory_order_relaxed); // Was empty
+                return nullptr;
+            }
+
+            Job* job = mJobs[bottom & (JOB_DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+            if (top == bottom)
+            {
+                // Last job, race any thieves for it
+                if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))  job = nullptr;
+                mBottom.store(bottom + 1, std::memory_order_relaxed);
+            }
+            return job;
+        }
+
+        // Any thread. Takes the oldest job, returns nullptr if empty or another thread took it first
+        Job* Steal()
+        {
+            int64_t top = mTop.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t bottom = mBottom.load(std::memory_order_acquire);
+            if (top >= bottom)  return nullptr;
+
+            Job* job = mJobs[top & (JOB_DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+            if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))  return nullptr;
+            return job;
+        }
+
+    private:
+        // Top and bottom on separate cache lines, as thieves write one and the owner the other
+        std::atomic<int64_t> mTop{ 0 };
+        char                 mPadding[64];
+        std::atomic<int64_t> mBottom{ 0 };
+        std::atomic<Job*>    mJobs[JOB_DEQUE_CAPACITY];
+    };
+
+
+    // Index of the current thread's deque in the pool, -1 for threads without one
+    thread_local int tThreadIndex = -1;
+
+    // State for choosing which thread to steal from, a different sequence on each thread (xorshift)
+    thread_local uint32_t tStealRandom = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Thread pool
+//--------------------------------------------------------------------------------------
+
+class JobPool
+{
+public:
+    // The calling thread takes the first deque, the workers the rest
+    JobPool()
+    {
+        unsigned int numWorkers = std::max(1u, std::thread::hardware_concurrency()) - 1;
+        for (unsigned int i = 0; i < numWorkers + 1; ++i)  mDeques.emplace_back(new WorkStealingDeque);
+        mActiveThreads = numWorkers + 1;
+
+        tThreadIndex = 0;
+        for (unsigned int i = 0; i < numWorkers; ++i)
+        {
+            mWorkers.emplace_back([this, i]() { WorkerLoop(i + 1); });
+        }
+    }
+
+    ~JobPool()
+    {
+        mQuit = true;
+        Wake(true);
+        for (auto& worker : mWorkers)  worker.join();
+    }
+
+    unsigned int NumThreads()  { return static_cast<unsigned int>(mDeques.size()); }
+
+    unsigned int ActiveThreads()  { return mActiveThreads; }
+    void SetActiveThreads(unsigned int numThreads)
+    {
+        mActiveThreads = std::min(std::max(numThreads, 1u), NumThreads());
+        Wake(true);
+    }
+
+
+    // Count a new job and start it, or leave it with its dependency if that isn't done
+    void Add(std::function<void()> function, JobCounter* counter, JobCounter* dependency)
+    {
+        Job* job = new Job{ std::move(function), counter };
+        if (counter != nullptr)  counter->mCount.fetch_add(1, std::memory_order_relaxed);
+
+        if (dependency != nullptr)
+        {
+            std::lock_guard<std::mutex> lock(dependency->mMutex);
+            if (dependency->mCount.load(std::memory_order_acquire) != 0)
+            {
+                dependency->mWaitingJobs.push_back(job);
+                return;
+            }
+        }
+        Schedule(job);
+    }
+
+    // Run jobs until the counter reaches zero
+    void Wait(JobCounter& counter)
+    {
+        while (counter.mCount.load(std::memory_order_acquire) != 0)
+        {
+            Job* job = FindJob(tThreadIndex);
+            if (job != nullptr)  Execute(job);
+            else                 std::this_thread::yield();
+        }
+
+        // The last job takes the counter's lock as the count reaches zero, so once the lock is free here that job has
+        // finished with the counter and it can be destroyed
+        std::lock_guard<std::mutex> lock(counter.mMutex);
+    }
+
+
+private:
+    // Put a job that is ready to run on this thread's deque, or the shared queue for threads without one
+    void Schedule(Job* job)
+    {
+        int index = tThreadIndex;
+        if (index >= 0)
+        {
+            if (!mDeques[index]->Push(job))
+            {
+                Execute(job); // Deque full, run the job now rather than wait for space
+                return;
+            }
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(mSharedMutex);
+            mSharedJobs.push_back(job);
+            mNumSharedJobs.fetch_add(1, std::memory_order_release);
+        }
+        Wake(false);
+    }
+
+    // Run a job then count it as done, starting the jobs that depended on its counter if it was the last one
+    void Execute(Job* job)
+    {
+        job->function();
+        JobCounter* counter = job->counter;
+        delete job;
+        if (counter == nullptr)  return;
+
+        // Most jobs aren't the last of their counter and just decrement it
+        unsigned int count = counter->mCount.load(std::memory_order_relaxed);
+        while (count > 1)
+        {
+            if (counter->mCount.compare_exchange_weak(count, count - 1, std::memory_order_acq_rel, std::memory_order_relaxed))  return;
+        }
+
+        // Possibly the last, reach zero under the lock (see Wait) and take the waiting jobs
+        std::vector<Job*> readyJobs;
+        {
+            std::lock_guard<std::mutex> lock(counter->mMutex);
+            if (counter->mCount.fetch_sub(1, std::memory_order_acq_rel) == 1)  readyJobs.swap(counter->mWaitingJobs);
+        }
+        for (auto readyJob : readyJobs)  Schedule(readyJob);
+    }
+
+    // Take a job from this thread's deque, or the shared queue, or steal one from another thread
+    Job* FindJob(int index)
+    {
+        if (index >= 0)
+        {
+            Job* job = mDeques[index]->Pop();
+            if (job != nullptr)  return job;
+        }
+
+        if (mNumSharedJobs.load(std::memory_order_acquire) > 0)
+        {
+            std::lock_guard<std::mutex> lock(mSharedMutex);
+            if (!mSharedJobs.empty())
+            {
+                Job* job = mSharedJobs.front();
+                mSharedJobs.pop_front();
+                mNumSharedJobs.fetch_sub(1, std::memory_order_relaxed);
+                return job;
+            }
+        }
+
+        // Start from a random thread so thieves spread over the victims
+        if (tStealRandom == 0)  tStealRandom = 2654435761u * (index + 2);
+        tStealRandom ^= tStealRandom << 13;
+        tStealRandom ^= tStealRandom >> 17;
+        tStealRandom ^= tStealRandom << 5;
+        unsigned int numDeques = NumThreads();
+        unsigned int first = tStealRandom % numDeques;
+        for (unsigned int i = 0; i < numDeques; ++i)
+        {
+            unsigned int victim = (first + i) % numDeques;
+            if (static_cast<int>(victim) == index)  continue;
+            Job* job = mDeques[victim]->Steal();
+            if (job != nullptr)  return job;
+        }
+        return nullptr;
+    }
+
+    // Wake sleeping workers after adding work. The generation changes first, so a worker that looked for work before
+    // it was added sees the change as it goes to sleep and looks again
+    void Wake(bool allWorkers)
+    {
+        mWakeGeneration.fetch_add(1);
+        if (mNumSleeping.load() == 0)  return;
+
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        if (allWorkers || mActiveThreads < NumThreads())  mWakeUp.notify_all(); // Any worker woken might be inactive
+        else                                              mWakeUp.notify_one();
+    }
+
+    void WorkerLoop(unsigned int index)
+    {
+        tThreadIndex = static_cast<int>(index);
+        unsigned int idleSpins = 0;
+        while (!mQuit)
+        {
+            unsigned int generation = mWakeGeneration.load();
+            if (index < mActiveThreads)
+            {
+                Job* job = FindJob(tThreadIndex);
+                if (job != nullptr)
+                {
+                    Execute(job);
+                    idleSpins = 0;
+                    continue;
+                }
+                if (++idleSpins < JOB_IDLE_SPINS)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+            }
+
+            std::unique_lock<std::mutex> lock(mSleepMutex);
+            ++mNumSleeping;
+            mWakeUp.wait(lock, [&]() { return mQuit || mWakeGeneration.load() != generation; });
+            --mNumSleeping;
+            idleSpins = 0;
+        }
+    }
+
+
+    std::vector<std::unique_ptr<WorkStealingDeque>> mDeques; // One for each thread, the first for the thread creating the pool
+    std::vector<std::thread>                        mWorkers;
+    std::atomic<unsigned int>                       mActiveThreads{ 1 };
+
+    // Jobs added by threads without a deque
+    std::mutex                mSharedMutex;
+    std::deque<Job*>          mSharedJobs;
+    std::atomic<unsigned int> mNumSharedJobs{ 0 };
+
+    // Idle workers sleep until the generation changes
+    std::mutex                mSleepMutex;
+    std::condition_variable   mWakeUp;
+    std::atomic<unsigned int> mWakeGeneration{ 0 };
+    std::atomic<unsigned int> mNumSleeping{ 0 };
+    std::atomic<bool>         mQuit{ false };
+};
+
+namespace
+{
+    JobPool& Pool()
+    {
+        static JobPool pool; // Created on first use
+        return pool;
+    }
+
+    // Run the batches of a range, splitting off the upper half as a new job while there is more than one batch so
+    // other threads can steal it
+    void RunRange(const std::shared_ptr<std::function<void(unsigned int, unsigned int)>>& function, unsigned int start,
+                  unsigned int end, unsigned int batchSize, JobCounter* counter)
+    {
+        while (end - start > batchSize)
+        {
+            unsigned int numBatches = (end - start + batchSize - 1) / batchSize;
+            unsigned int middle = start + numBatches / 2 * batchSize;
+            Pool().Add([=]() { RunRange(function, middle, end, batchSize, counter); }, counter, nullptr);
+            end = middle;
+        }
+        (*function)(start, end);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Jobs
+//--------------------------------------------------------------------------------------
+
+// Add a job to run the given function, counted by the counter and started when the dependency reaches zero
+void RunJob(std::function<void()> function, JobCounter* counter /*= nullptr*/, JobCounter* dependency /*= nullptr*/)
+{
+    Pool().Add(std::move(function), counter, dependency);
+}
+
+// Add jobs to run a loop over the range 0 -> count-1 split into batches
+void ParallelJobs(unsigned int count, unsigned int batchSize, std::function<void(unsigned int start, unsigned int end)> function,
+                  JobCounter& counter, JobCounter* dependency /*= nullptr*/)
+{
+    if (count == 0)  return;
+    if (batchSize == 0)  batchSize = 1;
+    auto sharedFunction = std::make_shared<std::function<void(unsigned int, unsigned int)>>(std::move(function));
+    JobCounter* counterPointer = &counter;
+    Pool().Add([=]() { RunRange(sharedFunction, 0, count, batchSize, counterPointer); }, counterPointer, dependency);
+}
+
+// Wait until the counter reaches zero, running other jobs while waiting
+void WaitForJobs(JobCounter& counter)
+{
+    Pool().Wait(counter);
+}
+
+
+// Number of threads that run jobs, including the thread that first used the jobs
+unsigned int JobThreads()
+{
+    return Pool().NumThreads();
+}
+
+// Limit the number of threads running jobs
+void SetActiveJobThreads(unsigned int numThreads)
+{
+    Pool().SetActiveThreads(numThreads);
+}
+
+unsigned int ActiveJobThreads()
+{
+    return Pool().ActiveThreads();
+}
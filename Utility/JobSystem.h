@@ -0,0 +1,68 @@
+//--------------------------------------------------------------------------------------
+// Job system - small pieces of work spread over a pool of worker threads
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+// A job is a function to run on any thread. Each thread keeps the jobs it adds in its own
+// deque (Chase-Lev work stealing), taking the newest from one end while idle threads steal
+// the oldest from the other end, so threads rarely contend and stolen jobs tend to be large.
+// The worker threads are created on first use and live until the app exits. The thread that
+// first uses the jobs (normally the main thread) also has a deque. Other threads can add jobs
+// and wait for them too, through a shared queue.
+//
+// Jobs are counted by a JobCounter, which reaches zero once all its jobs are done. A job can
+// depend on a counter so it only starts once the counter reaches zero. A thread waiting for a
+// counter runs other jobs meanwhile, so jobs can add jobs and wait for them without deadlock.
+
+#ifndef _JOB_SYSTEM_H_INCLUDED_
+#define _JOB_SYSTEM_H_INCLUDED_
+
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+
+struct Job;
+class JobPool;
+
+// Counts unfinished jobs. Jobs added with a counter are counted from when they are added, even if they are waiting on
+// a dependency. Wait for a counter with WaitForJobs before it is destroyed
+class JobCounter
+{
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+private:
+    friend class JobPool;
+    std::atomic<unsigned int> mCount{ 0 };
+    std::mutex                mMutex;       // Held while the count reaches zero and while jobs are added to the list below
+    std::vector<Job*>         mWaitingJobs; // Jobs that depend on this counter, started when it reaches zero
+};
+
+
+// Add a job to run the given function. If a counter is given it counts the job until it is done. If a dependency is
+// given the job doesn't start until that counter reaches zero (it starts at once if the counter is already zero)
+void RunJob(std::function<void()> function, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+// Add jobs to run a loop over the range 0 -> count-1 split into batches of (at most) batchSize items. The function is
+// called with the start and end (exclusive) of each batch. The range is split in half as threads steal it, so a few
+// jobs cover any number of batches. The counter counts the jobs, wait on it to know the whole loop is done
+void ParallelJobs(unsigned int count, unsigned int batchSize, std::function<void(unsigned int start, unsigned int end)> function,
+                  JobCounter& counter, JobCounter* dependency = nullptr);
+
+// Wait until the counter reaches zero, running other jobs while waiting
+void WaitForJobs(JobCounter& counter);
+
+
+// Number of threads that run jobs, including the thread that first used the jobs
+unsigned int JobThreads();
+
+// Limit the number of threads running jobs, e.g. to measure how work scales. The thread that first used the jobs and
+// any thread waiting for jobs always runs them. Pass JobThreads() to use them all again
+void SetActiveJobThreads(unsigned int numThreads);
+unsigned int ActiveJobThreads();
+
+
+#endif //_JOB_SYSTEM_H_INCLUDED_
@@ -0,0 +1,89 @@
+//--------------------------------------------------------------------------------------
+// Read-only memory mapped file
+//--------------------------------------------------------------------------------------
+
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+// Map a whole file into memory, read-only
+MappedFile::MappedFile(const std::string& fileName)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("Error opening " + fileName);
+    }
+    mFile = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        throw std::runtime_error("Error reading size of " + fileName);
+    }
+    mSize = static_cast<size_t>(size.QuadPart);
+
+    mMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mMapping == nullptr)
+    {
+        CloseHandle(file);
+        throw std::runtime_error("Error mapping " + fileName);
+    }
+
+    mData = MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+    if (mData == nullptr)
+    {
+        CloseHandle(mMapping);
+        CloseHandle(file);
+        throw std::runtime_error("Error mapping " + fileName);
+    }
+#else
+    int file = open(fileName.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        throw std::runtime_error("Error opening " + fileName);
+    }
+
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size == 0)
+    {
+        close(file);
+        throw std::runtime_error("Error reading size of " + fileName);
+    }
+    mSize = static_cast<size_t>(status.st_size);
+
+    // The mapping keeps the file alive, so it can be closed straight away
+    void* data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED)
+    {
+        throw std::runtime_error("Error mapping " + fileName);
+    }
+    mData = data;
+#endif
+}
+
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    if (mData)     UnmapViewOfFile(mData);
+    if (mMapping)  CloseHandle(mMapping);
+    if (mFile)     CloseHandle(mFile);
+#else
+    if (mData)     munmap(mData, mSize);
+#endif
+}
@@ -0,0 +1,41 @@
+//--------------------------------------------------------------------------------------
+// Read-only memory mapped file
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+// The whole file appears in memory without being read or copied up front, pages are loaded by
+// the OS as they are first touched. The contents stay valid until the object is destroyed.
+
+#ifndef _MAPPED_FILE_H_INCLUDED_
+#define _MAPPED_FILE_H_INCLUDED_
+
+#include <string>
+#include <cstddef>
+
+
+class MappedFile
+{
+public:
+    // Map a whole file into memory, read-only
+    // Will throw a std::runtime_error exception on failure (since constructors can't return errors)
+    MappedFile(const std::string& fileName);
+    ~MappedFile();
+
+    // Mappings can't be shared
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const void* Data()  { return mData; }
+    size_t      Size()  { return mSize; }
+
+
+private:
+#ifdef _WIN32
+    void*  mFile    = nullptr; // Windows handles, kept as void* so this header doesn't need Windows.h
+    void*  mMapping = nullptr;
+#endif
+    void*  mData    = nullptr;
+    size_t mSize    = 0;
+};
+
+
+#endif //_MAPPED_FILE_H_INCLUDED_
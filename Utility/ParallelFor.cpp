@@ -0,0 +1,34 @@
+//--------------------------------------------------------------------------------------
+// Simple parallel loop over a pool of worker threads
+//--------------------------------------------------------------------------------------
+
+#include "ParallelFor.h"
+#include "JobSystem.h"
+
+
+//--------------------------------------------------------------------------------------
+// Parallel loop
+//--------------------------------------------------------------------------------------
+
+// Run a loop over the range 0 -> count-1 split into batches, as jobs that the calling thread helps with
+void ParallelFor(unsigned int count, unsigned int batchSize, const std::function<void(unsigned int start, unsigned int end)>& function)
+{
+    if (count == 0)  return;
+    if (batchSize == 0)  batchSize = 1;
+    if (count <= batchSize)
+    {
+        function(0, count);
+        return;
+    }
+
+    // The loop is finished before returning, so the jobs can refer to the function rather than copy it
+    JobCounter loopDone;
+    ParallelJobs(count, batchSize, [&function](unsigned int start, unsigned int end) { function(start, end); }, loopDone);
+    WaitForJobs(loopDone);
+}
+
+// Number of threads that share the work in ParallelFor, including the calling thread
+unsigned int ParallelForThreads()
+{
+    return JobThreads();
+}
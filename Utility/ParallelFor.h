@@ -0,0 +1,24 @@
+//--------------------------------------------------------------------------------------
+// Simple parallel loop over a pool of worker threads
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+// Runs on the job system (see JobSystem.h). The calling thread joins in with the work, so a
+// loop always makes progress even with no workers, and loops can run inside jobs or other loops.
+
+#ifndef _PARALLEL_FOR_H_INCLUDED_
+#define _PARALLEL_FOR_H_INCLUDED_
+
+#include <functional>
+
+
+// Run a loop over the range 0 -> count-1 split into batches of (at most) batchSize items. The function is called
+// with the start and end (exclusive) of each batch, on several threads at once. Returns when all batches are done.
+// Small loops (a single batch) run directly on the calling thread. Several loops can run at once, from different threads
+// or nested inside each other, sharing the worker threads
+void ParallelFor(unsigned int count, unsigned int batchSize, const std::function<void(unsigned int start, unsigned int end)>& function);
+
+// Number of threads that share the work in ParallelFor, including the calling thread
+unsigned int ParallelForThreads();
+
+
+#endif //_PARALLEL_FOR_H_INCLUDED_
@@ -0,0 +1,57 @@
+//--------------------------------------------------------------------------------------
+// Radix sort of 32-bit keys, e.g. depths for drawing back to front
+//--------------------------------------------------------------------------------------
+
+#include "RadixSort.h"
+
+
+// Bits of the key placed by each pass, three passes cover the 32-bit keys
+const unsigned int RADIX_BITS = 11;
+const unsigned int RADIX_SIZE = 1 << RADIX_BITS;
+const unsigned int RADIX_PASSES = 3;
+
+
+// Sort the first count keys in ascending order, moving their values with them
+void RadixSort(std::vector<uint32_t>& keys, std::vector<uint32_t>& values,
+               std::vector<uint32_t>& tempKeys, std::vector<uint32_t>& tempValues, unsigned int count)
+{
+    if (count < 2)  return;
+
+    // Count the digits for every pass in one read of the keys
+    std::vector<uint32_t> counts(RADIX_PASSES * RADIX_SIZE, 0);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        uint32_t key = keys[i];
+        for (unsigned int pass = 0; pass < RADIX_PASSES; ++pass)  ++counts[pass * RADIX_SIZE + ((key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1))];
+    }
+
+    for (unsigned int pass = 0; pass < RADIX_PASSES; ++pass)
+    {
+        // Skip a pass where every key has the same digit, it would change nothing
+        uint32_t* passCounts = &counts[pass * RADIX_SIZE];
+        unsigned int shift = pass * RADIX_BITS;
+        if (passCounts[(keys[0] >> shift) & (RADIX_SIZE - 1)] == count)  continue;
+
+        // Counts become the position of the first key with each digit
+        uint32_t offset = 0;
+        for (unsigned int digit = 0; digit < RADIX_SIZE; ++digit)
+        {
+            uint32_t digitCount = passCounts[digit];
+            passCounts[digit] = offset;
+            offset += digitCount;
+        }
+
+        const uint32_t* inKeys = keys.data();
+        const uint32_t* inValues = values.data();
+        uint32_t* outKeys = tempKeys.data();
+        uint32_t* outValues = tempValues.data();
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            uint32_t destination = passCounts[(inKeys[i] >> shift) & (RADIX_SIZE - 1)]++;
+            outKeys[destination] = inKeys[i];
+            outValues[destination] = inValues[i];
+        }
+        keys.swap(tempKeys);
+        values.swap(tempValues);
+    }
+}
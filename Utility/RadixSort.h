@@ -0,0 +1,38 @@
+//--------------------------------------------------------------------------------------
+// Radix sort of 32-bit keys, e.g. depths for drawing back to front
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+// A least significant digit radix sort: each pass moves the keys into buckets by one digit,
+// keeping the order from the previous pass, so after the last pass they are fully sorted.
+// Three passes of 11 bits cover 32-bit keys, and a pass is skipped when every key has the
+// same digit, which is common for the top digits of keys that are close together. The cost
+// is linear in the number of keys. Each key carries a 32-bit value, e.g. an index.
+
+#ifndef _RADIX_SORT_H_INCLUDED_
+#define _RADIX_SORT_H_INCLUDED_
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+
+// Sort the first count keys in ascending order, moving their values with them. The temporary arrays are used for
+// alternate passes and must be at least count long. The vectors may be swapped with their temporary arrays, so the
+// sorted result is always in keys and values
+void RadixSort(std::vector<uint32_t>& keys, std::vector<uint32_t>& values,
+               std::vector<uint32_t>& tempKeys, std::vector<uint32_t>& tempValues, unsigned int count);
+
+
+// Key that sorts floats from largest to smallest, e.g. depths from furthest to nearest for drawing back to front.
+// The sign bit of a positive float is flipped and all the bits of a negative one, which makes them sort as unsigned
+// integers, then all the bits are inverted to reverse the order
+inline uint32_t DescendingFloatKey(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t flip = (bits & 0x80000000u) ? ~0u : 0x80000000u;
+    return ~(bits ^ flip);
+}
+
+
+#endif //_RADIX_SORT_H_INCLUDED_
@@ -0,0 +1,87 @@
+//--------------------------------------------------------------------------------------
+// Packing rectangles into a larger one, e.g. images into a texture atlas
+//--------------------------------------------------------------------------------------
+
+#include "RectPacker.h"
+
+#include <algorithm>
+
+
+RectPacker::RectPacker(uint32_t width, uint32_t height) : mWidth(width), mHeight(height)
+{
+    mSkyline.push_back({ 0, 0, width });
+}
+
+
+// The lowest y a rectangle can be placed at with its left edge on the given segment, or false if it doesn't fit
+bool RectPacker::Fit(size_t segment, uint32_t width, uint32_t height, uint32_t& y)
+{
+    uint32_t x = mSkyline[segment].x;
+    if (x + width > mWidth)  return false;
+
+    // The rectangle rests on the highest segment it spans
+    y = 0;
+    uint32_t remaining = width;
+    for (size_t i = segment; remaining > 0; ++i)
+    {
+        y = std::max(y, mSkyline[i].y);
+        remaining -= std::min(remaining, mSkyline[i].width);
+    }
+    return y + height <= mHeight;
+}
+
+
+// Find a place for a rectangle and mark it used. Returns false if there is no room, leaving the packer unchanged
+bool RectPacker::Insert(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y)
+{
+    if (width == 0 || height == 0)  return false;
+
+    // Lowest top edge, then narrowest segment so wide gaps are kept for wide rectangles
+    size_t best = mSkyline.size();
+    uint32_t bestTop = 0, bestWidth = 0, bestY = 0;
+    for (size_t i = 0; i < mSkyline.size(); ++i)
+    {
+        uint32_t fitY;
+        if (!Fit(i, width, height, fitY))  continue;
+        if (best == mSkyline.size() || fitY + height < bestTop || (fitY + height == bestTop && mSkyline[i].width < bestWidth))
+        {
+            best = i;
+            bestTop = fitY + height;
+            bestWidth = mSkyline[i].width;
+            bestY = fitY;
+        }
+    }
+    if (best == mSkyline.size())  return false;
+
+    x = mSkyline[best].x;
+    y = bestY;
+    mUsedArea += static_cast<uint64_t>(width) * height;
+
+    // The new rectangle's top replaces the segments it covers, trimming the last one it partly covers
+    Segment top = { x, bestTop, width };
+    size_t end = best;
+    while (end < mSkyline.size() && mSkyline[end].x + mSkyline[end].width <= x + width)  ++end;
+    if (end < mSkyline.size() && mSkyline[end].x < x + width)
+    {
+        uint32_t cut = x + width - mSkyline[end].x;
+        mSkyline[end].x += cut;
+        mSkyline[end].width -= cut;
+    }
+    mSkyline.erase(mSkyline.begin() + best, mSkyline.begin() + end);
+    mSkyline.insert(mSkyline.begin() + best, top);
+
+    // Join neighbouring segments at the same height
+    for (size_t i = 0; i + 1 < mSkyline.size(); )
+    {
+        if (mSkyline[i].y == mSkyline[i + 1].y)
+        {
+            mSkyline[i].width += mSkyline[i + 1].width;
+            mSkyline.erase(mSkyline.begin() + i + 1);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,51 @@
+//--------------------------------------------------------------------------------------
+// Packing rectangles into a larger one, e.g. images into a texture atlas
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+// A skyline packer: the top edge of the rectangles placed so far is kept as a list of
+// horizontal segments, and each new rectangle goes where its top would be lowest (the
+// narrowest such spot on a tie). Space under an overhang is lost, but for rectangles added
+// tallest first that is little, and each insert only looks along the skyline.
+
+#ifndef _RECT_PACKER_H_INCLUDED_
+#define _RECT_PACKER_H_INCLUDED_
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+class RectPacker
+{
+public:
+    RectPacker(uint32_t width, uint32_t height);
+
+    // Find a place for a rectangle and mark it used. Returns false if there is no room, leaving the packer unchanged
+    bool Insert(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y);
+
+    uint32_t Width()     { return mWidth; }
+    uint32_t Height()    { return mHeight; }
+    uint64_t UsedArea()  { return mUsedArea; } // Total area of the rectangles inserted
+
+
+private:
+    // Part of the skyline: the top of the rectangles below x -> x + width is at y
+    struct Segment
+    {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+    };
+
+    // The lowest y a rectangle can be placed at with its left edge on the given segment, or false if it doesn't fit
+    bool Fit(size_t segment, uint32_t width, uint32_t height, uint32_t& y);
+
+    uint32_t mWidth;
+    uint32_t mHeight;
+    uint64_t mUsedArea = 0;
+
+    std::vector<Segment> mSkyline; // Left to right, covering the full width
+};
+
+
+#endif //_RECT_PACKER_H_INCLUDED_
@@ -0,0 +1,99 @@
+//--------------------------------------------------------------------------------------
+// Weighted blended order independent transparency
+//--------------------------------------------------------------------------------------
+
+#include "WeightedOIT.h"
+#include "Shader.h"
+#include "State.h"
+
+#include <stdexcept>
+
+
+// Accumulation needs the range and precision of floats, as weighted colours sum to large values. Revealage only
+// holds 0 -> 1
+const DXGI_FORMAT OIT_FORMATS[2] = { DXGI_FORMAT_R16G16B16A16_FLOAT, DXGI_FORMAT_R16_FLOAT };
+
+
+// Create the targets and views
+WeightedOIT::WeightedOIT(unsigned int width, unsigned int height)
+{
+    for (unsigned int target = 0; target < 2; ++target)
+    {
+        D3D11_TEXTURE2D_DESC textureDesc = {};
+        textureDesc.Width  = width;
+        textureDesc.Height = height;
+        textureDesc.MipLevels = 1;
+        textureDesc.ArraySize = 1;
+        textureDesc.Format = OIT_FORMATS[target];
+        textureDesc.SampleDesc.Count = 1;
+        textureDesc.SampleDesc.Quality = 0;
+        textureDesc.Usage = D3D11_USAGE_DEFAULT;
+        textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+        textureDesc.CPUAccessFlags = 0;
+        textureDesc.MiscFlags = 0;
+        if (FAILED(gD3DDevice->CreateTexture2D(&textureDesc, nullptr, &mTextures[target])))
+        {
+            throw std::runtime_error("Error creating transparency target");
+        }
+
+        // Views take the texture's format
+        if (FAILED(gD3DDevice->CreateRenderTargetView(mTextures[target], nullptr, &mRenderTargets[target])) ||
+            FAILED(gD3DDevice->CreateShaderResourceView(mTextures[target], nullptr, &mSRVs[target])))
+        {
+            throw std::runtime_error("Error creating transparency target views");
+        }
+    }
+
+    // The composite draws a full screen triangle with no vertex buffer, so needs no input layout
+    PipelineStateDesc desc;
+    desc.vertexShader = gFullScreenVertexShader;
+    desc.pixelShader = gOITCompositePixelShader;
+    desc.blendState = gAlphaBlendingState;
+    desc.rasterizerState = gCullNoneState;
+    desc.depthStencilState = gNoDepthBufferState;
+    desc.samplerState = gPointSampler;
+    mCompositeState = CreatePipelineState(desc);
+}
+
+
+WeightedOIT::~WeightedOIT()
+{
+    for (unsigned int target = 0; target < 2; ++target)
+    {
+        if (mSRVs[target])           mSRVs[target]->Release();
+        if (mRenderTargets[target])  mRenderTargets[target]->Release();
+        if (mTextures[target])       mTextures[target]->Release();
+    }
+}
+
+
+// Clear the targets to nothing drawn: no colour and the background fully revealed
+void WeightedOIT::Begin(ID3D11DepthStencilView* depthStencil)
+{
+    // Unbind the targets from the composite, a texture can't be read and written at once
+    BindObjectTexture(0, nullptr);
+    BindObjectTexture(1, nullptr);
+
+    const float clearAccumulation[4] = { 0, 0, 0, 0 };
+    const float clearRevealage[4]    = { 1, 1, 1, 1 };
+    gD3DContext->ClearRenderTargetView(mRenderTargets[0], clearAccumulation);
+    gD3DContext->ClearRenderTargetView(mRenderTargets[1], clearRevealage);
+    gD3DContext->OMSetRenderTargets(2, mRenderTargets, depthStencil);
+}
+
+
+// Draw a full screen triangle reading the targets
+void WeightedOIT::Composite(ID3D11RenderTargetView* renderTarget, ID3D11DepthStencilView* depthStencil)
+{
+    gD3DContext->OMSetRenderTargets(1, &renderTarget, depthStencil);
+
+    BindPipelineState(mCompositeState);
+    BindObjectTexture(0, mSRVs[0]);
+    BindObjectTexture(1, mSRVs[1]);
+    gD3DContext->IASetInputLayout(nullptr);
+    gD3DContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    gD3DContext->Draw(3, 0);
+
+    // The input layout was set directly, so the pipeline state no longer knows what is bound
+    InvalidatePipelineState();
+}
@@ -0,0 +1,53 @@
+//--------------------------------------------------------------------------------------
+// Weighted blended order independent transparency
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+// Alpha blending gives the right result only when drawing back to front. Weighted blended
+// transparency (McGuire and Bavoil, 2013) instead draws transparent pixels in any order into two
+// targets: the sum of their premultiplied colours and alphas, each scaled by a weight that favours
+// nearer and more opaque pixels, and the product of one minus their alphas (the "revealage", the
+// share of the background still seen). A full screen pass then blends the weighted average colour
+// over the scene with coverage one minus the revealage. Exact for layers of equal colour, and close
+// for a few layers of similar alpha such as smoke, with no sorting.
+//
+// Transparent pixels still test against the scene's depth buffer but don't write it. The layer is
+// composited over the view as it stands, so it always shows in front of sorted transparent objects.
+
+#ifndef _WEIGHTED_OIT_H_INCLUDED_
+#define _WEIGHTED_OIT_H_INCLUDED_
+
+#include "Common.h"
+#include "PipelineState.h"
+
+
+class WeightedOIT
+{
+public:
+    // Create the accumulation and revealage targets, width and height in pixels matching the render target they are
+    // composited over
+    // Will throw a std::runtime_error exception on failure (since constructors can't return errors)
+    WeightedOIT(unsigned int width, unsigned int height);
+    ~WeightedOIT();
+
+    // Prevent copying, the class owns DirectX objects
+    WeightedOIT(const WeightedOIT&) = delete;
+    WeightedOIT& operator=(const WeightedOIT&) = delete;
+
+    // Clear the targets and set them for rendering, testing against the given depth buffer. Draw the transparent
+    // pixels with gOITBlendingState and a pixel shader writing both targets (e.g. ParticleOIT_ps.hlsl)
+    void Begin(ID3D11DepthStencilView* depthStencil);
+
+    // Blend the transparent layer over the render target within the viewport, then set the render target back
+    void Composite(ID3D11RenderTargetView* renderTarget, ID3D11DepthStencilView* depthStencil);
+
+
+private:
+    ID3D11Texture2D*          mTextures[2]      = {}; // Accumulation then revealage
+    ID3D11RenderTargetView*   mRenderTargets[2] = {};
+    ID3D11ShaderResourceView* mSRVs[2]          = {};
+
+    PipelineStateHandle mCompositeState;
+};
+
+
+#endif //_WEIGHTED_OIT_H_INCLUDED_